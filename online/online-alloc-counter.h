@@ -0,0 +1,72 @@
+// online/online-alloc-counter.h
+
+// See ../../COPYING for clarification regarding multiple authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//  http://www.apache.org/licenses/LICENSE-2.0
+//
+// THIS CODE IS PROVIDED *AS IS* BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, EITHER EXPRESS OR IMPLIED, INCLUDING WITHOUT LIMITATION ANY IMPLIED
+// WARRANTIES OR CONDITIONS OF TITLE, FITNESS FOR A PARTICULAR PURPOSE,
+// MERCHANTABLITY OR NON-INFRINGEMENT.
+// See the Apache 2 License for the specific language governing permissions and
+// limitations under the License.
+
+
+#ifndef KALDI_ONLINE_ONLINE_ALLOC_COUNTER_H_
+#define KALDI_ONLINE_ONLINE_ALLOC_COUNTER_H_
+
+#include <atomic>
+#include <cerrno>
+#include <cstdlib>
+#include <new>
+
+#include "base/kaldi-common.h"
+
+// Counts the memory allocations made by a test or benchmark program, to check
+// that the code it runs does not allocate once it is running.  Kaldi's
+// matrices and vectors are allocated with posix_memalign(), and everything
+// else we care about with operator new, so both are replaced here: this header
+// must be included by exactly one source file of the program, and never by the
+// library.  Some tests allocate from two threads, hence the atomic count.
+// The allocations can only be counted with glibc.
+
+#if defined(__GLIBC__)
+static std::atomic<kaldi::int64> g_num_allocs(0);
+
+extern "C" void *__libc_memalign(size_t alignment, size_t size);
+
+extern "C" int posix_memalign(void **memptr, size_t alignment,
+                              size_t size) throw() {
+  g_num_allocs++;
+  *memptr = __libc_memalign(alignment, size);
+  return (*memptr == NULL ? ENOMEM : 0);
+}
+
+void *operator new(size_t size) {
+  g_num_allocs++;
+  void *ptr = malloc(size);
+  if (ptr == NULL) throw std::bad_alloc();
+  return ptr;
+}
+
+void operator delete(void *ptr) throw() { free(ptr); }
+#endif
+
+namespace kaldi {
+
+// The number of allocations made so far, or -1 if they are not counted.
+inline int64 NumAllocsSoFar() {
+#if defined(__GLIBC__)
+  return g_num_allocs;
+#else
+  return -1;
+#endif
+}
+
+} // namespace kaldi
+
+#endif // KALDI_ONLINE_ONLINE_ALLOC_COUNTER_H_
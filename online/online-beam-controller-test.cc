@@ -0,0 +1,131 @@
+// online/online-beam-controller-test.cc
+
+// See ../../COPYING for clarification regarding multiple authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//  http://www.apache.org/licenses/LICENSE-2.0
+//
+// THIS CODE IS PROVIDED *AS IS* BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, EITHER EXPRESS OR IMPLIED, INCLUDING WITHOUT LIMITATION ANY IMPLIED
+// WARRANTIES OR CONDITIONS OF TITLE, FITNESS FOR A PARTICULAR PURPOSE,
+// MERCHANTABLITY OR NON-INFRINGEMENT.
+// See the Apache 2 License for the specific language governing permissions and
+// limitations under the License.
+
+#include "online/online-beam-controller.h"
+
+namespace kaldi {
+
+// A synthetic model of the decoder's speed: the time spent per frame grows
+// quadratically with the beam, plus some noise.
+static double SimulatedElapsed(BaseFloat beam, int32 num_frames,
+                               BaseFloat frame_shift, BaseFloat cost_scale) {
+  double rtf = cost_scale * (beam / 10.0) * (beam / 10.0);
+  rtf *= 1.0 + 0.1 * (RandUniform() - 0.5);
+  return rtf * num_frames * frame_shift;
+}
+
+void TestRtfBeamController() {
+  BaseFloat max_beam = 16.0, frame_shift = 0.01;
+  OnlineRtfBeamController controller(0.7, 0.75, 0.01, 0.05, max_beam,
+                                     frame_shift);
+  // Too slow: the beam has to decrease.
+  BaseFloat beam = 12.0;
+  BaseFloat new_beam = controller.Update(beam, 3 * frame_shift * 2.0, 3, 1000);
+  KALDI_ASSERT(new_beam < beam);
+  // Within [rt_min, rt_max]: no change.
+  new_beam = controller.Update(beam, 3 * frame_shift * 0.72, 3, 1000);
+  KALDI_ASSERT(new_beam == beam);
+  // Too fast: the beam grows, but never beyond the maximum.
+  for (int32 i = 0; i < 1000; i++)
+    beam = controller.Update(beam, 3 * frame_shift * 0.1, 3, 1000);
+  KALDI_ASSERT(beam == max_beam);
+
+  // The same wall-clock time means a lower real-time factor with a longer
+  // frame shift.
+  controller.SetFrameShift(0.03);
+  beam = 12.0;
+  new_beam = controller.Update(beam, 3 * 0.01 * 0.72, 3, 1000);
+  KALDI_ASSERT(new_beam > beam);
+
+  // No time measured at all: the beam grows by the maximum step, unless the
+  // update rate is 0, which keeps it fixed whatever the speed.
+  new_beam = controller.Update(beam, 0.0, 3, 1000);
+  KALDI_ASSERT(ApproxEqual(new_beam, beam * 1.05));
+  OnlineRtfBeamController fixed(0.7, 0.75, 0.0, 0.05, max_beam, frame_shift);
+  KALDI_ASSERT(fixed.Update(beam, 0.0, 3, 1000) == beam);
+  KALDI_ASSERT(fixed.Update(beam, 3 * frame_shift * 0.1, 3, 1000) == beam);
+  KALDI_ASSERT(fixed.Update(beam, 3 * frame_shift * 2.0, 3, 1000) == beam);
+}
+
+void TestPiBeamControllerConverges() {
+  OnlinePiBeamControllerOpts opts;
+  opts.target_rtf = 0.3 + 0.5 * RandUniform();
+  BaseFloat max_beam = 30.0, frame_shift = (Rand() % 2 == 0 ? 0.01 : 0.03);
+  BaseFloat cost_scale = 0.5 + RandUniform();
+  OnlinePiBeamController controller(opts, max_beam, frame_shift);
+
+  BaseFloat beam = max_beam;
+  for (int32 i = 0; i < 500; i++) {
+    double elapsed = SimulatedElapsed(beam, 3, frame_shift, cost_scale);
+    beam = controller.Update(beam, elapsed, 3, 1000);
+    KALDI_ASSERT(beam >= opts.min_beam && beam <= max_beam);
+  }
+  // The beam for which the noise-free simulated RTF equals the target.
+  BaseFloat ideal_beam = 10.0 * std::sqrt(opts.target_rtf / cost_scale);
+  ideal_beam = std::max(opts.min_beam, std::min(max_beam, ideal_beam));
+  KALDI_ASSERT(std::abs(beam - ideal_beam) < 0.1 * ideal_beam);
+
+  controller.Reset();
+  KALDI_ASSERT(controller.SmoothedRtf() < 0.0);
+}
+
+void TestPiBeamControllerTokenBudget() {
+  OnlinePiBeamControllerOpts opts;
+  opts.target_rtf = 1.0;
+  opts.max_tokens = 2000;
+  BaseFloat max_beam = 16.0, frame_shift = 0.01;
+  OnlinePiBeamController controller(opts, max_beam, frame_shift);
+  // We are very fast, but over the token budget: the beam must go down to
+  // the minimum.
+  BaseFloat beam = max_beam;
+  for (int32 i = 0; i < 500; i++) {
+    BaseFloat new_beam = controller.Update(beam, 3 * frame_shift * 0.01, 3,
+                                           2 * opts.max_tokens);
+    KALDI_ASSERT(new_beam <= beam);
+    beam = new_beam;
+  }
+  KALDI_ASSERT(beam == opts.min_beam);
+  // Back within the budget, the beam recovers.
+  for (int32 i = 0; i < 500; i++)
+    beam = controller.Update(beam, 3 * frame_shift * 0.01, 3,
+                             opts.max_tokens / 2);
+  KALDI_ASSERT(beam == max_beam);
+}
+
+void TestPiBeamControllerRateLimit() {
+  OnlinePiBeamControllerOpts opts;
+  opts.kp = 100.0; // absurd gains, so the rate limit is what matters
+  opts.ki = 100.0;
+  BaseFloat max_beam = 16.0, frame_shift = 0.01, beam = 10.0;
+  OnlinePiBeamController controller(opts, max_beam, frame_shift);
+  BaseFloat new_beam = controller.Update(beam, 100.0, 3, 1000);
+  KALDI_ASSERT(std::abs(new_beam - beam / (1.0 + opts.max_beam_update))
+               < 1.0e-04);
+}
+
+}  // end namespace kaldi
+
+int main() {
+  using namespace kaldi;
+  TestRtfBeamController();
+  for (int i = 0; i < 20; i++) {
+    TestPiBeamControllerConverges();
+    TestPiBeamControllerTokenBudget();
+    TestPiBeamControllerRateLimit();
+  }
+  std::cout << "Test OK.\n";
+}
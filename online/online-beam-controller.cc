@@ -0,0 +1,85 @@
+// online/online-beam-controller.cc
+
+// See ../../COPYING for clarification regarding multiple authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//  http://www.apache.org/licenses/LICENSE-2.0
+//
+// THIS CODE IS PROVIDED *AS IS* BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, EITHER EXPRESS OR IMPLIED, INCLUDING WITHOUT LIMITATION ANY IMPLIED
+// WARRANTIES OR CONDITIONS OF TITLE, FITNESS FOR A PARTICULAR PURPOSE,
+// MERCHANTABLITY OR NON-INFRINGEMENT.
+// See the Apache 2 License for the specific language governing permissions and
+// limitations under the License.
+
+#include <algorithm>
+
+#include "online/online-beam-controller.h"
+
+namespace kaldi {
+
+BaseFloat OnlineRtfBeamController::Update(BaseFloat beam, double elapsed,
+                                          int32 num_frames, int32 num_tokens) {
+  KALDI_ASSERT(num_frames > 0);
+  BaseFloat factor = elapsed / (rt_max_ * num_frames * frame_shift_);
+  BaseFloat min_factor = rt_min_ / rt_max_;
+  if (factor > 1 || factor < min_factor) {
+    BaseFloat update_factor;
+    if (factor > 1)
+      update_factor = -std::min(beam_update_ * factor, max_beam_update_);
+    else if (factor > 0)
+      update_factor = std::min(beam_update_ / factor, max_beam_update_);
+    else  // too fast for the clock; 0/0 if beam_update_ is 0
+      update_factor = (beam_update_ > 0 ? max_beam_update_ : 0.0);
+    beam += beam * update_factor;
+    beam = std::min(beam, max_beam_);
+  }
+  return beam;
+}
+
+
+OnlinePiBeamController::OnlinePiBeamController(
+    const OnlinePiBeamControllerOpts &opts, BaseFloat max_beam,
+    BaseFloat frame_shift)
+    : opts_(opts), max_beam_(max_beam), frame_shift_(frame_shift),
+      rtf_(-1.0), prev_error_(0.0) {
+  KALDI_ASSERT(opts.target_rtf > 0.0 && frame_shift > 0.0);
+  KALDI_ASSERT(opts.smoothing > 0.0 && opts.smoothing <= 1.0);
+  KALDI_ASSERT(opts.min_beam > 0.0 && opts.min_beam <= max_beam);
+}
+
+void OnlinePiBeamController::Reset() {
+  rtf_ = -1.0;
+  prev_error_ = 0.0;
+}
+
+BaseFloat OnlinePiBeamController::Update(BaseFloat beam, double elapsed,
+                                         int32 num_frames, int32 num_tokens) {
+  KALDI_ASSERT(num_frames > 0);
+  BaseFloat rtf = elapsed / (num_frames * frame_shift_);
+  if (rtf_ < 0.0)
+    rtf_ = rtf;
+  else
+    rtf_ = opts_.smoothing * rtf + (1.0 - opts_.smoothing) * rtf_;
+
+  // Positive error means we have time to spare, so the beam may grow.
+  BaseFloat error = (opts_.target_rtf - rtf_) / opts_.target_rtf;
+  if (opts_.max_tokens > 0 && num_tokens > opts_.max_tokens) {
+    BaseFloat token_error = static_cast<BaseFloat>(opts_.max_tokens -
+                                                   num_tokens) /
+        opts_.max_tokens;
+    error = std::min(error, token_error);
+  }
+  BaseFloat log_update = opts_.kp * (error - prev_error_) + opts_.ki * error;
+  prev_error_ = error;
+  // Limit the rate of change, in both directions.
+  BaseFloat max_log_update = Log(1.0 + opts_.max_beam_update);
+  log_update = std::max(-max_log_update, std::min(max_log_update, log_update));
+  beam *= Exp(log_update);
+  return std::max(opts_.min_beam, std::min(max_beam_, beam));
+}
+
+} // namespace kaldi
@@ -0,0 +1,144 @@
+// online/online-beam-controller.h
+
+// See ../../COPYING for clarification regarding multiple authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//  http://www.apache.org/licenses/LICENSE-2.0
+//
+// THIS CODE IS PROVIDED *AS IS* BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, EITHER EXPRESS OR IMPLIED, INCLUDING WITHOUT LIMITATION ANY IMPLIED
+// WARRANTIES OR CONDITIONS OF TITLE, FITNESS FOR A PARTICULAR PURPOSE,
+// MERCHANTABLITY OR NON-INFRINGEMENT.
+// See the Apache 2 License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef KALDI_ONLINE_ONLINE_BEAM_CONTROLLER_H_
+#define KALDI_ONLINE_ONLINE_BEAM_CONTROLLER_H_
+
+#include "base/kaldi-common.h"
+#include "itf/options-itf.h"
+
+namespace kaldi {
+
+// Policy used by OnlineFasterDecoder to adapt its beam to the decoding speed.
+class OnlineBeamControllerItf {
+ public:
+  // Called by the decoder every few frames.
+  // "beam" - the beam that was used for the last "num_frames" frames
+  // "elapsed" - the wall-clock time in seconds it took to decode them
+  // "num_tokens" - the number of currently active tokens
+  // Returns the beam to use from now on.
+  virtual BaseFloat Update(BaseFloat beam, double elapsed, int32 num_frames,
+                           int32 num_tokens) = 0;
+
+  // Tells the controller the time in seconds between two frames, as
+  // configured in the feature extraction.
+  virtual void SetFrameShift(BaseFloat frame_shift) = 0;
+
+  // Forgets any state accumulated so far, e.g. at the start of a new stream.
+  virtual void Reset() { }
+
+  virtual ~OnlineBeamControllerItf() { }
+};
+
+
+// The original OnlineFasterDecoder policy: if the real-time factor of the last
+// update interval is out of [rt_min, rt_max], the beam is changed
+// multiplicatively, in proportion to the relative deviation.
+class OnlineRtfBeamController : public OnlineBeamControllerItf {
+ public:
+  OnlineRtfBeamController(BaseFloat rt_min, BaseFloat rt_max,
+                          BaseFloat beam_update, BaseFloat max_beam_update,
+                          BaseFloat max_beam, BaseFloat frame_shift = 0.01):
+      rt_min_(rt_min), rt_max_(rt_max), beam_update_(beam_update),
+      max_beam_update_(max_beam_update), max_beam_(max_beam),
+      frame_shift_(frame_shift) { KALDI_ASSERT(frame_shift > 0.0); }
+
+  virtual BaseFloat Update(BaseFloat beam, double elapsed, int32 num_frames,
+                           int32 num_tokens);
+
+  virtual void SetFrameShift(BaseFloat frame_shift) {
+    KALDI_ASSERT(frame_shift > 0.0);
+    frame_shift_ = frame_shift;
+  }
+
+ private:
+  BaseFloat rt_min_;
+  BaseFloat rt_max_;
+  BaseFloat beam_update_;
+  BaseFloat max_beam_update_;
+  BaseFloat max_beam_;
+  BaseFloat frame_shift_;
+};
+
+
+struct OnlinePiBeamControllerOpts {
+  BaseFloat target_rtf; // the real-time factor we are trying to follow
+  int32 max_tokens; // the budget of active tokens (0 means no budget)
+  BaseFloat kp; // proportional gain
+  BaseFloat ki; // integral gain
+  BaseFloat smoothing; // weight of the newest RTF measurement in the average
+  BaseFloat min_beam;
+  BaseFloat max_beam_update; // maximum relative beam change per update
+
+  OnlinePiBeamControllerOpts(): target_rtf(0.7), max_tokens(0), kp(0.2),
+                                ki(0.05), smoothing(0.3), min_beam(4.0),
+                                max_beam_update(0.1) { }
+
+  void Register(OptionsItf *opts) {
+    opts->Register("target-rtf", &target_rtf,
+                   "Real-time factor the beam controller tries to follow");
+    opts->Register("max-tokens", &max_tokens,
+                   "If > 0, the beam is reduced while more than this many "
+                   "tokens are active");
+    opts->Register("beam-kp", &kp, "Proportional gain of the beam controller");
+    opts->Register("beam-ki", &ki, "Integral gain of the beam controller");
+    opts->Register("rtf-smoothing", &smoothing,
+                   "Weight of the newest real-time factor measurement in the "
+                   "exponentially smoothed one, in (0, 1]");
+    opts->Register("min-beam", &min_beam,
+                   "The beam controller never goes below this beam");
+    opts->Register("max-beam-change", &max_beam_update,
+                   "Maximum relative change of the beam in one update");
+  }
+};
+
+// A proportional-integral controller.  The error signal is the relative
+// distance of the (exponentially smoothed) real-time factor from the target;
+// when a token budget is set, the error is additionally capped by the
+// relative excess of active tokens over the budget, so the beam also shrinks
+// when the search explodes while we are still fast enough.  The controller
+// works in velocity form on the log of the beam, which does not suffer from
+// integral wind-up while the beam is clamped to [min_beam, max_beam].
+class OnlinePiBeamController : public OnlineBeamControllerItf {
+ public:
+  OnlinePiBeamController(const OnlinePiBeamControllerOpts &opts,
+                         BaseFloat max_beam, BaseFloat frame_shift = 0.01);
+
+  virtual BaseFloat Update(BaseFloat beam, double elapsed, int32 num_frames,
+                           int32 num_tokens);
+
+  virtual void SetFrameShift(BaseFloat frame_shift) {
+    KALDI_ASSERT(frame_shift > 0.0);
+    frame_shift_ = frame_shift;
+  }
+
+  virtual void Reset();
+
+  // The smoothed real-time factor, as of the last Update().
+  BaseFloat SmoothedRtf() const { return rtf_; }
+
+ private:
+  const OnlinePiBeamControllerOpts opts_;
+  const BaseFloat max_beam_;
+  BaseFloat frame_shift_;
+  BaseFloat rtf_; // smoothed real-time factor; negative before the first update
+  BaseFloat prev_error_;
+};
+
+} // namespace kaldi
+
+#endif // KALDI_ONLINE_ONLINE_BEAM_CONTROLLER_H_
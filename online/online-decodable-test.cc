@@ -0,0 +1,235 @@
+// online/online-decodable-test.cc
+
+// See ../../COPYING for clarification regarding multiple authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//  http://www.apache.org/licenses/LICENSE-2.0
+//
+// THIS CODE IS PROVIDED *AS IS* BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, EITHER EXPRESS OR IMPLIED, INCLUDING WITHOUT LIMITATION ANY IMPLIED
+// WARRANTIES OR CONDITIONS OF TITLE, FITNESS FOR A PARTICULAR PURPOSE,
+// MERCHANTABLITY OR NON-INFRINGEMENT.
+// See the Apache 2 License for the specific language governing permissions and
+// limitations under the License.
+
+#include <sstream>
+
+#include "gmm/model-test-common.h"
+#include "hmm/hmm-test-utils.h"
+#include "online/online-decodable.h"
+
+namespace kaldi {
+
+// Serves the rows of a matrix as features, "batch_size" at a time.
+class OnlineMatrixInput : public OnlineFeatInputItf {
+ public:
+  OnlineMatrixInput(const Matrix<BaseFloat> &feats):
+      position_(0), feats_(feats) { }
+
+  virtual int32 Dim() const { return feats_.NumCols(); }
+
+  virtual bool Compute(Matrix<BaseFloat> *output) {
+    int32 num_frames = std::min(output->NumRows(),
+                                feats_.NumRows() - position_);
+    if (num_frames == 0) {
+      output->Resize(0, 0);
+      return false;
+    }
+    output->Resize(num_frames, feats_.NumCols());
+    output->CopyFromMat(feats_.Range(position_, num_frames,
+                                     0, feats_.NumCols()));
+    position_ += num_frames;
+    return position_ < feats_.NumRows();
+  }
+
+ private:
+  int32 position_;
+  Matrix<BaseFloat> feats_;
+};
+
+// A random model, with one random GMM per pdf of a random transition model,
+// and its Gaussians stacked for the batched scoring.
+struct TestModel {
+  TestModel(int32 dim, int32 num_comp) {
+    ContextDependency *ctx_dep = NULL;
+    trans_model = GenRandTransitionModel(&ctx_dep);
+    delete ctx_dep;
+    for (int32 pdf_id = 0; pdf_id < trans_model->NumPdfs(); pdf_id++) {
+      DiagGmm gmm;
+      unittest::InitRandDiagGmm(dim, num_comp, &gmm);
+      am_gmm.AddPdf(gmm);
+    }
+    stacked_gmm = new OnlineStackedGmm(am_gmm);
+  }
+  ~TestModel() {
+    delete stacked_gmm;
+    delete trans_model;
+  }
+
+  // One transition-id for each pdf.
+  void GetTransitionIds(std::vector<int32> *tids) const {
+    tids->assign(trans_model->NumPdfs(), 0);
+    for (int32 tid = 1; tid <= trans_model->NumTransitionIds(); tid++)
+      (*tids)[trans_model->TransitionIdToPdf(tid)] = tid;
+  }
+
+  TransitionModel *trans_model;
+  AmDiagGmm am_gmm;
+  OnlineStackedGmm *stacked_gmm;
+};
+
+// Simulates what a decoder asks for: on every frame, the likelihoods of a
+// slowly drifting set of "num_active" pdfs, some of them more than once.
+// Outputs the likelihoods.
+static void RequestLikelihoods(const TestModel &model,
+                               const Matrix<BaseFloat> &feats,
+                               const OnlineDecodableOptions &opts,
+                               int32 num_active, int32 seed,
+                               std::vector<BaseFloat> *loglikes) {
+  std::vector<int32> tids;
+  model.GetTransitionIds(&tids);
+  int32 num_pdfs = tids.size();
+  srand(seed);
+  std::vector<int32> active(num_active);
+  for (int32 i = 0; i < num_active; i++)
+    active[i] = Rand() % num_pdfs;
+
+  OnlineMatrixInput input(feats);
+  OnlineFeatureMatrixOptions feature_opts;
+  OnlineFeatureMatrix feature_matrix(feature_opts, &input);
+  OnlineDecodableDiagGmmScaled decodable(model.am_gmm, *model.trans_model,
+                                         0.1, &feature_matrix, opts, NULL,
+                                         model.stacked_gmm);
+  loglikes->clear();
+  for (int32 frame = 0; frame < feats.NumRows(); frame++) {
+    for (int32 i = 0; i < num_active; i++) {
+      if (Rand() % 10 == 0)
+        active[i] = Rand() % num_pdfs;
+      int32 num_requests = 1 + Rand() % 3;
+      for (int32 j = 0; j < num_requests; j++) {
+        loglikes->push_back(decodable.LogLikelihood(frame, tids[active[i]]));
+      }
+    }
+  }
+}
+
+void TestBatchPdfs() {
+  int32 dim = 5 + Rand() % 20, num_comp = 1 + Rand() % 8;
+  TestModel model(dim, num_comp);
+  int32 num_pdfs = model.trans_model->NumPdfs();
+  Matrix<BaseFloat> feats(20 + Rand() % 50, dim);
+  feats.SetRandn();
+
+  OnlineDecodableOptions plain_opts, batch_opts;
+  batch_opts.batch_pdfs = true;
+  batch_opts.full_eval_ratio = RandUniform();
+  batch_opts.lookahead_frames = 1 + Rand() % 10;
+  int32 num_active = 1 + Rand() % num_pdfs, seed = Rand();
+  std::vector<BaseFloat> plain_loglikes, batch_loglikes;
+  RequestLikelihoods(model, feats, plain_opts, num_active, seed,
+                     &plain_loglikes);
+  RequestLikelihoods(model, feats, batch_opts, num_active, seed,
+                     &batch_loglikes);
+  KALDI_ASSERT(plain_loglikes.size() == batch_loglikes.size());
+  for (size_t i = 0; i < plain_loglikes.size(); i++)
+    KALDI_ASSERT(ApproxEqual(plain_loglikes[i], batch_loglikes[i], 1.0e-03));
+}
+
+// Checks the likelihoods of the stacked Gaussians against the model's own, for
+// single pdfs, for subsets of them, and for all of them in blocks of random
+// size.
+void TestStackedGmm() {
+  int32 dim = 5 + Rand() % 20, num_comp = 1 + Rand() % 8;
+  TestModel model(dim, num_comp);
+  OnlineStackedGmm stacked(model.am_gmm, 1 + Rand() % 20);
+  int32 num_pdfs = stacked.NumPdfs(), num_frames = 1 + Rand() % 5;
+  KALDI_ASSERT(stacked.IsCompatible(model.am_gmm) &&
+               stacked.Dim() == dim && num_pdfs == model.am_gmm.NumPdfs());
+
+  Matrix<BaseFloat> feats(num_frames, dim), data(num_frames, 2 * dim);
+  feats.SetRandn();
+  for (int32 t = 0; t < num_frames; t++) {
+    SubVector<BaseFloat> row(data, t);
+    stacked.ComputeData(feats.Row(t), &row);
+  }
+  std::vector<int32> pdfs;
+  for (int32 pdf_id = 0; pdf_id < num_pdfs; pdf_id++)
+    if (Rand() % 2 == 0)
+      pdfs.push_back(pdf_id);
+  Matrix<BaseFloat> all_loglikes(num_frames, num_pdfs),
+      some_loglikes(num_frames, pdfs.size()), gauss_loglikes;
+  Vector<BaseFloat> pdf_gauss_loglikes;
+  stacked.LogLikelihoods(data, &gauss_loglikes, &all_loglikes);
+  stacked.LogLikelihoods(data, pdfs, &gauss_loglikes, &some_loglikes);
+  for (int32 t = 0; t < num_frames; t++) {
+    for (int32 pdf_id = 0; pdf_id < num_pdfs; pdf_id++) {
+      BaseFloat ref = model.am_gmm.LogLikelihood(pdf_id, feats.Row(t));
+      KALDI_ASSERT(ApproxEqual(all_loglikes(t, pdf_id), ref, 1.0e-03));
+      KALDI_ASSERT(ApproxEqual(stacked.LogLikelihood(data.Row(t), pdf_id,
+                                                     &pdf_gauss_loglikes),
+                               ref, 1.0e-03));
+    }
+    for (size_t i = 0; i < pdfs.size(); i++)
+      KALDI_ASSERT(ApproxEqual(some_loglikes(t, i), all_loglikes(t, pdfs[i]),
+                               1.0e-03));
+  }
+}
+
+// With every Gaussian attached to every UBM component, Gaussian selection
+// must give the same likelihoods as the full evaluation; also checks that the
+// index survives being written and read back.
+void TestGselect() {
+  int32 dim = 5 + Rand() % 20, num_comp = 1 + Rand() % 8,
+      num_ubm = 1 + Rand() % 10;
+  TestModel model(dim, num_comp);
+  DiagGmm ubm;
+  unittest::InitRandDiagGmm(dim, num_ubm, &ubm);
+  OnlineGselectIndex built;
+  built.Build(ubm, model.am_gmm, num_ubm);
+  KALDI_ASSERT(built.IsCompatible(model.am_gmm));
+
+  bool binary = (Rand() % 2 == 0);
+  std::ostringstream os;
+  built.Write(os, binary);
+  OnlineGselectIndex gselect;
+  std::istringstream is(os.str());
+  gselect.Read(is, binary);
+  KALDI_ASSERT(gselect.IsCompatible(model.am_gmm) &&
+               gselect.NumUbmPerGauss() == num_ubm);
+
+  Matrix<BaseFloat> feats(10 + Rand() % 20, dim);
+  feats.SetRandn();
+  OnlineDecodableOptions opts;
+  opts.batch_pdfs = (Rand() % 2 == 0);
+  opts.gselect_num = 1 + Rand() % num_ubm;
+  OnlineMatrixInput full_input(feats), sel_input(feats);
+  OnlineFeatureMatrixOptions feature_opts;
+  OnlineFeatureMatrix full_feats(feature_opts, &full_input),
+      sel_feats(feature_opts, &sel_input);
+  OnlineDecodableDiagGmmScaled full(model.am_gmm, *model.trans_model, 0.1,
+                                    &full_feats),
+      sel(model.am_gmm, *model.trans_model, 0.1, &sel_feats, opts, &gselect,
+          model.stacked_gmm);
+  std::vector<int32> tids;
+  model.GetTransitionIds(&tids);
+  for (int32 frame = 0; frame < feats.NumRows(); frame++)
+    for (size_t i = 0; i < tids.size(); i++)
+      KALDI_ASSERT(ApproxEqual(full.LogLikelihood(frame, tids[i]),
+                               sel.LogLikelihood(frame, tids[i]), 1.0e-03));
+}
+
+}  // end namespace kaldi
+
+int main() {
+  using namespace kaldi;
+  for (int i = 0; i < 10; i++)
+    TestStackedGmm();
+  for (int i = 0; i < 10; i++)
+    TestBatchPdfs();
+  for (int i = 0; i < 10; i++)
+    TestGselect();
+  std::cout << "Test OK.\n";
+}
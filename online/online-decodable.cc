@@ -1,71 +1,216 @@
-// online/online-decodable.cc
-
-// Copyright 2012 Cisco Systems (author: Matthias Paulik)
-
-//   Modifications to the original contribution by Cisco Systems made by:
-//   Vassil Panayotov
-
-// See ../../COPYING for clarification regarding multiple authors
-//
-// Licensed under the Apache License, Version 2.0 (the "License");
-// you may not use this file except in compliance with the License.
-// You may obtain a copy of the License at
-//
-//  http://www.apache.org/licenses/LICENSE-2.0
-//
-// THIS CODE IS PROVIDED *AS IS* BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
-// KIND, EITHER EXPRESS OR IMPLIED, INCLUDING WITHOUT LIMITATION ANY IMPLIED
-// WARRANTIES OR CONDITIONS OF TITLE, FITNESS FOR A PARTICULAR PURPOSE,
-// MERCHANTABLITY OR NON-INFRINGEMENT.
-// See the Apache 2 License for the specific language governing permissions and
-// limitations under the License.
-
-#include "online/online-decodable.h"
-
-namespace kaldi {
-
-//构造函数
-OnlineDecodableDiagGmmScaled::OnlineDecodableDiagGmmScaled(
-    const AmDiagGmm &am, const TransitionModel &trans_model,
-    const BaseFloat scale, OnlineFeatureMatrix *input_feats):  
-      features_(input_feats), ac_model_(am),
-      ac_scale_(scale), trans_model_(trans_model),
-      feat_dim_(input_feats->Dim()), cur_frame_(-1) {
-  if (!input_feats->IsValidFrame(0)) {
-    // It's not safe to throw from a constructor, so please check
-    // this condition yourself before reaching this point in the code.
-    KALDI_ERR << "Attempt to initialize decodable object with empty "
-              << "input: please check this before the initializer!";
-  }
-  int32 num_pdfs = trans_model_.NumPdfs();
-  cache_.resize(num_pdfs, std::pair<int32,BaseFloat>(-1, 0.0));
-}
-
-void OnlineDecodableDiagGmmScaled::CacheFrame(int32 frame) {
-  KALDI_ASSERT(frame >= 0);
-  cur_feats_.Resize(feat_dim_);
-  if (!features_->IsValidFrame(frame))
-    KALDI_ERR << "Request for invalid frame (you need to check IsLastFrame, or, "
-              << "for frame zero, check that the input is valid.";
-  cur_feats_.CopyFromVec(features_->GetFrame(frame));
-  cur_frame_ = frame;
-}
-
-BaseFloat OnlineDecodableDiagGmmScaled::LogLikelihood(int32 frame, int32 index) {
-  if (frame != cur_frame_)
-    CacheFrame(frame);
-  int32 pdf_id = trans_model_.TransitionIdToPdf(index);
-  if (cache_[pdf_id].first == frame)
-    return cache_[pdf_id].second;
-  BaseFloat ans = ac_model_.LogLikelihood(pdf_id, cur_feats_) * ac_scale_;
-  cache_[pdf_id].first = frame;
-  cache_[pdf_id].second = ans;
-  return ans;
-}
-
-
-bool OnlineDecodableDiagGmmScaled::IsLastFrame(int32 frame) const {
-  return !features_->IsValidFrame(frame+1);
-}
-
-} // namespace kaldi
+// online/online-decodable.cc
+
+// Copyright 2012 Cisco Systems (author: Matthias Paulik)
+
+//   Modifications to the original contribution by Cisco Systems made by:
+//   Vassil Panayotov
+
+// See ../../COPYING for clarification regarding multiple authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//  http://www.apache.org/licenses/LICENSE-2.0
+//
+// THIS CODE IS PROVIDED *AS IS* BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, EITHER EXPRESS OR IMPLIED, INCLUDING WITHOUT LIMITATION ANY IMPLIED
+// WARRANTIES OR CONDITIONS OF TITLE, FITNESS FOR A PARTICULAR PURPOSE,
+// MERCHANTABLITY OR NON-INFRINGEMENT.
+// See the Apache 2 License for the specific language governing permissions and
+// limitations under the License.
+
+#include "online/online-decodable.h"
+
+namespace kaldi {
+
+//构造函数
+OnlineDecodableDiagGmmScaled::OnlineDecodableDiagGmmScaled(
+    const AmDiagGmm &am, const TransitionModel &trans_model,
+    const BaseFloat scale, OnlineFeatureMatrix *input_feats,
+    const OnlineDecodableOptions &opts, const OnlineGselectIndex *gselect,
+    const OnlineStackedGmm *stacked):
+      opts_(opts), gselect_(gselect), stacked_(stacked), features_(input_feats),
+      ac_model_(am), ac_scale_(scale), trans_model_(trans_model),
+      feat_dim_(input_feats->Dim()), cur_frame_(-1),
+      num_pdfs_(trans_model.NumPdfs()), scored_end_(0) {
+  if (!input_feats->IsValidFrame(0)) {
+    // It's not safe to throw from a constructor, so please check
+    // this condition yourself before reaching this point in the code.
+    KALDI_ERR << "Attempt to initialize decodable object with empty "
+              << "input: please check this before the initializer!";
+  }
+  int32 num_rows = 1;
+  if (opts_.batch_pdfs) {
+    KALDI_ASSERT(opts_.lookahead_frames > 0);
+    num_rows = opts_.lookahead_frames;
+  }
+  if (gselect_ != NULL) {
+    if (!gselect_->IsCompatible(ac_model_))
+      KALDI_ERR << "The Gaussian selection index does not match the model.";
+    // The selection is done frame by frame, so there is no look-ahead.
+    num_rows = 1;
+  }
+  if (opts_.batch_pdfs || gselect_ != NULL) {
+    if (stacked_ == NULL)
+      KALDI_ERR << "Batched scoring and Gaussian selection need the stacked "
+                << "Gaussians of the model.";
+    if (!stacked_->IsCompatible(ac_model_))
+      KALDI_ERR << "The stacked Gaussians do not match the model.";
+    data_.Resize(num_rows, 2 * feat_dim_);
+    requested_frame_.resize(num_pdfs_, -1);
+    if (gselect_ != NULL)
+      gauss_selected_.resize(stacked_->NumGauss(), -1);
+  }
+  cache_.Resize(num_rows, num_pdfs_);
+  cache_frame_.resize(num_rows * num_pdfs_, -1);
+}
+
+BaseFloat OnlineDecodableDiagGmmScaled::ScorePdf(int32 pdf_id) {
+  BaseFloat ans = stacked_->LogLikelihood(data_.Row(0), pdf_id,
+                                          &pdf_gauss_loglikes_) * ac_scale_;
+  int32 row = CacheRow(cur_frame_);
+  cache_(row, pdf_id) = ans;
+  cache_frame_[row * num_pdfs_ + pdf_id] = cur_frame_;
+  return ans;
+}
+
+BaseFloat OnlineDecodableDiagGmmScaled::ScorePdfSelected(int32 pdf_id) {
+  int32 offset = stacked_->PdfOffset(pdf_id),
+      n = stacked_->PdfNumGauss(pdf_id), num_selected = 0;
+  if (pdf_gauss_loglikes_.Dim() < n)
+    pdf_gauss_loglikes_.Resize(n, kUndefined);
+  SubVector<BaseFloat> data(data_, 0);
+  const Matrix<BaseFloat> &params = stacked_->Params();
+  const Vector<BaseFloat> &gconsts = stacked_->Gconsts();
+  for (int32 i = offset; i < offset + n; i++) {
+    if (gauss_selected_[i] == cur_frame_)
+      pdf_gauss_loglikes_(num_selected++) = gconsts(i) +
+          VecVec(params.Row(i), data);
+  }
+  if (num_selected == 0)
+    return ScorePdf(pdf_id);
+  BaseFloat ans = pdf_gauss_loglikes_.Range(0, num_selected).LogSumExp() *
+      ac_scale_;
+  cache_(0, pdf_id) = ans;
+  cache_frame_[pdf_id] = cur_frame_;
+  return ans;
+}
+
+void OnlineDecodableDiagGmmScaled::ScorePdfs(const std::vector<int32> &pdfs) {
+  // data_.Row(0) is already set up for the current frame.
+  int32 num_frames = 1;
+  while (num_frames < opts_.lookahead_frames &&
+         features_->IsAvailable(cur_frame_ + num_frames)) {
+    SubVector<BaseFloat> data(data_, num_frames);
+    stacked_->ComputeData(features_->GetFrame(cur_frame_ + num_frames), &data);
+    num_frames++;
+  }
+  scored_end_ = cur_frame_ + num_frames;
+  SubMatrix<BaseFloat> data(data_, 0, num_frames, 0, data_.NumCols());
+
+  // Above "full_eval_ratio", it is cheaper to score all the Gaussians, in a
+  // few big products, and then we may as well cache all the pdfs.
+  bool all_pdfs = (pdfs.size() > opts_.full_eval_ratio * num_pdfs_);
+  int32 num_scored = (all_pdfs ? num_pdfs_ : pdfs.size());
+  if (num_scored == 0)
+    return;
+  if (pdf_loglikes_.NumCols() < num_scored)
+    pdf_loglikes_.Resize(data_.NumRows(), num_scored, kUndefined);
+  SubMatrix<BaseFloat> loglikes(pdf_loglikes_, 0, num_frames, 0, num_scored);
+  if (all_pdfs)
+    stacked_->LogLikelihoods(data, &gauss_loglikes_, &loglikes);
+  else
+    stacked_->LogLikelihoods(data, pdfs, &gauss_loglikes_, &loglikes);
+  for (int32 i = 0; i < num_scored; i++) {
+    int32 pdf_id = (all_pdfs ? i : pdfs[i]);
+    for (int32 t = 0; t < num_frames; t++) {
+      int32 frame = cur_frame_ + t, row = CacheRow(frame);
+      cache_(row, pdf_id) = loglikes(t, i) * ac_scale_;
+      cache_frame_[row * num_pdfs_ + pdf_id] = frame;
+    }
+  }
+}
+
+void OnlineDecodableDiagGmmScaled::CacheFrame(int32 frame, bool score_ahead) {
+  KALDI_ASSERT(frame >= 0);
+  cur_feats_.Resize(feat_dim_);
+  if (!features_->IsValidFrame(frame))
+    KALDI_ERR << "Request for invalid frame (you need to check IsLastFrame, or, "
+              << "for frame zero, check that the input is valid.";
+  cur_feats_.CopyFromVec(features_->GetFrame(frame));
+  cur_frame_ = frame;
+  if (gselect_ != NULL) {
+    SubVector<BaseFloat> data(data_, 0);
+    stacked_->ComputeData(cur_feats_, &data);
+    gselect_->SelectUbmComponents(cur_feats_, opts_.gselect_num,
+                                  &ubm_loglikes_, &selected_ubm_);
+    for (size_t i = 0; i < selected_ubm_.size(); i++) {
+      const std::vector<int32> &gauss = gselect_->Gaussians(selected_ubm_[i]);
+      for (size_t j = 0; j < gauss.size(); j++)
+        gauss_selected_[gauss[j]] = frame;
+    }
+  } else if (opts_.batch_pdfs) {
+    SubVector<BaseFloat> data(data_, 0);
+    stacked_->ComputeData(cur_feats_, &data);
+    // The set of pdfs needed changes little from one frame to the next, so,
+    // unless this frame was already scored ahead, the pdfs of the previous
+    // frame are scored up front, for this frame and the next few available.
+    prev_pdfs_.swap(cur_pdfs_);
+    cur_pdfs_.clear();
+    if (score_ahead && frame >= scored_end_)
+      ScorePdfs(prev_pdfs_);
+  }
+}
+
+BaseFloat OnlineDecodableDiagGmmScaled::LogLikelihood(int32 frame, int32 index) {
+  if (frame != cur_frame_)
+    CacheFrame(frame);
+  int32 pdf_id = trans_model_.TransitionIdToPdf(index);
+  if (gselect_ != NULL) {
+    if (cache_frame_[pdf_id] == frame)
+      return cache_(0, pdf_id);
+    return ScorePdfSelected(pdf_id);
+  }
+  if (opts_.batch_pdfs) {
+    if (requested_frame_[pdf_id] != frame) {
+      requested_frame_[pdf_id] = frame;
+      cur_pdfs_.push_back(pdf_id);
+    }
+    int32 row = CacheRow(frame);
+    if (cache_frame_[row * num_pdfs_ + pdf_id] == frame)
+      return cache_(row, pdf_id);
+    return ScorePdf(pdf_id);
+  }
+  if (cache_frame_[pdf_id] == frame)
+    return cache_(0, pdf_id);
+  BaseFloat ans = ac_model_.LogLikelihood(pdf_id, cur_feats_) * ac_scale_;
+  cache_frame_[pdf_id] = frame;
+  cache_(0, pdf_id) = ans;
+  return ans;
+}
+
+const std::vector<int32> &OnlineDecodableDiagGmmScaled::PrepareFrame(
+    int32 frame, VectorBase<BaseFloat> *data) {
+  KALDI_ASSERT(BatchStackedGmm() != NULL);
+  if (frame != cur_frame_)
+    CacheFrame(frame, false);
+  data->CopyFromVec(data_.Row(0));
+  return prev_pdfs_;
+}
+
+void OnlineDecodableDiagGmmScaled::CacheLogLikelihoods(
+    const std::vector<int32> &pdfs, const VectorBase<BaseFloat> &loglikes) {
+  KALDI_ASSERT(loglikes.Dim() == static_cast<int32>(pdfs.size()));
+  int32 row = CacheRow(cur_frame_);
+  for (size_t i = 0; i < pdfs.size(); i++) {
+    cache_(row, pdfs[i]) = loglikes(i) * ac_scale_;
+    cache_frame_[row * num_pdfs_ + pdfs[i]] = cur_frame_;
+  }
+}
+
+bool OnlineDecodableDiagGmmScaled::IsLastFrame(int32 frame) const {
+  return !features_->IsValidFrame(frame+1);
+}
+
+} // namespace kaldi
@@ -1,71 +1,179 @@
-// online/online-decodable.h
-
-// Copyright 2012 Cisco Systems (author: Matthias Paulik)
-
-//   Modifications to the original contribution by Cisco Systems made by:
-//   Vassil Panayotov,
-//   Johns Hopkins University (author: Daniel Povey)
-
-// See ../../COPYING for clarification regarding multiple authors
-//
-// Licensed under the Apache License, Version 2.0 (the "License");
-// you may not use this file except in compliance with the License.
-// You may obtain a copy of the License at
-//
-//  http://www.apache.org/licenses/LICENSE-2.0
-//
-// THIS CODE IS PROVIDED *AS IS* BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
-// KIND, EITHER EXPRESS OR IMPLIED, INCLUDING WITHOUT LIMITATION ANY IMPLIED
-// WARRANTIES OR CONDITIONS OF TITLE, FITNESS FOR A PARTICULAR PURPOSE,
-// MERCHANTABLITY OR NON-INFRINGEMENT.
-// See the Apache 2 License for the specific language governing permissions and
-// limitations under the License.
-
-#ifndef KALDI_ONLINE_ONLINE_DECODABLE_H_
-#define KALDI_ONLINE_ONLINE_DECODABLE_H_
-
-#include "online/online-feat-input.h"
-#include "gmm/decodable-am-diag-gmm.h"
-
-namespace kaldi {
-
-
-
-// A decodable, taking input from an OnlineFeatureInput object on-demand
-//从onlinefeatureinput对象那里获得的可解码输入
-class OnlineDecodableDiagGmmScaled : public DecodableInterface {
- public:
-  OnlineDecodableDiagGmmScaled(const AmDiagGmm &am,
-                               const TransitionModel &trans_model,
-                               const BaseFloat scale,
-                               OnlineFeatureMatrix *input_feats);
-
-  
-  /// Returns the log likelihood, which will be negated in the decoder.
-  virtual BaseFloat LogLikelihood(int32 frame, int32 index);
-  
-  virtual bool IsLastFrame(int32 frame) const;
-  
-  /// Indices are one-based!  This is for compatibility with OpenFst.
-  virtual int32 NumIndices() const { return trans_model_.NumTransitionIds(); }
-
- private:
-  void CacheFrame(int32 frame);
-  
-  OnlineFeatureMatrix *features_;
-  //由final.mdl那里得到的对角协方差混合高斯矩阵
-  const AmDiagGmm &ac_model_;
-  BaseFloat ac_scale_;
-  //同样由final.mdl文件那里得到的转移矩阵
-  const TransitionModel &trans_model_;
-  const int32 feat_dim_; // dimensionality of the input features
-  Vector<BaseFloat> cur_feats_;
-  int32 cur_frame_;
-  std::vector<std::pair<int32, BaseFloat> > cache_;
-
-  KALDI_DISALLOW_COPY_AND_ASSIGN(OnlineDecodableDiagGmmScaled);
-};
-
-} // namespace kaldi
-
-#endif // KALDI_ONLINE_ONLINE_DECODABLE_H_
+// online/online-decodable.h
+
+// Copyright 2012 Cisco Systems (author: Matthias Paulik)
+
+//   Modifications to the original contribution by Cisco Systems made by:
+//   Vassil Panayotov,
+//   Johns Hopkins University (author: Daniel Povey)
+
+// See ../../COPYING for clarification regarding multiple authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//  http://www.apache.org/licenses/LICENSE-2.0
+//
+// THIS CODE IS PROVIDED *AS IS* BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, EITHER EXPRESS OR IMPLIED, INCLUDING WITHOUT LIMITATION ANY IMPLIED
+// WARRANTIES OR CONDITIONS OF TITLE, FITNESS FOR A PARTICULAR PURPOSE,
+// MERCHANTABLITY OR NON-INFRINGEMENT.
+// See the Apache 2 License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef KALDI_ONLINE_ONLINE_DECODABLE_H_
+#define KALDI_ONLINE_ONLINE_DECODABLE_H_
+
+#include "online/online-feat-input.h"
+#include "gmm/decodable-am-diag-gmm.h"
+#include "online/online-gselect.h"
+#include "online/online-stacked-gmm.h"
+
+namespace kaldi {
+
+struct OnlineDecodableOptions {
+  bool batch_pdfs; // score the pdfs requested on the previous frame in one go
+  BaseFloat full_eval_ratio; // above this fraction of pdfs, score all of them
+  int32 lookahead_frames; // number of frames scored together
+  std::string gselect_rxfilename; // Gaussian selection index, if any
+  int32 gselect_num; // number of UBM components selected per frame
+
+  OnlineDecodableOptions(): batch_pdfs(false), full_eval_ratio(0.5),
+                            lookahead_frames(1), gselect_num(20) { }
+
+  void Register(OptionsItf *opts) {
+    opts->Register("batch-pdfs", &batch_pdfs,
+                   "On each new frame, compute the likelihoods of all the pdfs "
+                   "that were needed on the previous frame at once, using "
+                   "matrix-vector products over the stacked Gaussians");
+    opts->Register("full-eval-ratio", &full_eval_ratio,
+                   "With --batch-pdfs, if more than this fraction of the pdfs "
+                   "is needed, all Gaussians of the model are scored in a "
+                   "single matrix-vector product");
+    opts->Register("lookahead-frames", &lookahead_frames,
+                   "With --batch-pdfs, score up to this many frames at once, "
+                   "using matrix-matrix products. Only the frames that were "
+                   "already read from the input are scored ahead, so this "
+                   "never waits for more input");
+    opts->Register("gselect", &gselect_rxfilename,
+                   "Gaussian selection index built by online-gmm-build-gselect; "
+                   "if given, only the Gaussians attached to the best UBM "
+                   "components are evaluated");
+    opts->Register("gselect-num", &gselect_num,
+                   "With --gselect, the number of best UBM components used on "
+                   "each frame; smaller is faster, but less accurate");
+  }
+};
+
+
+// A decodable, taking input from an OnlineFeatureInput object on-demand
+//从onlinefeatureinput对象那里获得的可解码输入
+// With --batch-pdfs or Gaussian selection, the Gaussians are scored from
+// "stacked", which must then be given; it is not owned, and is meant to be
+// shared by all the decodables using the model.
+class OnlineDecodableDiagGmmScaled : public DecodableInterface {
+ public:
+  OnlineDecodableDiagGmmScaled(const AmDiagGmm &am,
+                               const TransitionModel &trans_model,
+                               const BaseFloat scale,
+                               OnlineFeatureMatrix *input_feats,
+                               const OnlineDecodableOptions &opts =
+                               OnlineDecodableOptions(),
+                               const OnlineGselectIndex *gselect = NULL,
+                               const OnlineStackedGmm *stacked = NULL);
+
+  
+  /// Returns the log likelihood, which will be negated in the decoder.
+  virtual BaseFloat LogLikelihood(int32 frame, int32 index);
+  
+  virtual bool IsLastFrame(int32 frame) const;
+  
+  /// Indices are one-based!  This is for compatibility with OpenFst.
+  virtual int32 NumIndices() const { return trans_model_.NumTransitionIds(); }
+
+  // The functions below let the pdfs of several decodables be scored
+  // together, with one OnlineStackedGmm::LogLikelihoods() call (see
+  // OnlineMultiStreamDecoder).  This returns the stacked Gaussians if the
+  // decodable can take part, i.e. with --batch-pdfs and without Gaussian
+  // selection, and NULL otherwise.
+  const OnlineStackedGmm *BatchStackedGmm() const {
+    return (opts_.batch_pdfs && gselect_ == NULL ? stacked_ : NULL);
+  }
+
+  // Makes "frame", which must be valid, the current frame, without scoring
+  // anything ahead, and sets "data" to its [ x, x.^2 ].  Returns the pdfs to
+  // score for it: those requested on the previous frame.
+  const std::vector<int32> &PrepareFrame(int32 frame,
+                                         VectorBase<BaseFloat> *data);
+
+  // Caches "loglikes", the log-likelihoods of "pdfs" for the current frame
+  // as output by OnlineStackedGmm.
+  void CacheLogLikelihoods(const std::vector<int32> &pdfs,
+                           const VectorBase<BaseFloat> &loglikes);
+
+ private:
+  // Makes "frame" the current frame; with --batch-pdfs, also scores the pdfs
+  // of the previous frame ahead, unless "score_ahead" is false.
+  void CacheFrame(int32 frame, bool score_ahead = true);
+
+  // Computes the scaled log-likelihood of "pdf_id" for the current frame
+  // from the stacked Gaussians, and caches it.
+  BaseFloat ScorePdf(int32 pdf_id);
+
+  // Like ScorePdf(), but only evaluates the Gaussians selected for the
+  // current frame (all of them if none of the pdf's Gaussians was selected).
+  BaseFloat ScorePdfSelected(int32 pdf_id);
+
+  // Scores and caches all the pdfs in "pdfs" for the current frame and the
+  // frames following it that are already available, up to
+  // "lookahead_frames" frames in total.
+  void ScorePdfs(const std::vector<int32> &pdfs);
+
+  // The index of the row of the cache used for "frame".
+  inline int32 CacheRow(int32 frame) const {
+    return frame % cache_.NumRows();
+  }
+
+  const OnlineDecodableOptions opts_;
+  const OnlineGselectIndex *gselect_;
+  const OnlineStackedGmm *stacked_;
+  OnlineFeatureMatrix *features_;
+  //由final.mdl那里得到的对角协方差混合高斯矩阵
+  const AmDiagGmm &ac_model_;
+  BaseFloat ac_scale_;
+  //同样由final.mdl文件那里得到的转移矩阵
+  const TransitionModel &trans_model_;
+  const int32 feat_dim_; // dimensionality of the input features
+  Vector<BaseFloat> cur_feats_;
+  int32 cur_frame_;
+  // The likelihood cache, a ring buffer of "lookahead_frames" rows (one row
+  // without --batch-pdfs): cache_(CacheRow(t), p) is the scaled log-likelihood
+  // of pdf p on frame t, if cache_frame_[CacheRow(t) * num-pdfs + p] == t.
+  Matrix<BaseFloat> cache_;
+  std::vector<int32> cache_frame_;
+  int32 num_pdfs_;
+
+  // The rest is only used with --batch-pdfs or Gaussian selection.
+  Matrix<BaseFloat> data_; // row i is [ x, x.^2 ] for frame cur_frame_ + i
+  // Scratch space for the log-likelihoods of the Gaussians, and of the pdfs
+  // scored ahead.
+  Matrix<BaseFloat> gauss_loglikes_;
+  Vector<BaseFloat> pdf_gauss_loglikes_;
+  Matrix<BaseFloat> pdf_loglikes_;
+  int32 scored_end_; // the frame after the last one scored ahead
+  std::vector<int32> requested_frame_; // last frame each pdf was asked for
+  std::vector<int32> cur_pdfs_; // the pdfs asked for on the current frame...
+  std::vector<int32> prev_pdfs_; // ... and on the previous one
+
+  // For Gaussian selection: gauss_selected_[i] == cur_frame_ if Gaussian i is
+  // selected for the current frame.
+  std::vector<int32> gauss_selected_;
+  std::vector<int32> selected_ubm_;
+  Vector<BaseFloat> ubm_loglikes_;
+
+  KALDI_DISALLOW_COPY_AND_ASSIGN(OnlineDecodableDiagGmmScaled);
+};
+
+} // namespace kaldi
+
+#endif // KALDI_ONLINE_ONLINE_DECODABLE_H_
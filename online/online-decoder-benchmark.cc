@@ -0,0 +1,589 @@
+// online/online-decoder-benchmark.cc
+
+// See ../../COPYING for clarification regarding multiple authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//  http://www.apache.org/licenses/LICENSE-2.0
+//
+// THIS CODE IS PROVIDED *AS IS* BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, EITHER EXPRESS OR IMPLIED, INCLUDING WITHOUT LIMITATION ANY IMPLIED
+// WARRANTIES OR CONDITIONS OF TITLE, FITNESS FOR A PARTICULAR PURPOSE,
+// MERCHANTABLITY OR NON-INFRINGEMENT.
+// See the Apache 2 License for the specific language governing permissions and
+// limitations under the License.
+
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <set>
+#include <vector>
+
+#include "base/kaldi-common.h"
+#include "base/timer.h"
+#include "decoder/faster-decoder.h"
+#include "gmm/model-test-common.h"
+#include "hmm/hmm-test-utils.h"
+#include "matrix/kaldi-matrix.h"
+#include "online/online-alloc-counter.h"
+#include "online/online-decodable.h"
+#include "online/online-faster-decoder.h"
+#include "online/online-immortal-token.h"
+#include "online/online-token-pool.h"
+#include "util/common-utils.h"
+
+namespace kaldi {
+
+// Serves frames [first_frame, first_frame + num_frames) of a matrix of
+// log-likelihoods, indexed by transition-id minus one, as frames 0, 1, ...
+class BenchmarkDecodable : public DecodableInterface {
+ public:
+  BenchmarkDecodable(const Matrix<BaseFloat> &loglikes, int32 first_frame,
+                     int32 num_frames):
+      loglikes_(loglikes), first_frame_(first_frame), num_frames_(num_frames) {
+    KALDI_ASSERT(first_frame >= 0 && num_frames > 0 &&
+                 first_frame + num_frames <= loglikes.NumRows());
+  }
+
+  virtual BaseFloat LogLikelihood(int32 frame, int32 index) {
+    return loglikes_(first_frame_ + frame, index - 1);
+  }
+
+  virtual bool IsLastFrame(int32 frame) const {
+    return frame == num_frames_ - 1;
+  }
+
+  virtual int32 NumIndices() const { return loglikes_.NumCols(); }
+
+ private:
+  const Matrix<BaseFloat> &loglikes_;
+  int32 first_frame_;
+  int32 num_frames_;
+};
+
+// A random decoding graph over transition-ids [1, num_tids]: every state has
+// "num_arcs" emitting arcs to random states, and one state in five an
+// epsilon arc too; one arc in ten outputs a word.  All the states are final.
+static void MakeRandomGraph(int32 num_states, int32 num_arcs, int32 num_tids,
+                            int32 num_words, fst::VectorFst<fst::StdArc> *fst) {
+  typedef fst::StdArc Arc;
+  fst->DeleteStates();
+  for (int32 s = 0; s < num_states; s++)
+    fst->AddState();
+  fst->SetStart(0);
+  for (int32 s = 0; s < num_states; s++) {
+    for (int32 a = 0; a <= num_arcs; a++) {
+      if (a == num_arcs && Rand() % 5 != 0)
+        break;
+      int32 ilabel = (a == num_arcs ? 0 : 1 + Rand() % num_tids),
+          olabel = (Rand() % 10 == 0 ? 1 + Rand() % num_words : 0);
+      fst->AddArc(s, Arc(ilabel, olabel, Arc::Weight(2.0 * RandUniform()),
+                         Rand() % num_states));
+    }
+    fst->SetFinal(s, Arc::Weight(5.0 * RandUniform()));
+  }
+}
+
+// What one utterance cost: the frames, the time and the memory allocations.
+struct UtteranceResult {
+  int32 num_frames;
+  double elapsed;
+  int64 num_allocs; // -1 if not counted
+};
+
+// Decodes the frames of "loglikes" as utterances of "utt_frames" frames with
+// FasterDecoder, whose tokens are allocated on the heap one by one.
+static void RunHeapDecoder(const fst::Fst<fst::StdArc> &fst,
+                           const FasterDecoderOptions &opts,
+                           const Matrix<BaseFloat> &loglikes, int32 utt_frames,
+                           std::vector<UtteranceResult> *results) {
+  FasterDecoder decoder(fst, opts);
+  for (int32 start = 0; start + utt_frames <= loglikes.NumRows();
+       start += utt_frames) {
+    BenchmarkDecodable decodable(loglikes, start, utt_frames);
+    UtteranceResult result;
+    int64 allocs_start = NumAllocsSoFar();
+    Timer timer;
+    decoder.Decode(&decodable);
+    result.elapsed = timer.Elapsed();
+    result.num_allocs = (allocs_start < 0 ? -1 :
+                         NumAllocsSoFar() - allocs_start);
+    result.num_frames = utt_frames;
+    results->push_back(result);
+  }
+}
+
+// Decodes all the frames of "loglikes" as one stream with OnlineFasterDecoder,
+// whose tokens come from its pool; "force-utt-length" cuts the stream into
+// utterances of (at least) "utt_frames" frames.
+static void RunPoolDecoder(const fst::Fst<fst::StdArc> &fst,
+                           const OnlineFasterDecoderOpts &opts,
+                           const TransitionModel &trans_model,
+                           const Matrix<BaseFloat> &loglikes,
+                           std::vector<UtteranceResult> *results,
+                           int64 *num_tokens, int32 *num_slabs) {
+  // No silence phones: the utterances are only ended by "force-utt-length".
+  std::vector<int32> sil_phones;
+  OnlineFasterDecoder decoder(fst, opts, sil_phones, trans_model);
+  BenchmarkDecodable decodable(loglikes, 0, loglikes.NumRows());
+  OnlineFasterDecoder::DecodeState state;
+  UtteranceResult result;
+  int32 utt_start = 0;
+  int64 allocs_start = NumAllocsSoFar();
+  Timer timer;
+  do {
+    state = decoder.Decode(&decodable);
+    if (state == OnlineFasterDecoder::kEndBatch)
+      continue;
+    result.elapsed = timer.Elapsed();
+    result.num_allocs = (allocs_start < 0 ? -1 :
+                         NumAllocsSoFar() - allocs_start);
+    result.num_frames = decoder.frame() - utt_start;
+    results->push_back(result);
+    utt_start = decoder.frame();
+    allocs_start = NumAllocsSoFar();
+    timer.Reset();
+  } while (state != OnlineFasterDecoder::kEndFeats);
+  *num_tokens = decoder.NumTokensAllocated();
+  *num_slabs = decoder.NumTokenSlabs();
+}
+
+// Writes one line per utterance, and logs the totals, with and without the
+// first utterance, which is where the pool grows.
+static void ReportResults(const std::string &name,
+                          const std::vector<UtteranceResult> &results,
+                          std::ostream &os) {
+  int64 frames = 0, allocs = 0, steady_frames = 0, steady_allocs = 0;
+  double elapsed = 0.0;
+  for (size_t i = 0; i < results.size(); i++) {
+    const UtteranceResult &r = results[i];
+    os << name << '\t' << i << '\t' << r.num_frames << '\t' << r.elapsed
+       << '\t' << r.num_allocs << '\t'
+       << (r.num_allocs < 0 ? -1.0 :
+           static_cast<double>(r.num_allocs) / r.num_frames) << '\n';
+    frames += r.num_frames;
+    allocs += r.num_allocs;
+    elapsed += r.elapsed;
+    if (i > 0) {
+      steady_frames += r.num_frames;
+      steady_allocs += r.num_allocs;
+    }
+  }
+  if (results.empty() || results[0].num_allocs < 0) {
+    KALDI_LOG << name << ": " << frames / elapsed << " frames/s, "
+              << "allocations not counted";
+    return;
+  }
+  KALDI_LOG << name << ": " << frames / elapsed << " frames/s, "
+            << static_cast<double>(allocs) / frames << " allocations per "
+            << "frame, "
+            << (steady_frames > 0 ?
+                static_cast<double>(steady_allocs) / steady_frames : 0.0)
+            << " after the first utterance";
+}
+
+struct BenchmarkToken {
+  struct { int32 ilabel; } arc_;
+  BenchmarkToken *prev_;
+  int32 ref_count_;
+};
+
+// Grows a token tree like OnlineFasterDecoder does, with the same reference
+// counting, but with random arcs instead of a graph and a decodable.
+class TokenTreeMaker {
+ public:
+  TokenTreeMaker(): start_(NewToken(0, NULL)) { active_.push_back(start_); }
+  ~TokenTreeMaker() {
+    for (size_t i = 0; i < active_.size(); i++)
+      TokenRelease(active_[i]);
+  }
+
+  BenchmarkToken *Start() const { return start_; }
+  const std::vector<BenchmarkToken*> &Active() const { return active_; }
+
+  // Makes "num_toks" new active tokens, on emitting arcs from the current
+  // ones, which are then released; the best ones (the first in the list) get
+  // most of the children, so that the paths merge back in time.  Then
+  // non-emitting arcs are followed from some of the new tokens, which are
+  // either replaced by the token at the end of the arc, or stay active too.
+  void Frame(int32 num_toks) {
+    std::vector<BenchmarkToken*> prev_active;
+    prev_active.swap(active_);
+    for (int32 i = 0; i < num_toks; i++) {
+      double u = RandUniform();
+      size_t parent = static_cast<size_t>(prev_active.size() * u * u * u * u);
+      active_.push_back(NewToken(1, prev_active[parent]));
+    }
+    for (size_t i = 0; i < prev_active.size(); i++)
+      TokenRelease(prev_active[i]);
+    size_t num_emitting = active_.size();
+    for (size_t i = 0; i < num_emitting; i++) {
+      int32 r = Rand() % 10;
+      if (r == 0) {
+        active_.push_back(NewToken(0, active_[i]));
+      } else if (r == 1) {
+        BenchmarkToken *tok = NewToken(0, active_[i]);
+        TokenRelease(active_[i]);
+        active_[i] = tok;
+      }
+    }
+  }
+
+ private:
+  BenchmarkToken *NewToken(int32 ilabel, BenchmarkToken *prev) {
+    BenchmarkToken *tok = new (pool_.Allocate()) BenchmarkToken();
+    tok->arc_.ilabel = ilabel;
+    tok->prev_ = prev;
+    tok->ref_count_ = 1;
+    if (prev != NULL)
+      prev->ref_count_++;
+    return tok;
+  }
+  void TokenRelease(BenchmarkToken *tok) {
+    while (--tok->ref_count_ == 0) {
+      BenchmarkToken *prev = tok->prev_;
+      pool_.Free(tok);
+      if (prev == NULL)
+        return;
+      tok = prev;
+    }
+  }
+
+  OnlineTokenPool<BenchmarkToken> pool_;
+  BenchmarkToken *start_;
+  std::vector<BenchmarkToken*> active_;
+};
+
+// The algorithm OnlineFasterDecoder used before FindImmortalToken(): it goes
+// back one emitting token at a time from all the active tokens at once, until
+// they meet.  Returns NULL if they only meet at the start token.
+static BenchmarkToken *FindImmortalTokenBySweep(
+    const std::vector<BenchmarkToken*> &active) {
+  std::set<BenchmarkToken*> emitting;
+  for (size_t i = 0; i < active.size(); i++) {
+    BenchmarkToken *tok = active[i];
+    while (tok != NULL && tok->arc_.ilabel == 0)
+      tok = tok->prev_;
+    if (tok != NULL)
+      emitting.insert(tok);
+  }
+  while (emitting.size() > 1) {
+    std::set<BenchmarkToken*> prev_emitting;
+    for (std::set<BenchmarkToken*>::iterator it = emitting.begin();
+         it != emitting.end(); ++it) {
+      BenchmarkToken *tok = (*it)->prev_;
+      while (tok != NULL && tok->arc_.ilabel == 0)
+        tok = tok->prev_;
+      if (tok != NULL)
+        prev_emitting.insert(tok);
+    }
+    emitting.swap(prev_emitting);
+  }
+  return (emitting.empty() ? NULL : *emitting.begin());
+}
+
+// Times both algorithms with "num_toks" active tokens, once per batch of
+// "batch_size" frames, and checks that they agree.
+static void BenchmarkFindImmortalToken(int32 num_toks, int32 batch_size) {
+  int32 num_batches = 5;
+  TokenTreeMaker maker;
+  BenchmarkToken *immortal = maker.Start();
+  double sweep_time = 0.0, ref_count_time = 0.0;
+  for (int32 batch = 0; batch < num_batches; batch++) {
+    for (int32 frame = 0; frame < batch_size; frame++)
+      maker.Frame(num_toks);
+    Timer timer;
+    BenchmarkToken *ref = FindImmortalTokenBySweep(maker.Active());
+    sweep_time += timer.Elapsed();
+    timer.Reset();
+    BenchmarkToken *found = FindImmortalToken(maker.Active()[0], immortal);
+    ref_count_time += timer.Elapsed();
+    KALDI_ASSERT(found == (ref != NULL ? ref : immortal));
+    immortal = found;
+  }
+  KALDI_LOG << num_toks << " active tokens: "
+            << (1.0e6 * sweep_time / num_batches) << " us per batch with "
+            << "the sweep, " << (1.0e6 * ref_count_time / num_batches)
+            << " us with the reference counts";
+}
+
+// Serves the rows of a matrix as features, "batch_size" at a time.
+class OnlineMatrixInput : public OnlineFeatInputItf {
+ public:
+  OnlineMatrixInput(const Matrix<BaseFloat> &feats):
+      position_(0), feats_(feats) { }
+
+  virtual int32 Dim() const { return feats_.NumCols(); }
+
+  virtual bool Compute(Matrix<BaseFloat> *output) {
+    int32 num_frames = std::min(output->NumRows(),
+                                feats_.NumRows() - position_);
+    if (num_frames == 0) {
+      output->Resize(0, 0);
+      return false;
+    }
+    output->Resize(num_frames, feats_.NumCols());
+    output->CopyFromMat(feats_.Range(position_, num_frames,
+                                     0, feats_.NumCols()));
+    position_ += num_frames;
+    return position_ < feats_.NumRows();
+  }
+
+ private:
+  int32 position_;
+  Matrix<BaseFloat> feats_;
+};
+
+// A random model, with one random GMM per pdf of a random transition model,
+// and its Gaussians stacked for the batched scoring.
+struct GmmScoringModel {
+  GmmScoringModel(int32 dim, int32 num_comp) {
+    ContextDependency *ctx_dep = NULL;
+    trans_model = GenRandTransitionModel(&ctx_dep);
+    delete ctx_dep;
+    for (int32 pdf_id = 0; pdf_id < trans_model->NumPdfs(); pdf_id++) {
+      DiagGmm gmm;
+      unittest::InitRandDiagGmm(dim, num_comp, &gmm);
+      am_gmm.AddPdf(gmm);
+    }
+    stacked_gmm = new OnlineStackedGmm(am_gmm);
+  }
+  ~GmmScoringModel() {
+    delete stacked_gmm;
+    delete trans_model;
+  }
+
+  // One transition-id for each pdf.
+  void GetTransitionIds(std::vector<int32> *tids) const {
+    tids->assign(trans_model->NumPdfs(), 0);
+    for (int32 tid = 1; tid <= trans_model->NumTransitionIds(); tid++)
+      (*tids)[trans_model->TransitionIdToPdf(tid)] = tid;
+  }
+
+  TransitionModel *trans_model;
+  AmDiagGmm am_gmm;
+  OnlineStackedGmm *stacked_gmm;
+};
+
+// Simulates what a decoder asks for: on every frame, the likelihoods of a
+// slowly drifting set of "num_active" pdfs, some of them more than once.
+// Returns the time it took in seconds, and outputs the longest time spent on
+// a single frame in "max_frame_time" if not NULL.
+static double RequestLikelihoods(const GmmScoringModel &model,
+                                 const Matrix<BaseFloat> &feats,
+                                 const OnlineDecodableOptions &opts,
+                                 int32 num_active,
+                                 double *max_frame_time = NULL) {
+  std::vector<int32> tids;
+  model.GetTransitionIds(&tids);
+  int32 num_pdfs = tids.size();
+  std::vector<int32> active(num_active);
+  for (int32 i = 0; i < num_active; i++)
+    active[i] = Rand() % num_pdfs;
+
+  OnlineMatrixInput input(feats);
+  OnlineFeatureMatrixOptions feature_opts;
+  OnlineFeatureMatrix feature_matrix(feature_opts, &input);
+  OnlineDecodableDiagGmmScaled decodable(model.am_gmm, *model.trans_model,
+                                         0.1, &feature_matrix, opts, NULL,
+                                         model.stacked_gmm);
+  BaseFloat sum = 0.0;
+  Timer timer;
+  double frame_start = 0.0;
+  if (max_frame_time != NULL)
+    *max_frame_time = 0.0;
+  for (int32 frame = 0; frame < feats.NumRows(); frame++) {
+    for (int32 i = 0; i < num_active; i++) {
+      if (Rand() % 10 == 0)
+        active[i] = Rand() % num_pdfs;
+      int32 num_requests = 1 + Rand() % 3;
+      for (int32 j = 0; j < num_requests; j++)
+        sum += decodable.LogLikelihood(frame, tids[active[i]]);
+    }
+    if (max_frame_time != NULL) {
+      double now = timer.Elapsed();
+      *max_frame_time = std::max(*max_frame_time, now - frame_start);
+      frame_start = now;
+    }
+  }
+  double elapsed = timer.Elapsed();
+  KALDI_VLOG(2) << "Sum of the log-likelihoods: " << sum;
+  return elapsed;
+}
+
+// Reports the speed of the plain and the batched scoring with "num_active"
+// of the model's pdfs active on each frame.
+static void BenchmarkBatchPdfs(const GmmScoringModel &model,
+                               const Matrix<BaseFloat> &feats,
+                               int32 num_active) {
+  OnlineDecodableOptions plain_opts, batch_opts;
+  batch_opts.batch_pdfs = true;
+  int32 seed = Rand();
+  srand(seed);
+  double plain_time = RequestLikelihoods(model, feats, plain_opts, num_active);
+  srand(seed);
+  double batch_time = RequestLikelihoods(model, feats, batch_opts, num_active);
+  KALDI_LOG << "Active pdfs " << num_active << "/"
+            << model.trans_model->NumPdfs() << ": plain " << plain_time
+            << "s, batched " << batch_time << "s (speedup "
+            << plain_time / batch_time << ")";
+}
+
+// Reports the speed of the batched scoring with "lookahead" frames scored at
+// once, and the longest time spent on one frame, which is what the look-ahead
+// adds to the latency.
+static void BenchmarkLookahead(const GmmScoringModel &model,
+                               const Matrix<BaseFloat> &feats,
+                               int32 lookahead) {
+  int32 num_active = std::max(1, model.trans_model->NumPdfs() / 5);
+  OnlineDecodableOptions opts;
+  opts.batch_pdfs = true;
+  opts.lookahead_frames = lookahead;
+  double max_frame_time,
+      elapsed = RequestLikelihoods(model, feats, opts, num_active,
+                                   &max_frame_time);
+  KALDI_LOG << "Look-ahead " << lookahead << " frames: "
+            << feats.NumRows() / elapsed << " frames/s, longest frame "
+            << max_frame_time * 1000.0 << " ms";
+}
+
+}  // end namespace kaldi
+
+int main(int argc, char *argv[]) {
+  try {
+    using namespace kaldi;
+    typedef kaldi::int32 int32;
+    typedef kaldi::int64 int64;
+
+    const char *usage =
+        "Compares the memory allocations and the speed of FasterDecoder, which\n"
+        "allocates its tokens on the heap, and OnlineFasterDecoder, which takes\n"
+        "them from a pool, on a random graph and random scores.  FasterDecoder\n"
+        "decodes the utterances one by one; OnlineFasterDecoder decodes them\n"
+        "as one stream, cut with --force-utt-length.  One tab-separated line\n"
+        "is written per decoder and utterance: the frames, the seconds, the\n"
+        "memory allocations and the allocations per frame (-1 if not\n"
+        "counted).  Then the search for the immortal token is timed, with the\n"
+        "reference counts and with the sweep from all the active tokens that\n"
+        "OnlineFasterDecoder used before, on random token trees.  Last, the\n"
+        "plain and the batched GMM scoring of OnlineDecodableDiagGmmScaled\n"
+        "are timed on random models and features, and then the batched one\n"
+        "for different numbers of look-ahead frames.\n\n"
+        "Usage: online-decoder-benchmark [options] [results-wxfilename]\n\n"
+        "Example: online-decoder-benchmark --num-utts=20 --utt-frames=500 "
+        "--num-states=50000 --max-active=7000 results.tsv";
+    ParseOptions po(usage);
+    FasterDecoderOptions decoder_opts;
+    decoder_opts.Register(&po, true);
+    int32 num_utts = 10, utt_frames = 1000, num_states = 20000, num_arcs = 4,
+        num_words = 1000, seed = 0;
+    std::string immortal_sizes_str = "5000:20000:50000",
+        active_ratios_str = "0.05:0.2:0.5:1.0", lookaheads_str = "1:2:4:8:16";
+    int32 gmm_dim = 39, gmm_comp = 16, gmm_frames = 200;
+    po.Register("num-utts", &num_utts, "Number of utterances decoded");
+    po.Register("utt-frames", &utt_frames, "Frames per utterance");
+    po.Register("num-states", &num_states, "States of the random graph");
+    po.Register("num-arcs", &num_arcs,
+                "Emitting arcs per state of the random graph");
+    po.Register("num-words", &num_words, "Words of the random graph");
+    po.Register("seed", &seed, "Seed of the random graph and scores");
+    po.Register("immortal-sizes", &immortal_sizes_str,
+                "Colon-separated list of the numbers of active tokens to time "
+                "the search for the immortal token with (none if empty)");
+    po.Register("active-pdf-ratios", &active_ratios_str,
+                "Colon-separated list of the fractions of active pdfs to time "
+                "the plain and the batched GMM scoring with (none if empty)");
+    po.Register("lookaheads", &lookaheads_str,
+                "Colon-separated list of the numbers of look-ahead frames to "
+                "time the batched GMM scoring with (none if empty)");
+    po.Register("gmm-dim", &gmm_dim, "Feature dimension of the random GMMs");
+    po.Register("gmm-comp", &gmm_comp, "Gaussians per pdf of the random GMMs");
+    po.Register("gmm-frames", &gmm_frames, "Frames of random features scored");
+    po.Read(argc, argv);
+    if (po.NumArgs() > 1) {
+      po.PrintUsage();
+      return 1;
+    }
+    std::string results_wxfilename = po.GetOptArg(1);
+    if (results_wxfilename == "") results_wxfilename = "-";
+    if (num_utts <= 0 || utt_frames <= 0 || num_states <= 0 ||
+        num_arcs <= 0 || num_words <= 0)
+      KALDI_ERR << "Invalid --num-utts, --utt-frames, --num-states, "
+                << "--num-arcs or --num-words option";
+    std::vector<int32> immortal_sizes;
+    if (!SplitStringToIntegers(immortal_sizes_str, ":", true, &immortal_sizes))
+      KALDI_ERR << "Invalid --immortal-sizes option: " << immortal_sizes_str;
+    for (size_t i = 0; i < immortal_sizes.size(); i++)
+      if (immortal_sizes[i] <= 0)
+        KALDI_ERR << "Invalid --immortal-sizes option: " << immortal_sizes_str;
+    std::vector<BaseFloat> active_ratios;
+    if (!SplitStringToFloats(active_ratios_str, ":", true, &active_ratios))
+      KALDI_ERR << "Invalid --active-pdf-ratios option: " << active_ratios_str;
+    for (size_t i = 0; i < active_ratios.size(); i++)
+      if (active_ratios[i] <= 0.0 || active_ratios[i] > 1.0)
+        KALDI_ERR << "Invalid --active-pdf-ratios option: "
+                  << active_ratios_str;
+    std::vector<int32> lookaheads;
+    if (!SplitStringToIntegers(lookaheads_str, ":", true, &lookaheads))
+      KALDI_ERR << "Invalid --lookaheads option: " << lookaheads_str;
+    for (size_t i = 0; i < lookaheads.size(); i++)
+      if (lookaheads[i] <= 0)
+        KALDI_ERR << "Invalid --lookaheads option: " << lookaheads_str;
+    if (gmm_dim <= 0 || gmm_comp <= 0 || gmm_frames <= 0)
+      KALDI_ERR << "Invalid --gmm-dim, --gmm-comp or --gmm-frames option";
+
+    srand(seed);
+    ContextDependency *ctx_dep = NULL;
+    TransitionModel *trans_model = GenRandTransitionModel(&ctx_dep);
+    delete ctx_dep;
+    int32 num_tids = trans_model->NumTransitionIds();
+    fst::VectorFst<fst::StdArc> graph;
+    MakeRandomGraph(num_states, num_arcs, num_tids, num_words, &graph);
+    Matrix<BaseFloat> loglikes(num_utts * utt_frames, num_tids, kUndefined);
+    for (int32 t = 0; t < loglikes.NumRows(); t++)
+      for (int32 i = 0; i < num_tids; i++)
+        loglikes(t, i) = -3.0 * std::abs(RandGauss());
+
+    // The same search for both: the beam must not adapt to the speed.
+    OnlineFasterDecoderOpts online_opts;
+    static_cast<FasterDecoderOptions&>(online_opts) = decoder_opts;
+    online_opts.rt_min = 0.0;
+    online_opts.rt_max = std::numeric_limits<BaseFloat>::max();
+    online_opts.force_utt_len = utt_frames;
+
+    Output ko(results_wxfilename, false);
+    std::ostream &os = ko.Stream();
+    os << "decoder\tutterance\tframes\tseconds\tallocs\tallocs_per_frame\n";
+    std::vector<UtteranceResult> heap_results, pool_results;
+    RunHeapDecoder(graph, decoder_opts, loglikes, utt_frames, &heap_results);
+    ReportResults("heap", heap_results, os);
+    int64 num_tokens;
+    int32 num_slabs;
+    RunPoolDecoder(graph, online_opts, *trans_model, loglikes, &pool_results,
+                   &num_tokens, &num_slabs);
+    ReportResults("pool", pool_results, os);
+    KALDI_LOG << "The pool handed out " << num_tokens << " tokens from "
+              << num_slabs << " slabs.";
+    for (size_t i = 0; i < immortal_sizes.size(); i++)
+      BenchmarkFindImmortalToken(immortal_sizes[i], online_opts.batch_size);
+    if (!active_ratios.empty() || !lookaheads.empty()) {
+      GmmScoringModel model(gmm_dim, gmm_comp);
+      Matrix<BaseFloat> feats(gmm_frames, gmm_dim);
+      feats.SetRandn();
+      int32 num_pdfs = model.trans_model->NumPdfs();
+      for (size_t i = 0; i < active_ratios.size(); i++)
+        BenchmarkBatchPdfs(model, feats, std::max(1, static_cast<int32>(
+            active_ratios[i] * num_pdfs)));
+      for (size_t i = 0; i < lookaheads.size(); i++)
+        BenchmarkLookahead(model, feats, lookaheads[i]);
+    }
+    delete trans_model;
+    return 0;
+  } catch(const std::exception& e) {
+    std::cerr << e.what();
+    return -1;
+  }
+}
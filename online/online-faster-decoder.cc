@@ -1,277 +1,530 @@
-// online/online-faster-decoder.cc
-
-// Copyright 2012 Cisco Systems (author: Matthias Paulik)
-
-//   Modifications to the original contribution by Cisco Systems made by:
-//   Vassil Panayotov
-
-// See ../../COPYING for clarification regarding multiple authors
-//
-// Licensed under the Apache License, Version 2.0 (the "License");
-// you may not use this file except in compliance with the License.
-// You may obtain a copy of the License at
-//
-//  http://www.apache.org/licenses/LICENSE-2.0
-//
-// THIS CODE IS PROVIDED *AS IS* BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
-// KIND, EITHER EXPRESS OR IMPLIED, INCLUDING WITHOUT LIMITATION ANY IMPLIED
-// WARRANTIES OR CONDITIONS OF TITLE, FITNESS FOR A PARTICULAR PURPOSE,
-// MERCHANTABLITY OR NON-INFRINGEMENT.
-// See the Apache 2 License for the specific language governing permissions and
-// limitations under the License.
-
-#include "base/timer.h"
-#include "online-faster-decoder.h"
-#include "fstext/fstext-utils.h"
-#include "hmm/hmm-utils.h"
-
-namespace kaldi {
-
-void OnlineFasterDecoder::ResetDecoder(bool full) {
-  ClearToks(toks_.Clear());
-  StateId start_state = fst_.Start();
-  KALDI_ASSERT(start_state != fst::kNoStateId);
-  Arc dummy_arc(0, 0, Weight::One(), start_state);
-  Token *dummy_token = new Token(dummy_arc, NULL);
-  toks_.Insert(start_state, dummy_token);
-  prev_immortal_tok_ = immortal_tok_ = dummy_token;
-  utt_frames_ = 0;
-  if (full)
-    frame_ = 0;
-}
-
-
-void
-OnlineFasterDecoder::MakeLattice(const Token *start,
-                                 const Token *end,
-                                 fst::MutableFst<LatticeArc> *out_fst) const {
-  out_fst->DeleteStates();
-  if (start == NULL) return;
-  bool is_final = false;
-  double this_cost = start->cost_ + fst_.Final(start->arc_.nextstate).Value();
-  if (this_cost != std::numeric_limits<double>::infinity())
-    is_final = true;
-  std::vector<LatticeArc> arcs_reverse;  // arcs in reverse order.
-  for (const Token *tok = start; tok != end; tok = tok->prev_) {
-    BaseFloat tot_cost = tok->cost_ -
-        (tok->prev_ ? tok->prev_->cost_ : 0.0),
-        graph_cost = tok->arc_.weight.Value(),
-        ac_cost = tot_cost - graph_cost;
-    LatticeArc l_arc(tok->arc_.ilabel,
-                     tok->arc_.olabel,
-                     LatticeWeight(graph_cost, ac_cost),
-                     tok->arc_.nextstate);
-    arcs_reverse.push_back(l_arc);
-  }
-  if(arcs_reverse.back().nextstate == fst_.Start()) {
-    arcs_reverse.pop_back();  // that was a "fake" token... gives no info.
-  }
-  StateId cur_state = out_fst->AddState();
-  out_fst->SetStart(cur_state);
-  for (ssize_t i = static_cast<ssize_t>(arcs_reverse.size())-1; i >= 0; i--) {
-    LatticeArc arc = arcs_reverse[i];
-    arc.nextstate = out_fst->AddState();
-    out_fst->AddArc(cur_state, arc);
-    cur_state = arc.nextstate;
-  }
-  if (is_final) {
-    Weight final_weight = fst_.Final(start->arc_.nextstate);
-    out_fst->SetFinal(cur_state, LatticeWeight(final_weight.Value(), 0.0));
-  } else {
-    out_fst->SetFinal(cur_state, LatticeWeight::One());
-  }
-  RemoveEpsLocal(out_fst);
-}
-
-
-void OnlineFasterDecoder::UpdateImmortalToken() {
-  unordered_set<Token*> emitting;
-  for (const Elem *e = toks_.GetList(); e != NULL; e = e->tail) {
-    Token* tok = e->val;
-    while (tok->arc_.ilabel == 0) //deal with non-emitting ones ...
-      tok = tok->prev_;
-    if (tok != NULL)
-      emitting.insert(tok);
-  }
-  Token* the_one = NULL;
-  while (1) {
-    if (emitting.size() == 1) {
-      the_one = *(emitting.begin());
-      break;
-    }
-    if (emitting.size() == 0)
-      break;
-    unordered_set<Token*> prev_emitting;
-    unordered_set<Token*>::iterator it;
-    for (it = emitting.begin(); it != emitting.end(); ++it) {
-      Token* tok = *it;
-      Token* prev_token = tok->prev_;
-      while ((prev_token != NULL) && (prev_token->arc_.ilabel == 0))
-        prev_token = prev_token->prev_; //deal with non-emitting ones
-      if (prev_token == NULL)
-        continue;
-      prev_emitting.insert(prev_token);
-    } // for
-    emitting = prev_emitting;
-  } // while
-  if (the_one != NULL) {
-    prev_immortal_tok_ = immortal_tok_;
-    immortal_tok_ = the_one;
-    return;
-  }
-}
-
-
-bool
-OnlineFasterDecoder::PartialTraceback(fst::MutableFst<LatticeArc> *out_fst) {
-  UpdateImmortalToken();
-  if(immortal_tok_ == prev_immortal_tok_)
-    return false; //no partial traceback at that point of time
-  MakeLattice(immortal_tok_, prev_immortal_tok_, out_fst);
-  return true;
-}
-
-
-void
-OnlineFasterDecoder::FinishTraceBack(fst::MutableFst<LatticeArc> *out_fst) {
-  Token *best_tok = NULL;
-  bool is_final = ReachedFinal();
-  if (!is_final) {
-    for (const Elem *e = toks_.GetList(); e != NULL; e = e->tail)
-      if (best_tok == NULL || *best_tok < *(e->val) )
-        best_tok = e->val;
-  } else {
-    double best_cost = std::numeric_limits<double>::infinity();
-    for (const Elem *e = toks_.GetList(); e != NULL; e = e->tail) {
-      double this_cost = e->val->cost_ + fst_.Final(e->key).Value();
-      if (this_cost != std::numeric_limits<double>::infinity() &&
-          this_cost < best_cost) {
-        best_cost = this_cost;
-        best_tok = e->val;
-      }
-    }
-  }
-  MakeLattice(best_tok, immortal_tok_, out_fst);
-}
-
-
-void
-OnlineFasterDecoder::TracebackNFrames(int32 nframes,
-                                      fst::MutableFst<LatticeArc> *out_fst) {
-  Token *best_tok = NULL;
-  for (const Elem *e = toks_.GetList(); e != NULL; e = e->tail)
-    if (best_tok == NULL || *best_tok < *(e->val) )
-      best_tok = e->val;
-  if (best_tok == NULL) {
-    out_fst->DeleteStates();
-    return;
-  }
-
-  bool is_final = false;
-  double this_cost = best_tok->cost_ +
-      fst_.Final(best_tok->arc_.nextstate).Value();
-                             
-  if (this_cost != std::numeric_limits<double>::infinity())
-    is_final = true;
-  std::vector<LatticeArc> arcs_reverse;  // arcs in reverse order.
-  for (Token *tok = best_tok; (tok != NULL) && (nframes > 0); tok = tok->prev_) {
-    if (tok->arc_.ilabel != 0) // count only the non-epsilon arcs
-      --nframes;
-    BaseFloat tot_cost = tok->cost_ -
-        (tok->prev_ ? tok->prev_->cost_ : 0.0);
-    BaseFloat graph_cost = tok->arc_.weight.Value();
-    BaseFloat ac_cost = tot_cost - graph_cost;
-    LatticeArc larc(tok->arc_.ilabel,
-                     tok->arc_.olabel,
-                     LatticeWeight(graph_cost, ac_cost),
-                     tok->arc_.nextstate);
-    arcs_reverse.push_back(larc);
-  }
-  if(arcs_reverse.back().nextstate == fst_.Start())
-    arcs_reverse.pop_back();  // that was a "fake" token... gives no info.
-  StateId cur_state = out_fst->AddState();
-  out_fst->SetStart(cur_state);
-  for (ssize_t i = static_cast<ssize_t>(arcs_reverse.size())-1; i >= 0; i--) {
-    LatticeArc arc = arcs_reverse[i];
-    arc.nextstate = out_fst->AddState();
-    out_fst->AddArc(cur_state, arc);
-    cur_state = arc.nextstate;
-  }
-  if (is_final) {
-    Weight final_weight = fst_.Final(best_tok->arc_.nextstate);
-    out_fst->SetFinal(cur_state, LatticeWeight(final_weight.Value(), 0.0));
-  } else {
-    out_fst->SetFinal(cur_state, LatticeWeight::One());
-  }
-  RemoveEpsLocal(out_fst);
-}
-
-
-bool OnlineFasterDecoder::EndOfUtterance() {
-  fst::VectorFst<LatticeArc> trace;
-  int32 sil_frm = opts_.inter_utt_sil / (1 + utt_frames_ / opts_.max_utt_len_);
-  TracebackNFrames(sil_frm, &trace);
-  std::vector<int32> isymbols;
-  fst::GetLinearSymbolSequence(trace, &isymbols,
-                               static_cast<std::vector<int32>* >(0),
-                               static_cast<LatticeArc::Weight*>(0));
-  std::vector<std::vector<int32> > split;
-  SplitToPhones(trans_model_, isymbols, &split);
-  for (size_t i = 0; i < split.size(); i++) {
-    int32 tid = split[i][0];
-    int32 phone = trans_model_.TransitionIdToPhone(tid);
-    if (silence_set_.count(phone) == 0)
-      return false;
-  }
-  return true;
-}
-
-
-OnlineFasterDecoder::DecodeState
-OnlineFasterDecoder::Decode(DecodableInterface *decodable) {
-  if (state_ == kEndFeats || state_ == kEndUtt) // 新的语音
-    ResetDecoder(state_ == kEndFeats);
-  ProcessNonemitting(std::numeric_limits<float>::max());
-  int32 batch_frame = 0;
-  Timer timer;
-  double64 tstart = timer.Elapsed(), tstart_batch = tstart;
-  BaseFloat factor = -1;
-  for (; !decodable->IsLastFrame(frame_ - 1) && batch_frame < opts_.batch_size;
-       ++frame_, ++utt_frames_, ++batch_frame) {
-    if (batch_frame != 0 && (batch_frame % opts_.update_interval) == 0) {
-      // adjust the beam if needed
-      BaseFloat tend = timer.Elapsed();
-      BaseFloat elapsed = (tend - tstart) * 1000;
-      // warning: hardcoded 10ms frames assumption!
-      factor = elapsed / (opts_.rt_max * opts_.update_interval * 10);
-      BaseFloat min_factor = (opts_.rt_min / opts_.rt_max);
-      if (factor > 1 || factor < min_factor) {
-        BaseFloat update_factor = (factor > 1)?
-            -std::min(opts_.beam_update * factor, opts_.max_beam_update):
-             std::min(opts_.beam_update / factor, opts_.max_beam_update);
-        effective_beam_ += effective_beam_ * update_factor;
-        effective_beam_ = std::min(effective_beam_, max_beam_);
-      }
-      tstart = tend;
-    }
-    if (batch_frame != 0 && (frame_ % 200) == 0)
-      // one log message at every 2 seconds assuming 10ms frames
-      KALDI_VLOG(3) << "Beam: " << effective_beam_
-          << "; Speed: "
-          << ((timer.Elapsed() - tstart_batch) * 1000) / (batch_frame*10)
-          << " xRT";
-    BaseFloat weight_cutoff = ProcessEmitting(decodable);
-    ProcessNonemitting(weight_cutoff);
-  }
-  if (batch_frame == opts_.batch_size && !decodable->IsLastFrame(frame_ - 1)) {
-    if (EndOfUtterance())
-      state_ = kEndUtt;
-    else
-      state_ = kEndBatch;
-  } else {
-    state_ = kEndFeats;
-  }
-  return state_;
-}
-
-} // namespace kaldi
+// online/online-faster-decoder.cc
+
+// Copyright 2012 Cisco Systems (author: Matthias Paulik)
+
+//   Modifications to the original contribution by Cisco Systems made by:
+//   Vassil Panayotov
+
+// See ../../COPYING for clarification regarding multiple authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//  http://www.apache.org/licenses/LICENSE-2.0
+//
+// THIS CODE IS PROVIDED *AS IS* BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, EITHER EXPRESS OR IMPLIED, INCLUDING WITHOUT LIMITATION ANY IMPLIED
+// WARRANTIES OR CONDITIONS OF TITLE, FITNESS FOR A PARTICULAR PURPOSE,
+// MERCHANTABLITY OR NON-INFRINGEMENT.
+// See the Apache 2 License for the specific language governing permissions and
+// limitations under the License.
+
+#include "base/timer.h"
+#include "online-faster-decoder.h"
+#include "fstext/fstext-utils.h"
+
+namespace kaldi {
+
+void GetSilenceTransitions(const TransitionModel &trans_model,
+                           const std::vector<int32> &sil_phones,
+                           std::vector<bool> *silence_tids) {
+  std::vector<bool> is_sil_phone;
+  for (size_t i = 0; i < sil_phones.size(); i++) {
+    KALDI_ASSERT(sil_phones[i] > 0);
+    if (sil_phones[i] >= static_cast<int32>(is_sil_phone.size()))
+      is_sil_phone.resize(sil_phones[i] + 1, false);
+    is_sil_phone[sil_phones[i]] = true;
+  }
+  int32 num_tids = trans_model.NumTransitionIds();
+  silence_tids->assign(num_tids + 1, false);
+  for (int32 tid = 1; tid <= num_tids; tid++) {
+    int32 phone = trans_model.TransitionIdToPhone(tid);
+    (*silence_tids)[tid] = (phone < static_cast<int32>(is_sil_phone.size()) &&
+                            is_sil_phone[phone]);
+  }
+}
+
+
+OnlineFasterDecoder::OnlineFasterDecoder(const fst::Fst<fst::StdArc> &fst,
+                                         const OnlineFasterDecoderOpts &opts,
+                                         const std::vector<int32> &sil_phones,
+                                         const TransitionModel &trans_model)
+    : FasterDecoder(fst, opts), opts_(opts),
+      max_beam_(opts.beam), effective_beam_(FasterDecoder::config_.beam),
+      default_beam_controller_(opts.rt_min, opts.rt_max, opts.beam_update,
+                               opts.max_beam_update, opts.beam),
+      beam_controller_(&default_beam_controller_), frame_shift_(0.01),
+      keep_batch_stats_(false), state_(kEndFeats), frame_(0), utt_frames_(0),
+      batch_frame_(0), batch_time_(0.0), beam_update_time_(0.0),
+      num_active_toks_(0),
+      sil_tok_(NULL), sil_tok_frame_(-1), sil_tok_count_(0) {
+  // Precompute which transition-ids belong to silence phones, so that the
+  // endpointing does not have to map them to phones on every check.
+  GetSilenceTransitions(trans_model, sil_phones, &silence_tids_);
+}
+
+
+void OnlineFasterDecoder::ResetDecoder(bool full) {
+  // Nothing survives the end of the utterance, so instead of releasing the
+  // tokens one by one, the hash elements are given back and the whole pool is
+  // reset.
+  for (Elem *e = toks_.Clear(), *e_tail; e != NULL; e = e_tail) {
+    e_tail = e->tail;
+    toks_.Delete(e);
+  }
+  token_pool_.Reset();
+  StateId start_state = fst_.Start();
+  KALDI_ASSERT(start_state != fst::kNoStateId);
+  Arc dummy_arc(0, 0, Weight::One(), start_state);
+  Token *dummy_token = NewToken(dummy_arc, NULL);
+  toks_.Insert(start_state, dummy_token);
+  num_active_toks_ = 1;
+  prev_immortal_tok_ = immortal_tok_ = dummy_token;
+  sil_tok_ = NULL;
+  utt_frames_ = 0;
+  if (full)
+    frame_ = 0;
+  // ProcessEmitting() asks the decodable for frame "num_frames_decoded_".
+  num_frames_decoded_ = frame_;
+}
+
+
+void OnlineFasterDecoder::InitDecoding() {
+  ResetDecoder(true);
+  ProcessNonemitting(std::numeric_limits<float>::max());
+  num_frames_decoded_ = 0;
+}
+
+
+void OnlineFasterDecoder::ClearToks(Elem *list) {
+  for (Elem *e = list, *e_tail; e != NULL; e = e_tail) {
+    TokenRelease(e->val);
+    e_tail = e->tail;
+    toks_.Delete(e);
+  }
+}
+
+
+// The same as FasterDecoder::ProcessEmitting(), except for the allocation of
+// the tokens.
+double OnlineFasterDecoder::ProcessEmitting(DecodableInterface *decodable) {
+  int32 frame = num_frames_decoded_;
+  Elem *last_toks = toks_.Clear();
+  num_active_toks_ = 0;
+  size_t tok_cnt;
+  BaseFloat adaptive_beam;
+  Elem *best_elem = NULL;
+  double weight_cutoff = GetCutoff(last_toks, &tok_cnt,
+                                   &adaptive_beam, &best_elem);
+  KALDI_VLOG(3) << tok_cnt << " tokens active.";
+  PossiblyResizeHash(tok_cnt);
+
+  // This is the cutoff we use after adding in the log-likes (i.e.
+  // for the next frame).  This is a bound on the cutoff we will use
+  // on the next frame.
+  double next_weight_cutoff = std::numeric_limits<double>::infinity();
+
+  // First process the best token to get a hopefully
+  // reasonably tight bound on the next cutoff.
+  if (best_elem) {
+    StateId state = best_elem->key;
+    Token *tok = best_elem->val;
+    for (fst::ArcIterator<fst::Fst<Arc> > aiter(fst_, state);
+         !aiter.Done(); aiter.Next()) {
+      const Arc &arc = aiter.Value();
+      if (arc.ilabel != 0) {
+        BaseFloat ac_cost = - decodable->LogLikelihood(frame, arc.ilabel);
+        double new_weight = arc.weight.Value() + tok->cost_ + ac_cost;
+        if (new_weight + adaptive_beam < next_weight_cutoff)
+          next_weight_cutoff = new_weight + adaptive_beam;
+      }
+    }
+  }
+
+  for (Elem *e = last_toks, *e_tail; e != NULL; e = e_tail) {
+    StateId state = e->key;
+    Token *tok = e->val;
+    if (tok->cost_ < weight_cutoff) {  // not pruned.
+      KALDI_ASSERT(state == tok->arc_.nextstate);
+      for (fst::ArcIterator<fst::Fst<Arc> > aiter(fst_, state);
+           !aiter.Done(); aiter.Next()) {
+        const Arc &arc = aiter.Value();
+        if (arc.ilabel != 0) {  // we'd propagate..
+          BaseFloat ac_cost = - decodable->LogLikelihood(frame, arc.ilabel);
+          double new_weight = arc.weight.Value() + tok->cost_ + ac_cost;
+          if (new_weight < next_weight_cutoff) {  // not pruned..
+            Token *new_tok = NewToken(arc, ac_cost, tok);
+            Elem *e_found = toks_.Find(arc.nextstate);
+            if (new_weight + adaptive_beam < next_weight_cutoff)
+              next_weight_cutoff = new_weight + adaptive_beam;
+            if (e_found == NULL) {
+              toks_.Insert(arc.nextstate, new_tok);
+              num_active_toks_++;
+            } else {
+              if (*(e_found->val) < *new_tok) {
+                TokenRelease(e_found->val);
+                e_found->val = new_tok;
+              } else {
+                TokenRelease(new_tok);
+              }
+            }
+          }
+        }
+      }
+    }
+    e_tail = e->tail;
+    TokenRelease(e->val);
+    toks_.Delete(e);
+  }
+  num_frames_decoded_++;
+  return next_weight_cutoff;
+}
+
+
+// The same as FasterDecoder::ProcessNonemitting(), except for the allocation
+// of the tokens.
+void OnlineFasterDecoder::ProcessNonemitting(double cutoff) {
+  KALDI_ASSERT(nonemit_queue_.empty());
+  for (const Elem *e = toks_.GetList(); e != NULL;  e = e->tail)
+    nonemit_queue_.push_back(e->key);
+  while (!nonemit_queue_.empty()) {
+    StateId state = nonemit_queue_.back();
+    nonemit_queue_.pop_back();
+    Token *tok = toks_.Find(state)->val;
+    if (tok->cost_ > cutoff)  // don't bother processing successors.
+      continue;
+    KALDI_ASSERT(state == tok->arc_.nextstate);
+    for (fst::ArcIterator<fst::Fst<Arc> > aiter(fst_, state);
+         !aiter.Done(); aiter.Next()) {
+      const Arc &arc = aiter.Value();
+      if (arc.ilabel == 0) {  // propagate nonemitting only...
+        Token *new_tok = NewToken(arc, tok);
+        if (new_tok->cost_ > cutoff) {  // prune
+          TokenRelease(new_tok);
+        } else {
+          Elem *e_found = toks_.Find(arc.nextstate);
+          if (e_found == NULL) {
+            toks_.Insert(arc.nextstate, new_tok);
+            num_active_toks_++;
+            nonemit_queue_.push_back(arc.nextstate);
+          } else {
+            if (*(e_found->val) < *new_tok) {
+              TokenRelease(e_found->val);
+              e_found->val = new_tok;
+              nonemit_queue_.push_back(arc.nextstate);
+            } else {
+              TokenRelease(new_tok);
+            }
+          }
+        }
+      }
+    }
+  }
+}
+
+
+void OnlineFasterDecoder::TraceBackPath(const Token *start, const Token *end,
+                                        int32 max_frames,
+                                        std::vector<const Token*> *path) const {
+  path->clear();
+  for (const Token *tok = start; tok != end && tok != NULL && max_frames > 0;
+       tok = tok->prev_) {
+    if (tok->arc_.ilabel != 0) // count only the non-epsilon arcs
+      --max_frames;
+    path->push_back(tok);
+  }
+  if (!path->empty() && path->back()->prev_ == NULL)
+    path->pop_back();  // that was a "fake" token... gives no info.
+}
+
+
+void
+OnlineFasterDecoder::MakeLattice(const Token *start,
+                                 const std::vector<const Token*> &path,
+                                 fst::MutableFst<LatticeArc> *out_fst) const {
+  out_fst->DeleteStates();
+  if (start == NULL) return;
+  StateId cur_state = out_fst->AddState();
+  out_fst->SetStart(cur_state);
+  for (ssize_t i = static_cast<ssize_t>(path.size())-1; i >= 0; i--) {
+    const Token *tok = path[i];
+    BaseFloat tot_cost = tok->cost_ -
+        (tok->prev_ ? tok->prev_->cost_ : 0.0),
+        graph_cost = tok->arc_.weight.Value(),
+        ac_cost = tot_cost - graph_cost;
+    StateId next_state = out_fst->AddState();
+    out_fst->AddArc(cur_state, LatticeArc(tok->arc_.ilabel,
+                                          tok->arc_.olabel,
+                                          LatticeWeight(graph_cost, ac_cost),
+                                          next_state));
+    cur_state = next_state;
+  }
+  Weight final_weight = fst_.Final(start->arc_.nextstate);
+  if (final_weight != Weight::Zero())
+    out_fst->SetFinal(cur_state, LatticeWeight(final_weight.Value(), 0.0));
+  else
+    out_fst->SetFinal(cur_state, LatticeWeight::One());
+  RemoveEpsLocal(out_fst);
+}
+
+
+void OnlineFasterDecoder::PathToWords(const std::vector<const Token*> &path,
+                                      std::vector<int32> *word_ids) {
+  word_ids->clear();
+  for (ssize_t i = static_cast<ssize_t>(path.size())-1; i >= 0; i--)
+    if (path[i]->arc_.olabel != 0)
+      word_ids->push_back(path[i]->arc_.olabel);
+}
+
+
+void OnlineFasterDecoder::PathToLabels(
+    const std::vector<const Token*> &path,
+    std::vector<std::pair<int32, int32> > *labels) {
+  labels->clear();
+  for (ssize_t i = static_cast<ssize_t>(path.size())-1; i >= 0; i--) {
+    const Arc &arc = path[i]->arc_;
+    if (arc.ilabel != 0 || arc.olabel != 0)
+      labels->push_back(std::make_pair(arc.ilabel, arc.olabel));
+  }
+}
+
+
+OnlineFasterDecoder::Token *OnlineFasterDecoder::BestToken() const {
+  Token *best_tok = NULL;
+  for (const Elem *e = toks_.GetList(); e != NULL; e = e->tail)
+    if (best_tok == NULL || *best_tok < *(e->val) )
+      best_tok = e->val;
+  return best_tok;
+}
+
+
+OnlineFasterDecoder::Token *OnlineFasterDecoder::BestFinalToken() const {
+  if (!ReachedFinal())
+    return BestToken();
+  Token *best_tok = NULL;
+  double best_cost = std::numeric_limits<double>::infinity();
+  for (const Elem *e = toks_.GetList(); e != NULL; e = e->tail) {
+    double this_cost = e->val->cost_ + fst_.Final(e->key).Value();
+    if (this_cost != std::numeric_limits<double>::infinity() &&
+        this_cost < best_cost) {
+      best_cost = this_cost;
+      best_tok = e->val;
+    }
+  }
+  return best_tok;
+}
+
+
+void OnlineFasterDecoder::UpdateImmortalToken() {
+  const Elem *head = toks_.GetList();
+  if (head == NULL)
+    return;
+  prev_immortal_tok_ = immortal_tok_;
+  immortal_tok_ = FindImmortalToken(head->val, immortal_tok_);
+}
+
+
+bool
+OnlineFasterDecoder::PartialTraceback(fst::MutableFst<LatticeArc> *out_fst) {
+  UpdateImmortalToken();
+  if(immortal_tok_ == prev_immortal_tok_)
+    return false; //no partial traceback at that point of time
+  TraceBackPath(immortal_tok_, prev_immortal_tok_,
+                std::numeric_limits<int32>::max(), &path_);
+  MakeLattice(immortal_tok_, path_, out_fst);
+  return true;
+}
+
+
+bool OnlineFasterDecoder::PartialTraceback(std::vector<int32> *word_ids) {
+  UpdateImmortalToken();
+  if(immortal_tok_ == prev_immortal_tok_)
+    return false; //no partial traceback at that point of time
+  TraceBackPath(immortal_tok_, prev_immortal_tok_,
+                std::numeric_limits<int32>::max(), &path_);
+  PathToWords(path_, word_ids);
+  return true;
+}
+
+
+bool OnlineFasterDecoder::PartialTraceback(
+    std::vector<std::pair<int32, int32> > *labels) {
+  UpdateImmortalToken();
+  if(immortal_tok_ == prev_immortal_tok_)
+    return false; //no partial traceback at that point of time
+  TraceBackPath(immortal_tok_, prev_immortal_tok_,
+                std::numeric_limits<int32>::max(), &path_);
+  PathToLabels(path_, labels);
+  return true;
+}
+
+
+void
+OnlineFasterDecoder::FinishTraceBack(fst::MutableFst<LatticeArc> *out_fst) {
+  Token *best_tok = BestFinalToken();
+  TraceBackPath(best_tok, immortal_tok_, std::numeric_limits<int32>::max(),
+                &path_);
+  MakeLattice(best_tok, path_, out_fst);
+}
+
+
+void OnlineFasterDecoder::FinishTraceBack(std::vector<int32> *word_ids) {
+  TraceBackPath(BestFinalToken(), immortal_tok_,
+                std::numeric_limits<int32>::max(), &path_);
+  PathToWords(path_, word_ids);
+}
+
+
+void OnlineFasterDecoder::FinishTraceBack(
+    std::vector<std::pair<int32, int32> > *labels) {
+  TraceBackPath(BestFinalToken(), immortal_tok_,
+                std::numeric_limits<int32>::max(), &path_);
+  PathToLabels(path_, labels);
+}
+
+
+int32 OnlineFasterDecoder::TrailingSilenceFrames(int32 max_frames) {
+  const Token *best = BestToken();
+  int32 frame = frame_ - 1; // the frame of the next emitting token on the path
+  int32 num_sil = 0;
+  const Token *tok = best;
+  for (; tok != NULL && num_sil < max_frames; tok = tok->prev_) {
+    if (tok == sil_tok_ && frame == sil_tok_frame_) {
+      // The rest of the path was already looked at by the previous call.
+      num_sil = std::min(num_sil + sil_tok_count_, max_frames);
+      break;
+    }
+    int32 tid = tok->arc_.ilabel;
+    if (tid == 0)
+      continue;
+    if (!silence_tids_[tid])
+      break;
+    ++num_sil;
+    --frame;
+  }
+  if (tok == NULL) // reached the start of the utterance
+    num_sil = max_frames;
+  sil_tok_ = best;
+  sil_tok_frame_ = frame_ - 1;
+  sil_tok_count_ = num_sil;
+  return num_sil;
+}
+
+
+BaseFloat OnlineFasterDecoder::FinalRelativeCost() const {
+  double best_cost = std::numeric_limits<double>::infinity(),
+      best_final_cost = std::numeric_limits<double>::infinity();
+  for (const Elem *e = toks_.GetList(); e != NULL; e = e->tail) {
+    double cost = e->val->cost_;
+    best_cost = std::min(best_cost, cost);
+    best_final_cost = std::min(best_final_cost,
+                               cost + fst_.Final(e->key).Value());
+  }
+  if (best_final_cost == std::numeric_limits<double>::infinity())
+    return std::numeric_limits<BaseFloat>::infinity();
+  return best_final_cost - best_cost;
+}
+
+
+bool OnlineFasterDecoder::EndOfUtterance() {
+  if (opts_.force_utt_len > 0 && utt_frames_ >= opts_.force_utt_len)
+    return true;
+  int32 sil_frm = opts_.inter_utt_sil / (1 + utt_frames_ / opts_.max_utt_len_);
+  if (TrailingSilenceFrames(sil_frm) < sil_frm)
+    return false;
+  if (opts_.endpoint_rel_cost > 0.0 &&
+      FinalRelativeCost() > opts_.endpoint_rel_cost)
+    return false;
+  return true;
+}
+
+
+void OnlineFasterDecoder::SetBeamController(
+    OnlineBeamControllerItf *controller) {
+  beam_controller_ = (controller != NULL ? controller :
+                      &default_beam_controller_);
+  beam_controller_->SetFrameShift(frame_shift_);
+}
+
+
+void OnlineFasterDecoder::SetFrameShift(BaseFloat frame_shift) {
+  KALDI_ASSERT(frame_shift > 0.0);
+  frame_shift_ = frame_shift;
+  beam_controller_->SetFrameShift(frame_shift);
+}
+
+
+void OnlineFasterDecoder::GetBatchStats(
+    std::vector<OnlineDecodeBatchStats> *stats) {
+  stats->insert(stats->end(), batch_stats_.begin(), batch_stats_.end());
+  batch_stats_.clear();
+}
+
+
+OnlineFasterDecoder::DecodeState
+OnlineFasterDecoder::Decode(DecodableInterface *decodable) {
+  return Decode(decodable, -1);
+}
+
+OnlineFasterDecoder::DecodeState
+OnlineFasterDecoder::Decode(DecodableInterface *decodable, int32 max_frames) {
+  KALDI_ASSERT(max_frames != 0);
+  if (state_ == kEndFeats || state_ == kEndUtt) // 新的语音
+    ResetDecoder(state_ == kEndFeats);
+  if (state_ != kEndStep) { // a new batch
+    ProcessNonemitting(std::numeric_limits<float>::max());
+    batch_frame_ = 0;
+    batch_time_ = beam_update_time_ = 0.0;
+  }
+  Timer timer;
+  // log the speed about every 2 seconds of audio
+  int32 log_interval = std::max(1, static_cast<int32>(2.0 / frame_shift_));
+  for (int32 num_frames = 0;
+       !decodable->IsLastFrame(frame_ - 1) && batch_frame_ < opts_.batch_size &&
+           (max_frames < 0 || num_frames < max_frames);
+       ++frame_, ++utt_frames_, ++batch_frame_, ++num_frames) {
+    if (batch_frame_ != 0 && (batch_frame_ % opts_.update_interval) == 0) {
+      // adjust the beam if needed
+      double64 now = batch_time_ + timer.Elapsed();
+      effective_beam_ = beam_controller_->Update(effective_beam_,
+                                                 now - beam_update_time_,
+                                                 opts_.update_interval,
+                                                 NumActiveTokens());
+      beam_update_time_ = now;
+    }
+    if (batch_frame_ != 0 && (frame_ % log_interval) == 0) {
+      KALDI_VLOG(3) << "Beam: " << effective_beam_
+          << "; Speed: " << (batch_time_ + timer.Elapsed()) /
+          (batch_frame_ * frame_shift_) << " xRT";
+    }
+    BaseFloat weight_cutoff = ProcessEmitting(decodable);
+    ProcessNonemitting(weight_cutoff);
+  }
+  batch_time_ += timer.Elapsed();
+  bool last_frame = decodable->IsLastFrame(frame_ - 1);
+  if (batch_frame_ < opts_.batch_size && !last_frame) {
+    state_ = kEndStep;
+    return state_;
+  }
+  if (keep_batch_stats_ && batch_frame_ > 0) {
+    OnlineDecodeBatchStats stats;
+    stats.frame = frame_;
+    stats.num_frames = batch_frame_;
+    stats.beam = effective_beam_;
+    stats.rtf = batch_time_ / (batch_frame_ * frame_shift_);
+    stats.num_tokens = NumActiveTokens();
+    batch_stats_.push_back(stats);
+  }
+  if (batch_frame_ == opts_.batch_size && !last_frame) {
+    if (EndOfUtterance())
+      state_ = kEndUtt;
+    else
+      state_ = kEndBatch;
+  } else {
+    state_ = kEndFeats;
+  }
+  return state_;
+}
+
+} // namespace kaldi
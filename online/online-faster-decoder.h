@@ -1,136 +1,316 @@
-// online/online-faster-decoder.h
-
-// Copyright 2012 Cisco Systems (author: Matthias Paulik)
-
-//   Modifications to the original contribution by Cisco Systems made by:
-//   Vassil Panayotov
-
-// See ../../COPYING for clarification regarding multiple authors
-//
-// Licensed under the Apache License, Version 2.0 (the "License");
-// you may not use this file except in compliance with the License.
-// You may obtain a copy of the License at
-//
-//  http://www.apache.org/licenses/LICENSE-2.0
-//
-// THIS CODE IS PROVIDED *AS IS* BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
-// KIND, EITHER EXPRESS OR IMPLIED, INCLUDING WITHOUT LIMITATION ANY IMPLIED
-// WARRANTIES OR CONDITIONS OF TITLE, FITNESS FOR A PARTICULAR PURPOSE,
-// MERCHANTABLITY OR NON-INFRINGEMENT.
-// See the Apache 2 License for the specific language governing permissions and
-// limitations under the License.
-
-#ifndef KALDI_ONLINE_ONLINE_FASTER_DECODER_H_
-#define KALDI_ONLINE_ONLINE_FASTER_DECODER_H_
-
-#include "util/stl-utils.h"
-#include "decoder/faster-decoder.h"
-#include "hmm/transition-model.h"
-
-namespace kaldi {
-
-// Extends the definition of FasterDecoder's options to include additional
-// parameters. The meaning of the "beam" option is also redefined as
-// the _maximum_ beam value allowed.
-struct OnlineFasterDecoderOpts : public FasterDecoderOptions {
-  BaseFloat rt_min; // minimum decoding runtime factor
-  BaseFloat rt_max; // maximum decoding runtime factor
-  int32 batch_size; // number of features decoded in one go
-  int32 inter_utt_sil; // minimum silence (#frames) to trigger end of utterance
-  int32 max_utt_len_; // if utt. is longer, we accept shorter silence as utt. separators
-  int32 update_interval; // beam update period in # of frames
-  BaseFloat beam_update; // rate of adjustment of the beam
-  BaseFloat max_beam_update; // maximum rate of beam adjustment
-
-  OnlineFasterDecoderOpts() :
-    rt_min(.7), rt_max(.75), batch_size(27),
-    inter_utt_sil(50), max_utt_len_(1500),
-    update_interval(3), beam_update(.01),
-    max_beam_update(0.05) {}
-
-  void Register(OptionsItf *opts, bool full) {
-    FasterDecoderOptions::Register(opts, full);
-    opts->Register("rt-min", &rt_min,
-                   "Approximate minimum decoding run time factor");
-    opts->Register("rt-max", &rt_max,
-                   "Approximate maximum decoding run time factor");
-    opts->Register("update-interval", &update_interval,
-                   "Beam update interval in frames");
-    opts->Register("beam-update", &beam_update, "Beam update rate");
-    opts->Register("max-beam-update", &max_beam_update, "Max beam update rate");
-    opts->Register("inter-utt-sil", &inter_utt_sil,
-                   "Maximum # of silence frames to trigger new utterance");
-    opts->Register("max-utt-length", &max_utt_len_,
-                   "If the utterance becomes longer than this number of frames, "
-                   "shorter silence is acceptable as an utterance separator");
-  }
-};
-
-//继承自fasterdecoder
-class OnlineFasterDecoder : public FasterDecoder {
- public:
-  // Codes returned by Decode() to show the current state of the decoder
-  //默认情况下枚举值第一个为0 第二个为1 以此类推
-  enum DecodeState {
-    kEndFeats = 1, // No more scores are available from the Decodable
-    kEndUtt = 2, // End of utterance, caused by e.g. a sufficiently long silence语音结束
-    kEndBatch = 4 // End of batch - end of utterance not reached yet块终止
-  };
-
-  // "sil_phones" - 所有静音音素的id
-  OnlineFasterDecoder(const fst::Fst<fst::StdArc> &fst,
-                      const OnlineFasterDecoderOpts &opts,
-                      const std::vector<int32> &sil_phones,
-                      const TransitionModel &trans_model)
-      : FasterDecoder(fst, opts), opts_(opts),
-        silence_set_(sil_phones), trans_model_(trans_model),
-        max_beam_(opts.beam), effective_beam_(FasterDecoder::config_.beam),
-        state_(kEndFeats), frame_(0), utt_frames_(0) {}
-
-  DecodeState Decode(DecodableInterface *decodable);
-  
-  // Makes a linear graph, by tracing back from the last "immortal" token
-  // to the previous one
-  bool PartialTraceback(fst::MutableFst<LatticeArc> *out_fst);
-
-  // Makes a linear graph, by tracing back from the best currently active token
-  // to the last immortal token. This method is meant to be invoked at the end
-  // of an utterance in order to get the last chunk of the hypothesis
-  //通过从当前最活跃标记到最后一个恒定标记的追溯生成一个线性图。该方法在语音的结束阶段被调用
-  void FinishTraceBack(fst::MutableFst<LatticeArc> *fst_out);
-
-  // Returns "true" if the best current hypothesis ends with long enough silence
-  bool EndOfUtterance();
-
-  int32 frame() { return frame_; }
-
- private:
-  void ResetDecoder(bool full);
-
-  // Returns a linear fst by tracing back the last N frames, beginning
-  // from the best current token
-  void TracebackNFrames(int32 nframes, fst::MutableFst<LatticeArc> *out_fst);
-
-  // Makes a linear "lattice", by tracing back a path delimited by two tokens
-  void MakeLattice(const Token *start,
-                   const Token *end,
-                   fst::MutableFst<LatticeArc> *out_fst) const;
-
-  // Searches for the last token, ancestor of all currently active tokens
-  void UpdateImmortalToken();
-
-  const OnlineFasterDecoderOpts opts_;
-  const ConstIntegerSet<int32> silence_set_; // silence phones IDs
-  const TransitionModel &trans_model_; // needed for trans-id -> phone conversion
-  const BaseFloat max_beam_; // the maximum allowed beam
-  BaseFloat &effective_beam_; // the currently used beam
-  DecodeState state_; // the current state of the decoder当前的解码器状态
-  int32 frame_; // the next frame to be processed需要被处理的下一个帧
-  int32 utt_frames_; // # frames processed from the current utterance从当前语音中处理的帧
-  Token *immortal_tok_;      // "immortal" token means it's an ancestor of ...
-  Token *prev_immortal_tok_; // ... all currently active tokens
-  KALDI_DISALLOW_COPY_AND_ASSIGN(OnlineFasterDecoder);
-};
-
-} // namespace kaldi
-#endif // KALDI_ONLINE_ONLINE_FASTER_DECODER_H_
+// online/online-faster-decoder.h
+
+// Copyright 2012 Cisco Systems (author: Matthias Paulik)
+
+//   Modifications to the original contribution by Cisco Systems made by:
+//   Vassil Panayotov
+
+// See ../../COPYING for clarification regarding multiple authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//  http://www.apache.org/licenses/LICENSE-2.0
+//
+// THIS CODE IS PROVIDED *AS IS* BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, EITHER EXPRESS OR IMPLIED, INCLUDING WITHOUT LIMITATION ANY IMPLIED
+// WARRANTIES OR CONDITIONS OF TITLE, FITNESS FOR A PARTICULAR PURPOSE,
+// MERCHANTABLITY OR NON-INFRINGEMENT.
+// See the Apache 2 License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef KALDI_ONLINE_ONLINE_FASTER_DECODER_H_
+#define KALDI_ONLINE_ONLINE_FASTER_DECODER_H_
+
+#include <type_traits>
+
+#include "util/stl-utils.h"
+#include "decoder/faster-decoder.h"
+#include "hmm/transition-model.h"
+#include "online/online-beam-controller.h"
+#include "online/online-immortal-token.h"
+#include "online/online-token-pool.h"
+
+namespace kaldi {
+
+// Extends the definition of FasterDecoder's options to include additional
+// parameters. The meaning of the "beam" option is also redefined as
+// the _maximum_ beam value allowed.
+struct OnlineFasterDecoderOpts : public FasterDecoderOptions {
+  BaseFloat rt_min; // minimum decoding runtime factor
+  BaseFloat rt_max; // maximum decoding runtime factor
+  int32 batch_size; // number of features decoded in one go
+  int32 inter_utt_sil; // minimum silence (#frames) to trigger end of utterance
+  int32 max_utt_len_; // if utt. is longer, we accept shorter silence as utt. separators
+  int32 force_utt_len; // if > 0, utterances longer than this (#frames) are cut
+  BaseFloat endpoint_rel_cost; // if > 0, max. cost of reaching a final state,
+                               // relative to the best cost, at an endpoint
+  int32 update_interval; // beam update period in # of frames
+  BaseFloat beam_update; // rate of adjustment of the beam
+  BaseFloat max_beam_update; // maximum rate of beam adjustment
+
+  OnlineFasterDecoderOpts() :
+    rt_min(.7), rt_max(.75), batch_size(27),
+    inter_utt_sil(50), max_utt_len_(1500),
+    force_utt_len(0), endpoint_rel_cost(0.0),
+    update_interval(3), beam_update(.01),
+    max_beam_update(0.05) {}
+
+  void Register(OptionsItf *opts, bool full) {
+    FasterDecoderOptions::Register(opts, full);
+    opts->Register("rt-min", &rt_min,
+                   "Approximate minimum decoding run time factor");
+    opts->Register("rt-max", &rt_max,
+                   "Approximate maximum decoding run time factor");
+    opts->Register("update-interval", &update_interval,
+                   "Beam update interval in frames");
+    opts->Register("beam-update", &beam_update, "Beam update rate");
+    opts->Register("max-beam-update", &max_beam_update, "Max beam update rate");
+    opts->Register("inter-utt-sil", &inter_utt_sil,
+                   "Maximum # of silence frames to trigger new utterance");
+    opts->Register("max-utt-length", &max_utt_len_,
+                   "If the utterance becomes longer than this number of frames, "
+                   "shorter silence is acceptable as an utterance separator");
+    opts->Register("force-utt-length", &force_utt_len,
+                   "If > 0, the utterance is ended after this many frames, "
+                   "even if no silence was detected");
+    opts->Register("endpoint-relative-cost", &endpoint_rel_cost,
+                   "If > 0, a silence only ends the utterance if the best "
+                   "hypothesis that is in a final state costs at most this "
+                   "much more than the overall best one");
+  }
+};
+
+// Decoding statistics for one call to OnlineFasterDecoder::Decode()
+struct OnlineDecodeBatchStats {
+  int32 frame; // the first frame after the batch
+  int32 num_frames; // number of frames decoded in the batch
+  BaseFloat beam; // the beam at the end of the batch
+  BaseFloat rtf; // real-time factor of the batch
+  int32 num_tokens; // active tokens at the end of the batch
+};
+
+// Outputs a vector, indexed by transition-id (element 0 is unused), which is
+// true for the transitions of the phones in "sil_phones".
+void GetSilenceTransitions(const TransitionModel &trans_model,
+                           const std::vector<int32> &sil_phones,
+                           std::vector<bool> *silence_tids);
+
+//继承自fasterdecoder
+class OnlineFasterDecoder : public FasterDecoder {
+ public:
+  // Codes returned by Decode() to show the current state of the decoder
+  //默认情况下枚举值第一个为0 第二个为1 以此类推
+  enum DecodeState {
+    kEndFeats = 1, // No more scores are available from the Decodable
+    kEndUtt = 2, // End of utterance, caused by e.g. a sufficiently long silence语音结束
+    kEndBatch = 4, // End of batch - end of utterance not reached yet块终止
+    kEndStep = 8 // Only returned by Decode(decodable, max_frames): the frames
+                 // were decoded, but the batch is not finished yet
+  };
+
+  // "sil_phones" - 所有静音音素的id
+  OnlineFasterDecoder(const fst::Fst<fst::StdArc> &fst,
+                      const OnlineFasterDecoderOpts &opts,
+                      const std::vector<int32> &sil_phones,
+                      const TransitionModel &trans_model);
+
+  ~OnlineFasterDecoder() { ClearToks(toks_.Clear()); }
+
+  // Hides FasterDecoder::InitDecoding(), as the tokens are allocated
+  // differently here.
+  void InitDecoding();
+
+  DecodeState Decode(DecodableInterface *decodable);
+
+  // Like Decode(), but stops after "max_frames" frames, returning kEndStep,
+  // if the batch is not finished by then; the next call carries on with the
+  // same batch.  The batches, and so the places where the end of the
+  // utterance is looked for, are the same as with Decode(), however the
+  // frames are split up between the calls.  The beam controller only sees
+  // the time spent inside the calls.
+  DecodeState Decode(DecodableInterface *decodable, int32 max_frames);
+
+  // FasterDecoder's own frame loop would create tokens on the heap, and
+  // delete the ones from the pool; Decode() is the one to use.
+  void AdvanceDecoding(DecodableInterface *decodable,
+                       int32 max_num_frames = -1) = delete;
+
+  // Replaces the policy used to adapt the beam to the decoding speed; by
+  // default OnlineRtfBeamController, configured from the options, is used.
+  // "controller" is not owned and must outlive the decoder; NULL restores
+  // the default.
+  void SetBeamController(OnlineBeamControllerItf *controller);
+
+  // Sets the time in seconds between two feature frames (default: 0.01).
+  // It should match the frame shift of the feature extraction.
+  void SetFrameShift(BaseFloat frame_shift);
+
+  // Makes Decode() record the statistics of every batch, for GetBatchStats().
+  // Off by default.
+  void KeepBatchStats(bool keep) { keep_batch_stats_ = keep; }
+
+  // Appends the statistics of the batches decoded since the last call to
+  // "stats", and forgets them.  Callers that turned on KeepBatchStats() should
+  // call it after every Decode(), as the statistics are kept until then.
+  void GetBatchStats(std::vector<OnlineDecodeBatchStats> *stats);
+  
+  // Makes a linear graph, by tracing back from the last "immortal" token
+  // to the previous one
+  bool PartialTraceback(fst::MutableFst<LatticeArc> *out_fst);
+
+  // The same, but only outputs the word ids on the path, which does not
+  // require building an FST.
+  bool PartialTraceback(std::vector<int32> *word_ids);
+
+  // The same, but outputs the (input, output) labels of the arcs on the path,
+  // i.e. the transition-ids and word ids, 0 for none, in chronological order
+  // (see OnlineWordTimer).
+  bool PartialTraceback(std::vector<std::pair<int32, int32> > *labels);
+
+  // Makes a linear graph, by tracing back from the best currently active token
+  // to the last immortal token. This method is meant to be invoked at the end
+  // of an utterance in order to get the last chunk of the hypothesis
+  //通过从当前最活跃标记到最后一个恒定标记的追溯生成一个线性图。该方法在语音的结束阶段被调用
+  void FinishTraceBack(fst::MutableFst<LatticeArc> *fst_out);
+
+  // The same, but only outputs the word ids on the path.
+  void FinishTraceBack(std::vector<int32> *word_ids);
+
+  // The same, but outputs the labels on the path, like PartialTraceback().
+  // None of the FinishTraceBack() functions changes the state of the decoder,
+  // so they may also be called in the middle of an utterance, to get the
+  // part of the best hypothesis that is not fixed yet.
+  void FinishTraceBack(std::vector<std::pair<int32, int32> > *labels);
+
+  // Returns "true" if the current utterance should be ended here, i.e. if the
+  // best current hypothesis ends with long enough silence (and, if
+  // "endpoint-relative-cost" is set, can end in a final state cheaply enough),
+  // or if the utterance reached "force-utt-length" frames.
+  bool EndOfUtterance();
+
+  int32 frame() { return frame_; }
+
+  // The number of tokens created so far, and the number of slabs of memory
+  // the token pool had to get from the system for them.
+  int64 NumTokensAllocated() const { return token_pool_.NumAllocs(); }
+  int32 NumTokenSlabs() const { return token_pool_.NumSlabs(); }
+
+ private:
+  void ResetDecoder(bool full);
+
+  // Collects the tokens on the path from "start" back to "end" (exclusive),
+  // or until "max_frames" emitting tokens have been collected, into "path",
+  // in reverse order. The "fake" start token of the utterance is never
+  // included.  "path" is meant to be a reused buffer, so this does not
+  // allocate memory once the buffer has grown large enough.
+  void TraceBackPath(const Token *start, const Token *end, int32 max_frames,
+                     std::vector<const Token*> *path) const;
+
+  // Makes a linear "lattice" out of a path produced by TraceBackPath(),
+  // "start" being the token the path was traced back from.
+  void MakeLattice(const Token *start,
+                   const std::vector<const Token*> &path,
+                   fst::MutableFst<LatticeArc> *out_fst) const;
+
+  // Outputs the (non-epsilon) output labels on a path produced by
+  // TraceBackPath(), in chronological order.
+  static void PathToWords(const std::vector<const Token*> &path,
+                          std::vector<int32> *word_ids);
+
+  // Outputs the labels on a path produced by TraceBackPath(), in
+  // chronological order, leaving out the arcs with none.
+  static void PathToLabels(const std::vector<const Token*> &path,
+                           std::vector<std::pair<int32, int32> > *labels);
+
+  // Returns the active token with the lowest cost, or NULL if there is none.
+  Token *BestToken() const;
+
+  // Like BestToken(), but if any of the active tokens is in a final state,
+  // the best such token, taking the final cost into account, is returned.
+  Token *BestFinalToken() const;
+
+  // Returns the number of currently active tokens, which ProcessEmitting()
+  // and ProcessNonemitting() keep count of.
+  int32 NumActiveTokens() const { return num_active_toks_; }
+
+  // Returns the number of silence frames at the end of the best path, but at
+  // most "max_frames". If the whole utterance so far is silence, "max_frames"
+  // is returned. The result is remembered together with the best token, so
+  // on the next call only the frames decoded in between have to be looked at,
+  // as long as the best path still goes through that token.
+  int32 TrailingSilenceFrames(int32 max_frames);
+
+  // The cost of the best token in a final state (final cost included),
+  // relative to the cost of the best token; infinity if no token is final.
+  BaseFloat FinalRelativeCost() const;
+
+  // Searches for the last token, ancestor of all currently active tokens
+  // (see FindImmortalToken()).
+  void UpdateImmortalToken();
+
+  // The tokens are allocated from "token_pool_" instead of the heap, so the
+  // functions of FasterDecoder that create or delete tokens are replaced by
+  // the ones below. They are the same otherwise.
+  inline Token *NewToken(const Arc &arc, BaseFloat ac_cost, Token *prev) {
+    return new (token_pool_.Allocate()) Token(arc, ac_cost, prev);
+  }
+  inline Token *NewToken(const Arc &arc, Token *prev) {
+    return new (token_pool_.Allocate()) Token(arc, prev);
+  }
+  // Decrements the reference count of "tok", and frees it, and possibly its
+  // ancestors, when the count drops to zero; like Token::TokenDelete().
+  inline void TokenRelease(Token *tok) {
+    while (--tok->ref_count_ == 0) {
+      Token *prev = tok->prev_;
+      tok->~Token();
+      token_pool_.Free(tok);
+      if (prev == NULL)
+        return;
+      tok = prev;
+    }
+  }
+  double ProcessEmitting(DecodableInterface *decodable);
+  void ProcessNonemitting(double cutoff);
+  void ClearToks(Elem *list);
+
+  const OnlineFasterDecoderOpts opts_;
+  std::vector<bool> silence_tids_; // indexed by transition-id; true for the
+                                   // transitions of silence phones
+  const BaseFloat max_beam_; // the maximum allowed beam
+  BaseFloat &effective_beam_; // the currently used beam
+  OnlineRtfBeamController default_beam_controller_;
+  OnlineBeamControllerItf *beam_controller_; // adapts "effective_beam_"
+  BaseFloat frame_shift_; // in seconds
+  bool keep_batch_stats_;
+  std::vector<OnlineDecodeBatchStats> batch_stats_;
+  DecodeState state_; // the current state of the decoder当前的解码器状态
+  int32 frame_; // the next frame to be processed需要被处理的下一个帧
+  int32 utt_frames_; // # frames processed from the current utterance从当前语音中处理的帧
+  // The batch being decoded: its frames so far, the time spent decoding
+  // them, and that time when the beam was last updated.
+  int32 batch_frame_;
+  double64 batch_time_;
+  double64 beam_update_time_;
+  Token *immortal_tok_;      // "immortal" token means it's an ancestor of ...
+  Token *prev_immortal_tok_; // ... all currently active tokens
+  std::vector<const Token*> path_; // scratch buffer for the tracebacks
+  OnlineTokenPool<Token> token_pool_;
+  // ResetDecoder() drops all the tokens with token_pool_.Reset(), without
+  // running their destructors.
+  static_assert(std::is_trivially_destructible<Token>::value,
+                "Tokens must be trivially destructible to be dropped in bulk");
+  std::vector<StateId> nonemit_queue_; // used in ProcessNonemitting()
+  int32 num_active_toks_; // the number of elements in "toks_"
+  // The best token at the time of the last TrailingSilenceFrames() call, the
+  // frame it belongs to and its trailing silence frames. The frame is compared
+  // too, as the token itself may be gone and its address reused since then.
+  const Token *sil_tok_;
+  int32 sil_tok_frame_;
+  int32 sil_tok_count_;
+  KALDI_DISALLOW_COPY_AND_ASSIGN(OnlineFasterDecoder);
+};
+
+} // namespace kaldi
+#endif // KALDI_ONLINE_ONLINE_FASTER_DECODER_H_
@@ -0,0 +1,452 @@
+// online/online-feat-benchmark.cc
+
+// See ../../COPYING for clarification regarding multiple authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//  http://www.apache.org/licenses/LICENSE-2.0
+//
+// THIS CODE IS PROVIDED *AS IS* BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, EITHER EXPRESS OR IMPLIED, INCLUDING WITHOUT LIMITATION ANY IMPLIED
+// WARRANTIES OR CONDITIONS OF TITLE, FITNESS FOR A PARTICULAR PURPOSE,
+// MERCHANTABLITY OR NON-INFRINGEMENT.
+// See the Apache 2 License for the specific language governing permissions and
+// limitations under the License.
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <thread>
+#include <vector>
+
+#include "base/kaldi-common.h"
+#include "base/timer.h"
+#include "feat/feature-mfcc.h"
+#include "online/online-alloc-counter.h"
+#include "online/online-audio-source.h"
+#include "online/online-feat-input.h"
+#include "online/online-feat-pipeline.h"
+#include "util/common-utils.h"
+
+namespace kaldi {
+
+// The stages, in the order they are stacked; each one is benchmarked with
+// all the stages before it under it, except that LDA and deltas are
+// alternatives (like in the online decoders), and the cache and the feature
+// matrix are put on top of the deltas.
+enum BenchmarkStage {
+  kStageMfcc = 0,
+  kStageCmn,
+  kStageLda,
+  kStageDelta,
+  kStageCache,
+  kStageMatrix,
+  kNumStages
+};
+
+static const char *kStageNames[kNumStages] = {
+  "mfcc", "cmn", "lda", "delta", "cache", "matrix"
+};
+
+// The stage each one is stacked on, for working out its own cost.
+static const int32 kStageParent[kNumStages] = {
+  -1, kStageMfcc, kStageCmn, kStageCmn, kStageDelta, kStageDelta
+};
+
+struct BenchmarkResult {
+  int64 num_frames;
+  int64 num_calls;
+  double elapsed; // seconds, for the whole chain
+  int64 num_allocs; // while running, i.e. not counting the construction
+  std::vector<double> call_times; // seconds, one per call that computed
+
+  BenchmarkResult(): num_frames(0), num_calls(0), elapsed(0.0),
+                     num_allocs(0) { }
+
+  double MeanCallTimeMs() const {
+    double sum = 0.0;
+    for (size_t i = 0; i < call_times.size(); i++)
+      sum += call_times[i];
+    return (call_times.empty() ? 0.0 : sum * 1000.0 / call_times.size());
+  }
+
+  // The "q"-quantile of the time per call, in milliseconds.
+  double CallTimeMs(double q) {
+    if (call_times.empty()) return 0.0;
+    size_t n = std::min(call_times.size() - 1,
+                        static_cast<size_t>(q * call_times.size()));
+    std::nth_element(call_times.begin(), call_times.begin() + n,
+                     call_times.end());
+    return call_times[n] * 1000.0;
+  }
+};
+
+// Synthesizes "num_samples" of something with roughly the statistics of
+// speech: "syllables" of a quarter second, each with two slowly gliding
+// harmonics at a random level, some of them silent, over a noise floor.
+static void SynthesizeAudio(int64 num_samples, BaseFloat samp_freq,
+                            Vector<BaseFloat> *wave) {
+  wave->Resize(num_samples, kUndefined);
+  int32 segment = static_cast<int32>(samp_freq / 4);
+  double phase1 = 0.0, phase2 = 0.0;
+  for (int64 start = 0; start < num_samples; start += segment) {
+    bool silent = (Rand() % 5 == 0);
+    double f0 = 100.0 + 200.0 * RandUniform(),
+        formant = 300.0 + 2500.0 * RandUniform(),
+        glide = 1.0 + 0.3 * (RandUniform() - 0.5),
+        level = (silent ? 0.0 : 500.0 + 5000.0 * RandUniform());
+    int64 end = std::min(start + segment, num_samples);
+    for (int64 i = start; i < end; i++) {
+      double pos = static_cast<double>(i - start) / segment,
+          scale = 1.0 + (glide - 1.0) * pos;
+      phase1 += 2.0 * M_PI * f0 * scale / samp_freq;
+      phase2 += 2.0 * M_PI * formant * scale / samp_freq;
+      (*wave)(i) = level * (std::sin(phase1) + 0.3 * std::sin(phase2)) +
+          20.0 * RandGauss();
+    }
+    phase1 = std::fmod(phase1, 2.0 * M_PI);
+    phase2 = std::fmod(phase2, 2.0 * M_PI);
+  }
+}
+
+// Runs the chain of stages up to "stage" over all of "wave", asking for
+// "batch_size" frames at a time, and times each call to the top stage.
+static void RunStage(BenchmarkStage stage, const Vector<BaseFloat> &wave,
+                     const MfccOptions &mfcc_opts,
+                     const Matrix<BaseFloat> &lda_transform,
+                     int32 lda_context, int32 batch_size,
+                     BenchmarkResult *result) {
+  OnlineVectorSource source(wave);
+  Mfcc mfcc(mfcc_opts);
+  OnlineFeInput<Mfcc> fe_input(&source, &mfcc,
+                               mfcc_opts.frame_opts.WindowSize(),
+                               mfcc_opts.frame_opts.WindowShift());
+  OnlineCmnInput cmn_input(&fe_input, 600, 100);
+  OnlineLdaInput lda_input(&cmn_input, lda_transform,
+                           lda_context, lda_context);
+  DeltaFeaturesOptions delta_opts;
+  OnlineDeltaInput delta_input(delta_opts, &cmn_input);
+  OnlineCacheInput cache_input(&delta_input);
+  OnlineFeatInputItf *inputs[kStageMatrix] = {
+    &fe_input, &cmn_input, &lda_input, &delta_input, &cache_input
+  };
+
+  *result = BenchmarkResult();
+  result->call_times.reserve(wave.Dim() / mfcc_opts.frame_opts.WindowShift()
+                             / batch_size + 10);
+  Timer timer;
+  double call_start = 0.0;
+  int64 allocs_start;
+  if (stage == kStageMatrix) {
+    OnlineFeatureMatrixOptions matrix_opts;
+    matrix_opts.batch_size = batch_size;
+    OnlineFeatureMatrix matrix(matrix_opts, &delta_input);
+    allocs_start = NumAllocsSoFar();
+    timer.Reset();
+    for (int32 frame = 0; ; frame++) {
+      // Only the frames that are not there yet make it ask for a batch.
+      bool computes = !matrix.IsAvailable(frame);
+      if (computes) call_start = timer.Elapsed();
+      if (!matrix.IsValidFrame(frame)) break;
+      if (computes) {
+        result->call_times.push_back(timer.Elapsed() - call_start);
+        result->num_calls++;
+      }
+      matrix.GetFrame(frame);
+      result->num_frames++;
+    }
+  } else {
+    OnlineFeatInputItf *input = inputs[stage];
+    Matrix<BaseFloat> batch(batch_size, input->Dim());
+    allocs_start = NumAllocsSoFar();
+    timer.Reset();
+    bool more = true;
+    while (more) {
+      call_start = timer.Elapsed();
+      // Sizing the output is part of what the decoders do for every batch.
+      batch.Resize(batch_size, input->Dim(), kUndefined);
+      more = input->Compute(&batch);
+      result->call_times.push_back(timer.Elapsed() - call_start);
+      result->num_calls++;
+      result->num_frames += batch.NumRows();
+    }
+  }
+  result->elapsed = timer.Elapsed();
+  result->num_allocs = (allocs_start < 0 ? -1 :
+                        NumAllocsSoFar() - allocs_start);
+}
+
+// Returns exactly as many rows of a matrix as are requested, like a source
+// that always has data ready.
+class OnlineSteadyInput : public OnlineFeatInputItf {
+ public:
+  OnlineSteadyInput(const MatrixBase<BaseFloat> &feats):
+      position_(0), feats_(feats) { }
+
+  virtual int32 Dim() const { return feats_.NumCols(); }
+
+  virtual bool Compute(Matrix<BaseFloat> *output) {
+    int32 num_frames = std::min(output->NumRows(),
+                                feats_.NumRows() - position_);
+    if (num_frames == 0) {
+      output->Resize(0, 0);
+      return false;
+    }
+    output->Resize(num_frames, feats_.NumCols(), kUndefined);
+    output->CopyFromMat(feats_.RowRange(position_, num_frames));
+    position_ += num_frames;
+    return position_ < feats_.NumRows();
+  }
+
+ private:
+  int32 position_;
+  const MatrixBase<BaseFloat> &feats_;
+};
+
+// Compares the speed of OnlineLdaInput with splicing the frames and then
+// applying the transform to the spliced matrix, as it was done before, on
+// the MFCCs of "wave".
+static void BenchmarkLdaInput(const Vector<BaseFloat> &wave,
+                              const MfccOptions &mfcc_opts,
+                              const Matrix<BaseFloat> &transform,
+                              int32 context, int32 batch_size) {
+  Matrix<BaseFloat> input_feats;
+  {
+    Mfcc mfcc(mfcc_opts);
+    mfcc.Compute(wave, 1.0, &input_feats);
+  }
+  int32 num_frames = input_feats.NumRows(), dim = input_feats.NumCols(),
+      output_dim = transform.NumRows();
+
+  Timer timer;
+  {
+    OnlineSteadyInput steady_input(input_feats);
+    OnlineLdaInput lda_input(&steady_input, transform, context, context);
+    Matrix<BaseFloat> output(batch_size, output_dim);
+    while (lda_input.Compute(&output))
+      output.Resize(batch_size, output_dim, kUndefined);
+  }
+  double fused_time = timer.Elapsed();
+
+  timer.Reset();
+  {
+    Matrix<BaseFloat> spliced, output;
+    for (int32 start = 0; start < num_frames; start += batch_size) {
+      // Each batch is spliced together with its context frames.
+      int32 begin = std::max(0, start - context),
+          end = std::min(num_frames, start + batch_size + context);
+      SpliceFrames(input_feats.Range(begin, end - begin, 0, dim),
+                   context, context, &spliced);
+      output.Resize(spliced.NumRows(), output_dim, kUndefined);
+      output.AddMatMat(1.0, spliced, kNoTrans, transform, kTrans, 0.0);
+    }
+  }
+  double spliced_time = timer.Elapsed();
+  KALDI_LOG << "LDA with a context window of " << (2 * context + 1)
+            << ", batches of " << batch_size << " out of " << num_frames
+            << " frames: fused " << fused_time << "s, spliced "
+            << spliced_time << "s (speedup " << spliced_time / fused_time
+            << ")";
+}
+
+// Busy for "seconds", like a thread doing real work.
+static void Spin(double seconds) {
+  Timer timer;
+  while (timer.Elapsed() < seconds) { }
+}
+
+// Features of live audio: a frame becomes available every "frame_shift"
+// seconds after the clock was started, and each frame costs "cost" seconds of
+// work, as if the front end was computing it.
+class OnlinePacedInput : public OnlineFeatInputItf {
+ public:
+  OnlinePacedInput(int32 num_frames, int32 dim, double frame_shift,
+                   double cost, const Timer &clock):
+      num_frames_(num_frames), dim_(dim), position_(0),
+      frame_shift_(frame_shift), cost_(cost), clock_(clock) { }
+
+  virtual int32 Dim() const { return dim_; }
+
+  virtual bool Compute(Matrix<BaseFloat> *output) {
+    int32 num_frames = std::min(output->NumRows(), num_frames_ - position_);
+    if (num_frames == 0) {
+      output->Resize(0, 0);
+      return false;
+    }
+    double ready = (position_ + num_frames) * frame_shift_;
+    double now = clock_.Elapsed();
+    if (now < ready)
+      std::this_thread::sleep_for(std::chrono::duration<double>(ready - now));
+    Spin(num_frames * cost_);
+    output->Resize(num_frames, dim_);
+    position_ += num_frames;
+    return position_ < num_frames_;
+  }
+
+ private:
+  int32 num_frames_, dim_, position_;
+  double frame_shift_, cost_;
+  const Timer &clock_;
+};
+
+// Reports the latency, i.e. the time from when the audio of a frame is there
+// until the decoder is done with it, with and without a front-end thread,
+// for a front end and a decoder that each take "load" of real time.
+static void BenchmarkThreadedInput() {
+  int32 dim = 40, num_frames = 300, batch_size = 5;
+  double frame_shift = 0.002;
+  BaseFloat loads[] = { 0.3, 0.6 };
+  for (size_t i = 0; i < sizeof(loads) / sizeof(loads[0]); i++) {
+    double cost = loads[i] * frame_shift;
+    double mean_latency[2], max_latency[2];
+    for (int32 threaded = 0; threaded < 2; threaded++) {
+      Timer clock;
+      OnlinePacedInput paced_input(num_frames, dim, frame_shift, cost, clock);
+      OnlineThreadedInputOptions threaded_opts;
+      threaded_opts.batch_size = batch_size;
+      OnlineThreadedInput *threaded_input = NULL;
+      if (threaded)
+        threaded_input = new OnlineThreadedInput(threaded_opts, &paced_input);
+      OnlineFeatureMatrixOptions opts;
+      opts.batch_size = batch_size;
+      OnlineFeatureMatrix feature_matrix(
+          opts, threaded ? static_cast<OnlineFeatInputItf*>(threaded_input)
+                         : &paced_input);
+      mean_latency[threaded] = max_latency[threaded] = 0.0;
+      for (int32 frame = 0; frame < num_frames; frame++) {
+        KALDI_ASSERT(feature_matrix.IsValidFrame(frame));
+        Spin(cost); // decoding the frame
+        double latency = clock.Elapsed() - (frame + 1) * frame_shift;
+        mean_latency[threaded] += latency / num_frames;
+        max_latency[threaded] = std::max(max_latency[threaded], latency);
+      }
+      delete threaded_input;
+    }
+    KALDI_LOG << "Front end and decoder at " << loads[i] << " x real time "
+              << "each: latency without front-end thread " << mean_latency[0]
+              * 1000.0 << " ms (max " << max_latency[0] * 1000.0 << "), with "
+              << mean_latency[1] * 1000.0 << " ms (max " << max_latency[1]
+              * 1000.0 << ")";
+  }
+}
+
+}  // end namespace kaldi
+
+int main(int argc, char *argv[]) {
+  try {
+    using namespace kaldi;
+    typedef kaldi::int32 int32;
+    typedef kaldi::int64 int64;
+
+    const char *usage =
+        "Benchmarks the stages of the online feature pipeline (MFCC, CMN, LDA,\n"
+        "deltas, cache, feature matrix) on synthesized audio, read through\n"
+        "OnlineVectorSource.  Each stage is run with the stages it sits on,\n"
+        "for every batch size, and one tab-separated line is written per\n"
+        "stage and batch size: the throughput of the chain, the time of the\n"
+        "stage itself (the chain's minus that of the stage under it), the\n"
+        "memory allocations per frame once running (-1 if not counted) and\n"
+        "the time per call to the stage.  The speed of OnlineLdaInput against\n"
+        "splicing the frames first is then logged, for each batch size, as is\n"
+        "the latency of the features with and without a front-end thread\n"
+        "(OnlineThreadedInput), for input paced like live audio.\n\n"
+        "Usage: online-feat-benchmark [options] [results-wxfilename]\n\n"
+        "Example: online-feat-benchmark --audio-hours=0.5 "
+        "--batch-sizes=1:9:27:100 results.tsv";
+    ParseOptions po(usage);
+    BaseFloat audio_hours = 1.0;
+    std::string batch_sizes_str = "1:9:27:100";
+    int32 lda_context = 4, lda_dim = 40, seed = 0;
+    bool compare_lda = true, threaded_latency = true;
+    po.Register("audio-hours", &audio_hours,
+                "Hours of audio to synthesize and process for each run");
+    po.Register("batch-sizes", &batch_sizes_str,
+                "Colon-separated list of the numbers of frames requested "
+                "per call");
+    po.Register("lda-context", &lda_context,
+                "Left and right context of the (random) LDA transform");
+    po.Register("lda-dim", &lda_dim, "Output dimension of the LDA transform");
+    po.Register("seed", &seed, "Seed of the random audio and LDA transform");
+    po.Register("compare-lda", &compare_lda,
+                "Also compare OnlineLdaInput with splicing the frames and "
+                "then applying the transform");
+    po.Register("threaded-latency", &threaded_latency,
+                "Also measure the latency with a front-end thread (this "
+                "takes a few seconds of real time)");
+    po.Read(argc, argv);
+    if (po.NumArgs() > 1) {
+      po.PrintUsage();
+      return 1;
+    }
+    std::string results_wxfilename = po.GetOptArg(1);
+    if (results_wxfilename == "") results_wxfilename = "-";
+
+    std::vector<int32> batch_sizes;
+    if (!SplitStringToIntegers(batch_sizes_str, ":", false, &batch_sizes) ||
+        batch_sizes.empty())
+      KALDI_ERR << "Invalid --batch-sizes option: " << batch_sizes_str;
+    for (size_t i = 0; i < batch_sizes.size(); i++)
+      if (batch_sizes[i] <= 0)
+        KALDI_ERR << "Invalid --batch-sizes option: " << batch_sizes_str;
+    if (audio_hours <= 0.0 || lda_context < 0 || lda_dim <= 0)
+      KALDI_ERR << "Invalid --audio-hours, --lda-context or --lda-dim option";
+
+    MfccOptions mfcc_opts;
+    mfcc_opts.use_energy = false;
+    BaseFloat samp_freq = mfcc_opts.frame_opts.samp_freq;
+    srand(seed);
+    Vector<BaseFloat> wave;
+    Timer synth_timer;
+    SynthesizeAudio(static_cast<int64>(audio_hours * 3600.0 * samp_freq),
+                    samp_freq, &wave);
+    KALDI_LOG << "Synthesized " << audio_hours << " hours of audio in "
+              << synth_timer.Elapsed() << "s";
+    Matrix<BaseFloat> lda_transform(lda_dim, mfcc_opts.num_ceps *
+                                    (2 * lda_context + 1));
+    lda_transform.SetRandn();
+
+    Output ko(results_wxfilename, false);
+    std::ostream &os = ko.Stream();
+    os << "stage\tbatch_size\tframes\tcalls\tseconds\tframes_per_sec"
+       << "\tstage_seconds\tstage_us_per_frame\tallocs_per_frame"
+       << "\tcall_ms_mean\tcall_ms_p50\tcall_ms_p99\tcall_ms_max\n";
+    for (size_t b = 0; b < batch_sizes.size(); b++) {
+      std::vector<double> elapsed(kNumStages, 0.0);
+      for (int32 s = 0; s < kNumStages; s++) {
+        BenchmarkResult result;
+        RunStage(static_cast<BenchmarkStage>(s), wave, mfcc_opts,
+                 lda_transform, lda_context, batch_sizes[b], &result);
+        elapsed[s] = result.elapsed;
+        double stage_seconds = result.elapsed -
+            (kStageParent[s] < 0 ? 0.0 : elapsed[kStageParent[s]]);
+        int64 num_frames = std::max<int64>(result.num_frames, 1);
+        os << kStageNames[s] << '\t' << batch_sizes[b] << '\t'
+           << result.num_frames << '\t' << result.num_calls << '\t'
+           << result.elapsed << '\t' << result.num_frames / result.elapsed
+           << '\t' << stage_seconds << '\t'
+           << stage_seconds * 1.0e+06 / num_frames << '\t'
+           << (result.num_allocs < 0 ? -1.0 :
+               static_cast<double>(result.num_allocs) / num_frames) << '\t'
+           << result.MeanCallTimeMs() << '\t' << result.CallTimeMs(0.5) << '\t'
+           << result.CallTimeMs(0.99) << '\t' << result.CallTimeMs(1.0)
+           << '\n';
+        os.flush();
+        KALDI_VLOG(1) << "Stage " << kStageNames[s] << ", batch size "
+                      << batch_sizes[b] << ": " << result.num_frames /
+            result.elapsed << " frames/s";
+      }
+    }
+    for (size_t b = 0; compare_lda && b < batch_sizes.size(); b++)
+      BenchmarkLdaInput(wave, mfcc_opts, lda_transform, lda_context,
+                        batch_sizes[b]);
+    if (threaded_latency)
+      BenchmarkThreadedInput();
+    return 0;
+  } catch(const std::exception& e) {
+    std::cerr << e.what();
+    return -1;
+  }
+}
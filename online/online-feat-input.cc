@@ -1,558 +1,998 @@
-// online/online-feat-input.cc
-
-// Copyright 2012 Cisco Systems (author: Matthias Paulik)
-
-//   Modifications to the original contribution by Cisco Systems made by:
-//   Vassil Panayotov
-//   Johns Hopkins University (author: Daniel Povey)
-
-// See ../../COPYING for clarification regarding multiple authors
-//
-// Licensed under the Apache License, Version 2.0 (the "License");
-// you may not use this file except in compliance with the License.
-// You may obtain a copy of the License at
-//
-//  http://www.apache.org/licenses/LICENSE-2.0
-//
-// THIS CODE IS PROVIDED *AS IS* BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
-// KIND, EITHER EXPRESS OR IMPLIED, INCLUDING WITHOUT LIMITATION ANY IMPLIED
-// WARRANTIES OR CONDITIONS OF TITLE, FITNESS FOR A PARTICULAR PURPOSE,
-// MERCHANTABLITY OR NON-INFRINGEMENT.
-// See the Apache 2 License for the specific language governing permissions and
-// limitations under the License.
-
-#include "online-feat-input.h"
-
-namespace kaldi {
-
-
-// This is a wrapper for ComputeInternal.  It behaves exactly the
-// same as ComputeInternal, except that at the start of the file,
-// ComputeInternal may return empty output multiple times in a row.
-// This function prevents those initial non-productive calls, which
-// may otherwise confuse decoder code into thinking there is
-// a problem with the stream (too many timeouts), and cause it to fail.
-bool OnlineCmnInput::Compute(Matrix<BaseFloat> *output) {
-  
-  int32 orig_nr = output->NumRows(), orig_nc = output->NumCols();
-  int32 initial_t_in = t_in_;
-  bool ans;
-  while ((ans = ComputeInternal(output))) {
-    if (output->NumRows() == 0 &&
-        t_in_ != initial_t_in) {
-      // we produced no output but added to our internal buffer.
-      // Call ComputeInternal again.
-      initial_t_in = t_in_;
-      output->Resize(orig_nr, orig_nc); // make the same request.
-    } else {
-      return ans;
-    }
-  }
-  return ans;
-  // ans = false.  If ComputeInternal returned false,
-  // it means we are done, so no point calling it again.
-}
-
-
-int32 OnlineCmnInput::NumOutputFrames(int32 num_new_frames,
-                                      bool more_data) const {
-  // Tells the caller, assuming we get given "num_new_frames" of input (and
-  // given knowledge of whether there is more data coming), how many frames
-  // would we be able to output?
-
-  int32 max_t = t_in_ + num_new_frames;
-  if (max_t >= min_window_ || !more_data) {
-    // If this takes us to "min_window_" frames, we'll output all we have.
-    return num_new_frames + t_in_ - t_out_;
-  } else {
-    return 0; // We'll wait till we have at least "min_window_" frames.
-  }
-}
-
-
-// What happens at the start of the utterance is not really ideal, it would be
-// better to have some "fake stats" extracted from typical data from this domain,
-// to start with.  We'll have to do this later.
-bool OnlineCmnInput::ComputeInternal(Matrix<BaseFloat> *output) {
-  KALDI_ASSERT(output->NumRows() > 0 && output->NumCols() == Dim());
-
-  Matrix<BaseFloat> input;
-  input.Swap(output);
-  
-  bool more_data = input_->Compute(&input);
-
-  int32 num_input_frames = input.NumRows();
-  
-  int32 output_frames = NumOutputFrames(num_input_frames,
-                                        more_data);
-  output->Resize(output_frames,
-                 output_frames == 0 ? 0 : Dim());
-  
-  int32 output_counter = 0;
-  for (int32 i = 0; i < num_input_frames; i++) {
-    AcceptFrame(input.Row(i));
-    while (t_in_ >= cmn_window_ && t_out_ < t_in_) {
-      // We must output a frame now or we'll overwrite
-      // frames we need in the buffer.
-      SubVector<BaseFloat> this_frame(*output, output_counter);
-      OutputFrame(&this_frame);
-      output_counter++;
-    }
-  }
-  for (; output_counter < output_frames; output_counter++) {
-    SubVector<BaseFloat> this_frame(*output, output_counter);
-    OutputFrame(&this_frame);
-  }
-  return more_data;
-}
-
-void OnlineCmnInput::AcceptFrame(const VectorBase<BaseFloat> &input) {
-  KALDI_ASSERT(t_in_ <= t_out_ + cmn_window_);
-  history_.Row(t_in_ % (cmn_window_ + 1)).CopyFromVec(input);
-  t_in_++;
-}
-
-// Output the frame indexed "t_out_".
-void OnlineCmnInput::OutputFrame(VectorBase<BaseFloat> *output) {
-  KALDI_ASSERT(t_out_ < t_in_); // or there is nothing to output.
-  // First set "sum_".
-  if (t_out_ == 0) { // This is the first request for an output frame,
-    // so in general we need to set sum_ to the sum of the first "min_window_"
-    // frames.  We will have less than min_window_ frames if the input finished
-    // before then (if the input were not finished, we'd not have reached this
-    // code).
-    int32 num_frames = t_in_ < min_window_ ? t_in_ : min_window_;
-    for (int32 i = 0; i < num_frames; i++)
-      sum_.AddVec(1.0, history_.Row(i));
-  }
-  int32 num_history_frames;
-  if (t_out_ >= cmn_window_) num_history_frames = cmn_window_;
-  else if (t_out_ < min_window_)
-    num_history_frames = (t_in_ < min_window_ ? t_in_ : min_window_);
-  else
-    num_history_frames = t_out_;
-  
-  SubVector<BaseFloat> input_frame(history_, t_out_ % (cmn_window_ + 1));
-  output->CopyFromVec(input_frame);
-  output->AddVec(-1.0 / num_history_frames, sum_); // Apply CMN to the output.
-  
-  // Update sum.
-  if (t_out_ >= min_window_)
-    sum_.AddVec(1.0, input_frame);
-  if (t_out_ >= cmn_window_) { // Remove the frame from "cmn_window_" frames ago.
-    sum_.AddVec(-1.0, history_.Row((t_out_ - cmn_window_) % (cmn_window_ + 1)));
-    KALDI_ASSERT(t_in_ == t_out_ + 1); // or else the frame indexed t_out_ -
-                                       // cmn_window_ would not be the right one.
-  }
-  t_out_++;
-}
-
-#if !defined(_MSC_VER)
-
-//构造函数
-//udp端口输入 特征维度和udp端口号
-OnlineUdpInput::OnlineUdpInput(int32 port, int32 feature_dim):
-    feature_dim_(feature_dim) {
-  //服务器地址结构的配置
-  server_addr_.sin_family = AF_INET; // IPv4
-  server_addr_.sin_addr.s_addr = INADDR_ANY; // 在所有接口上聆听
-  server_addr_.sin_port = htons(port);    //sin_port为udp端口号 需要转换为网络地址的顺序
-  sock_desc_ = socket(AF_INET, SOCK_DGRAM, IPPROTO_UDP);  //套接字描述符
-  //如果套接字描述符为-1 则函数调用失败
-  if (sock_desc_ == -1)
-    KALDI_ERR << "socket() call failed!";
-  //定义接收端缓冲区大小
-  int32 rcvbuf_size = 30000;
-  //参数分别为套接字 套接字的层次(当前是通用套接字选项) 
-  //需要设置的选项名(当前是接收缓冲区大小) 包含新选项值得缓冲 
-  if (setsockopt(sock_desc_, SOL_SOCKET, SO_RCVBUF,
-                 &rcvbuf_size, sizeof(rcvbuf_size)) == -1)
-      KALDI_ERR << "setsockopt() failed to set receive buffer size!";
-  if (bind(sock_desc_,
-           reinterpret_cast<sockaddr*>(&server_addr_),
-           sizeof(server_addr_)) == -1)
-    //连接函数调用失败
-    KALDI_ERR << "bind() call failed!";
-}
-
-
-bool OnlineUdpInput::Compute(Matrix<BaseFloat> *output) {
-  char buf[65535];
-  socklen_t caddr_len = sizeof(client_addr_);
-  ssize_t nrecv = recvfrom(sock_desc_, buf, sizeof(buf), 0,
-                           reinterpret_cast<sockaddr*>(&client_addr_),
-                           &caddr_len);
-  if (nrecv == -1) {
-    KALDI_WARN << "recvfrom() call error!";
-    output->Resize(0, 0);
-    return false;
-  }
-  std::stringstream ss(std::stringstream::in | std::stringstream::out);
-  ss.write(buf, nrecv);
-  output->Read(ss, true);
-  return true;
-}
-
-#endif
-
-//在线lda特征输入类的构造函数
-OnlineLdaInput::OnlineLdaInput(OnlineFeatInputItf *input,
-                               const Matrix<BaseFloat> &transform,
-                               int32 left_context,
-                               int32 right_context):
-    input_(input), input_dim_(input->Dim()),
-    left_context_(left_context), right_context_(right_context) {
-  //总的上下文依赖数
-  int32 tot_context = left_context + 1 + right_context;
-  //判断lda矩阵的列数是否与输入的维度乘总上下文依赖数相同
-  if (transform.NumCols() == input_dim_ * tot_context) {
-    linear_transform_ = transform;
-    // and offset_ stays empty.
-  } else if (transform.NumCols() == input_dim_ * tot_context + 1) {
-    linear_transform_.Resize(transform.NumRows(), transform.NumCols() - 1);
-    linear_transform_.CopyFromMat(transform.Range(0, transform.NumRows(),
-                                           0, transform.NumCols() - 1));
-    offset_.Resize(transform.NumRows());
-    offset_.CopyColFromMat(transform, transform.NumCols() - 1);
-  } else {
-    KALDI_ERR << "Invalid parameters supplied to OnlineLdaInput";
-  }
-}
-
-// static
-void OnlineLdaInput::SpliceFrames(const MatrixBase<BaseFloat> &input1,
-                                  const MatrixBase<BaseFloat> &input2,
-                                  const MatrixBase<BaseFloat> &input3,
-                                  int32 context_window,
-                                  Matrix<BaseFloat> *output) {
-  KALDI_ASSERT(context_window > 0);
-  const int32 size1 = input1.NumRows(), size2 = input2.NumRows(),
-      size3 = input3.NumRows();
-  int32 num_frames_in = size1 + size2 + size3,
-      num_frames_out = num_frames_in - (context_window - 1),
-      dim = std::max(input1.NumCols(), std::max(input2.NumCols(), input3.NumCols()));
-  // do std::max in case one or more of the input matrices is empty.
-  
-  if (num_frames_out <= 0) {
-    output->Resize(0, 0);
-    return;
-  }
-  output->Resize(num_frames_out, dim * context_window);
-  for (int32 t_out = 0; t_out < num_frames_out; t_out++) {
-    for (int32 pos = 0; pos < context_window; pos++) {
-      int32 t_in = t_out + pos;
-      SubVector<BaseFloat> vec_out(output->Row(t_out), pos * dim, dim);
-      if (t_in < size1)
-        vec_out.CopyFromVec(input1.Row(t_in));
-      else if (t_in < size1 + size2)
-        vec_out.CopyFromVec(input2.Row(t_in - size1));
-      else
-        vec_out.CopyFromVec(input3.Row(t_in - size1 - size2));
-    }
-  }
-}
-
-void OnlineLdaInput::TransformToOutput(const MatrixBase<BaseFloat> &spliced_feats,
-                                       Matrix<BaseFloat> *output) {
-  if (spliced_feats.NumRows() == 0) {
-    output->Resize(0, 0);
-  } else {
-    output->Resize(spliced_feats.NumRows(), linear_transform_.NumRows());
-    output->AddMatMat(1.0, spliced_feats, kNoTrans,
-                      linear_transform_, kTrans, 0.0);
-    if (offset_.Dim() != 0)
-      output->AddVecToRows(1.0, offset_);
-  }
-}
-
-bool OnlineLdaInput::Compute(Matrix<BaseFloat> *output) {
-  KALDI_ASSERT(output->NumRows() > 0 &&
-               output->NumCols() == linear_transform_.NumRows());
-  // If output->NumRows() == 0, it corresponds to a request for zero frames,
-  // which makes no sense.
-
-  // We request the same number of frames of data that we were requested.
-  Matrix<BaseFloat> input(output->NumRows(), input_dim_);
-  bool ans = input_->Compute(&input);
-  // If we got no input (timed out) and we're not at the end, we return
-  // empty output.
-
-  if (input.NumRows() == 0 && ans) {
-    output->Resize(0, 0);
-    return ans;
-  } else if (input.NumRows() == 0 && !ans) {
-    // The end of the input stream, but no input this time.
-    if (remainder_.NumRows() == 0) {
-      output->Resize(0, 0);
-      return ans;
-    }
-  }
-
-  // If this is the first segment of the utterance, we put in the
-  // initial duplicates of the first frame, numbered "left_context".
-  if (remainder_.NumRows() == 0 && input.NumRows() != 0 && left_context_ != 0) {
-    remainder_.Resize(left_context_, input_dim_);
-    for (int32 i = 0; i < left_context_; i++)
-      remainder_.Row(i).CopyFromVec(input.Row(0));
-  }
-
-  // If this is the last segment, we put in the final duplicates of the
-  // last frame, numbered "right_context".
-  Matrix<BaseFloat> tail;
-  if (!ans && right_context_ > 0) {
-    tail.Resize(right_context_, input_dim_);
-    for (int32 i = 0; i < right_context_; i++) {
-      if (input.NumRows() > 0)
-        tail.Row(i).CopyFromVec(input.Row(input.NumRows() - 1));
-      else
-        tail.Row(i).CopyFromVec(remainder_.Row(remainder_.NumRows() - 1));
-    }
-  }
-  
-  Matrix<BaseFloat> spliced_feats;
-  int32 context_window = left_context_ + 1 + right_context_;
-  // The next line is a call to a member function.
-  SpliceFrames(remainder_, input, tail, context_window, &spliced_feats);
-  TransformToOutput(spliced_feats, output);
-  ComputeNextRemainder(input);
-  return ans; 
-}
-
-void OnlineLdaInput::ComputeNextRemainder(const MatrixBase<BaseFloat> &input) {
-  // The size of the remainder that we propagate to the next frame is
-  // context_window - 1, if available.
-  int32 context_window = left_context_ + 1 + right_context_;
-  int32 next_remainder_len = std::min(context_window - 1,
-                                      remainder_.NumRows() + input.NumRows());
-  if (next_remainder_len == 0) {
-    remainder_.Resize(0, 0);
-    return;
-  }
-  Matrix<BaseFloat> next_remainder(next_remainder_len, input_dim_);
-  int32 rsize = remainder_.NumRows(), isize = input.NumRows();
-  for (int32 i = 0; i < next_remainder_len; i++) {
-    SubVector<BaseFloat> dest(next_remainder, i);
-    int32 t = (rsize + isize) - next_remainder_len + i;
-    // Here, t is an offset into a numbering of the frames where we first have
-    // the old "remainder" frames, then the regular frames.
-    if (t < rsize) dest.CopyFromVec(remainder_.Row(t));
-    else dest.CopyFromVec(input.Row(t - rsize));
-  }
-  remainder_ = next_remainder;
-}
-
-
-bool OnlineCacheInput::Compute(Matrix<BaseFloat> *output) {
-  bool ans = input_->Compute(output);
-  if (output->NumRows() != 0)
-    data_.push_back(new Matrix<BaseFloat>(*output));
-  return ans;
-}
-
-void OnlineCacheInput::GetCachedData(Matrix<BaseFloat> *output) {
-  int32 num_frames = 0, dim = 0;
-  for (size_t i = 0; i < data_.size(); i++) {
-    num_frames += data_[i]->NumRows();
-    dim = data_[i]->NumCols();
-  }
-  output->Resize(num_frames, dim);
-  int32 frame_offset = 0;
-  for (size_t i = 0; i < data_.size(); i++) {
-    int32 this_frames = data_[i]->NumRows();
-    output->Range(frame_offset, this_frames, 0, dim).CopyFromMat(*data_[i]);
-    frame_offset += this_frames;
-  }
-  KALDI_ASSERT(frame_offset == num_frames);
-}
-
-void OnlineCacheInput::Deallocate() {
-  for (size_t i = 0; i < data_.size(); i++) delete data_[i];
-  data_.clear();
-}
-
-
-OnlineDeltaInput::OnlineDeltaInput(const DeltaFeaturesOptions &delta_opts,
-                                   OnlineFeatInputItf *input):
-    input_(input), opts_(delta_opts), input_dim_(input_->Dim()) { }
-
-
-// static
-void OnlineDeltaInput::AppendFrames(const MatrixBase<BaseFloat> &input1,
-                                    const MatrixBase<BaseFloat> &input2,
-                                    const MatrixBase<BaseFloat> &input3,
-                                    Matrix<BaseFloat> *output) {
-  const int32 size1 = input1.NumRows(), size2 = input2.NumRows(),
-      size3 = input3.NumRows(), size_out = size1 + size2 + size3;
-  if (size_out == 0) {
-    output->Resize(0, 0);
-    return;
-  }
-  // do std::max in case one or more of the input matrices is empty.  
-  int32 dim = std::max(input1.NumCols(),
-                       std::max(input2.NumCols(), input3.NumCols()));
-
-  output->Resize(size_out, dim);
-  if (size1 != 0)
-    output->Range(0, size1, 0, dim).CopyFromMat(input1);
-  if (size2 != 0)
-    output->Range(size1, size2, 0, dim).CopyFromMat(input2);
-  if (size3 != 0)
-    output->Range(size1 + size2, size3, 0, dim).CopyFromMat(input3);
-}
-
-void OnlineDeltaInput::DeltaComputation(const MatrixBase<BaseFloat> &input,
-                                        Matrix<BaseFloat> *output,
-                                        Matrix<BaseFloat> *remainder) const {
-  int32 input_rows = input.NumRows(),
-      output_rows = std::max(0, input_rows - Context() * 2),
-      remainder_rows = std::min(input_rows, Context() * 2),
-      input_dim = input_dim_,
-      output_dim = Dim();
-  if (remainder_rows > 0) {
-    remainder->Resize(remainder_rows, input_dim);
-    remainder->CopyFromMat(input.Range(input_rows - remainder_rows,
-                                       remainder_rows, 0, input_dim));
-  } else {
-    remainder->Resize(0, 0);
-  }
-  if (output_rows > 0) {
-    output->Resize(output_rows, output_dim);
-    DeltaFeatures delta(opts_);
-    for (int32 output_frame = 0; output_frame < output_rows; output_frame++) {
-      int32 input_frame = output_frame + Context();
-      SubVector<BaseFloat> output_row(*output, output_frame);
-      delta.Process(input, input_frame, &output_row);
-    }
-  } else {
-    output->Resize(0, 0);
-  }
-}                                     
-
-bool OnlineDeltaInput::Compute(Matrix<BaseFloat> *output) {
-  KALDI_ASSERT(output->NumRows() > 0 &&
-               output->NumCols() == Dim());
-  // If output->NumRows() == 0, it corresponds to a request for zero frames,
-  // which makes no sense.
-
-  // We request the same number of frames of data that we were requested.
-  Matrix<BaseFloat> input(output->NumRows(), input_dim_);
-  bool ans = input_->Compute(&input);
-
-  // If we got no input (timed out) and we're not at the end, we return
-  // empty output.
-  if (input.NumRows() == 0 && ans) {
-    output->Resize(0, 0);
-    return ans;
-  } else if (input.NumRows() == 0 && !ans) {
-    // The end of the input stream, but no input this time.
-    if (remainder_.NumRows() == 0) {
-      output->Resize(0, 0);
-      return ans;
-    }
-  }
-
-  // If this is the first segment of the utterance, we put in the
-  // initial duplicates of the first frame, numbered "Context()"
-  if (remainder_.NumRows() == 0 && input.NumRows() != 0 && Context() != 0) {
-    remainder_.Resize(Context(), input_dim_);
-    for (int32 i = 0; i < Context(); i++)
-      remainder_.Row(i).CopyFromVec(input.Row(0));
-  }
-
-  // If this is the last segment, we put in the final duplicates of the
-  // last frame, numbered "Context()".
-  Matrix<BaseFloat> tail;
-  if (!ans && Context() > 0) {
-    tail.Resize(Context(), input_dim_);
-    for (int32 i = 0; i < Context(); i++) {
-      if (input.NumRows() > 0)
-        tail.Row(i).CopyFromVec(input.Row(input.NumRows() - 1));
-      else
-        tail.Row(i).CopyFromVec(remainder_.Row(remainder_.NumRows() - 1));
-    }
-  }
-  
-  Matrix<BaseFloat> appended_feats;
-  AppendFrames(remainder_, input, tail, &appended_feats);
-  DeltaComputation(appended_feats, output, &remainder_);
-  return ans; 
-}
-
-
-
-void OnlineFeatureMatrix::GetNextFeatures() {
-  if (finished_) return; // Nothing to do.
-  
-  // We always keep the most recent frame of features, if present,
-  // in case it is needed (this may happen when someone calls
-  // IsLastFrame(), which requires us to get the next frame, while
-  // they're stil processing this frame.
-  bool have_last_frame = (feat_matrix_.NumRows() != 0);
-  Vector<BaseFloat> last_frame;
-  if (have_last_frame)
-    last_frame = feat_matrix_.Row(feat_matrix_.NumRows() - 1);
-
-  int32 iter;
-  for (iter = 0; iter < opts_.num_tries; iter++) {
-    Matrix<BaseFloat> next_features(opts_.batch_size, feat_dim_);
-    finished_ = ! input_->Compute(&next_features);
-    if (next_features.NumRows() == 0 && ! finished_) {
-      // It timed out.  Try again.
-      continue;
-    }
-    if (next_features.NumRows() > 0) {
-      int32 new_size = (have_last_frame ? 1 : 0) +
-          next_features.NumRows();
-      feat_offset_ += feat_matrix_.NumRows() -
-          (have_last_frame ? 1 : 0); // we're discarding this many
-                                     // frames.
-      feat_matrix_.Resize(new_size, feat_dim_, kUndefined);
-      if (have_last_frame) {
-        feat_matrix_.Row(0).CopyFromVec(last_frame);
-        feat_matrix_.Range(1, next_features.NumRows(), 0, feat_dim_).
-            CopyFromMat(next_features);
-      } else {
-        feat_matrix_.CopyFromMat(next_features);
-      }
-    }
-    break;
-  }
-  if (iter == opts_.num_tries) { // we fell off the loop
-    KALDI_WARN << "After " << opts_.num_tries << ", got no features, giving up.";
-    finished_ = true; // We set finished_ to true even though the stream
-    // doesn't say it's finished, because the delay is too much-- we gave up.
-  }
-}
-
-
-bool OnlineFeatureMatrix::IsValidFrame (int32 frame) {
-   KALDI_ASSERT(frame >= feat_offset_ &&
-               "You are attempting to get expired frames.");
-  if (frame < feat_offset_ + feat_matrix_.NumRows())
-    return true;
-  else {
-    GetNextFeatures();
-    if (frame < feat_offset_ + feat_matrix_.NumRows())
-      return true;
-    else {
-      if (finished_) return false;
-      else {
-        KALDI_WARN << "Unexpected point reached in code: "
-                   << "possibly you are skipping frames?";
-        return false;
-      }
-    }
-  }
-}
-
-SubVector<BaseFloat> OnlineFeatureMatrix::GetFrame(int32 frame) {
-  if (frame < feat_offset_)
-    KALDI_ERR << "Attempting to get a discarded frame.";
-  if (frame >= feat_offset_ + feat_matrix_.NumRows())
-    KALDI_ERR << "Attempt get frame without check its validity.";
-  return feat_matrix_.Row(frame - feat_offset_);
-}
-
-
-} // namespace kaldi
-
+// online/online-feat-input.cc
+
+// Copyright 2012 Cisco Systems (author: Matthias Paulik)
+
+//   Modifications to the original contribution by Cisco Systems made by:
+//   Vassil Panayotov
+//   Johns Hopkins University (author: Daniel Povey)
+
+// See ../../COPYING for clarification regarding multiple authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//  http://www.apache.org/licenses/LICENSE-2.0
+//
+// THIS CODE IS PROVIDED *AS IS* BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, EITHER EXPRESS OR IMPLIED, INCLUDING WITHOUT LIMITATION ANY IMPLIED
+// WARRANTIES OR CONDITIONS OF TITLE, FITNESS FOR A PARTICULAR PURPOSE,
+// MERCHANTABLITY OR NON-INFRINGEMENT.
+// See the Apache 2 License for the specific language governing permissions and
+// limitations under the License.
+
+#include <cstdlib>
+#include <cstring>
+#if !defined(_MSC_VER)
+#include <unistd.h>
+#endif
+
+#include "online-feat-input.h"
+
+namespace kaldi {
+
+
+// This is a wrapper for ComputeInternal.  It behaves exactly the
+// same as ComputeInternal, except that at the start of the file,
+// ComputeInternal may return empty output multiple times in a row.
+// This function prevents those initial non-productive calls, which
+// may otherwise confuse decoder code into thinking there is
+// a problem with the stream (too many timeouts), and cause it to fail.
+bool OnlineCmnInput::Compute(Matrix<BaseFloat> *output) {
+  
+  int32 orig_nr = output->NumRows(), orig_nc = output->NumCols();
+  int32 initial_t_in = t_in_;
+  bool ans;
+  while ((ans = ComputeInternal(output))) {
+    if (output->NumRows() == 0 &&
+        t_in_ != initial_t_in) {
+      // we produced no output but added to our internal buffer.
+      // Call ComputeInternal again.
+      initial_t_in = t_in_;
+      output->Resize(orig_nr, orig_nc); // make the same request.
+    } else {
+      return ans;
+    }
+  }
+  return ans;
+  // ans = false.  If ComputeInternal returned false,
+  // it means we are done, so no point calling it again.
+}
+
+
+int32 OnlineCmnInput::NumOutputFrames(int32 num_new_frames,
+                                      bool more_data) const {
+  // Tells the caller, assuming we get given "num_new_frames" of input (and
+  // given knowledge of whether there is more data coming), how many frames
+  // would we be able to output?
+
+  int32 max_t = t_in_ + num_new_frames;
+  if (max_t >= min_window_ || !more_data || prior_stats_.NumRows() != 0) {
+    // If this takes us to "min_window_" frames, we'll output all we have.
+    return num_new_frames + t_in_ - t_out_;
+  } else {
+    return 0; // We'll wait till we have at least "min_window_" frames.
+  }
+}
+
+
+// Without a prior (see SetPrior()), what happens at the start of the
+// utterance is not really ideal: we have to wait for "min_window_" frames.
+bool OnlineCmnInput::ComputeInternal(Matrix<BaseFloat> *output) {
+  KALDI_ASSERT(output->NumRows() > 0 && output->NumCols() == Dim());
+
+  // We request the same number of frames of data that we were requested.
+  input_frames_.Resize(output->NumRows(), Dim(), kUndefined);
+  bool more_data = input_->Compute(&input_frames_);
+
+  int32 num_input_frames = input_frames_.NumRows();
+  
+  int32 output_frames = NumOutputFrames(num_input_frames,
+                                        more_data);
+  output->Resize(output_frames,
+                 output_frames == 0 ? 0 : Dim(), kUndefined);
+  
+  int32 output_counter = 0;
+  for (int32 i = 0; i < num_input_frames; i++) {
+    AcceptFrame(input_frames_.Row(i));
+    while (t_in_ >= cmn_window_ && t_out_ < t_in_) {
+      // We must output a frame now or we'll overwrite
+      // frames we need in the buffer.
+      SubVector<BaseFloat> this_frame(*output, output_counter);
+      OutputFrame(&this_frame);
+      output_counter++;
+    }
+  }
+  for (; output_counter < output_frames; output_counter++) {
+    SubVector<BaseFloat> this_frame(*output, output_counter);
+    OutputFrame(&this_frame);
+  }
+  return more_data;
+}
+
+void OnlineCmnInput::SetPrior(const MatrixBase<double> &stats) {
+  KALDI_ASSERT(t_in_ == 0 && "SetPrior() called after Compute()");
+  KALDI_ASSERT(stats.NumRows() == 2 && stats.NumCols() == Dim() + 1);
+  double count = stats(0, Dim());
+  if (count <= 0.0)
+    KALDI_ERR << "CMN prior stats have no frames in them.";
+  prior_stats_ = stats;
+  prior_mean_.Resize(Dim());
+  prior_mean_.CopyFromVec(stats.Row(0).Range(0, Dim()));
+  prior_mean_.Scale(1.0 / count);
+  if (decay_ > 0.0) {
+    count_ = 1.0 / (1.0 - decay_);
+    sum_.CopyFromVec(prior_mean_);
+    sum_.Scale(count_);
+  }
+}
+
+void OnlineCmnInput::GetStats(Matrix<double> *stats) const {
+  *stats = stats_;
+  if (prior_stats_.NumRows() != 0)
+    stats->AddMat(1.0, prior_stats_);
+}
+
+void OnlineCmnInput::AcceptFrame(const VectorBase<BaseFloat> &input) {
+  KALDI_ASSERT(t_in_ <= t_out_ + cmn_window_);
+  history_.Row(t_in_ % (cmn_window_ + 1)).CopyFromVec(input);
+  AccCmvnStats(input, 1.0, &stats_);
+  t_in_++;
+}
+
+// Output the frame indexed "t_out_".
+void OnlineCmnInput::OutputFrame(VectorBase<BaseFloat> *output) {
+  KALDI_ASSERT(t_out_ < t_in_); // or there is nothing to output.
+  bool have_prior = (prior_stats_.NumRows() != 0);
+  // First set "sum_".
+  if (t_out_ == 0 && !have_prior) { // This is the first request for an output
+    // frame, so in general we need to set sum_ to the sum of the first
+    // "min_window_" frames.  We will have less than min_window_ frames if the
+    // input finished before then (if the input were not finished, we'd not
+    // have reached this code).
+    int32 num_frames = t_in_ < min_window_ ? t_in_ : min_window_;
+    for (int32 i = 0; i < num_frames; i++)
+      sum_.AddVec(1.0, history_.Row(i));
+    count_ = num_frames;
+  }
+  // After the start-up, the frames before t_out_ go into the mean.
+  bool update = (have_prior || t_out_ >= min_window_);
+  
+  SubVector<BaseFloat> input_frame(history_, t_out_ % (cmn_window_ + 1));
+  output->CopyFromVec(input_frame);
+  if (decay_ > 0.0) {
+    output->AddVec(-1.0 / count_, sum_); // Apply CMN to the output.
+    if (update) {
+      sum_.Scale(decay_);
+      sum_.AddVec(1.0, input_frame);
+      count_ = decay_ * count_ + 1.0;
+    }
+    t_out_++;
+    return;
+  }
+
+  int32 num_history_frames;
+  if (t_out_ >= cmn_window_) num_history_frames = cmn_window_;
+  else if (have_prior) num_history_frames = t_out_;
+  else if (t_out_ < min_window_)
+    num_history_frames = (t_in_ < min_window_ ? t_in_ : min_window_);
+  else
+    num_history_frames = t_out_;
+  
+  if (have_prior && num_history_frames < cmn_window_) {
+    // The prior mean stands in for the frames we don't have yet.
+    mean_.CopyFromVec(sum_);
+    mean_.AddVec(cmn_window_ - num_history_frames, prior_mean_);
+    output->AddVec(-1.0 / cmn_window_, mean_);
+  } else {
+    output->AddVec(-1.0 / num_history_frames, sum_); // Apply CMN to the output.
+  }
+  
+  // Update sum.
+  if (update)
+    sum_.AddVec(1.0, input_frame);
+  if (t_out_ >= cmn_window_) { // Remove the frame from "cmn_window_" frames ago.
+    sum_.AddVec(-1.0, history_.Row((t_out_ - cmn_window_) % (cmn_window_ + 1)));
+    KALDI_ASSERT(t_in_ == t_out_ + 1); // or else the frame indexed t_out_ -
+                                       // cmn_window_ would not be the right one.
+  }
+  t_out_++;
+}
+
+#if !defined(_MSC_VER)
+
+void OnlineFeatPacketHeader::Write(char *buf) const {
+  uint32 fields32[4] = { htonl(kMagic), htonl(stream_id), htonl(seq),
+                         htonl(first_frame) };
+  uint16 fields16[4] = { htons(num_frames), htons(dim), htons(flags), 0 };
+  memcpy(buf, fields32, sizeof(fields32));
+  memcpy(buf + sizeof(fields32), fields16, sizeof(fields16));
+}
+
+bool OnlineFeatPacketHeader::Read(const char *buf, size_t size) {
+  if (size < kSize)
+    return false;
+  uint32 fields32[4];
+  uint16 fields16[4];
+  memcpy(fields32, buf, sizeof(fields32));
+  memcpy(fields16, buf + sizeof(fields32), sizeof(fields16));
+  if (ntohl(fields32[0]) != kMagic)
+    return false;
+  stream_id = ntohl(fields32[1]);
+  seq = ntohl(fields32[2]);
+  first_frame = ntohl(fields32[3]);
+  num_frames = ntohs(fields16[0]);
+  dim = ntohs(fields16[1]);
+  flags = ntohs(fields16[2]);
+  return size == kSize + sizeof(uint32) * num_frames * dim;
+}
+
+void EncodeFeatPacket(const OnlineFeatPacketHeader &header,
+                      const MatrixBase<BaseFloat> &feats, int32 first_row,
+                      std::vector<char> *packet) {
+  KALDI_ASSERT(first_row >= 0 &&
+               first_row + header.num_frames <= feats.NumRows() &&
+               header.dim == feats.NumCols());
+  size_t size = OnlineFeatPacketHeader::kSize +
+      sizeof(uint32) * header.num_frames * header.dim;
+  KALDI_ASSERT(size <= OnlineFeatPacketHeader::kMaxPacketSize);
+  packet->resize(size);
+  char *data = &((*packet)[0]);
+  header.Write(data);
+  data += OnlineFeatPacketHeader::kSize;
+  for (int32 r = first_row; r < first_row + header.num_frames; r++) {
+    const BaseFloat *row = feats.RowData(r);
+    for (int32 c = 0; c < header.dim; c++, data += sizeof(uint32)) {
+      float value = row[c];
+      uint32 bits;
+      memcpy(&bits, &value, sizeof(bits));
+      bits = htonl(bits);
+      memcpy(data, &bits, sizeof(bits));
+    }
+  }
+}
+
+//构造函数
+//udp端口输入 特征维度和udp端口号
+OnlineUdpInput::OnlineUdpInput(int32 port, int32 feature_dim,
+                               const OnlineUdpInputOptions &opts):
+    opts_(opts), feature_dim_(feature_dim),
+    recv_bufs_(opts.batch_packets,
+               std::vector<char>(OnlineFeatPacketHeader::kMaxPacketSize)),
+    recv_addrs_(opts.batch_packets),
+#if defined(__linux__)
+    msgs_(opts.batch_packets), iovecs_(opts.batch_packets),
+#endif
+    in_stream_(false), stream_id_(0), end_pending_(false), next_seq_(0),
+    next_frame_(0),
+    frames_(feature_dim), last_frame_(feature_dim), have_last_frame_(false),
+    num_received_(0), num_lost_(0), num_reordered_(0), num_dropped_(0) {
+  KALDI_ASSERT(opts.batch_packets > 0 && opts.max_reorder >= 0);
+  //服务器地址结构的配置
+  server_addr_.sin_family = AF_INET; // IPv4
+  server_addr_.sin_addr.s_addr = INADDR_ANY; // 在所有接口上聆听
+  server_addr_.sin_port = htons(port);    //sin_port为udp端口号 需要转换为网络地址的顺序
+  sock_desc_ = socket(AF_INET, SOCK_DGRAM, IPPROTO_UDP);  //套接字描述符
+  //如果套接字描述符为-1 则函数调用失败
+  if (sock_desc_ == -1)
+    KALDI_ERR << "socket() call failed!";
+  //接收端缓冲区大小
+  int32 rcvbuf_size = opts.rcvbuf_size;
+  //参数分别为套接字 套接字的层次(当前是通用套接字选项) 
+  //需要设置的选项名(当前是接收缓冲区大小) 包含新选项值得缓冲 
+  if (setsockopt(sock_desc_, SOL_SOCKET, SO_RCVBUF,
+                 &rcvbuf_size, sizeof(rcvbuf_size)) == -1)
+      KALDI_ERR << "setsockopt() failed to set receive buffer size!";
+  if (bind(sock_desc_,
+           reinterpret_cast<sockaddr*>(&server_addr_),
+           sizeof(server_addr_)) == -1)
+    //连接函数调用失败
+    KALDI_ERR << "bind() call failed!";
+}
+
+
+bool OnlineUdpInput::Compute(Matrix<BaseFloat> *output) {
+  if (!end_pending_ && !pending_.empty()) {
+    // The last stream is over, so the next one can start.
+    std::vector<std::pair<std::vector<char>, sockaddr_in> > packets;
+    packets.swap(pending_);
+    for (size_t i = 0; i < packets.size(); i++)
+      AcceptPacket(&(packets[i].first[0]), packets[i].first.size(),
+                   packets[i].second);
+  }
+  while (frames_.NumFrames() == 0 && !end_pending_) {
+    if (!ReceivePackets()) {
+      output->Resize(0, 0);
+      return false;
+    }
+  }
+  if (frames_.NumFrames() == 0) {
+    output->Resize(0, 0);
+  } else {
+    output->Resize(frames_.NumFrames(), feature_dim_, kUndefined);
+    output->CopyFromMat(frames_.Frames());
+    frames_.Clear();
+  }
+  if (end_pending_) {
+    end_pending_ = false;
+    return false;
+  }
+  return true;
+}
+
+bool OnlineUdpInput::ReceivePackets() {
+#if defined(__linux__)
+  // Takes whatever is already waiting in the socket, up to batch_packets
+  // datagrams, in a single system call.
+  int32 num_bufs = recv_bufs_.size();
+  for (int32 i = 0; i < num_bufs; i++) {
+    iovecs_[i].iov_base = &(recv_bufs_[i][0]);
+    iovecs_[i].iov_len = recv_bufs_[i].size();
+    msghdr &hdr = msgs_[i].msg_hdr;
+    memset(&hdr, 0, sizeof(hdr));
+    hdr.msg_name = &(recv_addrs_[i]);
+    hdr.msg_namelen = sizeof(recv_addrs_[i]);
+    hdr.msg_iov = &(iovecs_[i]);
+    hdr.msg_iovlen = 1;
+  }
+  int num_recv = recvmmsg(sock_desc_, &(msgs_[0]), num_bufs, MSG_WAITFORONE,
+                          NULL);
+  if (num_recv == -1) {
+    KALDI_WARN << "recvmmsg() call error!";
+    return false;
+  }
+  for (int i = 0; i < num_recv; i++)
+    AcceptPacket(&(recv_bufs_[i][0]), msgs_[i].msg_len, recv_addrs_[i]);
+#else
+  socklen_t caddr_len = sizeof(recv_addrs_[0]);
+  ssize_t nrecv = recvfrom(sock_desc_, &(recv_bufs_[0][0]),
+                           recv_bufs_[0].size(), 0,
+                           reinterpret_cast<sockaddr*>(&(recv_addrs_[0])),
+                           &caddr_len);
+  if (nrecv == -1) {
+    KALDI_WARN << "recvfrom() call error!";
+    return false;
+  }
+  AcceptPacket(&(recv_bufs_[0][0]), nrecv, recv_addrs_[0]);
+#endif
+  return true;
+}
+
+void OnlineUdpInput::AcceptPacket(const char *data, size_t size,
+                                  const sockaddr_in &addr) {
+  OnlineFeatPacketHeader header;
+  if (!header.Read(data, size) || header.dim != feature_dim_) {
+    KALDI_WARN << "Dropping a malformed datagram of " << size << " bytes";
+    num_dropped_++;
+    return;
+  }
+  num_received_++;
+  if (IsPastStream(header.stream_id)) {
+    num_dropped_++; // a late packet of a stream that ended
+    return;
+  }
+  if (in_stream_ && header.stream_id != stream_id_) {
+    // The end of the current stream was lost; what is held is all that is
+    // left of it.
+    KALDI_WARN << "Stream " << header.stream_id << " started before the end "
+               << "of stream " << stream_id_;
+    while (in_stream_ && !held_.empty())
+      SkipMissingPackets();
+    if (in_stream_)
+      EndStream();
+  }
+  if (end_pending_) {
+    pending_.push_back(std::make_pair(std::vector<char>(data, data + size),
+                                      addr));
+    return;
+  }
+  if (!in_stream_)
+    StartStream(header);
+  client_addr_ = addr;
+  int32 ahead = static_cast<int32>(header.seq - next_seq_);
+  if (ahead < 0 || held_.count(header.seq) != 0) {
+    num_dropped_++; // a duplicate, or one we have given up on
+    return;
+  }
+  if (ahead > 0) {
+    num_reordered_++;
+    held_[header.seq].assign(data, data + size);
+    if (held_.size() > static_cast<size_t>(opts_.max_reorder))
+      SkipMissingPackets();
+    return;
+  }
+  AppendPacket(header, data + OnlineFeatPacketHeader::kSize);
+  AppendHeldPackets();
+}
+
+void OnlineUdpInput::AppendPacket(const OnlineFeatPacketHeader &header,
+                                  const char *payload) {
+  int32 num_missing = static_cast<int32>(header.first_frame - next_frame_);
+  if (num_missing > 0 && have_last_frame_)
+    frames_.AppendCopies(last_frame_, num_missing);
+  // The payload is decoded one frame at a time into last_frame_, which is
+  // where the frames to conceal a loss come from anyway.
+  for (int32 f = 0; f < header.num_frames; f++) {
+    for (int32 d = 0; d < feature_dim_; d++, payload += sizeof(uint32)) {
+      uint32 bits;
+      memcpy(&bits, payload, sizeof(bits));
+      bits = ntohl(bits);
+      float value;
+      memcpy(&value, &bits, sizeof(value));
+      last_frame_(d) = value;
+    }
+    frames_.AppendCopies(last_frame_, 1);
+    have_last_frame_ = true;
+  }
+  next_seq_ = header.seq + 1;
+  next_frame_ = header.first_frame + header.num_frames;
+  if (header.flags & OnlineFeatPacketHeader::kEndOfStream)
+    EndStream();
+}
+
+void OnlineUdpInput::AppendHeldPackets() {
+  while (in_stream_ && !held_.empty() && held_.begin()->first == next_seq_) {
+    std::vector<char> &packet = held_.begin()->second;
+    OnlineFeatPacketHeader header;
+    header.Read(&(packet[0]), packet.size());
+    AppendPacket(header, &(packet[0]) + OnlineFeatPacketHeader::kSize);
+    held_.erase(held_.begin());
+  }
+}
+
+void OnlineUdpInput::SkipMissingPackets() {
+  uint32 seq = held_.begin()->first;
+  KALDI_WARN << "Lost packets " << next_seq_ << " to " << (seq - 1)
+             << " of stream " << stream_id_;
+  num_lost_ += seq - next_seq_;
+  next_seq_ = seq;
+  AppendHeldPackets();
+}
+
+void OnlineUdpInput::StartStream(const OnlineFeatPacketHeader &header) {
+  in_stream_ = true;
+  stream_id_ = header.stream_id;
+  // The packets before this one may still come.
+  next_seq_ = 0;
+  next_frame_ = 0;
+  held_.clear();
+  have_last_frame_ = false;
+}
+
+void OnlineUdpInput::EndStream() {
+  in_stream_ = false;
+  end_pending_ = true;
+  held_.clear();
+  past_streams_.push_back(stream_id_);
+  if (past_streams_.size() > kNumPastStreams)
+    past_streams_.pop_front();
+}
+
+bool OnlineUdpInput::IsPastStream(uint32 stream_id) const {
+  return std::find(past_streams_.begin(), past_streams_.end(), stream_id) !=
+      past_streams_.end();
+}
+
+#endif
+
+
+void OnlineFrameBuffer::Reserve(int32 num_frames) {
+  if (num_frames <= data_.NumRows())
+    return;
+  Matrix<BaseFloat> new_data(std::max(num_frames, 2 * data_.NumRows()), dim_,
+                             kUndefined);
+  if (num_frames_ > 0)
+    new_data.Range(0, num_frames_, 0, dim_).CopyFromMat(Frames());
+  data_.Swap(&new_data);
+}
+
+void OnlineFrameBuffer::Append(const MatrixBase<BaseFloat> &frames) {
+  KALDI_ASSERT(frames.NumCols() == dim_);
+  int32 num_new = frames.NumRows();
+  if (num_new == 0)
+    return;
+  Reserve(num_frames_ + num_new);
+  data_.Range(num_frames_, num_new, 0, dim_).CopyFromMat(frames);
+  num_frames_ += num_new;
+}
+
+void OnlineFrameBuffer::AppendCopies(const VectorBase<BaseFloat> &frame,
+                                     int32 count) {
+  Reserve(num_frames_ + count);
+  for (int32 i = 0; i < count; i++)
+    data_.Row(num_frames_++).CopyFromVec(frame);
+}
+
+void OnlineFrameBuffer::AppendCopiesOfLast(int32 count) {
+  KALDI_ASSERT(num_frames_ > 0);
+  Reserve(num_frames_ + count);
+  SubVector<BaseFloat> last(data_, num_frames_ - 1);
+  for (int32 i = 0; i < count; i++)
+    data_.Row(num_frames_++).CopyFromVec(last);
+}
+
+void OnlineFrameBuffer::KeepLast(int32 count) {
+  if (count >= num_frames_)
+    return;
+  int32 start = num_frames_ - count;
+  // The frames move towards the start, so a frame is always copied before it
+  // is overwritten.
+  for (int32 i = 0; i < count; i++)
+    data_.Row(i).CopyFromVec(data_.Row(start + i));
+  num_frames_ = count;
+}
+
+OnlineFrameRing::OnlineFrameRing(int32 capacity, int32 dim):
+    capacity_(capacity), num_frames_(0), data_(2 * capacity, dim, kUndefined) {
+  KALDI_ASSERT(capacity > 0);
+}
+
+void OnlineFrameRing::Append(const MatrixBase<BaseFloat> &frames) {
+  KALDI_ASSERT(frames.NumCols() == Dim());
+  int32 num_new = frames.NumRows(),
+      skip = std::max(0, num_new - capacity_); // would be overwritten anyway
+  num_frames_ += skip;
+  for (int32 i = skip; i < num_new; ) {
+    // As many frames as fit before the end of the first copy.
+    int32 row = num_frames_ % capacity_,
+        count = std::min(num_new - i, capacity_ - row);
+    SubMatrix<BaseFloat> src(frames, i, count, 0, Dim());
+    data_.Range(row, count, 0, Dim()).CopyFromMat(src);
+    data_.Range(row + capacity_, count, 0, Dim()).CopyFromMat(src);
+    i += count;
+    num_frames_ += count;
+  }
+}
+
+void OnlineFrameRing::SetCapacity(int32 capacity) {
+  KALDI_ASSERT(capacity > 0);
+  int32 num_kept = std::min(num_frames_ - Begin(), capacity);
+  Matrix<BaseFloat> kept;
+  if (num_kept > 0) {
+    kept.Resize(num_kept, Dim(), kUndefined);
+    kept.CopyFromMat(Frames(num_frames_ - num_kept, num_kept));
+  }
+  capacity_ = capacity;
+  data_.Resize(2 * capacity, Dim(), kUndefined);
+  num_frames_ -= num_kept;
+  if (num_kept > 0)
+    Append(kept);
+}
+
+
+//在线lda特征输入类的构造函数
+OnlineLdaInput::OnlineLdaInput(OnlineFeatInputItf *input,
+                               const Matrix<BaseFloat> &transform,
+                               int32 left_context,
+                               int32 right_context):
+    input_(input), input_dim_(input->Dim()),
+    left_context_(left_context), right_context_(right_context),
+    buffer_(input->Dim()) {
+  //总的上下文依赖数
+  int32 tot_context = left_context + 1 + right_context;
+  //判断lda矩阵的列数是否与输入的维度乘总上下文依赖数相同
+  if (transform.NumCols() == input_dim_ * tot_context) {
+    linear_transform_ = transform;
+    // and offset_ stays empty.
+  } else if (transform.NumCols() == input_dim_ * tot_context + 1) {
+    linear_transform_.Resize(transform.NumRows(), transform.NumCols() - 1);
+    linear_transform_.CopyFromMat(transform.Range(0, transform.NumRows(),
+                                           0, transform.NumCols() - 1));
+    offset_.Resize(transform.NumRows());
+    offset_.CopyColFromMat(transform, transform.NumCols() - 1);
+  } else {
+    KALDI_ERR << "Invalid parameters supplied to OnlineLdaInput";
+  }
+}
+
+void OnlineLdaInput::TransformToOutput(const MatrixBase<BaseFloat> &input,
+                                       Matrix<BaseFloat> *output) {
+  int32 context_window = left_context_ + 1 + right_context_,
+      num_frames_out = input.NumRows() - (context_window - 1),
+      output_dim = linear_transform_.NumRows();
+  if (num_frames_out <= 0) {
+    output->Resize(0, 0);
+    return;
+  }
+  output->Resize(num_frames_out, output_dim, kUndefined);
+  // Output frame t is the sum over "pos" of block "pos" of the transform
+  // times input frame t + pos, so for each block we do one GEMM over a
+  // shifted view of the input.  This reads each input frame once per block,
+  // where splicing would first write it context_window times.
+  for (int32 pos = 0; pos < context_window; pos++) {
+    SubMatrix<BaseFloat> frames(input, pos, num_frames_out, 0, input_dim_),
+        block(linear_transform_, 0, output_dim, pos * input_dim_, input_dim_);
+    output->AddMatMat(1.0, frames, kNoTrans, block, kTrans,
+                      (pos == 0 ? 0.0 : 1.0));
+  }
+  if (offset_.Dim() != 0)
+    output->AddVecToRows(1.0, offset_);
+}
+
+bool OnlineLdaInput::Compute(Matrix<BaseFloat> *output) {
+  KALDI_ASSERT(output->NumRows() > 0 &&
+               output->NumCols() == linear_transform_.NumRows());
+  // If output->NumRows() == 0, it corresponds to a request for zero frames,
+  // which makes no sense.
+
+  // We request the same number of frames of data that we were requested.
+  input_frames_.Resize(output->NumRows(), input_dim_, kUndefined);
+  bool ans = input_->Compute(&input_frames_);
+  int32 num_input = input_frames_.NumRows();
+  // If we got no input (timed out) and we're not at the end, we return
+  // empty output; likewise at the end of the input stream if there is
+  // nothing left over from before.
+  if (num_input == 0 && (ans || buffer_.NumFrames() == 0)) {
+    output->Resize(0, 0);
+    return ans;
+  }
+
+  // If this is the first segment of the utterance, we put in the
+  // initial duplicates of the first frame, numbered "left_context".
+  if (buffer_.NumFrames() == 0)
+    buffer_.AppendCopies(input_frames_.Row(0), left_context_);
+  buffer_.Append(input_frames_);
+  // If this is the last segment, we put in the final duplicates of the
+  // last frame, numbered "right_context".
+  if (!ans)
+    buffer_.AppendCopiesOfLast(right_context_);
+  
+  TransformToOutput(buffer_.Frames(), output);
+  // The size of the remainder that we propagate to the next call is
+  // context_window - 1, if available.
+  if (ans)
+    buffer_.KeepLast(left_context_ + right_context_);
+  else
+    buffer_.Clear();
+  return ans; 
+}
+
+
+OnlineCacheInput::OnlineCacheInput(OnlineFeatInputItf *input,
+                                   const OnlineCacheOptions &opts):
+    input_(input), opts_(opts), current_(input->Dim()), num_frames_(0),
+    memory_bytes_(0), num_spilled_(0) {
+  KALDI_ASSERT(opts.chunk_frames > 0 && opts.max_memory_mb >= 0.0);
+}
+
+bool OnlineCacheInput::Compute(Matrix<BaseFloat> *output) {
+  bool ans = input_->Compute(output);
+  for (int32 i = 0; i < output->NumRows(); ) {
+    int32 count = std::min(output->NumRows() - i,
+                           opts_.chunk_frames - current_.NumFrames());
+    current_.Append(output->Range(i, count, 0, Dim()));
+    i += count;
+    if (current_.NumFrames() == opts_.chunk_frames)
+      AddChunk();
+  }
+  num_frames_ += output->NumRows();
+  return ans;
+}
+
+void OnlineCacheInput::AddChunk() {
+  chunks_.push_back(Chunk());
+  Chunk &chunk = chunks_.back();
+  int32 num_frames = current_.NumFrames(), dim = Dim();
+  chunk.num_frames = num_frames;
+  chunk.file_offset = -1;
+  if (opts_.compress) {
+    chunk.compressed.CopyFromMat(current_.Frames());
+    // As CompressedMatrix lays out its data: a global header, and either a
+    // header per column and a byte per element, or two bytes per element
+    // for matrices of up to 8 rows.
+    chunk.bytes = 16 + (num_frames > 8 ? 8 * dim + num_frames * dim
+                                       : 2 * num_frames * dim);
+  } else {
+    chunk.frames.Resize(num_frames, dim, kUndefined);
+    chunk.frames.CopyFromMat(current_.Frames());
+    chunk.bytes = static_cast<int64>(num_frames) * dim * sizeof(BaseFloat);
+  }
+  current_.Clear();
+  memory_bytes_ += chunk.bytes;
+  if (opts_.max_memory_mb > 0.0 &&
+      memory_bytes_ > opts_.max_memory_mb * 1048576.0)
+    SpillChunks();
+}
+
+void OnlineCacheInput::SpillChunks() {
+  if (!spill_file_.is_open())
+    OpenSpillFile();
+  spill_file_.clear();
+  spill_file_.seekp(0, std::ios::end);
+  while (memory_bytes_ > opts_.max_memory_mb * 1048576.0 &&
+         num_spilled_ < chunks_.size()) {
+    Chunk &chunk = chunks_[num_spilled_++];
+    chunk.file_offset = spill_file_.tellp();
+    if (opts_.compress) {
+      chunk.compressed.Write(spill_file_, true);
+      chunk.compressed.Clear();
+    } else {
+      chunk.frames.Write(spill_file_, true);
+      chunk.frames.Resize(0, 0);
+    }
+    memory_bytes_ -= chunk.bytes;
+  }
+  if (!spill_file_.good())
+    KALDI_ERR << "Error writing cached features to a temporary file";
+}
+
+void OnlineCacheInput::OpenSpillFile() {
+#if !defined(_MSC_VER)
+  std::string dir = opts_.spill_dir;
+  if (dir.empty()) {
+    const char *tmpdir = getenv("TMPDIR");
+    dir = (tmpdir != NULL ? tmpdir : "/tmp");
+  }
+  std::string pattern = dir + "/kaldi-online-cache-XXXXXX";
+  std::vector<char> name(pattern.begin(), pattern.end());
+  name.push_back('\0');
+  int fd = mkstemp(&(name[0]));
+  if (fd == -1)
+    KALDI_ERR << "Could not create a temporary file in " << dir;
+  spill_file_.open(&(name[0]), std::ios::in | std::ios::out |
+                   std::ios::binary | std::ios::trunc);
+  close(fd);
+  unlink(&(name[0])); // it goes away once closed, whatever happens.
+  if (!spill_file_.is_open())
+    KALDI_ERR << "Could not open the temporary file " << &(name[0]);
+#else
+  KALDI_ERR << "Moving cached features to a file is not supported here.";
+#endif
+}
+
+void OnlineCacheInput::GetCachedData(Matrix<BaseFloat> *output) {
+  if (num_frames_ == 0) {
+    output->Resize(0, 0);
+    return;
+  }
+  int32 dim = Dim(), offset = 0;
+  output->Resize(num_frames_, dim, kUndefined);
+  for (size_t i = 0; i < chunks_.size(); i++) {
+    const Chunk &chunk = chunks_[i];
+    SubMatrix<BaseFloat> dest(*output, offset, chunk.num_frames, 0, dim);
+    if (chunk.file_offset >= 0) {
+      spill_file_.clear();
+      spill_file_.seekg(chunk.file_offset);
+      if (opts_.compress) {
+        read_compressed_.Read(spill_file_, true);
+        read_compressed_.CopyToMat(&dest);
+      } else {
+        read_frames_.Read(spill_file_, true);
+        dest.CopyFromMat(read_frames_);
+      }
+      if (spill_file_.fail())
+        KALDI_ERR << "Error reading cached features from a temporary file";
+    } else if (opts_.compress) {
+      chunk.compressed.CopyToMat(&dest);
+    } else {
+      dest.CopyFromMat(chunk.frames);
+    }
+    offset += chunk.num_frames;
+  }
+  if (current_.NumFrames() != 0)
+    output->Range(offset, current_.NumFrames(), 0, dim).CopyFromMat(
+        current_.Frames());
+}
+
+void OnlineCacheInput::Deallocate() {
+  chunks_.clear();
+  current_.Clear();
+  num_frames_ = 0;
+  memory_bytes_ = 0;
+  num_spilled_ = 0;
+  if (spill_file_.is_open())
+    spill_file_.close();
+}
+
+
+BatchDeltaFeatures::BatchDeltaFeatures(const DeltaFeaturesOptions &opts):
+    opts_(opts) {
+  KALDI_ASSERT(opts.order >= 0 && opts.order < 1000);
+  KALDI_ASSERT(opts.window > 0 && opts.window < 1000);
+  // The filters are worked out exactly as in DeltaFeatures, so that we
+  // get the same output.
+  scales_.resize(opts.order + 1);
+  scales_[0].resize(1, 1.0);
+  for (int32 i = 1; i <= opts.order; i++) {
+    const std::vector<BaseFloat> &prev_scales = scales_[i - 1];
+    std::vector<BaseFloat> &cur_scales = scales_[i];
+    int32 window = opts.window,
+        prev_offset = (static_cast<int32>(prev_scales.size()) - 1) / 2,
+        cur_offset = prev_offset + window;
+    cur_scales.resize(prev_scales.size() + 2 * window, 0.0);
+    BaseFloat normalizer = 0.0;
+    for (int32 j = -window; j <= window; j++) {
+      normalizer += j * j;
+      for (int32 k = -prev_offset; k <= prev_offset; k++)
+        cur_scales[j + k + cur_offset] +=
+            static_cast<BaseFloat>(j) * prev_scales[k + prev_offset];
+    }
+    BaseFloat scale = 1.0 / normalizer;
+    for (size_t j = 0; j < cur_scales.size(); j++)
+      cur_scales[j] *= scale;
+  }
+}
+
+void BatchDeltaFeatures::Process(const MatrixBase<BaseFloat> &input,
+                                 MatrixBase<BaseFloat> *output) const {
+  int32 dim = input.NumCols(), num_frames = output->NumRows(),
+      context = Context();
+  KALDI_ASSERT(num_frames == input.NumRows() - 2 * context &&
+               output->NumCols() == dim * (opts_.order + 1));
+  MatrixIndexT in_stride = input.Stride(), out_stride = output->Stride();
+  output->SetZero();
+  for (int32 i = 0; i <= opts_.order; i++) {
+    const std::vector<BaseFloat> &scales = scales_[i];
+    int32 max_offset = (static_cast<int32>(scales.size()) - 1) / 2;
+    BaseFloat *out_block = output->Data() + i * dim;
+    // One tap of the filter at a time, over the whole block.  The taps are
+    // added in the same order as in DeltaFeatures::Process().
+    for (int32 j = -max_offset; j <= max_offset; j++) {
+      BaseFloat scale = scales[j + max_offset];
+      if (scale == 0.0)
+        continue;
+      const BaseFloat *in_data = input.Data() + (context + j) * in_stride;
+      for (int32 t = 0; t < num_frames; t++) {
+        const BaseFloat *in_row = in_data + t * in_stride;
+        BaseFloat *out_row = out_block + t * out_stride;
+        for (int32 d = 0; d < dim; d++)
+          out_row[d] += scale * in_row[d];
+      }
+    }
+  }
+}
+
+void ComputeDeltasBatch(const DeltaFeaturesOptions &delta_opts,
+                        const MatrixBase<BaseFloat> &input_features,
+                        Matrix<BaseFloat> *output_features) {
+  int32 num_frames = input_features.NumRows(), dim = input_features.NumCols();
+  if (num_frames == 0) {
+    output_features->Resize(0, 0);
+    return;
+  }
+  BatchDeltaFeatures delta(delta_opts);
+  int32 context = delta.Context();
+  // At the edges, DeltaFeatures uses the first and last frames in place of
+  // the missing ones; we copy them there.
+  Matrix<BaseFloat> padded(num_frames + 2 * context, dim, kUndefined);
+  for (int32 t = 0; t < padded.NumRows(); t++) {
+    int32 t_in = std::min(std::max(t - context, 0), num_frames - 1);
+    padded.Row(t).CopyFromVec(input_features.Row(t_in));
+  }
+  output_features->Resize(num_frames, dim * (delta_opts.order + 1), kUndefined);
+  delta.Process(padded, output_features);
+}
+
+
+OnlineDeltaInput::OnlineDeltaInput(const DeltaFeaturesOptions &delta_opts,
+                                   OnlineFeatInputItf *input):
+    input_(input), opts_(delta_opts), input_dim_(input_->Dim()),
+    delta_(delta_opts), buffer_(input_->Dim()) { }
+
+
+void OnlineDeltaInput::DeltaComputation(const MatrixBase<BaseFloat> &input,
+                                        Matrix<BaseFloat> *output) const {
+  int32 input_rows = input.NumRows(),
+      output_rows = std::max(0, input_rows - Context() * 2),
+      output_dim = Dim();
+  if (output_rows > 0) {
+    output->Resize(output_rows, output_dim, kUndefined);
+    delta_.Process(input, output);
+  } else {
+    output->Resize(0, 0);
+  }
+}                                     
+
+bool OnlineDeltaInput::Compute(Matrix<BaseFloat> *output) {
+  KALDI_ASSERT(output->NumRows() > 0 &&
+               output->NumCols() == Dim());
+  // If output->NumRows() == 0, it corresponds to a request for zero frames,
+  // which makes no sense.
+
+  // We request the same number of frames of data that we were requested.
+  input_frames_.Resize(output->NumRows(), input_dim_, kUndefined);
+  bool ans = input_->Compute(&input_frames_);
+  int32 num_input = input_frames_.NumRows();
+
+  // If we got no input (timed out) and we're not at the end, we return
+  // empty output; likewise at the end of the input stream if there is
+  // nothing left over from before.
+  if (num_input == 0 && (ans || buffer_.NumFrames() == 0)) {
+    output->Resize(0, 0);
+    return ans;
+  }
+
+  // If this is the first segment of the utterance, we put in the
+  // initial duplicates of the first frame, numbered "Context()"
+  if (buffer_.NumFrames() == 0)
+    buffer_.AppendCopies(input_frames_.Row(0), Context());
+  buffer_.Append(input_frames_);
+  // If this is the last segment, we put in the final duplicates of the
+  // last frame, numbered "Context()".
+  if (!ans)
+    buffer_.AppendCopiesOfLast(Context());
+  
+  DeltaComputation(buffer_.Frames(), output);
+  // The last Context() * 2 frames are needed as context for the next call.
+  if (ans)
+    buffer_.KeepLast(Context() * 2);
+  else
+    buffer_.Clear();
+  return ans; 
+}
+
+
+
+void OnlineFeatureMatrix::GetNextFeatures() {
+  if (finished_) return; // Nothing to do.
+  
+  int32 iter;
+  for (iter = 0; iter < opts_.num_tries; iter++) {
+    // This does nothing if the last call produced a full batch.
+    next_features_.Resize(opts_.batch_size, feat_dim_, kUndefined);
+    finished_ = ! input_->Compute(&next_features_);
+    if (next_features_.NumRows() == 0 && ! finished_) {
+      // It timed out.  Try again.
+      continue;
+    }
+    if (next_features_.NumRows() > 0) {
+      // We always keep the most recent frame of features, if present, in
+      // case it is needed (this may happen when someone calls IsLastFrame(),
+      // which requires us to get the next frame, while they're stil
+      // processing this frame), and history_frames before it.  The input may
+      // give us more than we asked for.
+      int32 capacity = opts_.history_frames + 1 + next_features_.NumRows();
+      if (capacity > frames_.Capacity())
+        frames_.SetCapacity(capacity);
+      frames_.Append(next_features_);
+    }
+    break;
+  }
+  if (iter == opts_.num_tries) { // we fell off the loop
+    KALDI_WARN << "After " << opts_.num_tries << ", got no features, giving up.";
+    finished_ = true; // We set finished_ to true even though the stream
+    // doesn't say it's finished, because the delay is too much-- we gave up.
+  }
+}
+
+
+bool OnlineFeatureMatrix::IsValidFrame (int32 frame) {
+   KALDI_ASSERT(frame >= frames_.Begin() &&
+               "You are attempting to get expired frames.");
+  if (frame < frames_.NumFrames())
+    return true;
+  else {
+    GetNextFeatures();
+    if (frame < frames_.NumFrames())
+      return true;
+    else {
+      if (finished_) return false;
+      else {
+        KALDI_WARN << "Unexpected point reached in code: "
+                   << "possibly you are skipping frames?";
+        return false;
+      }
+    }
+  }
+}
+
+SubVector<BaseFloat> OnlineFeatureMatrix::GetFrame(int32 frame) {
+  if (frame < frames_.Begin())
+    KALDI_ERR << "Attempting to get a discarded frame.";
+  if (frame >= frames_.NumFrames())
+    KALDI_ERR << "Attempt get frame without check its validity.";
+  return frames_.Frame(frame);
+}
+
+SubMatrix<BaseFloat> OnlineFeatureMatrix::GetFrames(int32 frame,
+                                                    int32 num_frames) {
+  if (frame < frames_.Begin())
+    KALDI_ERR << "Attempting to get a discarded frame.";
+  if (num_frames <= 0 || frame + num_frames > frames_.NumFrames())
+    KALDI_ERR << "Attempt get frames without check their validity.";
+  return frames_.Frames(frame, num_frames);
+}
+
+
+} // namespace kaldi
+
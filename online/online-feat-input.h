@@ -1,379 +1,779 @@
-// online/online-feat-input.h
-
-// Copyright 2012 Cisco Systems (author: Matthias Paulik)
-//           2012-2013  Vassil Panayotov
-//           2013 Johns Hopkins University (author: Daniel Povey)
-
-// See ../../COPYING for clarification regarding multiple authors
-//
-// Licensed under the Apache License, Version 2.0 (the "License");
-// you may not use this file except in compliance with the License.
-// You may obtain a copy of the License at
-//
-//  http://www.apache.org/licenses/LICENSE-2.0
-//
-// THIS CODE IS PROVIDED *AS IS* BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
-// KIND, EITHER EXPRESS OR IMPLIED, INCLUDING WITHOUT LIMITATION ANY IMPLIED
-// WARRANTIES OR CONDITIONS OF TITLE, FITNESS FOR A PARTICULAR PURPOSE,
-// MERCHANTABLITY OR NON-INFRINGEMENT.
-// See the Apache 2 License for the specific language governing permissions and
-// limitations under the License.
-
-#ifndef KALDI_ONLINE_ONLINE_FEAT_INPUT_H_
-#define KALDI_ONLINE_ONLINE_FEAT_INPUT_H_
-
-#if !defined(_MSC_VER)
-#include <sys/types.h>
-#include <sys/socket.h>
-#include <netinet/in.h>
-#include <arpa/inet.h>
-#endif
-
-#include "online-audio-source.h"
-#include "feat/feature-functions.h"
-
-namespace kaldi {
-
-//接口说明
-class OnlineFeatInputItf {
- public:
-  // 以一些方式生成特征向量
-  //这些特征很可能是 例如从音频样本中接收并提取，或者从另一个在线特征输入类转换而来
-  //
-  // "output" - a matrix to store the extracted feature vectors in its rows.
-  //            The number of rows (NumRows()) of "output" when the function is
-  //            called, is treated as a hint of how many frames the user wants,
-  //            but this function does not promise to produce exactly that many:
-  //            it may be slightly more, less, or even zero, on a given call.
-  //            Zero frames may be returned because we timed out or because
-  //            we're at the beginning of the file and some buffering is going on.
-  //            In that case you should try again.  The function will return "false"
-  //            when it knows the stream is finished, but if it returns nothing
-  //            several times in a row you may want to terminate processing the
-  //            stream.按行存储了提取出的特征向量的矩阵。函数调用时输出的行数表明了用户需要的帧数
-  //
-  // Note: similar to the OnlineAudioInput::Read(), Compute() previously
-  //       had a second argument - "timeout". Again we decided against including
-  //       this parameter in the interface specification. Instead we are
-  //       considering time out handling to be implementation detail, and if needed
-  //       it should be configured, through the descendant class' constructor,
-  //       or by other means.
-  //       For consistency, we recommend 'timeout' values greater than zero
-  //       to mean that Compute() should not block for more than that number
-  //       of milliseconds, and to return whatever data it has, when the timeout
-  //       period is exceeded.
-  //
-  // Returns "false" if we know the underlying data source has no more data, and
-  // true if there may be more data.
-  virtual bool Compute(Matrix<BaseFloat> *output) = 0;
-
-  virtual int32 Dim() const = 0; // 返回这些特征的输出维度
-  
-  virtual ~OnlineFeatInputItf() {}
-};
-
-
-// Acts as a proxy to an underlying OnlineFeatInput.作为潜在在线特征输入的代理
-// 运用倒谱均值归一化
-class OnlineCmnInput: public OnlineFeatInputItf {
- public:
-  // "input" - 未归一化的在线特征输入
-  // "cmn_window" - the count of the preceding vectors over which the average is
-  //                calculated
-  // "min_window" - the minimum count of frames for which it will compute the
-  //                mean, at the start of the file.  Adds latency but only at the
-  //                start
-  OnlineCmnInput(OnlineFeatInputItf *input, int32 cmn_window, int32 min_window)
-      : input_(input), cmn_window_(cmn_window), min_window_(min_window),
-        history_(cmn_window + 1, input->Dim()), t_in_(0), t_out_(0),
-        sum_(input->Dim()) { KALDI_ASSERT(cmn_window >= min_window && min_window > 0); }
-  
-  virtual bool Compute(Matrix<BaseFloat> *output);
-
-  virtual int32 Dim() const { return input_->Dim(); }
-
- private:
-  virtual bool ComputeInternal(Matrix<BaseFloat> *output);
-
-  
-  OnlineFeatInputItf *input_;
-  const int32 cmn_window_; // > 0
-  const int32 min_window_; // > 0, < cmn_window_.
-  Matrix<BaseFloat> history_; // circular-buffer history, of dim (cmn_window_ +
-                              // 1, feat-dim).  The + 1 is to serve as a place
-                              // for the frame we're about to normalize.
-
-  void AcceptFrame(const VectorBase<BaseFloat> &input); // Accept the next frame
-                                                        // of input (read into the
-                                                        // history buffer).
-  void OutputFrame(VectorBase<BaseFloat> *output); // Output the next frame.
-  
-  int32 NumOutputFrames(int32 num_new_frames,
-                        bool more_data) const; // Tells the caller, assuming
-  // we get given "num_new_frames" of input (and given knowledge of whether
-  // there is more data coming), how many frames would we be able to
-  // output?
-  
-  
-  int64 t_in_; // Time-counter for what we've obtained from the input.
-  int64 t_out_; // Time-counter for what we've written to the output.
-  
-  Vector<double> sum_; // Sum of the frames from t_out_ - HistoryLength(t_out_),
-                       // to t_out_ - 1.
-  
-  KALDI_DISALLOW_COPY_AND_ASSIGN(OnlineCmnInput);
-};
-
-//继承自OnlineFeatInputItf类
-class OnlineCacheInput : public OnlineFeatInputItf {
- public:
-  OnlineCacheInput(OnlineFeatInputItf *input): input_(input) { }
-  
-  // The Compute function just forwards to the previous member of the
-  // chain, except that we locally accumulate the result, and
-  // GetCachedData() will return the entire input up to the current time.
-  virtual bool Compute(Matrix<BaseFloat> *output);
-
-  void GetCachedData(Matrix<BaseFloat> *output);
-  
-  int32 Dim() const { return input_->Dim(); }
-  
-  void Deallocate();
-    
-  virtual ~OnlineCacheInput() { Deallocate(); }
-  
- private:
-  OnlineFeatInputItf *input_;
-  // data_ is a list of all the outputs we produced in successive
-  // calls to Compute().  The memory is owned here.
-  //data_是我们持续调用compute函数生成的所有输出的列表
-  std::vector<Matrix<BaseFloat>* > data_;
-};
-
-
-#if !defined(_MSC_VER)
-
-// Accepts features over an UDP socket
-// The current implementation doesn't support the "timeout" -
-// the server is waiting for data indefinetily long time.
-//接收udp套接字传来的特征 目前的实现不支持暂停——服务器长时间等待数据的到来
-class OnlineUdpInput : public OnlineFeatInputItf {
- public:
-  OnlineUdpInput(int32 port, int32 feature_dim);
-
-  virtual bool Compute(Matrix<BaseFloat> *output);
-  //特征维度
-  virtual int32 Dim() const { return feature_dim_; }
-  //客户端地址
-  const sockaddr_in& client_addr() const { return client_addr_; }
-  //返回套接字描述符
-  const int32 descriptor() const { return sock_desc_; }
-  
- private:
-  int32 feature_dim_;
-  // various BSD sockets-related data structures
-  int32 sock_desc_; // 套接字描述符
-  sockaddr_in server_addr_;   //套接字服务器地址
-  sockaddr_in client_addr_;   //套接字客户端地址
-};
-
-#endif
-
-
-// Splices the input features and applies a transformation matrix.
-// Note: the transformation matrix will usually be a linear transformation
-// [output-dim x input-dim] but we accept an affine transformation too.
-//拼接输入特征并且运用一个转换矩阵。
-//注意：转换矩阵通常是线性变换
-//只有在输入了lda矩阵的情况下调用这个类
-class OnlineLdaInput: public OnlineFeatInputItf {
- public:
-  OnlineLdaInput(OnlineFeatInputItf *input,
-                 const Matrix<BaseFloat> &transform,
-                 int32 left_context,
-                 int32 right_context);
-
-  virtual bool Compute(Matrix<BaseFloat> *output);
-
-  virtual int32 Dim() const { return linear_transform_.NumRows(); }
-
- private:
-  // The static function SpliceFeats splices together the features and
-  // puts them together in a matrix, so that each row of "output" contains
-  // a contiguous window of size "context_window" of input frames.  The dimension
-  // of "output" will be feats.NumRows() - context_window + 1 by
-  // feats.NumCols() * context_window.  The input features are
-  // treated as if the frames of input1, input2 and input3 have been appended
-  // together before applying the main operation.
-  static void SpliceFrames(const MatrixBase<BaseFloat> &input1,
-                           const MatrixBase<BaseFloat> &input2,
-                           const MatrixBase<BaseFloat> &input3,
-                           int32 context_window,
-                           Matrix<BaseFloat> *output);
-
-  void TransformToOutput(const MatrixBase<BaseFloat> &spliced_feats,
-                         Matrix<BaseFloat> *output);
-  void ComputeNextRemainder(const MatrixBase<BaseFloat> &input);
-  
-  OnlineFeatInputItf *input_; // underlying/inferior input object
-  const int32 input_dim_; // dimension of the feature vectors before xform
-  const int32 left_context_;
-  const int32 right_context_;
-  Matrix<BaseFloat> linear_transform_; // LDA转换矩阵 (只有线性部分)
-  Vector<BaseFloat> offset_; // Offset, if present; else empty.
-  Matrix<BaseFloat> remainder_; // The last few frames of the input, that may
-  // be needed for context purposes.
-  
-  KALDI_DISALLOW_COPY_AND_ASSIGN(OnlineLdaInput);
-};
-
-
-// 计算时间导数 (e.g., 添加 deltas 和 delta-deltas).
-// 这是更加陈旧的特征提取标准.  Like an online
-// version of the function ComputeDeltas in feat/feature-functions.h, where the
-// class DeltaFeaturesOptions is also defined.
-class OnlineDeltaInput: public OnlineFeatInputItf {
- public:
-  OnlineDeltaInput(const DeltaFeaturesOptions &delta_opts,
-                   OnlineFeatInputItf *input);
-  
-  virtual bool Compute(Matrix<BaseFloat> *output);
-
-  virtual int32 Dim() const { return input_dim_ * (opts_.order + 1); }
-  
- private:
-  // The static function AppendFrames appends together the three input matrices,
-  // some of which may be empty.
-  static void AppendFrames(const MatrixBase<BaseFloat> &input1,
-                           const MatrixBase<BaseFloat> &input2,
-                           const MatrixBase<BaseFloat> &input3,
-                           Matrix<BaseFloat> *output);
-
-  // Context() is the number of frames on each side of a given frame,
-  // that we need for context.
-  int32 Context() const { return opts_.order * opts_.window; }
-  
-  // Does the delta computation.  Here, "output" will be resized to dimension
-  // (input.NumRows() - Context() * 2) by (input.NumCols() * opts_.order)
-  // "remainder" will be the last Context() rows of "input".
-  void DeltaComputation(const MatrixBase<BaseFloat> &input,
-                        Matrix<BaseFloat> *output,
-                        Matrix<BaseFloat> *remainder) const;
-  
-  OnlineFeatInputItf *input_; // underlying/inferior input object
-  DeltaFeaturesOptions opts_;
-  const int32 input_dim_;
-  Matrix<BaseFloat> remainder_; // The last few frames of the input, that may
-  // be needed for context purposes.
-  
-  KALDI_DISALLOW_COPY_AND_ASSIGN(OnlineDeltaInput);
-};
-
-// Implementation, that is meant to be used to read samples from an
-// OnlineAudioSource and to extract MFCC/PLP features in the usual way
-//执行，意味着以通常的方式从一个onlineaudiosource对象中读取样本并且提取mfcc/plp特征
-template <class E>
-class OnlineFeInput : public OnlineFeatInputItf {
- public:
-  // "au_src" - OnlineAudioSourceItf对象
-  // "fe" - 执行MFCC/PLP特征提取的对象
-  // "frame_size" - 音频样本的帧提取窗口大小
-  // "frame_shift" - 音频样本的特征帧宽度
-  OnlineFeInput(OnlineAudioSourceItf *au_src, E *fe,
-                const int32 frame_size, const int32 frame_shift);
-
-  virtual int32 Dim() const { return extractor_->Dim(); }
-
-  virtual bool Compute(Matrix<BaseFloat> *output);
-
- private:
-  OnlineAudioSourceItf *source_; // 音频资源
-  E *extractor_; // 实际使用的特征提取器
-  const int32 frame_size_;
-  const int32 frame_shift_;
-  Vector<BaseFloat> wave_; // 传输后用于提取的样本
-
-  KALDI_DISALLOW_COPY_AND_ASSIGN(OnlineFeInput);
-};
-
-template<class E>
-OnlineFeInput<E>::OnlineFeInput(OnlineAudioSourceItf *au_src, E *fe,
-                                   int32 frame_size, int32 frame_shift)
-    : source_(au_src), extractor_(fe),
-      frame_size_(frame_size), frame_shift_(frame_shift) {}
-
-template<class E> bool
-OnlineFeInput<E>::Compute(Matrix<BaseFloat> *output) {
-  MatrixIndexT nvec = output->NumRows(); // 输出特征的数量
-  if (nvec <= 0) {
-    KALDI_WARN << "No feature vectors requested?!";
-    return true;
-  }
-
-  
-  //准备输入音频样本
-  int32 samples_req = frame_size_ + (nvec - 1) * frame_shift_;
-  Vector<BaseFloat> read_samples(samples_req);
-
-  bool ans = source_->Read(&read_samples);
-
-  // 提取特征
-  if (read_samples.Dim() >= frame_size_) {
-    extractor_->Compute(read_samples, 1.0, output);
-  } else {
-    output->Resize(0, 0);
-  }
-
-  return ans;
-}
-
-struct OnlineFeatureMatrixOptions {
-  int32 batch_size; // 每一次请求的帧数
-  int32 num_tries; // 在放弃请求之前得到空输出和超时的尝试次数
-
-  OnlineFeatureMatrixOptions(): batch_size(27),
-                                num_tries(5) { }
-  void Register(OptionsItf *opts) {
-    opts->Register("batch-size", &batch_size,
-                   "Number of feature vectors processed w/o interruption");
-    opts->Register("num-tries", &num_tries,
-                   "Number of successive repetitions of timeout before we "
-                   "terminate stream");
-  }
-};
-
-// The class OnlineFeatureMatrix wraps something of type
-// OnlineFeatInputItf in a manner that is convenient for
-// a Decodable type to consume.
-class OnlineFeatureMatrix {
- public:
-  OnlineFeatureMatrix(const OnlineFeatureMatrixOptions &opts,
-                      OnlineFeatInputItf *input):
-      opts_(opts), input_(input), feat_dim_(input->Dim()),
-      feat_offset_(0), finished_(false) { }
-  
-  bool IsValidFrame (int32 frame); 
-
-  int32 Dim() const { return feat_dim_; }
-
-  //如果不是有效的帧  GetFrame() 调用失败; you have to
-  // call IsValidFrame() for this frame, to see whether it
-  // is valid.
-  SubVector<BaseFloat> GetFrame(int32 frame);
-
-  bool Good(); // 如果我们至少拥有一帧返回真值
- private:
-  void GetNextFeatures(); //当我们需要更多特征时调用.确保获得至少一帧或者将finished_设为true
-  
-  const OnlineFeatureMatrixOptions opts_;
-  OnlineFeatInputItf *input_;
-  int32 feat_dim_;
-  Matrix<BaseFloat> feat_matrix_;
-  int32 feat_offset_; // 目前批次下第一帧的帧移
-  bool finished_; // 如果没有得到更多的输入帧则为真
-};
-
-
-} //  kaldi命名空间
-
-#endif // KALDI_ONLINE_ONLINE_FEAT_INPUT_H_
+// online/online-feat-input.h
+
+// Copyright 2012 Cisco Systems (author: Matthias Paulik)
+//           2012-2013  Vassil Panayotov
+//           2013 Johns Hopkins University (author: Daniel Povey)
+
+// See ../../COPYING for clarification regarding multiple authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//  http://www.apache.org/licenses/LICENSE-2.0
+//
+// THIS CODE IS PROVIDED *AS IS* BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, EITHER EXPRESS OR IMPLIED, INCLUDING WITHOUT LIMITATION ANY IMPLIED
+// WARRANTIES OR CONDITIONS OF TITLE, FITNESS FOR A PARTICULAR PURPOSE,
+// MERCHANTABLITY OR NON-INFRINGEMENT.
+// See the Apache 2 License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef KALDI_ONLINE_ONLINE_FEAT_INPUT_H_
+#define KALDI_ONLINE_ONLINE_FEAT_INPUT_H_
+
+#if !defined(_MSC_VER)
+#include <sys/types.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+#endif
+#if defined(__linux__)
+#include <sys/uio.h>
+#endif
+
+#include <algorithm>
+#include <cstring>
+#include <deque>
+#include <fstream>
+#include <map>
+#include <string>
+#include <vector>
+
+#include "online-audio-source.h"
+#include "feat/feature-functions.h"
+#include "matrix/compressed-matrix.h"
+#include "transform/cmvn.h"
+
+namespace kaldi {
+
+//接口说明
+class OnlineFeatInputItf {
+ public:
+  // 以一些方式生成特征向量
+  //这些特征很可能是 例如从音频样本中接收并提取，或者从另一个在线特征输入类转换而来
+  //
+  // "output" - a matrix to store the extracted feature vectors in its rows.
+  //            The number of rows (NumRows()) of "output" when the function is
+  //            called, is treated as a hint of how many frames the user wants,
+  //            but this function does not promise to produce exactly that many:
+  //            it may be slightly more, less, or even zero, on a given call.
+  //            Zero frames may be returned because we timed out or because
+  //            we're at the beginning of the file and some buffering is going on.
+  //            In that case you should try again.  The function will return "false"
+  //            when it knows the stream is finished, but if it returns nothing
+  //            several times in a row you may want to terminate processing the
+  //            stream.按行存储了提取出的特征向量的矩阵。函数调用时输出的行数表明了用户需要的帧数
+  //
+  // Note: similar to the OnlineAudioInput::Read(), Compute() previously
+  //       had a second argument - "timeout". Again we decided against including
+  //       this parameter in the interface specification. Instead we are
+  //       considering time out handling to be implementation detail, and if needed
+  //       it should be configured, through the descendant class' constructor,
+  //       or by other means.
+  //       For consistency, we recommend 'timeout' values greater than zero
+  //       to mean that Compute() should not block for more than that number
+  //       of milliseconds, and to return whatever data it has, when the timeout
+  //       period is exceeded.
+  //
+  // Returns "false" if we know the underlying data source has no more data, and
+  // true if there may be more data.
+  virtual bool Compute(Matrix<BaseFloat> *output) = 0;
+
+  virtual int32 Dim() const = 0; // 返回这些特征的输出维度
+  
+  virtual ~OnlineFeatInputItf() {}
+};
+
+
+// Options for OnlineCmnInput other than the window sizes, which the programs
+// register separately.
+struct OnlineCmnOptions {
+  std::string prior_rxfilename; // global CMVN stats to start from, if any
+  BaseFloat prior_frames; // the global stats are scaled to this many frames
+  BaseFloat decay; // if > 0, use an exponentially decaying mean
+
+  OnlineCmnOptions(): prior_frames(200.0), decay(0.0) { }
+  void Register(OptionsItf *opts) {
+    opts->Register("cmn-prior", &prior_rxfilename,
+                   "Global CMVN stats (e.g. from compute-cmvn-stats and "
+                   "matrix-sum) used as the mean at the start of each "
+                   "utterance, so that there is no start-up delay");
+    opts->Register("cmn-prior-frames", &prior_frames,
+                   "The stats from --cmn-prior count as at most this many "
+                   "frames when combined with the stats of a speaker");
+    opts->Register("cmn-decay", &decay,
+                   "If > 0, subtract an exponentially decaying mean, with "
+                   "this decay per frame (e.g. 0.995), instead of the mean "
+                   "over --cmn-window frames");
+  }
+};
+
+// Acts as a proxy to an underlying OnlineFeatInput.作为潜在在线特征输入的代理
+// 运用倒谱均值归一化
+class OnlineCmnInput: public OnlineFeatInputItf {
+ public:
+  // "input" - 未归一化的在线特征输入
+  // "cmn_window" - the count of the preceding vectors over which the average is
+  //                calculated
+  // "min_window" - the minimum count of frames for which it will compute the
+  //                mean, at the start of the file.  Adds latency but only at the
+  //                start, and only if there is no prior (see SetPrior())
+  // "decay" - if > 0, we subtract the mean of all the preceding frames,
+  //           weighted by decay^(number of frames ago), and cmn_window only
+  //           limits how long frames may be held back
+  OnlineCmnInput(OnlineFeatInputItf *input, int32 cmn_window, int32 min_window,
+                 BaseFloat decay = 0.0)
+      : input_(input), cmn_window_(cmn_window), min_window_(min_window),
+        decay_(decay), history_(cmn_window + 1, input->Dim()), t_in_(0),
+        t_out_(0), sum_(input->Dim()), count_(0.0), mean_(input->Dim()) {
+    KALDI_ASSERT(cmn_window >= min_window && min_window > 0);
+    KALDI_ASSERT(decay >= 0.0 && decay < 1.0);
+    InitCmvnStats(input->Dim(), &stats_);
+  }
+  
+  virtual bool Compute(Matrix<BaseFloat> *output);
+
+  virtual int32 Dim() const { return input_->Dim(); }
+
+  // Sets the mean we start from, from CMVN stats in the usual format (the
+  // first row has the sums of the features, followed by the count).  With a
+  // prior there is no start-up delay: while there are fewer than cmn_window
+  // frames of history, the prior mean makes up for the missing frames (or,
+  // with "decay", counts as 1 / (1 - decay) frames).  Must be called before
+  // the first call to Compute().
+  void SetPrior(const MatrixBase<double> &stats);
+
+  // Outputs the prior stats plus the stats of all the frames read so far, to
+  // be used as the prior for the next utterance of the same speaker.
+  void GetStats(Matrix<double> *stats) const;
+
+ private:
+  virtual bool ComputeInternal(Matrix<BaseFloat> *output);
+
+  
+  OnlineFeatInputItf *input_;
+  const int32 cmn_window_; // > 0
+  const int32 min_window_; // > 0, < cmn_window_.
+  const BaseFloat decay_; // 0 for a mean over the last cmn_window_ frames
+  Matrix<BaseFloat> history_; // circular-buffer history, of dim (cmn_window_ +
+                              // 1, feat-dim).  The + 1 is to serve as a place
+                              // for the frame we're about to normalize.
+
+  void AcceptFrame(const VectorBase<BaseFloat> &input); // Accept the next frame
+                                                        // of input (read into the
+                                                        // history buffer).
+  void OutputFrame(VectorBase<BaseFloat> *output); // Output the next frame.
+  
+  int32 NumOutputFrames(int32 num_new_frames,
+                        bool more_data) const; // Tells the caller, assuming
+  // we get given "num_new_frames" of input (and given knowledge of whether
+  // there is more data coming), how many frames would we be able to
+  // output?
+  
+  
+  int64 t_in_; // Time-counter for what we've obtained from the input.
+  int64 t_out_; // Time-counter for what we've written to the output.
+  
+  Vector<double> sum_; // Sum of the frames from t_out_ - HistoryLength(t_out_),
+                       // to t_out_ - 1; with decay_ > 0, their decayed sum,
+                       // plus the prior.
+  double count_; // With decay_ > 0, the decayed count that goes with sum_.
+
+  Matrix<double> prior_stats_; // empty if there is no prior
+  Vector<double> prior_mean_;
+  Matrix<double> stats_; // stats of the frames read, see GetStats()
+  Vector<double> mean_; // scratch space for OutputFrame()
+
+  Matrix<BaseFloat> input_frames_; // what we got from input_ on this call.
+  
+  KALDI_DISALLOW_COPY_AND_ASSIGN(OnlineCmnInput);
+};
+
+// The frames kept by OnlineLdaInput and OnlineDeltaInput between calls to
+// Compute(): the last few frames of the previous call, needed for context,
+// followed by the frames of the current call.  OnlineUdpInput uses it for the
+// frames it has received but not output yet, and OnlineCacheInput for the
+// frames of the chunk it is filling.  They are stored contiguously,
+// so that the whole of them can be processed as one matrix.  The storage only
+// grows, so once it is large enough for the requests that are made, the
+// stages of the feature pipeline do not allocate any more memory.
+class OnlineFrameBuffer {
+ public:
+  explicit OnlineFrameBuffer(int32 dim): num_frames_(0), dim_(dim) { }
+
+  int32 NumFrames() const { return num_frames_; }
+
+  // The frames currently in the buffer; there must be at least one.
+  SubMatrix<BaseFloat> Frames() {
+    KALDI_ASSERT(num_frames_ > 0);
+    return data_.Range(0, num_frames_, 0, dim_);
+  }
+
+  // Appends the rows of "frames".
+  void Append(const MatrixBase<BaseFloat> &frames);
+
+  // Appends "count" copies of "frame", which must not be in the buffer.
+  void AppendCopies(const VectorBase<BaseFloat> &frame, int32 count);
+
+  // Appends "count" copies of the last frame in the buffer.
+  void AppendCopiesOfLast(int32 count);
+
+  // Discards all but the last "count" frames, which are moved to the start.
+  void KeepLast(int32 count);
+
+  void Clear() { num_frames_ = 0; }
+
+ private:
+  // Makes sure there is room for "num_frames" frames.
+  void Reserve(int32 num_frames);
+
+  Matrix<BaseFloat> data_; // the first num_frames_ rows are used.
+  int32 num_frames_;
+  const int32 dim_;
+
+  KALDI_DISALLOW_COPY_AND_ASSIGN(OnlineFrameBuffer);
+};
+
+// The most recent frames of a stream, up to Capacity() of them, in one
+// circular buffer: frame t is in row t % Capacity().  Every frame is written
+// twice, to that row and to the one Capacity() rows further on, so that any
+// run of up to Capacity() consecutive frames is contiguous in memory and can
+// be handed out as a SubMatrix, without copying.
+class OnlineFrameRing {
+ public:
+  OnlineFrameRing(int32 capacity, int32 dim);
+
+  int32 Capacity() const { return capacity_; }
+  int32 Dim() const { return data_.NumCols(); }
+
+  // The number of frames appended so far, i.e. the index of the next one.
+  int32 NumFrames() const { return num_frames_; }
+  // The oldest frame still kept.
+  int32 Begin() const { return std::max(0, num_frames_ - capacity_); }
+  bool Contains(int32 frame) const {
+    return frame >= Begin() && frame < num_frames_;
+  }
+
+  // Appends the rows of "frames", which take the place of the oldest ones.
+  void Append(const MatrixBase<BaseFloat> &frames);
+
+  // Frame "frame", which must be kept.
+  SubVector<BaseFloat> Frame(int32 frame) {
+    KALDI_ASSERT(Contains(frame));
+    return data_.Row(frame % capacity_);
+  }
+  // Frames "begin" to begin + count - 1, which must all be kept.
+  SubMatrix<BaseFloat> Frames(int32 begin, int32 count) {
+    KALDI_ASSERT(count > 0 && Contains(begin) && Contains(begin + count - 1));
+    return data_.Range(begin % capacity_, count, 0, Dim());
+  }
+
+  // Changes the capacity, keeping the most recent frames that fit.
+  void SetCapacity(int32 capacity);
+
+ private:
+  int32 capacity_;
+  int32 num_frames_;
+  Matrix<BaseFloat> data_; // 2 * capacity_ rows
+
+  KALDI_DISALLOW_COPY_AND_ASSIGN(OnlineFrameRing);
+};
+
+struct OnlineCacheOptions {
+  int32 chunk_frames; // frames stored together
+  bool compress; // whether the chunks are stored as CompressedMatrix
+  BaseFloat max_memory_mb; // beyond this, chunks go to a file; 0 is no limit
+  std::string spill_dir; // where the file goes; "" means $TMPDIR or /tmp
+
+  OnlineCacheOptions(): chunk_frames(1000), compress(false),
+                        max_memory_mb(0.0) { }
+  void Register(OptionsItf *opts) {
+    opts->Register("cache-chunk-frames", &chunk_frames,
+                   "Number of feature vectors the feature cache stores "
+                   "together");
+    opts->Register("cache-compress", &compress,
+                   "Store the cached features compressed, in about a quarter "
+                   "of the memory (lossy)");
+    opts->Register("cache-max-memory-mb", &max_memory_mb,
+                   "Memory the cached features may take before the oldest "
+                   "are moved to a temporary file (0 means no limit)");
+    opts->Register("cache-spill-dir", &spill_dir,
+                   "Directory for the temporary file of the feature cache "
+                   "(default: $TMPDIR, or /tmp)");
+  }
+};
+
+//继承自OnlineFeatInputItf类
+// The frames are stored in chunks of opts.chunk_frames, compressed if
+// opts.compress is set.  When the chunks in memory take more than
+// opts.max_memory_mb, the oldest ones are written to a temporary file (which
+// is deleted as soon as it is created, so nothing is left behind), and only
+// read back by GetCachedData().  That way hours of audio can be cached in
+// bounded memory.
+class OnlineCacheInput : public OnlineFeatInputItf {
+ public:
+  OnlineCacheInput(OnlineFeatInputItf *input,
+                   const OnlineCacheOptions &opts = OnlineCacheOptions());
+  
+  // The Compute function just forwards to the previous member of the
+  // chain, except that we locally accumulate the result, and
+  // GetCachedData() will return the entire input up to the current time.
+  virtual bool Compute(Matrix<BaseFloat> *output);
+
+  // The output is sized once, and every chunk is decoded straight into its
+  // place in it.
+  void GetCachedData(Matrix<BaseFloat> *output);
+  
+  int32 Dim() const { return input_->Dim(); }
+
+  int32 NumFrames() const { return num_frames_; }
+
+  // The memory taken by the chunks not in the temporary file, in bytes.
+  int64 MemoryBytes() const { return memory_bytes_; }
+  
+  // Forgets the frames cached so far.
+  void Deallocate();
+  
+ private:
+  struct Chunk {
+    int32 num_frames;
+    Matrix<BaseFloat> frames; // if not compressed, while in memory
+    CompressedMatrix compressed; // if compressed, while in memory
+    int64 bytes; // the memory it takes, while in memory
+    int64 file_offset; // where it is in spill_file_, or -1 if in memory
+  };
+
+  // Turns the frames in current_ into a new chunk.
+  void AddChunk();
+  // Moves chunks to spill_file_, oldest first, until the ones in memory
+  // take no more than opts_.max_memory_mb.
+  void SpillChunks();
+  void OpenSpillFile();
+
+  OnlineFeatInputItf *input_;
+  const OnlineCacheOptions opts_;
+  std::deque<Chunk> chunks_;
+  OnlineFrameBuffer current_; // the latest frames, not in a chunk yet
+  int32 num_frames_;
+  int64 memory_bytes_; // of the chunks in memory
+  size_t num_spilled_; // the first num_spilled_ chunks are in spill_file_
+  std::fstream spill_file_;
+  // For reading the chunks back from spill_file_.
+  Matrix<BaseFloat> read_frames_;
+  CompressedMatrix read_compressed_;
+
+  KALDI_DISALLOW_COPY_AND_ASSIGN(OnlineCacheInput);
+};
+
+
+
+#if !defined(_MSC_VER)
+
+// The datagrams of features sent to OnlineUdpInput (see online-net-client)
+// consist of a header, followed by num_frames * dim floats, frame by frame.
+// The header fields and the bit patterns of the floats are in network byte
+// order.
+struct OnlineFeatPacketHeader {
+  uint32 stream_id; // chosen by the sender, the same for a whole stream
+  uint32 seq; // packet number within the stream, starting from 0
+  uint32 first_frame; // index of the first frame in the stream
+  uint16 num_frames;
+  uint16 dim;
+  uint16 flags; // kEndOfStream, or 0
+
+  static const uint32 kMagic = 0x4b464631; // "KFF1"
+  static const uint16 kEndOfStream = 1;
+  static const size_t kSize = 24; // size of the header in a packet
+  static const size_t kMaxPacketSize = 65507; // the most UDP allows
+
+  OnlineFeatPacketHeader(): stream_id(0), seq(0), first_frame(0),
+                            num_frames(0), dim(0), flags(0) { }
+
+  // Writes the header to the first kSize bytes of "buf".
+  void Write(char *buf) const;
+  // Reads the header of a packet of "size" bytes; returns false if it is not
+  // one of ours, or if the size does not match.
+  bool Read(const char *buf, size_t size);
+};
+
+// Encodes header.num_frames rows of "feats", starting from "first_row", as a
+// packet into "packet", resizing it as needed.
+void EncodeFeatPacket(const OnlineFeatPacketHeader &header,
+                      const MatrixBase<BaseFloat> &feats, int32 first_row,
+                      std::vector<char> *packet);
+
+struct OnlineUdpInputOptions {
+  int32 rcvbuf_size; // SO_RCVBUF of the socket
+  int32 batch_packets; // the most packets taken from the socket at once
+  int32 max_reorder; // the most packets held while waiting for a missing one
+
+  OnlineUdpInputOptions(): rcvbuf_size(1 << 20), batch_packets(16),
+                           max_reorder(8) { }
+  void Register(OptionsItf *opts) {
+    opts->Register("udp-rcvbuf-size", &rcvbuf_size,
+                   "Size of the receive buffer of the UDP socket, in bytes");
+    opts->Register("udp-batch-packets", &batch_packets,
+                   "Maximum number of datagrams received in one system call");
+    opts->Register("udp-max-reorder", &max_reorder,
+                   "Number of later datagrams we keep while waiting for a "
+                   "missing one; after that it is taken as lost");
+  }
+};
+
+// Accepts features over an UDP socket, in datagrams as described above.
+// Datagrams that arrive out of order are put back in order; when one is
+// lost, the missing frames are filled in with copies of the last frame
+// received, so that the frame numbering of the stream is kept.  Only one
+// stream is decoded at a time: a stream ends with a datagram flagged
+// kEndOfStream, or when a datagram of a stream not seen recently arrives,
+// whatever its sequence number (which starts the next stream, with its
+// datagrams put in order as above).  Datagrams of the recent streams that
+// arrive late are dropped, rather than starting them again.
+// Compute() returns false with the last frames of each stream; calling it
+// again waits for the next stream, which is to be decoded from scratch.
+// The current implementation doesn't support the "timeout" -
+// the server is waiting for data indefinetily long time.
+//接收udp套接字传来的特征 目前的实现不支持暂停——服务器长时间等待数据的到来
+class OnlineUdpInput : public OnlineFeatInputItf {
+ public:
+  OnlineUdpInput(int32 port, int32 feature_dim,
+                 const OnlineUdpInputOptions &opts = OnlineUdpInputOptions());
+
+  virtual bool Compute(Matrix<BaseFloat> *output);
+  //特征维度
+  virtual int32 Dim() const { return feature_dim_; }
+  //客户端地址
+  const sockaddr_in& client_addr() const { return client_addr_; }
+  //返回套接字描述符
+  const int32 descriptor() const { return sock_desc_; }
+
+  // Statistics of the transport, over all streams so far.
+  int64 NumPacketsReceived() const { return num_received_; }
+  int64 NumPacketsLost() const { return num_lost_; }
+  int64 NumPacketsReordered() const { return num_reordered_; }
+  int64 NumPacketsDropped() const { return num_dropped_; }
+  
+ private:
+  // Reads at least one datagram from the socket (blocking), and passes all
+  // those read to AcceptPacket().  Returns false on error.
+  bool ReceivePackets();
+  // Deals with one datagram of "size" bytes that came from "addr".
+  void AcceptPacket(const char *data, size_t size, const sockaddr_in &addr);
+  // Appends the frames of a packet that is next in sequence to frames_.
+  void AppendPacket(const OnlineFeatPacketHeader &header, const char *payload);
+  // Appends the held packets that are now next in sequence.
+  void AppendHeldPackets();
+  // Takes the earliest held packet as the next one, i.e. gives up on those
+  // before it.
+  void SkipMissingPackets();
+  void StartStream(const OnlineFeatPacketHeader &header);
+  void EndStream();
+  bool IsPastStream(uint32 stream_id) const;
+
+  // The number of ended streams whose late datagrams are recognized.
+  static const size_t kNumPastStreams = 16;
+
+  OnlineUdpInputOptions opts_;
+  int32 feature_dim_;
+  // various BSD sockets-related data structures
+  int32 sock_desc_; // 套接字描述符
+  sockaddr_in server_addr_;   //套接字服务器地址
+  sockaddr_in client_addr_;   //套接字客户端地址
+
+  // Buffers for receiving, one per packet of a batch.
+  std::vector<std::vector<char> > recv_bufs_;
+  std::vector<sockaddr_in> recv_addrs_;
+#if defined(__linux__)
+  std::vector<mmsghdr> msgs_; // for recvmmsg()
+  std::vector<iovec> iovecs_;
+#endif
+
+  bool in_stream_; // false before the first stream and after each one ends
+  uint32 stream_id_;
+  bool end_pending_; // "stream_id_" ended, but Compute() has not said so yet
+  std::deque<uint32> past_streams_; // the last streams that ended
+  // Datagrams of the next stream that came before Compute() ended the last
+  // one, with where they came from.
+  std::vector<std::pair<std::vector<char>, sockaddr_in> > pending_;
+  uint32 next_seq_; // the packet we are waiting for
+  uint32 next_frame_; // the frame the next packet should start with
+  std::map<uint32, std::vector<char> > held_; // early packets, by seq
+  OnlineFrameBuffer frames_; // frames not yet output
+  Vector<BaseFloat> last_frame_; // the last frame received ...
+  bool have_last_frame_; // ... if any, in this stream
+
+  int64 num_received_, num_lost_, num_reordered_, num_dropped_;
+
+  KALDI_DISALLOW_COPY_AND_ASSIGN(OnlineUdpInput);
+};
+
+#endif
+
+
+// Splices the input features and applies a transformation matrix.
+// Note: the transformation matrix will usually be a linear transformation
+// [output-dim x input-dim] but we accept an affine transformation too.
+//拼接输入特征并且运用一个转换矩阵。
+//注意：转换矩阵通常是线性变换
+//只有在输入了lda矩阵的情况下调用这个类
+class OnlineLdaInput: public OnlineFeatInputItf {
+ public:
+  OnlineLdaInput(OnlineFeatInputItf *input,
+                 const Matrix<BaseFloat> &transform,
+                 int32 left_context,
+                 int32 right_context);
+
+  virtual bool Compute(Matrix<BaseFloat> *output);
+
+  virtual int32 Dim() const { return linear_transform_.NumRows(); }
+
+ private:
+  // Outputs the transformed, spliced features for every complete context
+  // window of the frames in "input", i.e. "output" will have
+  // input.NumRows() - context_window + 1 rows.  The spliced features are never
+  // formed: the transform is made of one block of input_dim_ columns per
+  // position in the window, and the product of each block with the frames at
+  // that position is added to the output, straight from "input".
+  void TransformToOutput(const MatrixBase<BaseFloat> &input,
+                         Matrix<BaseFloat> *output);
+  
+  OnlineFeatInputItf *input_; // underlying/inferior input object
+  const int32 input_dim_; // dimension of the feature vectors before xform
+  const int32 left_context_;
+  const int32 right_context_;
+  Matrix<BaseFloat> linear_transform_; // LDA转换矩阵 (只有线性部分)
+  Vector<BaseFloat> offset_; // Offset, if present; else empty.
+  OnlineFrameBuffer buffer_; // The last few frames of the input, that may be
+  // needed for context purposes, followed by the new input.
+  Matrix<BaseFloat> input_frames_; // what we got from input_ on this call.
+  
+  KALDI_DISALLOW_COPY_AND_ASSIGN(OnlineLdaInput);
+};
+
+
+// Computes the same deltas as class DeltaFeatures in feat/feature-functions.h,
+// but for a whole block of frames at once: each order of deltas is a 1-D
+// convolution along time, which we do by adding up scaled, shifted views of
+// the block, one tap of the filter at a time.  The inner loops run over
+// contiguous memory, and nothing is done per frame.
+class BatchDeltaFeatures {
+ public:
+  explicit BatchDeltaFeatures(const DeltaFeaturesOptions &opts);
+
+  // The number of frames on each side of a frame needed to compute its deltas.
+  int32 Context() const { return opts_.order * opts_.window; }
+
+  // Computes the features with deltas for those frames of "input" that have
+  // all their context in "input", i.e. "output" must have
+  // input.NumRows() - 2 * Context() rows, the first of which is for input
+  // frame Context(), and input.NumCols() * (order + 1) columns.
+  void Process(const MatrixBase<BaseFloat> &input,
+               MatrixBase<BaseFloat> *output) const;
+
+ private:
+  DeltaFeaturesOptions opts_;
+  // The filter for each order; scales_[i] has 2 * i * window + 1 taps.
+  std::vector<std::vector<BaseFloat> > scales_;
+};
+
+// Like ComputeDeltas() in feat/feature-functions.h, with the same output up to
+// rounding, but using BatchDeltaFeatures; for use in offline tools.
+void ComputeDeltasBatch(const DeltaFeaturesOptions &delta_opts,
+                        const MatrixBase<BaseFloat> &input_features,
+                        Matrix<BaseFloat> *output_features);
+
+
+// 计算时间导数 (e.g., 添加 deltas 和 delta-deltas).
+// 这是更加陈旧的特征提取标准.  Like an online
+// version of the function ComputeDeltas in feat/feature-functions.h, where the
+// class DeltaFeaturesOptions is also defined.
+class OnlineDeltaInput: public OnlineFeatInputItf {
+ public:
+  OnlineDeltaInput(const DeltaFeaturesOptions &delta_opts,
+                   OnlineFeatInputItf *input);
+  
+  virtual bool Compute(Matrix<BaseFloat> *output);
+
+  virtual int32 Dim() const { return input_dim_ * (opts_.order + 1); }
+  
+ private:
+  // Context() is the number of frames on each side of a given frame,
+  // that we need for context.
+  int32 Context() const { return delta_.Context(); }
+  
+  // Does the delta computation.  Here, "output" will be resized to dimension
+  // (input.NumRows() - Context() * 2) by (input.NumCols() * opts_.order)
+  void DeltaComputation(const MatrixBase<BaseFloat> &input,
+                        Matrix<BaseFloat> *output) const;
+  
+  OnlineFeatInputItf *input_; // underlying/inferior input object
+  DeltaFeaturesOptions opts_;
+  const int32 input_dim_;
+  BatchDeltaFeatures delta_;
+  OnlineFrameBuffer buffer_; // The last few frames of the input, that may be
+  // needed for context purposes, followed by the new input.
+  Matrix<BaseFloat> input_frames_; // what we got from input_ on this call.
+  
+  KALDI_DISALLOW_COPY_AND_ASSIGN(OnlineDeltaInput);
+};
+
+// Implementation, that is meant to be used to read samples from an
+// OnlineAudioSource and to extract MFCC/PLP features in the usual way
+//执行，意味着以通常的方式从一个onlineaudiosource对象中读取样本并且提取mfcc/plp特征
+// The frames are sample-accurate: frame t always starts at sample
+// t * frame_shift of the stream, however the samples arrive.  The samples
+// read but not used up yet (the overlap with the next frame, and whatever
+// did not make a whole frame) stay at the start of a buffer that is kept
+// between calls, and the source writes the new samples straight after them,
+// so only the newly complete frames are computed, and nothing is allocated
+// once the buffer has the size for the number of frames requested.
+template <class E>
+class OnlineFeInput : public OnlineFeatInputItf {
+ public:
+  // "au_src" - OnlineAudioSourceItf对象
+  // "fe" - 执行MFCC/PLP特征提取的对象
+  // "frame_size" - 音频样本的帧提取窗口大小
+  // "frame_shift" - 音频样本的特征帧宽度
+  OnlineFeInput(OnlineAudioSourceItf *au_src, E *fe,
+                const int32 frame_size, const int32 frame_shift);
+
+  virtual int32 Dim() const { return extractor_->Dim(); }
+
+  virtual bool Compute(Matrix<BaseFloat> *output);
+
+ private:
+  OnlineAudioSourceItf *source_; // 音频资源
+  E *extractor_; // 实际使用的特征提取器
+  const int32 frame_size_;
+  const int32 frame_shift_;
+  Vector<BaseFloat> wave_; // 传输后用于提取的样本
+  int32 num_samples_; // the samples in wave_ are wave_(0 .. num_samples_-1)
+
+  KALDI_DISALLOW_COPY_AND_ASSIGN(OnlineFeInput);
+};
+
+template<class E>
+OnlineFeInput<E>::OnlineFeInput(OnlineAudioSourceItf *au_src, E *fe,
+                                   int32 frame_size, int32 frame_shift)
+    : source_(au_src), extractor_(fe),
+      frame_size_(frame_size), frame_shift_(frame_shift), num_samples_(0) {
+  KALDI_ASSERT(frame_shift > 0 && frame_size >= frame_shift);
+}
+
+template<class E> bool
+OnlineFeInput<E>::Compute(Matrix<BaseFloat> *output) {
+  MatrixIndexT nvec = output->NumRows(); // 输出特征的数量
+  if (nvec <= 0) {
+    KALDI_WARN << "No feature vectors requested?!";
+    return true;
+  }
+
+  //准备输入音频样本
+  int32 samples_req = frame_size_ + (nvec - 1) * frame_shift_;
+  if (wave_.Dim() < samples_req)
+    wave_.Resize(samples_req, kCopyData);
+
+  bool ans = true;
+  if (num_samples_ < samples_req) {
+    SubVector<BaseFloat> new_samples(wave_, num_samples_,
+                                     samples_req - num_samples_);
+    int32 num_read;
+    ans = source_->ReadInto(&new_samples, &num_read);
+    num_samples_ += num_read;
+  }
+
+  // 提取特征
+  if (num_samples_ < frame_size_) {
+    output->Resize(0, 0);
+    return ans;
+  }
+  // At the end of the stream, all the frames left are output at once.
+  int32 num_frames = 1 + (num_samples_ - frame_size_) / frame_shift_;
+  if (ans)
+    num_frames = std::min(nvec, num_frames);
+  SubVector<BaseFloat> frame_samples(
+      wave_, 0, frame_size_ + (num_frames - 1) * frame_shift_);
+  extractor_->Compute(frame_samples, 1.0, output);
+
+  // The next frame starts with sample num_frames * frame_shift_.
+  int32 num_used = num_frames * frame_shift_;
+  num_samples_ -= num_used;
+  if (num_samples_ > 0)
+    memmove(wave_.Data(), wave_.Data() + num_used,
+            num_samples_ * sizeof(BaseFloat));
+
+  return ans;
+}
+
+struct OnlineFeatureMatrixOptions {
+  int32 batch_size; // 每一次请求的帧数
+  int32 num_tries; // 在放弃请求之前得到空输出和超时的尝试次数
+  int32 history_frames; // frames kept before the previous batch's last one
+
+  OnlineFeatureMatrixOptions(): batch_size(27),
+                                num_tries(5),
+                                history_frames(0) { }
+  void Register(OptionsItf *opts) {
+    opts->Register("batch-size", &batch_size,
+                   "Number of feature vectors processed w/o interruption");
+    opts->Register("num-tries", &num_tries,
+                   "Number of successive repetitions of timeout before we "
+                   "terminate stream");
+    opts->Register("history-frames", &history_frames,
+                   "Number of past feature vectors kept accessible, for "
+                   "consumers that look back (e.g. rescoring)");
+  }
+};
+
+// The class OnlineFeatureMatrix wraps something of type
+// OnlineFeatInputItf in a manner that is convenient for
+// a Decodable type to consume.
+// The frames are kept in an OnlineFrameRing: those of the latest batch,
+// the last frame of the batch before, and opts.history_frames before that,
+// so consumers that look back (rescoring, confidence models) can get at
+// them without caching the features themselves.
+class OnlineFeatureMatrix {
+ public:
+  OnlineFeatureMatrix(const OnlineFeatureMatrixOptions &opts,
+                      OnlineFeatInputItf *input):
+      opts_(opts), input_(input), feat_dim_(input->Dim()),
+      frames_(opts.history_frames + 1 + opts.batch_size, input->Dim()),
+      finished_(false) { }
+  
+  bool IsValidFrame (int32 frame); 
+
+  // Returns true if "frame" can be read with GetFrame() right away, i.e.
+  // without asking the input for more features.
+  bool IsAvailable(int32 frame) const { return frames_.Contains(frame); }
+
+  // The oldest frame that can still be read.
+  int32 FirstAvailableFrame() const { return frames_.Begin(); }
+
+  int32 Dim() const { return feat_dim_; }
+
+  //如果不是有效的帧  GetFrame() 调用失败; you have to
+  // call IsValidFrame() for this frame, to see whether it
+  // is valid.
+  SubVector<BaseFloat> GetFrame(int32 frame);
+
+  // Returns "num_frames" frames from "frame" on, as rows of a matrix, without
+  // copying them; they must all be available (see IsAvailable()).
+  SubMatrix<BaseFloat> GetFrames(int32 frame, int32 num_frames);
+
+  bool Good(); // 如果我们至少拥有一帧返回真值
+ private:
+  void GetNextFeatures(); //当我们需要更多特征时调用.确保获得至少一帧或者将finished_设为true
+  
+  const OnlineFeatureMatrixOptions opts_;
+  OnlineFeatInputItf *input_;
+  int32 feat_dim_;
+  OnlineFrameRing frames_;
+  Matrix<BaseFloat> next_features_; // kept to avoid reallocating it
+  bool finished_; // 如果没有得到更多的输入帧则为真
+};
+
+
+} //  kaldi命名空间
+
+#endif // KALDI_ONLINE_ONLINE_FEAT_INPUT_H_
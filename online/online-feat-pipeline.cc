@@ -0,0 +1,215 @@
+// online/online-feat-pipeline.cc
+
+// See ../../COPYING for clarification regarding multiple authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//  http://www.apache.org/licenses/LICENSE-2.0
+//
+// THIS CODE IS PROVIDED *AS IS* BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, EITHER EXPRESS OR IMPLIED, INCLUDING WITHOUT LIMITATION ANY IMPLIED
+// WARRANTIES OR CONDITIONS OF TITLE, FITNESS FOR A PARTICULAR PURPOSE,
+// MERCHANTABLITY OR NON-INFRINGEMENT.
+// See the Apache 2 License for the specific language governing permissions and
+// limitations under the License.
+
+#include <algorithm>
+
+#include "online/online-feat-pipeline.h"
+
+namespace kaldi {
+
+OnlineFrameQueue::OnlineFrameQueue(int32 capacity, int32 dim):
+    ring_(capacity, dim, kUndefined), num_written_(0), num_read_(0),
+    num_timeouts_(0), closed_(false), aborted_(false), num_timeouts_seen_(0),
+    producer_waiting_(false), consumer_waiting_(false) {
+  KALDI_ASSERT(capacity > 0 && dim > 0);
+}
+
+// All the atomics use the default, sequentially consistent ordering.  What
+// makes the sleeping safe is that a side sets its "waiting" flag before
+// checking for the last time whether it has to wait, and the other side
+// updates the counts before checking the flag: at least one of them sees
+// what the other did.  The waker takes the mutex to notify, so that the
+// notification cannot come between the check and the wait.
+template<class Pred>
+void OnlineFrameQueue::Wait(std::atomic<bool> *waiting,
+                            std::condition_variable *cond, Pred ready) {
+  if (ready())
+    return;
+  std::unique_lock<std::mutex> lock(mutex_);
+  *waiting = true;
+  cond->wait(lock, ready);
+  *waiting = false;
+}
+
+void OnlineFrameQueue::Wake(const std::atomic<bool> &waiting,
+                            std::condition_variable *cond) {
+  if (waiting) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    cond->notify_one();
+  }
+}
+
+void OnlineFrameQueue::Write(const MatrixBase<BaseFloat> &src, int32 src_row,
+                             int64 ring_row, int32 count) {
+  int32 capacity = Capacity(), dim = Dim();
+  int32 start = ring_row % capacity,
+      first_part = std::min(count, capacity - start);
+  ring_.Range(start, first_part, 0, dim).CopyFromMat(
+      src.Range(src_row, first_part, 0, dim));
+  if (first_part < count)
+    ring_.Range(0, count - first_part, 0, dim).CopyFromMat(
+        src.Range(src_row + first_part, count - first_part, 0, dim));
+}
+
+void OnlineFrameQueue::Read(int64 ring_row, int32 count,
+                            MatrixBase<BaseFloat> *dest) {
+  int32 capacity = Capacity(), dim = Dim();
+  int32 start = ring_row % capacity,
+      first_part = std::min(count, capacity - start);
+  dest->Range(0, first_part, 0, dim).CopyFromMat(
+      ring_.Range(start, first_part, 0, dim));
+  if (first_part < count)
+    dest->Range(first_part, count - first_part, 0, dim).CopyFromMat(
+        ring_.Range(0, count - first_part, 0, dim));
+}
+
+bool OnlineFrameQueue::Push(const MatrixBase<BaseFloat> &frames) {
+  KALDI_ASSERT(frames.NumCols() == Dim());
+  int64 capacity = Capacity(), written = num_written_;
+  int32 row = 0;
+  while (row < frames.NumRows()) {
+    Wait(&producer_waiting_, &producer_cond_, [&]() {
+        return aborted_ || written - num_read_ < capacity; });
+    if (aborted_)
+      return false;
+    int32 count = std::min<int64>(frames.NumRows() - row,
+                                  capacity - (written - num_read_));
+    Write(frames, row, written, count);
+    row += count;
+    written += count;
+    num_written_ = written; // publishes the frames
+    Wake(consumer_waiting_, &consumer_cond_);
+  }
+  return !aborted_;
+}
+
+void OnlineFrameQueue::NotifyTimeout() {
+  num_timeouts_++;
+  Wake(consumer_waiting_, &consumer_cond_);
+}
+
+void OnlineFrameQueue::Close() {
+  closed_ = true;
+  Wake(consumer_waiting_, &consumer_cond_);
+}
+
+bool OnlineFrameQueue::Pop(Matrix<BaseFloat> *output) {
+  int64 read = num_read_;
+  Wait(&consumer_waiting_, &consumer_cond_, [&]() {
+      return num_written_ != read || closed_ ||
+          num_timeouts_ != num_timeouts_seen_; });
+  // "closed_" has to be read before the count: frames pushed before the
+  // queue was closed must not be missed.
+  bool closed = closed_;
+  int64 available = num_written_ - read;
+  num_timeouts_seen_ = num_timeouts_;
+  int32 count = available;
+  if (output->NumRows() != 0)
+    count = std::min<int64>(available, output->NumRows());
+  if (count == 0) {
+    output->Resize(0, 0);
+    return !closed;
+  }
+  output->Resize(count, Dim(), kUndefined);
+  Read(read, count, output);
+  num_read_ = read + count; // gives the rows back to the producer
+  Wake(producer_waiting_, &producer_cond_);
+  return !(closed && count == available);
+}
+
+void OnlineFrameQueue::Abort() {
+  aborted_ = true;
+  Wake(producer_waiting_, &producer_cond_);
+}
+
+
+OnlineThreadedInput::OnlineThreadedInput(
+    const OnlineThreadedInputOptions &opts, OnlineFeatInputItf *input):
+    opts_(opts), input_(input), queue_(opts.queue_size, input->Dim()) {
+  KALDI_ASSERT(opts.batch_size > 0);
+  thread_ = std::thread(&OnlineThreadedInput::Run, this);
+}
+
+OnlineThreadedInput::~OnlineThreadedInput() {
+  queue_.Abort();
+  thread_.join();
+}
+
+void OnlineThreadedInput::Run() {
+  try {
+    Matrix<BaseFloat> batch;
+    bool more = true;
+    while (more) {
+      batch.Resize(opts_.batch_size, input_->Dim(), kUndefined);
+      more = input_->Compute(&batch);
+      if (batch.NumRows() != 0) {
+        if (!queue_.Push(batch))
+          break; // the decoder is not interested any more.
+      } else if (more) {
+        queue_.NotifyTimeout();
+      }
+    }
+  } catch(const std::exception &e) {
+    error_ = e.what();
+  }
+  queue_.Close();
+}
+
+bool OnlineThreadedInput::Compute(Matrix<BaseFloat> *output) {
+  bool ans = queue_.Pop(output);
+  if (!ans && !error_.empty())
+    KALDI_ERR << "Error in the front-end thread: " << error_;
+  return ans;
+}
+
+
+OnlinePrefetchInput::OnlinePrefetchInput(OnlineFeatInputItf *input,
+                                         int32 batch_size):
+    input_(input), batch_size_(batch_size), frames_(input->Dim()),
+    num_read_(0), num_prefetched_(0), ended_(false) {
+  KALDI_ASSERT(batch_size > 0);
+}
+
+bool OnlinePrefetchInput::Prefetch() {
+  // The frames that were read make room for the new ones.
+  frames_.KeepLast(frames_.NumFrames() - num_read_);
+  num_read_ = 0;
+  while (!ended_) {
+    batch_.Resize(batch_size_, input_->Dim(), kUndefined);
+    ended_ = !input_->Compute(&batch_);
+    if (batch_.NumRows() == 0)
+      break;
+    frames_.Append(batch_);
+    num_prefetched_ += batch_.NumRows();
+  }
+  return !ended_;
+}
+
+bool OnlinePrefetchInput::Compute(Matrix<BaseFloat> *output) {
+  int32 available = frames_.NumFrames() - num_read_,
+      count = std::min(available, output->NumRows());
+  if (count == 0) {
+    output->Resize(0, 0);
+  } else {
+    output->Resize(count, Dim(), kUndefined);
+    output->CopyFromMat(frames_.Frames().Range(num_read_, count, 0, Dim()));
+    num_read_ += count;
+  }
+  return !(ended_ && num_read_ == frames_.NumFrames());
+}
+
+} // namespace kaldi
@@ -0,0 +1,197 @@
+// online/online-feat-pipeline.h
+
+// See ../../COPYING for clarification regarding multiple authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//  http://www.apache.org/licenses/LICENSE-2.0
+//
+// THIS CODE IS PROVIDED *AS IS* BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, EITHER EXPRESS OR IMPLIED, INCLUDING WITHOUT LIMITATION ANY IMPLIED
+// WARRANTIES OR CONDITIONS OF TITLE, FITNESS FOR A PARTICULAR PURPOSE,
+// MERCHANTABLITY OR NON-INFRINGEMENT.
+// See the Apache 2 License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef KALDI_ONLINE_ONLINE_FEAT_PIPELINE_H_
+#define KALDI_ONLINE_ONLINE_FEAT_PIPELINE_H_
+
+#include <atomic>
+#include <condition_variable>
+#include <mutex>
+#include <string>
+#include <thread>
+
+#include "base/kaldi-common.h"
+#include "matrix/kaldi-matrix.h"
+#include "online/online-feat-input.h"
+
+namespace kaldi {
+
+// A bounded queue of feature frames from one producer thread to one consumer
+// thread.  The frames are kept in a ring of Capacity() rows, and the two
+// sides share only the counts of frames written and read, so neither of them
+// takes a lock as long as there is room (for the producer) or there are
+// frames (for the consumer).  A side that has to wait sleeps on a condition
+// variable, and the other side only wakes it if it says it is waiting.
+class OnlineFrameQueue {
+ public:
+  OnlineFrameQueue(int32 capacity, int32 dim);
+
+  // The producer's side.
+  // Appends the rows of "frames", waiting for room as needed.  Returns false
+  // if the consumer has called Abort(); the frames are then only partly
+  // added, which does not matter as nobody will read them.
+  bool Push(const MatrixBase<BaseFloat> &frames);
+  // Tells the consumer that the producer's input timed out, so that it can
+  // count the timeouts like it would without the queue.
+  void NotifyTimeout();
+  // No more frames will be pushed.
+  void Close();
+
+  // The consumer's side.
+  // Waits until there is at least one frame, a timeout was notified or the
+  // queue is closed, then moves up to output->NumRows() of the frames (all
+  // of them if it is zero) to "output", which is resized.  The output is
+  // empty after a timeout.  Returns false once the queue is closed and all
+  // its frames were read, like OnlineFeatInputItf::Compute().
+  bool Pop(Matrix<BaseFloat> *output);
+  // Makes Push() fail from now on, e.g. because the decoder gave up.
+  void Abort();
+
+  int32 Capacity() const { return ring_.NumRows(); }
+  int32 Dim() const { return ring_.NumCols(); }
+
+ private:
+  // Copies "count" rows of "src", starting with "src_row", to the ring,
+  // starting with row "ring_row"; and the other way round for Read().  Both
+  // may wrap around the end of the ring.
+  void Write(const MatrixBase<BaseFloat> &src, int32 src_row,
+             int64 ring_row, int32 count);
+  void Read(int64 ring_row, int32 count, MatrixBase<BaseFloat> *dest);
+  // Blocks until "ready" returns true, with "waiting" set meanwhile.
+  template<class Pred>
+  void Wait(std::atomic<bool> *waiting, std::condition_variable *cond,
+            Pred ready);
+  // Wakes the other side if it is waiting on "cond".
+  void Wake(const std::atomic<bool> &waiting, std::condition_variable *cond);
+
+  Matrix<BaseFloat> ring_;
+  std::atomic<int64> num_written_;
+  std::atomic<int64> num_read_;
+  std::atomic<int64> num_timeouts_;
+  std::atomic<bool> closed_;
+  std::atomic<bool> aborted_;
+  int64 num_timeouts_seen_; // by the consumer
+
+  std::mutex mutex_; // only for sleeping
+  std::condition_variable producer_cond_, consumer_cond_;
+  std::atomic<bool> producer_waiting_, consumer_waiting_;
+
+  KALDI_DISALLOW_COPY_AND_ASSIGN(OnlineFrameQueue);
+};
+
+struct OnlineThreadedInputOptions {
+  bool use_thread; // whether the binaries use OnlineThreadedInput at all
+  int32 queue_size; // in frames
+  int32 batch_size; // frames asked from the input at a time
+
+  OnlineThreadedInputOptions(): use_thread(false), queue_size(200),
+                                batch_size(5) { }
+  void Register(OptionsItf *opts) {
+    opts->Register("frontend-thread", &use_thread,
+                   "Compute the features on a thread of their own, ahead of "
+                   "the decoder");
+    opts->Register("frontend-queue-size", &queue_size,
+                   "Maximum number of frames the front-end thread may get "
+                   "ahead of the decoder");
+    opts->Register("frontend-batch-size", &batch_size,
+                   "Number of feature vectors the front-end thread asks for "
+                   "at a time (smaller is less latency, more overhead)");
+  }
+};
+
+// Runs a chain of OnlineFeatInputItf objects (audio source, MFCC, CMN,
+// LDA...) on a thread of its own, which keeps computing features as the
+// audio comes in while the decoder works on the earlier ones.  The frames
+// are passed on through an OnlineFrameQueue, and when the decoder falls
+// behind by more than the size of the queue, the front-end thread waits.
+// The chain must not be used by anyone else until this object is destroyed;
+// the timeouts of the input are passed on, so OnlineFeatureMatrix can count
+// them as before.
+class OnlineThreadedInput : public OnlineFeatInputItf {
+ public:
+  // Starts the thread.  "input" is not owned.
+  OnlineThreadedInput(const OnlineThreadedInputOptions &opts,
+                      OnlineFeatInputItf *input);
+
+  // Stops the thread, once the call to the input it is in (if any) returns.
+  ~OnlineThreadedInput();
+
+  // Returns up to output->NumRows() of the frames computed so far, waiting
+  // for the first one if there are none.  An error in the front-end thread
+  // is raised again here.
+  virtual bool Compute(Matrix<BaseFloat> *output);
+
+  virtual int32 Dim() const { return input_->Dim(); }
+
+ private:
+  void Run(); // the body of the thread
+
+  const OnlineThreadedInputOptions opts_;
+  OnlineFeatInputItf *input_;
+  OnlineFrameQueue queue_;
+  std::string error_; // what the thread died of, if it did
+  std::thread thread_; // the last member: started once the rest is ready
+
+  KALDI_DISALLOW_COPY_AND_ASSIGN(OnlineThreadedInput);
+};
+
+// For decoding driven by the arrival of the audio rather than by the
+// decoder, as in a server that multiplexes many connections: Prefetch()
+// computes all the frames the audio received so far gives, and Compute()
+// only passes them on, never asking the input.  Whoever drives the decoder
+// checks NumFramesReady() first, so that the decoder does not run out of
+// frames (which OnlineFeatureMatrix would take as a timeout) before the
+// audio has ended.
+class OnlinePrefetchInput : public OnlineFeatInputItf {
+ public:
+  // "input" is not owned; "batch_size" is the number of frames asked from
+  // it at a time.
+  explicit OnlinePrefetchInput(OnlineFeatInputItf *input,
+                               int32 batch_size = 50);
+
+  // Asks the input for frames until it returns none.  Returns false once
+  // the input has ended.
+  bool Prefetch();
+
+  // The number of frames prefetched so far, including those already passed
+  // on by Compute().
+  int64 NumFramesReady() const { return num_prefetched_; }
+
+  // True once the input has ended, i.e. NumFramesReady() is final.
+  bool Ended() const { return ended_; }
+
+  // Moves up to output->NumRows() of the prefetched frames to "output",
+  // which is resized.
+  virtual bool Compute(Matrix<BaseFloat> *output);
+
+  virtual int32 Dim() const { return input_->Dim(); }
+
+ private:
+  OnlineFeatInputItf *input_;
+  const int32 batch_size_;
+  Matrix<BaseFloat> batch_;
+  OnlineFrameBuffer frames_; // those from row num_read_ on are not read yet
+  int32 num_read_;
+  int64 num_prefetched_;
+  bool ended_;
+
+  KALDI_DISALLOW_COPY_AND_ASSIGN(OnlinePrefetchInput);
+};
+
+} // namespace kaldi
+
+#endif // KALDI_ONLINE_ONLINE_FEAT_PIPELINE_H_
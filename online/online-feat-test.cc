@@ -1,260 +1,850 @@
-// online/online-feat-test.cc
-
-// Copyright 2013   Daniel Povey
-
-// See ../../COPYING for clarification regarding multiple authors
-//
-// Licensed under the Apache License, Version 2.0 (the "License");
-// you may not use this file except in compliance with the License.
-// You may obtain a copy of the License at
-//
-//  http://www.apache.org/licenses/LICENSE-2.0
-//
-// THIS CODE IS PROVIDED *AS IS* BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
-// KIND, EITHER EXPRESS OR IMPLIED, INCLUDING WITHOUT LIMITATION ANY IMPLIED
-// WARRANTIES OR CONDITIONS OF TITLE, FITNESS FOR A PARTICULAR PURPOSE,
-// MERCHANTABLITY OR NON-INFRINGEMENT.
-// See the Apache 2 License for the specific language governing permissions and
-// limitations under the License.
-
-#include "online/online-feat-input.h"
-
-namespace kaldi {
-
-// This class is for testing and prototyping purposes, it
-// does not really do anything except wrap a matrix of features
-// in this class.  Note: it maintains a reference to the input
-// matrix, so be careful not to delete it while this object
-// Since this is intended for testing purposes, it may occasionally
-// "time out" and return fewer than requested
-class OnlineMatrixInput : public OnlineFeatInputItf {
- public:
-  OnlineMatrixInput(const Matrix<BaseFloat> &feats):
-      position_(0), feats_(feats) { }
-
-  virtual int32 Dim() const { return feats_.NumCols(); }
-  
-  virtual bool Compute(Matrix<BaseFloat> *output) {
-    if (feats_.NumRows() == 0) { // empty input.
-      output->Resize(0, 0);
-      return false;
-    }
-    
-    KALDI_ASSERT(output->NumRows() > 0 &&
-                 output->NumCols() == feats_.NumCols());
-    
-    // Because this is a kind of stress test, we completely ignore
-    // the number of frames requested, and return whatever number of
-    // frames we please.
-
-    int32 num_frames_left = feats_.NumRows() - position_;
-    int32 num_frames_return = std::min((Rand() % 5), num_frames_left);
-    if (num_frames_return == 0) {
-      output->Resize(0, 0);
-    } else {
-      output->Resize(num_frames_return, feats_.NumCols());
-      output->CopyFromMat(feats_.Range(position_, num_frames_return,
-                                       0, feats_.NumCols()));
-    }
-    position_ += num_frames_return;
-    if (position_ == feats_.NumRows()) return false;
-    else return true;
-  }
-
- private:
-  int32 position_;
-  Matrix<BaseFloat> feats_;
-};
-
-template<class Real> static void AssertEqual(const Matrix<Real> &A,
-                                             const Matrix<Real> &B,
-                                             float tol = 0.001) {
-  KALDI_ASSERT(A.NumRows() == B.NumRows()&&A.NumCols() == B.NumCols());
-  for (MatrixIndexT i = 0;i < A.NumRows();i++)
-    for (MatrixIndexT j = 0;j < A.NumCols();j++) {
-      KALDI_ASSERT(std::abs(A(i, j)-B(i, j)) < tol*std::max(1.0, (double) (std::abs(A(i, j))+std::abs(B(i, j)))));
-    }
-}
-
-// This function will crash if the two objects do not
-// give the same output.
-void GetOutput(OnlineFeatInputItf *a,
-               Matrix<BaseFloat> *output) {
-  int32 dim = a->Dim();
-  OnlineCacheInput cache(a);
-  while (true) {
-    Matrix<BaseFloat> garbage;
-    int32 batch_size = 1 + Rand() % 10;
-    garbage.Resize(batch_size, dim); // some random requested amount.
-    if (!cache.Compute(&garbage)) // returns false when done.
-      break;
-  }
-  cache.GetCachedData(output);
-}
-
-// test the MatrixInput and CacheInput classes.
-void TestOnlineMatrixInput() {
-  int32 dim = 2 + Rand() % 5; // dimension of features.
-  int32 num_frames = 100 + Rand() % 100;
-
-  Matrix<BaseFloat> input_feats(num_frames, dim);
-  input_feats.SetRandn();
-
-  OnlineMatrixInput matrix_input(input_feats);
-  
-  Matrix<BaseFloat> output_feats;
-  GetOutput(&matrix_input, &output_feats);
-  AssertEqual(input_feats, output_feats);
-}
-
-void TestOnlineFeatureMatrix() {
-  int32 dim = 2 + Rand() % 5; // dimension of features.
-  int32 num_frames = 100 + Rand() % 100;
-
-  Matrix<BaseFloat> input_feats(num_frames, dim);
-  input_feats.SetRandn();
-
-  OnlineMatrixInput matrix_input(input_feats);
-  OnlineFeatureMatrixOptions opts;
-  opts.num_tries = 100; // makes it very unlikely we'll get that many timeouts.
-  OnlineFeatureMatrix online_feature_matrix(opts, &matrix_input);
-
-  for (int32 frame = 0; frame < num_frames; frame++) {
-    KALDI_ASSERT(online_feature_matrix.IsValidFrame(frame));
-    KALDI_ASSERT(online_feature_matrix.GetFrame(frame).ApproxEqual(input_feats.Row(frame)));
-  }
-  KALDI_ASSERT(!online_feature_matrix.IsValidFrame(num_frames));
-}
-
-
-
-void TestOnlineLdaInput() {
-  int32 dim = 2 + Rand() % 5; // dimension of features.
-  int32 num_frames = 100 + Rand() % 100;
-  int32 left_context = Rand() % 3, right_context = Rand() % 3;
-  bool have_offset = (Rand() % 2 == 0);
-  int32 lda_input_dim = (dim * (left_context + 1 + right_context)),
-      lda_output_dim = 1 + Rand() % 5; // this can even be more than
-       // the input dim, the class doesn't care.
-  
-  Matrix<BaseFloat> transform(lda_output_dim, lda_input_dim +
-                              (have_offset ? 1 : 0));
-  transform.SetRandn();
-  Matrix<BaseFloat> input_feats(num_frames, dim);
-  input_feats.SetRandn();
-
-  OnlineMatrixInput matrix_input(input_feats);
-  OnlineLdaInput lda_input(&matrix_input, transform, left_context, right_context);
-
-  Matrix<BaseFloat> output_feats1;
-  GetOutput(&lda_input, &output_feats1);
-  Matrix<BaseFloat> temp_feats;
-  SpliceFrames(input_feats, left_context, right_context, &temp_feats);
-  Matrix<BaseFloat> output_feats2(temp_feats.NumRows(), transform.NumRows());
-  if (!have_offset) {
-    output_feats2.AddMatMat(1.0, temp_feats, kNoTrans, transform, kTrans, 0.0);
-  } else {
-    SubMatrix<BaseFloat> linear_part(transform, 0, transform.NumRows(),
-                                     0, transform.NumCols() - 1);
-    output_feats2.AddMatMat(1.0, temp_feats, kNoTrans, linear_part, kTrans, 0.0);
-    Vector<BaseFloat> offset(transform.NumRows());
-    offset.CopyColFromMat(transform, transform.NumCols() - 1);
-    output_feats2.AddVecToRows(1.0, offset);
-  }
-  KALDI_ASSERT(output_feats1.ApproxEqual(output_feats2));
-}
-
-
-void TestOnlineDeltaInput() {
-  int32 dim = 2 + Rand() % 5; // dimension of features.
-  int32 num_frames = 100 + Rand() % 100;
-  DeltaFeaturesOptions opts;
-  opts.order = Rand() % 3;
-  opts.window = 1 + Rand() % 3;
-
-  int32 output_dim = dim * (1 + opts.order);
-  
-  Matrix<BaseFloat> input_feats(num_frames, dim);
-  input_feats.SetRandn();
-  
-  OnlineMatrixInput matrix_input(input_feats);
-  OnlineDeltaInput delta_input(opts, &matrix_input);
-
-  Matrix<BaseFloat> output_feats1;
-  GetOutput(&delta_input, &output_feats1);
-
-  Matrix<BaseFloat> output_feats2(num_frames, output_dim);
-  ComputeDeltas(opts, input_feats, &output_feats2);
-
-  KALDI_ASSERT(output_feats1.ApproxEqual(output_feats2));
-}
-
-
-void TestOnlineCmnInput() { // We're also testing OnlineCacheInput here.
-  int32 dim = 2 + Rand() % 5; // dimension of features.
-  int32 num_frames = 10 + Rand() % 10;
-  
-  Matrix<BaseFloat> input_feats(num_frames, dim);
-  input_feats.SetRandn();
-
-  OnlineMatrixInput matrix_input(input_feats);
-  int32 cmn_window = 10 + Rand() % 20;
-  int32 min_window = 1 + Rand() % (cmn_window - 1);
-  if (Rand() % 3 == 0) min_window = cmn_window;
-  
-  OnlineCmnInput cmn_input(&matrix_input, cmn_window,
-                           min_window);
-  OnlineCacheInput cache_input(&cmn_input);
-  
-  Matrix<BaseFloat> output_feats1;
-  GetOutput(&cache_input, &output_feats1);
-  
-  Matrix<BaseFloat> output_feats2(input_feats);
-  for (int32 i = 0; i < output_feats2.NumRows(); i++) {
-    SubVector<BaseFloat> this_row(output_feats2, i);
-    if (i == 0 && min_window == 0) this_row.SetZero();
-    else if (i < min_window) {
-      int32 window_nframes = std::min(min_window, input_feats.NumRows());
-      Vector<BaseFloat> this_sum(dim);
-      SubMatrix<BaseFloat> this_block(input_feats, 0, window_nframes,
-                                      0, dim);
-      this_sum.AddRowSumMat(1.0, this_block, 0.0);
-      this_row.AddVec(-1.0 / window_nframes, this_sum);
-    } else {
-      int32 window_nframes = std::min(i, cmn_window);
-      Vector<BaseFloat> this_sum(dim);
-      SubMatrix<BaseFloat> this_block(input_feats, i - window_nframes, window_nframes,
-                                      0, dim);
-      this_sum.AddRowSumMat(1.0, this_block, 0.0);
-      this_row.AddVec(-1.0 / window_nframes, this_sum);
-    }
-  }
-  KALDI_ASSERT(output_feats1.NumRows() == output_feats2.NumRows());
-  for (int32 i = 0; i < output_feats2.NumRows(); i++) {
-    if (!output_feats1.Row(i).ApproxEqual(output_feats2.Row(i))) {
-      KALDI_ERR << "Rows differ " << i << ", " << input_feats.Row(i) << output_feats1.Row(i)
-                << output_feats2.Row(i);
-    }
-  }
-  KALDI_ASSERT(output_feats1.ApproxEqual(output_feats2));
-  Matrix<BaseFloat> output_feats3;
-  cache_input.GetCachedData(&output_feats3);
-  KALDI_ASSERT(output_feats1.ApproxEqual(output_feats3));
-}
-
-
-
-}  // end namespace kaldi
-
-int main() {
-  using namespace kaldi;
-  for (int i = 0; i < 40; i++) {
-    TestOnlineMatrixInput();
-    TestOnlineFeatureMatrix();
-    TestOnlineLdaInput();
-    TestOnlineDeltaInput();
-    TestOnlineCmnInput(); // also tests cache input.
-    // I have not tested the delta input yet.
-  }
-  std::cout << "Test OK.\n";
-}
+// online/online-feat-test.cc
+
+// Copyright 2013   Daniel Povey
+
+// See ../../COPYING for clarification regarding multiple authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//  http://www.apache.org/licenses/LICENSE-2.0
+//
+// THIS CODE IS PROVIDED *AS IS* BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, EITHER EXPRESS OR IMPLIED, INCLUDING WITHOUT LIMITATION ANY IMPLIED
+// WARRANTIES OR CONDITIONS OF TITLE, FITNESS FOR A PARTICULAR PURPOSE,
+// MERCHANTABLITY OR NON-INFRINGEMENT.
+// See the Apache 2 License for the specific language governing permissions and
+// limitations under the License.
+
+#include <cstdlib>
+#include <cstring>
+#include <unistd.h>
+
+#include "feat/feature-mfcc.h"
+#include "online/online-alloc-counter.h"
+#include "online/online-feat-input.h"
+#include "online/online-feat-pipeline.h"
+
+namespace kaldi {
+
+// This class is for testing and prototyping purposes, it
+// does not really do anything except wrap a matrix of features
+// in this class.  Note: it maintains a reference to the input
+// matrix, so be careful not to delete it while this object
+// Since this is intended for testing purposes, it may occasionally
+// "time out" and return fewer than requested
+class OnlineMatrixInput : public OnlineFeatInputItf {
+ public:
+  OnlineMatrixInput(const Matrix<BaseFloat> &feats):
+      position_(0), feats_(feats) { }
+
+  virtual int32 Dim() const { return feats_.NumCols(); }
+  
+  virtual bool Compute(Matrix<BaseFloat> *output) {
+    if (feats_.NumRows() == 0) { // empty input.
+      output->Resize(0, 0);
+      return false;
+    }
+    
+    KALDI_ASSERT(output->NumRows() > 0 &&
+                 output->NumCols() == feats_.NumCols());
+    
+    // Because this is a kind of stress test, we completely ignore
+    // the number of frames requested, and return whatever number of
+    // frames we please.
+
+    int32 num_frames_left = feats_.NumRows() - position_;
+    int32 num_frames_return = std::min((Rand() % 5), num_frames_left);
+    if (num_frames_return == 0) {
+      output->Resize(0, 0);
+    } else {
+      output->Resize(num_frames_return, feats_.NumCols());
+      output->CopyFromMat(feats_.Range(position_, num_frames_return,
+                                       0, feats_.NumCols()));
+    }
+    position_ += num_frames_return;
+    if (position_ == feats_.NumRows()) return false;
+    else return true;
+  }
+
+ private:
+  int32 position_;
+  Matrix<BaseFloat> feats_;
+};
+
+// Returns exactly as many rows of a matrix as are requested, like a source
+// that always has data ready.
+class OnlineSteadyInput : public OnlineFeatInputItf {
+ public:
+  OnlineSteadyInput(const Matrix<BaseFloat> &feats):
+      position_(0), feats_(feats) { }
+
+  virtual int32 Dim() const { return feats_.NumCols(); }
+
+  virtual bool Compute(Matrix<BaseFloat> *output) {
+    int32 num_frames = std::min(output->NumRows(),
+                                feats_.NumRows() - position_);
+    if (num_frames == 0) {
+      output->Resize(0, 0);
+      return false;
+    }
+    output->Resize(num_frames, feats_.NumCols(), kUndefined);
+    output->CopyFromMat(feats_.Range(position_, num_frames,
+                                     0, feats_.NumCols()));
+    position_ += num_frames;
+    return position_ < feats_.NumRows();
+  }
+
+  int32 NumFramesRead() const { return position_; }
+
+ private:
+  int32 position_;
+  Matrix<BaseFloat> feats_;
+};
+
+template<class Real> static void AssertEqual(const Matrix<Real> &A,
+                                             const Matrix<Real> &B,
+                                             float tol = 0.001) {
+  KALDI_ASSERT(A.NumRows() == B.NumRows()&&A.NumCols() == B.NumCols());
+  for (MatrixIndexT i = 0;i < A.NumRows();i++)
+    for (MatrixIndexT j = 0;j < A.NumCols();j++) {
+      KALDI_ASSERT(std::abs(A(i, j)-B(i, j)) < tol*std::max(1.0, (double) (std::abs(A(i, j))+std::abs(B(i, j)))));
+    }
+}
+
+// This function will crash if the two objects do not
+// give the same output.
+void GetOutput(OnlineFeatInputItf *a,
+               Matrix<BaseFloat> *output) {
+  int32 dim = a->Dim();
+  OnlineCacheInput cache(a);
+  while (true) {
+    Matrix<BaseFloat> garbage;
+    int32 batch_size = 1 + Rand() % 10;
+    garbage.Resize(batch_size, dim); // some random requested amount.
+    if (!cache.Compute(&garbage)) // returns false when done.
+      break;
+  }
+  cache.GetCachedData(output);
+}
+
+// test the MatrixInput and CacheInput classes.
+void TestOnlineMatrixInput() {
+  int32 dim = 2 + Rand() % 5; // dimension of features.
+  int32 num_frames = 100 + Rand() % 100;
+
+  Matrix<BaseFloat> input_feats(num_frames, dim);
+  input_feats.SetRandn();
+
+  OnlineMatrixInput matrix_input(input_feats);
+  
+  Matrix<BaseFloat> output_feats;
+  GetOutput(&matrix_input, &output_feats);
+  AssertEqual(input_feats, output_feats);
+}
+
+void TestOnlineFeatureMatrix() {
+  int32 dim = 2 + Rand() % 5; // dimension of features.
+  int32 num_frames = 100 + Rand() % 100;
+
+  Matrix<BaseFloat> input_feats(num_frames, dim);
+  input_feats.SetRandn();
+
+  OnlineMatrixInput matrix_input(input_feats);
+  OnlineFeatureMatrixOptions opts;
+  opts.num_tries = 100; // makes it very unlikely we'll get that many timeouts.
+  OnlineFeatureMatrix online_feature_matrix(opts, &matrix_input);
+
+  for (int32 frame = 0; frame < num_frames; frame++) {
+    KALDI_ASSERT(online_feature_matrix.IsValidFrame(frame));
+    KALDI_ASSERT(online_feature_matrix.GetFrame(frame).ApproxEqual(input_feats.Row(frame)));
+  }
+  KALDI_ASSERT(!online_feature_matrix.IsValidFrame(num_frames));
+}
+
+// The frames from history_frames before the last one of the previous batch
+// on must stay readable, one at a time and as spans.  The batches asked for
+// are small, so the input often returns more than that.
+void TestOnlineFeatureMatrixHistory() {
+  int32 dim = 2 + Rand() % 5; // dimension of features.
+  int32 num_frames = 100 + Rand() % 100;
+
+  Matrix<BaseFloat> input_feats(num_frames, dim);
+  input_feats.SetRandn();
+
+  OnlineMatrixInput matrix_input(input_feats);
+  OnlineFeatureMatrixOptions opts;
+  opts.num_tries = 100; // makes it very unlikely we'll get that many timeouts.
+  opts.batch_size = 1 + Rand() % 3;
+  opts.history_frames = Rand() % 20;
+  OnlineFeatureMatrix online_feature_matrix(opts, &matrix_input);
+
+  for (int32 frame = 0; frame < num_frames; frame++) {
+    KALDI_ASSERT(online_feature_matrix.IsValidFrame(frame));
+    int32 first = std::max(0, frame - 1 - opts.history_frames);
+    KALDI_ASSERT(online_feature_matrix.FirstAvailableFrame() <= first);
+    for (int32 t = first; t <= frame; t++)
+      KALDI_ASSERT(online_feature_matrix.GetFrame(t).ApproxEqual(
+          input_feats.Row(t)));
+    SubMatrix<BaseFloat> span(
+        online_feature_matrix.GetFrames(first, frame + 1 - first));
+    AssertEqual(Matrix<BaseFloat>(span),
+                Matrix<BaseFloat>(input_feats.Range(first, frame + 1 - first,
+                                                    0, dim)));
+  }
+  KALDI_ASSERT(!online_feature_matrix.IsValidFrame(num_frames));
+}
+
+
+// Caches random features in small chunks, compressed or not, with a memory
+// cap small enough that most chunks go to the temporary file.  The data is
+// also read back half way, to check that the cache can go on after that.
+void TestOnlineCacheInputChunks() {
+  int32 dim = 2 + Rand() % 5; // dimension of features.
+  int32 num_frames = 100 + Rand() % 400;
+  Matrix<BaseFloat> input_feats(num_frames, dim);
+  input_feats.SetRandn();
+
+  OnlineMatrixInput matrix_input(input_feats);
+  OnlineCacheOptions cache_opts;
+  cache_opts.chunk_frames = 1 + Rand() % 50;
+  cache_opts.compress = (Rand() % 2 == 0);
+  if (Rand() % 2 == 0)
+    cache_opts.max_memory_mb = 0.001;
+  OnlineCacheInput cache(&matrix_input, cache_opts);
+  // The compression is lossy.
+  float tol = (cache_opts.compress ? 0.05 : 0.001);
+
+  Matrix<BaseFloat> batch, cached;
+  bool more = true, read_half_way = false;
+  while (more) {
+    batch.Resize(1 + Rand() % 10, dim);
+    more = cache.Compute(&batch);
+    if (!read_half_way && cache.NumFrames() >= num_frames / 2) {
+      cache.GetCachedData(&cached);
+      AssertEqual(Matrix<BaseFloat>(input_feats.Range(0, cached.NumRows(),
+                                                      0, dim)),
+                  cached, tol);
+      read_half_way = true;
+    }
+    if (cache_opts.max_memory_mb > 0.0)
+      KALDI_ASSERT(cache.MemoryBytes() <= cache_opts.max_memory_mb * 1048576);
+  }
+  cache.GetCachedData(&cached);
+  AssertEqual(input_feats, cached, tol);
+}
+
+void TestOnlineLdaInput() {
+  int32 dim = 2 + Rand() % 5; // dimension of features.
+  int32 num_frames = 100 + Rand() % 100;
+  int32 left_context = Rand() % 3, right_context = Rand() % 3;
+  bool have_offset = (Rand() % 2 == 0);
+  int32 lda_input_dim = (dim * (left_context + 1 + right_context)),
+      lda_output_dim = 1 + Rand() % 5; // this can even be more than
+       // the input dim, the class doesn't care.
+  
+  Matrix<BaseFloat> transform(lda_output_dim, lda_input_dim +
+                              (have_offset ? 1 : 0));
+  transform.SetRandn();
+  Matrix<BaseFloat> input_feats(num_frames, dim);
+  input_feats.SetRandn();
+
+  OnlineMatrixInput matrix_input(input_feats);
+  OnlineLdaInput lda_input(&matrix_input, transform, left_context, right_context);
+
+  Matrix<BaseFloat> output_feats1;
+  GetOutput(&lda_input, &output_feats1);
+  Matrix<BaseFloat> temp_feats;
+  SpliceFrames(input_feats, left_context, right_context, &temp_feats);
+  Matrix<BaseFloat> output_feats2(temp_feats.NumRows(), transform.NumRows());
+  if (!have_offset) {
+    output_feats2.AddMatMat(1.0, temp_feats, kNoTrans, transform, kTrans, 0.0);
+  } else {
+    SubMatrix<BaseFloat> linear_part(transform, 0, transform.NumRows(),
+                                     0, transform.NumCols() - 1);
+    output_feats2.AddMatMat(1.0, temp_feats, kNoTrans, linear_part, kTrans, 0.0);
+    Vector<BaseFloat> offset(transform.NumRows());
+    offset.CopyColFromMat(transform, transform.NumCols() - 1);
+    output_feats2.AddVecToRows(1.0, offset);
+  }
+  KALDI_ASSERT(output_feats1.ApproxEqual(output_feats2));
+}
+
+
+void TestOnlineDeltaInput() {
+  int32 dim = 2 + Rand() % 5; // dimension of features.
+  int32 num_frames = 100 + Rand() % 100;
+  DeltaFeaturesOptions opts;
+  opts.order = Rand() % 3;
+  opts.window = 1 + Rand() % 3;
+
+  int32 output_dim = dim * (1 + opts.order);
+  
+  Matrix<BaseFloat> input_feats(num_frames, dim);
+  input_feats.SetRandn();
+  
+  OnlineMatrixInput matrix_input(input_feats);
+  OnlineDeltaInput delta_input(opts, &matrix_input);
+
+  Matrix<BaseFloat> output_feats1;
+  GetOutput(&delta_input, &output_feats1);
+
+  Matrix<BaseFloat> output_feats2(num_frames, output_dim);
+  ComputeDeltas(opts, input_feats, &output_feats2);
+
+  KALDI_ASSERT(output_feats1.ApproxEqual(output_feats2));
+}
+
+
+void TestComputeDeltasBatch() {
+  int32 dim = 1 + Rand() % 40;
+  int32 num_frames = 1 + Rand() % 50; // may be less than the context.
+  DeltaFeaturesOptions opts;
+  opts.order = Rand() % 4;
+  opts.window = 1 + Rand() % 3;
+
+  Matrix<BaseFloat> input_feats(num_frames, dim);
+  input_feats.SetRandn();
+
+  Matrix<BaseFloat> output_feats1;
+  ComputeDeltasBatch(opts, input_feats, &output_feats1);
+  Matrix<BaseFloat> output_feats2;
+  ComputeDeltas(opts, input_feats, &output_feats2);
+  AssertEqual(output_feats1, output_feats2, 1.0e-04);
+}
+
+
+void TestOnlineCmnInput() { // We're also testing OnlineCacheInput here.
+  int32 dim = 2 + Rand() % 5; // dimension of features.
+  int32 num_frames = 10 + Rand() % 10;
+  
+  Matrix<BaseFloat> input_feats(num_frames, dim);
+  input_feats.SetRandn();
+
+  OnlineMatrixInput matrix_input(input_feats);
+  int32 cmn_window = 10 + Rand() % 20;
+  int32 min_window = 1 + Rand() % (cmn_window - 1);
+  if (Rand() % 3 == 0) min_window = cmn_window;
+  
+  OnlineCmnInput cmn_input(&matrix_input, cmn_window,
+                           min_window);
+  OnlineCacheInput cache_input(&cmn_input);
+  
+  Matrix<BaseFloat> output_feats1;
+  GetOutput(&cache_input, &output_feats1);
+  
+  Matrix<BaseFloat> output_feats2(input_feats);
+  for (int32 i = 0; i < output_feats2.NumRows(); i++) {
+    SubVector<BaseFloat> this_row(output_feats2, i);
+    if (i == 0 && min_window == 0) this_row.SetZero();
+    else if (i < min_window) {
+      int32 window_nframes = std::min(min_window, input_feats.NumRows());
+      Vector<BaseFloat> this_sum(dim);
+      SubMatrix<BaseFloat> this_block(input_feats, 0, window_nframes,
+                                      0, dim);
+      this_sum.AddRowSumMat(1.0, this_block, 0.0);
+      this_row.AddVec(-1.0 / window_nframes, this_sum);
+    } else {
+      int32 window_nframes = std::min(i, cmn_window);
+      Vector<BaseFloat> this_sum(dim);
+      SubMatrix<BaseFloat> this_block(input_feats, i - window_nframes, window_nframes,
+                                      0, dim);
+      this_sum.AddRowSumMat(1.0, this_block, 0.0);
+      this_row.AddVec(-1.0 / window_nframes, this_sum);
+    }
+  }
+  KALDI_ASSERT(output_feats1.NumRows() == output_feats2.NumRows());
+  for (int32 i = 0; i < output_feats2.NumRows(); i++) {
+    if (!output_feats1.Row(i).ApproxEqual(output_feats2.Row(i))) {
+      KALDI_ERR << "Rows differ " << i << ", " << input_feats.Row(i) << output_feats1.Row(i)
+                << output_feats2.Row(i);
+    }
+  }
+  KALDI_ASSERT(output_feats1.ApproxEqual(output_feats2));
+  Matrix<BaseFloat> output_feats3;
+  cache_input.GetCachedData(&output_feats3);
+  KALDI_ASSERT(output_feats1.ApproxEqual(output_feats3));
+}
+
+
+
+void TestOnlineCmnPrior() {
+  int32 dim = 2 + Rand() % 5;
+  int32 num_frames = 10 + Rand() % 100;
+  int32 cmn_window = 10 + Rand() % 20, min_window = 1 + Rand() % cmn_window;
+  bool use_decay = (Rand() % 2 == 0);
+  BaseFloat decay = (use_decay ? 0.9 + 0.09 * RandUniform() : 0.0);
+
+  Matrix<BaseFloat> input_feats(num_frames, dim);
+  input_feats.SetRandn();
+  Matrix<double> prior(2, dim + 1);
+  prior.SetRandn();
+  prior(0, dim) = 1.0 + Rand() % 1000;
+  prior(1, dim) = 0.0;
+  Vector<double> prior_mean(dim);
+  prior_mean.CopyFromVec(prior.Row(0).Range(0, dim));
+  prior_mean.Scale(1.0 / prior(0, dim));
+
+  OnlineMatrixInput matrix_input(input_feats);
+  OnlineCmnInput cmn_input(&matrix_input, cmn_window, min_window, decay);
+  cmn_input.SetPrior(prior);
+  Matrix<BaseFloat> output_feats1;
+  GetOutput(&cmn_input, &output_feats1);
+
+  Matrix<BaseFloat> output_feats2(input_feats);
+  Vector<double> decayed_sum(prior_mean);
+  double decayed_count = (use_decay ? 1.0 / (1.0 - decay) : 0.0);
+  decayed_sum.Scale(decayed_count);
+  for (int32 i = 0; i < num_frames; i++) {
+    SubVector<BaseFloat> this_row(output_feats2, i);
+    if (use_decay) {
+      this_row.AddVec(-1.0 / decayed_count, decayed_sum);
+      decayed_sum.Scale(decay);
+      decayed_sum.AddVec(1.0, input_feats.Row(i));
+      decayed_count = decay * decayed_count + 1.0;
+    } else {
+      int32 window_nframes = std::min(i, cmn_window);
+      Vector<double> this_sum(dim);
+      for (int32 j = i - window_nframes; j < i; j++)
+        this_sum.AddVec(1.0, input_feats.Row(j));
+      this_sum.AddVec(cmn_window - window_nframes, prior_mean);
+      this_row.AddVec(-1.0 / cmn_window, this_sum);
+    }
+  }
+  AssertEqual(output_feats1, output_feats2);
+
+  // The stats are the prior plus those of the input.
+  Matrix<double> stats, stats2(prior);
+  cmn_input.GetStats(&stats);
+  for (int32 i = 0; i < num_frames; i++)
+    AccCmvnStats(input_feats.Row(i), 1.0, &stats2);
+  KALDI_ASSERT(stats.ApproxEqual(stats2));
+}
+
+// With a prior, the first frame comes out as soon as it comes in; without
+// one, only after "min_window" frames.  Reports the difference in latency.
+void TestOnlineCmnPriorLatency() {
+  int32 dim = 13, num_frames = 200, cmn_window = 600, min_window = 100;
+  Matrix<BaseFloat> input_feats(num_frames, dim);
+  input_feats.SetRandn();
+  Matrix<double> prior(2, dim + 1);
+  prior(0, dim) = 1.0;
+
+  int32 frames_read[2];
+  for (int32 i = 0; i < 2; i++) {
+    OnlineSteadyInput steady_input(input_feats);
+    OnlineCmnInput cmn_input(&steady_input, cmn_window, min_window);
+    if (i == 1)
+      cmn_input.SetPrior(prior);
+    Matrix<BaseFloat> output;
+    do {
+      output.Resize(1, dim);
+    } while (cmn_input.Compute(&output) && output.NumRows() == 0);
+    frames_read[i] = steady_input.NumFramesRead();
+  }
+  KALDI_ASSERT(frames_read[0] == min_window && frames_read[1] == 1);
+  KALDI_LOG << "Frames read before the first CMN output: " << frames_read[0]
+            << " without a prior, " << frames_read[1] << " with one ("
+            << (frames_read[0] - frames_read[1]) * 10 << " ms less latency "
+            << "at a 10 ms frame shift)";
+}
+
+#if !defined(_MSC_VER)
+// Encodes some frames as a datagram for OnlineUdpInput, and checks that the
+// header reads back and that the payload carries the features.
+void TestFeatPacket() {
+  int32 dim = 1 + Rand() % 40, num_rows = 1 + Rand() % 20,
+      first_row = Rand() % num_rows,
+      num_frames = Rand() % (num_rows - first_row + 1);
+  Matrix<BaseFloat> feats(num_rows, dim);
+  feats.SetRandn();
+  OnlineFeatPacketHeader header;
+  header.stream_id = Rand();
+  header.seq = Rand() % 1000;
+  header.first_frame = Rand() % 10000;
+  header.num_frames = num_frames;
+  header.dim = dim;
+  header.flags = (Rand() % 2 == 0 ? OnlineFeatPacketHeader::kEndOfStream : 0);
+  std::vector<char> packet;
+  EncodeFeatPacket(header, feats, first_row, &packet);
+
+  OnlineFeatPacketHeader read_header;
+  KALDI_ASSERT(read_header.Read(&(packet[0]), packet.size()));
+  KALDI_ASSERT(read_header.stream_id == header.stream_id &&
+               read_header.seq == header.seq &&
+               read_header.first_frame == header.first_frame &&
+               read_header.num_frames == header.num_frames &&
+               read_header.dim == header.dim &&
+               read_header.flags == header.flags);
+  // A truncated packet, or one with another magic number, is not accepted.
+  KALDI_ASSERT(!read_header.Read(&(packet[0]), packet.size() - 1));
+  packet[0] ^= 1;
+  KALDI_ASSERT(!read_header.Read(&(packet[0]), packet.size()));
+  packet[0] ^= 1;
+
+  const char *payload = &(packet[0]) + OnlineFeatPacketHeader::kSize;
+  for (int32 r = 0; r < num_frames; r++) {
+    for (int32 c = 0; c < dim; c++, payload += sizeof(uint32)) {
+      uint32 bits;
+      memcpy(&bits, payload, sizeof(bits));
+      bits = ntohl(bits);
+      float value;
+      memcpy(&value, &bits, sizeof(value));
+      KALDI_ASSERT(value == static_cast<float>(feats(first_row + r, c)));
+    }
+  }
+}
+
+// Sends datagrams of features to an OnlineUdpInput over the loopback
+// interface.
+class FeatPacketSender {
+ public:
+  FeatPacketSender(const OnlineUdpInput &input, int32 dim): dim_(dim) {
+    socklen_t addr_len = sizeof(addr_);
+    KALDI_ASSERT(getsockname(input.descriptor(),
+                             reinterpret_cast<sockaddr*>(&addr_),
+                             &addr_len) == 0);
+    addr_.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    sock_desc_ = socket(AF_INET, SOCK_DGRAM, IPPROTO_UDP);
+    KALDI_ASSERT(sock_desc_ != -1);
+  }
+  ~FeatPacketSender() { close(sock_desc_); }
+
+  // Sends the "seq"-th packet of a stream whose packets are "frames_per_packet"
+  // rows of "feats" each.
+  void Send(uint32 stream_id, uint32 seq, int32 frames_per_packet,
+            const Matrix<BaseFloat> &feats) {
+    OnlineFeatPacketHeader header;
+    header.stream_id = stream_id;
+    header.seq = seq;
+    header.first_frame = seq * frames_per_packet;
+    header.num_frames = std::min(
+        frames_per_packet,
+        feats.NumRows() - static_cast<int32>(header.first_frame));
+    header.dim = dim_;
+    if (header.first_frame + header.num_frames == feats.NumRows())
+      header.flags = OnlineFeatPacketHeader::kEndOfStream;
+    std::vector<char> packet;
+    EncodeFeatPacket(header, feats, header.first_frame, &packet);
+    KALDI_ASSERT(sendto(sock_desc_, &(packet[0]), packet.size(), 0,
+                        reinterpret_cast<sockaddr*>(&addr_),
+                        sizeof(addr_)) ==
+                 static_cast<ssize_t>(packet.size()));
+  }
+
+ private:
+  int32 dim_;
+  int32 sock_desc_;
+  sockaddr_in addr_;
+};
+
+// Reads what Compute() gives until it says that the stream ended.
+void ReadUdpStream(OnlineUdpInput *input, Matrix<BaseFloat> *feats) {
+  feats->Resize(0, 0);
+  Matrix<BaseFloat> output;
+  bool more;
+  do {
+    output.Resize(1, input->Dim());
+    more = input->Compute(&output);
+    if (output.NumRows() == 0)
+      continue;
+    int32 num_rows = feats->NumRows();
+    feats->Resize(num_rows + output.NumRows(), input->Dim(), kCopyData);
+    feats->RowRange(num_rows, output.NumRows()).CopyFromMat(output);
+  } while (more);
+}
+
+// Sends two streams whose packets are reordered, the first one of the second
+// stream coming after the second one and after a late duplicate of the first
+// stream, and checks that both come out whole, one after the other.
+void TestUdpInputReorder() {
+  int32 dim = 1 + Rand() % 10, frames_per_packet = 1 + Rand() % 4;
+  OnlineUdpInputOptions opts;
+  opts.max_reorder = 4;
+  OnlineUdpInput input(0, dim, opts);
+  FeatPacketSender sender(input, dim);
+  Matrix<BaseFloat> feats1(frames_per_packet * 5, dim),
+      feats2(frames_per_packet * 3 + 1, dim);
+  feats1.SetRandn();
+  feats2.SetRandn();
+  int32 order1[] = { 0, 2, 1, 3, 4 }, order2[] = { 1, 0, 2, 3 };
+  for (int32 i = 0; i < 5; i++)
+    sender.Send(7, order1[i], frames_per_packet, feats1);
+  sender.Send(7, 3, frames_per_packet, feats1);
+  for (int32 i = 0; i < 4; i++)
+    sender.Send(8, order2[i], frames_per_packet, feats2);
+
+  Matrix<BaseFloat> output;
+  ReadUdpStream(&input, &output);
+  KALDI_ASSERT(output.NumRows() == feats1.NumRows() &&
+               output.ApproxEqual(feats1));
+  ReadUdpStream(&input, &output);
+  KALDI_ASSERT(output.NumRows() == feats2.NumRows() &&
+               output.ApproxEqual(feats2));
+  KALDI_ASSERT(input.NumPacketsLost() == 0 &&
+               input.NumPacketsDropped() == 1);
+}
+
+// Sends a stream whose end is lost, then one whose first packet is lost, and
+// checks that the first one ends when the second one starts, and that what
+// arrived of the second one comes out once the loss is given up on.
+void TestUdpInputLoss() {
+  int32 dim = 1 + Rand() % 10, frames_per_packet = 1 + Rand() % 4;
+  OnlineUdpInputOptions opts;
+  opts.max_reorder = 2;
+  OnlineUdpInput input(0, dim, opts);
+  FeatPacketSender sender(input, dim);
+  Matrix<BaseFloat> feats1(frames_per_packet * 3, dim),
+      feats2(frames_per_packet * 5, dim);
+  feats1.SetRandn();
+  feats2.SetRandn();
+  for (int32 seq = 0; seq < 2; seq++)
+    sender.Send(7, seq, frames_per_packet, feats1);
+  for (int32 seq = 1; seq < 5; seq++)
+    sender.Send(8, seq, frames_per_packet, feats2);
+
+  Matrix<BaseFloat> output;
+  ReadUdpStream(&input, &output);
+  KALDI_ASSERT(output.NumRows() == frames_per_packet * 2 &&
+               output.ApproxEqual(feats1.RowRange(0, frames_per_packet * 2)));
+  ReadUdpStream(&input, &output);
+  KALDI_ASSERT(output.NumRows() == frames_per_packet * 4 &&
+               output.ApproxEqual(feats2.RowRange(frames_per_packet,
+                                                  frames_per_packet * 4)));
+  KALDI_ASSERT(input.NumPacketsLost() == 1);
+}
+#endif
+
+// Checks that the frames come out of OnlineThreadedInput the same as they
+// went in, with timeouts of the input on the way and small queues, so that
+// the two threads often have to wait for each other.
+void TestOnlineThreadedInput() {
+  int32 dim = 2 + Rand() % 5;
+  int32 num_frames = 100 + Rand() % 100;
+  Matrix<BaseFloat> input_feats(num_frames, dim);
+  input_feats.SetRandn();
+
+  OnlineMatrixInput matrix_input(input_feats);
+  OnlineThreadedInputOptions threaded_opts;
+  threaded_opts.queue_size = 1 + Rand() % 20;
+  threaded_opts.batch_size = 1 + Rand() % 10;
+  OnlineThreadedInput threaded_input(threaded_opts, &matrix_input);
+  OnlineFeatureMatrixOptions opts;
+  opts.batch_size = 1 + Rand() % 30;
+  opts.num_tries = 100; // makes it very unlikely we'll get that many timeouts.
+  OnlineFeatureMatrix online_feature_matrix(opts, &threaded_input);
+
+  for (int32 frame = 0; frame < num_frames; frame++) {
+    KALDI_ASSERT(online_feature_matrix.IsValidFrame(frame));
+    KALDI_ASSERT(online_feature_matrix.GetFrame(frame).ApproxEqual(
+        input_feats.Row(frame)));
+  }
+  KALDI_ASSERT(!online_feature_matrix.IsValidFrame(num_frames));
+}
+
+// Stops reading half way, while the front-end thread is waiting for room in
+// the queue; destroying the input must not hang.
+void TestOnlineThreadedInputAbort() {
+  int32 dim = 2 + Rand() % 5, num_frames = 200;
+  Matrix<BaseFloat> input_feats(num_frames, dim);
+  input_feats.SetRandn();
+  OnlineSteadyInput steady_input(input_feats);
+  OnlineThreadedInputOptions threaded_opts;
+  threaded_opts.queue_size = 1 + Rand() % 10;
+  OnlineThreadedInput threaded_input(threaded_opts, &steady_input);
+  Matrix<BaseFloat> output(1 + Rand() % 10, dim);
+  KALDI_ASSERT(threaded_input.Compute(&output) && output.NumRows() > 0);
+  KALDI_ASSERT(output.Row(0).ApproxEqual(input_feats.Row(0)));
+}
+
+// The timeouts of OnlineMatrixInput stand for audio that has not arrived
+// yet.  The frames that OnlinePrefetchInput says are ready must be readable
+// without a single timeout, and the frames must come out as they went in.
+void TestOnlinePrefetchInput() {
+  int32 dim = 2 + Rand() % 5, num_frames = 1 + Rand() % 100;
+  Matrix<BaseFloat> input_feats(num_frames, dim);
+  input_feats.SetRandn();
+  OnlineMatrixInput matrix_input(input_feats);
+  OnlinePrefetchInput prefetch_input(&matrix_input, 1 + Rand() % 10);
+  OnlineFeatureMatrixOptions opts;
+  opts.batch_size = 1 + Rand() % 30;
+  opts.num_tries = 1; // any timeout would end the features.
+  OnlineFeatureMatrix online_feature_matrix(opts, &prefetch_input);
+
+  int32 frame = 0;
+  bool more = true;
+  while (more) {
+    more = prefetch_input.Prefetch();
+    KALDI_ASSERT(more == !prefetch_input.Ended());
+    for (; frame < prefetch_input.NumFramesReady(); frame++) {
+      KALDI_ASSERT(online_feature_matrix.IsValidFrame(frame));
+      KALDI_ASSERT(online_feature_matrix.GetFrame(frame).ApproxEqual(
+          input_feats.Row(frame)));
+    }
+  }
+  KALDI_ASSERT(frame == num_frames &&
+               !online_feature_matrix.IsValidFrame(num_frames));
+}
+
+// A feature extractor for testing OnlineFeInput, with the same framing as
+// Mfcc: the features of a frame are its first sample and the sum of its
+// samples.
+class OnlineTestExtractor {
+ public:
+  OnlineTestExtractor(int32 frame_size, int32 frame_shift):
+      frame_size_(frame_size), frame_shift_(frame_shift) { }
+
+  int32 Dim() const { return 2; }
+
+  void Compute(const VectorBase<BaseFloat> &wave, BaseFloat vtln_warp,
+               Matrix<BaseFloat> *output) {
+    if (wave.Dim() < frame_size_) {
+      output->Resize(0, 0);
+      return;
+    }
+    int32 num_frames = 1 + (wave.Dim() - frame_size_) / frame_shift_;
+    output->Resize(num_frames, 2, kUndefined);
+    for (int32 t = 0; t < num_frames; t++) {
+      SubVector<BaseFloat> frame(wave, t * frame_shift_, frame_size_);
+      (*output)(t, 0) = frame(0);
+      (*output)(t, 1) = frame.Sum();
+    }
+  }
+
+ private:
+  int32 frame_size_, frame_shift_;
+};
+
+// Reads all the features of "wave" through OnlineFeInput, asking for a
+// random number of frames at a time.
+template<class E>
+static void GetOnlineFeatures(const Vector<BaseFloat> &wave, E *extractor,
+                              int32 frame_size, int32 frame_shift,
+                              Matrix<BaseFloat> *output) {
+  OnlineVectorSource source(wave);
+  OnlineFeInput<E> fe_input(&source, extractor, frame_size, frame_shift);
+  std::vector<Vector<BaseFloat> > frames;
+  Matrix<BaseFloat> batch;
+  bool more = true;
+  while (more) {
+    batch.Resize(1 + Rand() % 10, extractor->Dim());
+    more = fe_input.Compute(&batch);
+    for (int32 t = 0; t < batch.NumRows(); t++)
+      frames.push_back(Vector<BaseFloat>(batch.Row(t)));
+  }
+  output->Resize(frames.size(), extractor->Dim());
+  for (size_t t = 0; t < frames.size(); t++)
+    output->Row(t).CopyFromVec(frames[t]);
+}
+
+// The frames must come out the same as when the whole waveform is processed
+// at once, whatever the batches.
+void TestOnlineFeInput() {
+  int32 frame_shift = 1 + Rand() % 40,
+      frame_size = frame_shift + Rand() % 60;
+  Vector<BaseFloat> wave(1000 + Rand() % 4000);
+  wave.SetRandn();
+  OnlineTestExtractor extractor(frame_size, frame_shift);
+  Matrix<BaseFloat> whole_feats, online_feats;
+  extractor.Compute(wave, 1.0, &whole_feats);
+  GetOnlineFeatures(wave, &extractor, frame_size, frame_shift, &online_feats);
+  AssertEqual(whole_feats, online_feats);
+
+  MfccOptions mfcc_opts;
+  mfcc_opts.frame_opts.dither = 0.0;
+  Mfcc mfcc(mfcc_opts);
+  wave.Scale(1000.0);
+  mfcc.Compute(wave, 1.0, &whole_feats, NULL);
+  GetOnlineFeatures(wave, &mfcc, mfcc_opts.frame_opts.WindowSize(),
+                    mfcc_opts.frame_opts.WindowShift(), &online_feats);
+  AssertEqual(whole_feats, online_feats);
+}
+
+// Once the sample buffer has its size, reading samples and cutting them into
+// frames should not allocate.
+void TestOnlineFeInputAllocations() {
+#if defined(__GLIBC__)
+  int32 frame_size = 400, frame_shift = 160, batch_size = 27;
+  Vector<BaseFloat> wave(200 * frame_shift);
+  wave.SetRandn();
+  OnlineVectorSource source(wave);
+  OnlineTestExtractor extractor(frame_size, frame_shift);
+  OnlineFeInput<OnlineTestExtractor> fe_input(&source, &extractor,
+                                              frame_size, frame_shift);
+  Matrix<BaseFloat> output(batch_size, extractor.Dim());
+  KALDI_ASSERT(fe_input.Compute(&output));
+  int64 num_allocs = NumAllocsSoFar();
+  for (int32 i = 0; i < 5; i++) {
+    KALDI_ASSERT(fe_input.Compute(&output) &&
+                 output.NumRows() == batch_size);
+  }
+  KALDI_ASSERT(NumAllocsSoFar() == num_allocs);
+#endif
+}
+
+// Once the pipeline has warmed up (the CMN window is full and all the buffers
+// have reached their size), reading features must not allocate any memory.
+void TestSteadyStateAllocations() {
+#if defined(__GLIBC__)
+  int32 dim = 13, num_frames = 2000, warmup_frames = 300,
+      left_context = 4, right_context = 4;
+  Matrix<BaseFloat> input_feats(num_frames, dim);
+  input_feats.SetRandn();
+  Matrix<BaseFloat> transform(40, dim * (left_context + 1 + right_context));
+  transform.SetRandn();
+
+  OnlineSteadyInput steady_input(input_feats);
+  OnlineCmnInput cmn_input(&steady_input, 100, 10);
+  OnlineLdaInput lda_input(&cmn_input, transform, left_context, right_context);
+  DeltaFeaturesOptions delta_opts;
+  OnlineDeltaInput delta_input(delta_opts, &lda_input);
+  OnlineFeatureMatrixOptions opts;
+  OnlineFeatureMatrix feature_matrix(opts, &delta_input);
+
+  int32 frame = 0;
+  for (; frame < warmup_frames; frame++)
+    KALDI_ASSERT(feature_matrix.IsValidFrame(frame));
+  int64 num_allocs = NumAllocsSoFar();
+  BaseFloat sum = 0.0;
+  // We stop well before the end, where the batches get smaller.
+  for (; frame < num_frames - 200; frame++) {
+    KALDI_ASSERT(feature_matrix.IsValidFrame(frame));
+    sum += feature_matrix.GetFrame(frame)(0);
+  }
+  KALDI_ASSERT(NumAllocsSoFar() == num_allocs);
+  KALDI_ASSERT(sum == sum); // not NaN; also keeps the loop from being
+                            // optimized away.
+#endif
+}
+
+}  // end namespace kaldi
+
+int main() {
+  using namespace kaldi;
+  for (int i = 0; i < 40; i++) {
+    TestOnlineMatrixInput();
+    TestOnlineFeatureMatrix();
+    TestOnlineFeatureMatrixHistory();
+    TestOnlineCacheInputChunks();
+    TestOnlineLdaInput();
+    TestOnlineDeltaInput();
+    TestComputeDeltasBatch();
+    TestOnlineCmnInput(); // also tests cache input.
+    TestOnlineCmnPrior();
+    TestOnlineThreadedInput();
+    TestOnlineThreadedInputAbort();
+    TestOnlinePrefetchInput();
+    TestOnlineFeInput();
+#if !defined(_MSC_VER)
+    TestFeatPacket();
+    TestUdpInputReorder();
+    TestUdpInputLoss();
+#endif
+    // I have not tested the delta input yet.
+  }
+  TestOnlineCmnPriorLatency();
+  TestSteadyStateAllocations();
+  TestOnlineFeInputAllocations();
+  std::cout << "Test OK.\n";
+}
@@ -0,0 +1,112 @@
+// online/online-gselect.cc
+
+// See ../../COPYING for clarification regarding multiple authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//  http://www.apache.org/licenses/LICENSE-2.0
+//
+// THIS CODE IS PROVIDED *AS IS* BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, EITHER EXPRESS OR IMPLIED, INCLUDING WITHOUT LIMITATION ANY IMPLIED
+// WARRANTIES OR CONDITIONS OF TITLE, FITNESS FOR A PARTICULAR PURPOSE,
+// MERCHANTABLITY OR NON-INFRINGEMENT.
+// See the Apache 2 License for the specific language governing permissions and
+// limitations under the License.
+
+#include <algorithm>
+#include <functional>
+#include <utility>
+
+#include "online/online-gselect.h"
+
+namespace kaldi {
+
+void OnlineGselectIndex::Build(const DiagGmm &ubm, const AmDiagGmm &am_gmm,
+                               int32 num_ubm_per_gauss) {
+  int32 num_ubm = ubm.NumGauss();
+  KALDI_ASSERT(num_ubm_per_gauss > 0 && num_ubm > 0);
+  if (ubm.Dim() != am_gmm.Dim())
+    KALDI_ERR << "UBM dimension " << ubm.Dim() << " does not match the "
+              << "model dimension " << am_gmm.Dim();
+  num_ubm_per_gauss = std::min(num_ubm_per_gauss, num_ubm);
+  ubm_.CopyFromDiagGmm(ubm);
+  num_ubm_per_gauss_ = num_ubm_per_gauss;
+  num_gauss_per_pdf_.resize(am_gmm.NumPdfs());
+  gauss_lists_.clear();
+  gauss_lists_.resize(num_ubm);
+
+  Vector<BaseFloat> loglikes(num_ubm);
+  std::vector<int32> selected;
+  int32 gauss_index = 0;
+  for (int32 pdf_id = 0; pdf_id < am_gmm.NumPdfs(); pdf_id++) {
+    const DiagGmm &gmm = am_gmm.GetPdf(pdf_id);
+    num_gauss_per_pdf_[pdf_id] = gmm.NumGauss();
+    Matrix<BaseFloat> means;
+    gmm.GetMeans(&means);
+    for (int32 g = 0; g < gmm.NumGauss(); g++, gauss_index++) {
+      SelectUbmComponents(means.Row(g), num_ubm_per_gauss, &loglikes,
+                          &selected);
+      for (size_t i = 0; i < selected.size(); i++)
+        gauss_lists_[selected[i]].push_back(gauss_index);
+    }
+  }
+}
+
+void OnlineGselectIndex::SelectUbmComponents(
+    const VectorBase<BaseFloat> &data, int32 num_select,
+    Vector<BaseFloat> *loglikes, std::vector<int32> *selected) const {
+  ubm_.LogLikelihoods(data, loglikes);
+  int32 num_ubm = loglikes->Dim();
+  num_select = std::min(num_select, num_ubm);
+  std::vector<std::pair<BaseFloat, int32> > scores(num_ubm);
+  for (int32 i = 0; i < num_ubm; i++)
+    scores[i] = std::make_pair((*loglikes)(i), i);
+  std::nth_element(scores.begin(), scores.begin() + num_select - 1,
+                   scores.end(), std::greater<std::pair<BaseFloat, int32> >());
+  selected->resize(num_select);
+  for (int32 i = 0; i < num_select; i++)
+    (*selected)[i] = scores[i].second;
+}
+
+bool OnlineGselectIndex::IsCompatible(const AmDiagGmm &am_gmm) const {
+  if (am_gmm.NumPdfs() != static_cast<int32>(num_gauss_per_pdf_.size()) ||
+      am_gmm.Dim() != ubm_.Dim())
+    return false;
+  for (int32 pdf_id = 0; pdf_id < am_gmm.NumPdfs(); pdf_id++)
+    if (am_gmm.GetPdf(pdf_id).NumGauss() != num_gauss_per_pdf_[pdf_id])
+      return false;
+  return true;
+}
+
+void OnlineGselectIndex::Write(std::ostream &os, bool binary) const {
+  WriteToken(os, binary, "<OnlineGselectIndex>");
+  WriteToken(os, binary, "<Ubm>");
+  ubm_.Write(os, binary);
+  WriteToken(os, binary, "<NumUbmPerGauss>");
+  WriteBasicType(os, binary, num_ubm_per_gauss_);
+  WriteToken(os, binary, "<NumGaussPerPdf>");
+  WriteIntegerVector(os, binary, num_gauss_per_pdf_);
+  WriteToken(os, binary, "<GaussLists>");
+  for (size_t i = 0; i < gauss_lists_.size(); i++)
+    WriteIntegerVector(os, binary, gauss_lists_[i]);
+  WriteToken(os, binary, "</OnlineGselectIndex>");
+}
+
+void OnlineGselectIndex::Read(std::istream &is, bool binary) {
+  ExpectToken(is, binary, "<OnlineGselectIndex>");
+  ExpectToken(is, binary, "<Ubm>");
+  ubm_.Read(is, binary);
+  ExpectToken(is, binary, "<NumUbmPerGauss>");
+  ReadBasicType(is, binary, &num_ubm_per_gauss_);
+  ExpectToken(is, binary, "<NumGaussPerPdf>");
+  ReadIntegerVector(is, binary, &num_gauss_per_pdf_);
+  ExpectToken(is, binary, "<GaussLists>");
+  gauss_lists_.resize(ubm_.NumGauss());
+  for (size_t i = 0; i < gauss_lists_.size(); i++)
+    ReadIntegerVector(is, binary, &(gauss_lists_[i]));
+  ExpectToken(is, binary, "</OnlineGselectIndex>");
+}
+
+} // namespace kaldi
@@ -0,0 +1,75 @@
+// online/online-gselect.h
+
+// See ../../COPYING for clarification regarding multiple authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//  http://www.apache.org/licenses/LICENSE-2.0
+//
+// THIS CODE IS PROVIDED *AS IS* BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, EITHER EXPRESS OR IMPLIED, INCLUDING WITHOUT LIMITATION ANY IMPLIED
+// WARRANTIES OR CONDITIONS OF TITLE, FITNESS FOR A PARTICULAR PURPOSE,
+// MERCHANTABLITY OR NON-INFRINGEMENT.
+// See the Apache 2 License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef KALDI_ONLINE_ONLINE_GSELECT_H_
+#define KALDI_ONLINE_ONLINE_GSELECT_H_
+
+#include <vector>
+
+#include "base/kaldi-common.h"
+#include "gmm/am-diag-gmm.h"
+#include "gmm/diag-gmm.h"
+
+namespace kaldi {
+
+// An index for Gaussian selection in GMM scoring.  Every Gaussian of the
+// acoustic model is attached to the few components of a small UBM that are
+// closest to it.  When decoding, the UBM is evaluated on each frame, and only
+// the Gaussians attached to its best-scoring components are evaluated for the
+// pdfs of the model.  The Gaussians are numbered like in the model, i.e. the
+// Gaussians of pdf 0 first, then those of pdf 1 and so on.
+class OnlineGselectIndex {
+ public:
+  OnlineGselectIndex(): num_ubm_per_gauss_(0) { }
+
+  // Builds the index: each Gaussian of "am_gmm" is attached to the
+  // "num_ubm_per_gauss" components of "ubm" under which its mean is the
+  // most likely.
+  void Build(const DiagGmm &ubm, const AmDiagGmm &am_gmm,
+             int32 num_ubm_per_gauss);
+
+  // Outputs the indices of the "num_select" UBM components that score
+  // best on "data".  "loglikes" is a scratch buffer.
+  void SelectUbmComponents(const VectorBase<BaseFloat> &data,
+                           int32 num_select, Vector<BaseFloat> *loglikes,
+                           std::vector<int32> *selected) const;
+
+  // The Gaussians of the model attached to UBM component "ubm_comp".
+  const std::vector<int32> &Gaussians(int32 ubm_comp) const {
+    return gauss_lists_[ubm_comp];
+  }
+
+  // Checks that the index was built for a model with the same layout.
+  bool IsCompatible(const AmDiagGmm &am_gmm) const;
+
+  const DiagGmm &Ubm() const { return ubm_; }
+
+  int32 NumUbmPerGauss() const { return num_ubm_per_gauss_; }
+
+  void Write(std::ostream &os, bool binary) const;
+  void Read(std::istream &is, bool binary);
+
+ private:
+  DiagGmm ubm_;
+  int32 num_ubm_per_gauss_;
+  std::vector<int32> num_gauss_per_pdf_; // for checking the model
+  std::vector<std::vector<int32> > gauss_lists_; // indexed by UBM component
+};
+
+} // namespace kaldi
+
+#endif // KALDI_ONLINE_ONLINE_GSELECT_H_
@@ -0,0 +1,151 @@
+// online/online-immortal-token-test.cc
+
+// See ../../COPYING for clarification regarding multiple authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//  http://www.apache.org/licenses/LICENSE-2.0
+//
+// THIS CODE IS PROVIDED *AS IS* BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, EITHER EXPRESS OR IMPLIED, INCLUDING WITHOUT LIMITATION ANY IMPLIED
+// WARRANTIES OR CONDITIONS OF TITLE, FITNESS FOR A PARTICULAR PURPOSE,
+// MERCHANTABLITY OR NON-INFRINGEMENT.
+// See the Apache 2 License for the specific language governing permissions and
+// limitations under the License.
+
+#include <cmath>
+#include <set>
+
+#include "online/online-immortal-token.h"
+#include "online/online-token-pool.h"
+
+namespace kaldi {
+
+struct TestToken {
+  struct { int32 ilabel; } arc_;
+  TestToken *prev_;
+  int32 ref_count_;
+};
+
+// Grows a token tree like OnlineFasterDecoder does, with the same reference
+// counting, but with random arcs instead of a graph and a decodable.
+class TokenTreeMaker {
+ public:
+  TokenTreeMaker(): start_(NewToken(0, NULL)) { active_.push_back(start_); }
+  ~TokenTreeMaker() {
+    for (size_t i = 0; i < active_.size(); i++)
+      TokenRelease(active_[i]);
+  }
+
+  TestToken *Start() const { return start_; }
+  const std::vector<TestToken*> &Active() const { return active_; }
+
+  // Makes "num_toks" new active tokens, on emitting arcs from the current
+  // ones, which are then released; the best ones (the first in the list) get
+  // most of the children, so that the paths merge back in time.  Then
+  // non-emitting arcs are followed from some of the new tokens, which are
+  // either replaced by the token at the end of the arc, or stay active too.
+  void Frame(int32 num_toks) {
+    std::vector<TestToken*> prev_active;
+    prev_active.swap(active_);
+    for (int32 i = 0; i < num_toks; i++) {
+      double u = RandUniform();
+      size_t parent = static_cast<size_t>(prev_active.size() * u * u * u * u);
+      active_.push_back(NewToken(1, prev_active[parent]));
+    }
+    for (size_t i = 0; i < prev_active.size(); i++)
+      TokenRelease(prev_active[i]);
+    size_t num_emitting = active_.size();
+    for (size_t i = 0; i < num_emitting; i++) {
+      int32 r = Rand() % 10;
+      if (r == 0) {
+        active_.push_back(NewToken(0, active_[i]));
+      } else if (r == 1) {
+        TestToken *tok = NewToken(0, active_[i]);
+        TokenRelease(active_[i]);
+        active_[i] = tok;
+      }
+    }
+  }
+
+ private:
+  TestToken *NewToken(int32 ilabel, TestToken *prev) {
+    TestToken *tok = new (pool_.Allocate()) TestToken();
+    tok->arc_.ilabel = ilabel;
+    tok->prev_ = prev;
+    tok->ref_count_ = 1;
+    if (prev != NULL)
+      prev->ref_count_++;
+    return tok;
+  }
+  void TokenRelease(TestToken *tok) {
+    while (--tok->ref_count_ == 0) {
+      TestToken *prev = tok->prev_;
+      pool_.Free(tok);
+      if (prev == NULL)
+        return;
+      tok = prev;
+    }
+  }
+
+  OnlineTokenPool<TestToken> pool_;
+  TestToken *start_;
+  std::vector<TestToken*> active_;
+};
+
+// The algorithm OnlineFasterDecoder used before FindImmortalToken(): it goes
+// back one emitting token at a time from all the active tokens at once, until
+// they meet.  Returns NULL if they only meet at the start token.
+static TestToken *FindImmortalTokenBySweep(
+    const std::vector<TestToken*> &active) {
+  std::set<TestToken*> emitting;
+  for (size_t i = 0; i < active.size(); i++) {
+    TestToken *tok = active[i];
+    while (tok != NULL && tok->arc_.ilabel == 0)
+      tok = tok->prev_;
+    if (tok != NULL)
+      emitting.insert(tok);
+  }
+  while (emitting.size() > 1) {
+    std::set<TestToken*> prev_emitting;
+    for (std::set<TestToken*>::iterator it = emitting.begin();
+         it != emitting.end(); ++it) {
+      TestToken *tok = (*it)->prev_;
+      while (tok != NULL && tok->arc_.ilabel == 0)
+        tok = tok->prev_;
+      if (tok != NULL)
+        prev_emitting.insert(tok);
+    }
+    emitting.swap(prev_emitting);
+  }
+  return (emitting.empty() ? NULL : *emitting.begin());
+}
+
+void TestFindImmortalToken() {
+  TokenTreeMaker maker;
+  TestToken *immortal = maker.Start();
+  int32 num_toks = 1 + Rand() % 50, batch_size = 1 + Rand() % 10;
+  for (int32 frame = 0; frame < 200; frame++) {
+    maker.Frame(1 + Rand() % num_toks);
+    if (frame % batch_size != 0)
+      continue;
+    const std::vector<TestToken*> &active = maker.Active();
+    TestToken *ref = FindImmortalTokenBySweep(active);
+    // Any of the active tokens will do.
+    TestToken *found = FindImmortalToken(active[Rand() % active.size()],
+                                         immortal);
+    KALDI_ASSERT(found == (ref != NULL ? ref : immortal));
+    immortal = found;
+  }
+}
+
+}  // end namespace kaldi
+
+int main() {
+  using namespace kaldi;
+  for (int i = 0; i < 100; i++)
+    TestFindImmortalToken();
+  std::cout << "Test OK.\n";
+}
@@ -0,0 +1,58 @@
+// online/online-immortal-token.h
+
+// See ../../COPYING for clarification regarding multiple authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//  http://www.apache.org/licenses/LICENSE-2.0
+//
+// THIS CODE IS PROVIDED *AS IS* BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, EITHER EXPRESS OR IMPLIED, INCLUDING WITHOUT LIMITATION ANY IMPLIED
+// WARRANTIES OR CONDITIONS OF TITLE, FITNESS FOR A PARTICULAR PURPOSE,
+// MERCHANTABLITY OR NON-INFRINGEMENT.
+// See the Apache 2 License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef KALDI_ONLINE_ONLINE_IMMORTAL_TOKEN_H_
+#define KALDI_ONLINE_ONLINE_IMMORTAL_TOKEN_H_
+
+#include "base/kaldi-common.h"
+
+namespace kaldi {
+
+// Returns the "immortal" token, i.e. the last emitting token that is an
+// ancestor (or self) of all the active tokens, given "active_tok", any one of
+// them, and "immortal_tok", the previous immortal token (or the start token of
+// the utterance).  If there is none after "immortal_tok", "immortal_tok" is
+// returned.
+//
+// "Token" is a decoder token with "prev_", "ref_count_" and "arc_.ilabel"
+// members, whose reference counts follow FasterDecoder's rules: the tokens
+// reachable from the active ones form a tree rooted at "immortal_tok", and
+// the count of every token in it is its number of children, plus one if it is
+// active itself.  So on the path from any active token back to
+// "immortal_tok", the token nearest to the root with a count other than 1 is
+// the deepest common ancestor of all the active tokens: every token above it
+// has exactly one child and is not active.  This costs O(frames since
+// "immortal_tok"), whatever the number of active tokens.
+template<class Token>
+Token *FindImmortalToken(Token *active_tok, Token *immortal_tok) {
+  Token *common = active_tok;
+  for (Token *tok = common->prev_; tok != NULL; tok = tok->prev_) {
+    if (tok->ref_count_ != 1)
+      common = tok;
+    if (tok == immortal_tok)
+      break;
+  }
+  // The immortal token must be emitting, so back off to the nearest
+  // emitting ancestor-or-self of the common ancestor.
+  while (common != immortal_tok && common->arc_.ilabel == 0)
+    common = common->prev_;
+  return common;
+}
+
+} // namespace kaldi
+
+#endif // KALDI_ONLINE_ONLINE_IMMORTAL_TOKEN_H_
@@ -0,0 +1,123 @@
+// online/online-lattice-decoder.cc
+
+// See ../../COPYING for clarification regarding multiple authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//  http://www.apache.org/licenses/LICENSE-2.0
+//
+// THIS CODE IS PROVIDED *AS IS* BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, EITHER EXPRESS OR IMPLIED, INCLUDING WITHOUT LIMITATION ANY IMPLIED
+// WARRANTIES OR CONDITIONS OF TITLE, FITNESS FOR A PARTICULAR PURPOSE,
+// MERCHANTABLITY OR NON-INFRINGEMENT.
+// See the Apache 2 License for the specific language governing permissions and
+// limitations under the License.
+
+#include "fstext/fstext-utils.h"
+#include "lat/determinize-lattice-pruned.h"
+#include "online/online-lattice-decoder.h"
+
+namespace kaldi {
+
+OnlineLatticeDecoder::OnlineLatticeDecoder(
+    const fst::Fst<fst::StdArc> &fst, const OnlineLatticeDecoderOpts &opts,
+    const std::vector<int32> &sil_phones, const TransitionModel &trans_model)
+    : opts_(opts), trans_model_(trans_model),
+      decoder_(fst, opts.decoder_opts), state_(OnlineFasterDecoder::kEndFeats),
+      frame_(0), utt_start_frame_(0), num_raw_arcs_(0) {
+  KALDI_ASSERT(opts.batch_size > 0);
+  GetSilenceTransitions(trans_model, sil_phones, &silence_tids_);
+}
+
+
+bool OnlineLatticeDecoder::EndOfUtterance() {
+  int32 utt_frames = frame_ - utt_start_frame_;
+  if (opts_.force_utt_len > 0 && utt_frames >= opts_.force_utt_len)
+    return true;
+  int32 sil_frm = opts_.inter_utt_sil / (1 + utt_frames / opts_.max_utt_len_);
+  LatticeFasterOnlineDecoder::BestPathIterator iter =
+      decoder_.BestPathEnd(false);
+  while (!iter.Done() && sil_frm > 0) {
+    LatticeArc arc;
+    iter = decoder_.TraceBackBestPath(iter, &arc);
+    if (arc.ilabel == 0)
+      continue;
+    --sil_frm;
+    if (!silence_tids_[arc.ilabel])
+      return false;
+  }
+  return true;
+}
+
+
+OnlineLatticeDecoder::DecodeState
+OnlineLatticeDecoder::Decode(DecodableInterface *decodable) {
+  if (state_ == OnlineFasterDecoder::kEndFeats ||
+      state_ == OnlineFasterDecoder::kEndUtt) {
+    if (state_ == OnlineFasterDecoder::kEndFeats)
+      frame_ = 0;
+    utt_start_frame_ = frame_;
+    decoder_.InitDecoding();
+  }
+  int32 batch_frame = 0;
+  for (; !decodable->IsLastFrame(frame_ - 1) && batch_frame < opts_.batch_size;
+       ++frame_, ++batch_frame) {
+    // IsLastFrame() above made sure frame "frame_" is available.
+    utt_decodable_.Init(decodable, utt_start_frame_,
+                        frame_ - utt_start_frame_ + 1);
+    decoder_.AdvanceDecoding(&utt_decodable_, 1);
+  }
+  if (batch_frame == opts_.batch_size && !decodable->IsLastFrame(frame_ - 1)) {
+    if (EndOfUtterance())
+      state_ = OnlineFasterDecoder::kEndUtt;
+    else
+      state_ = OnlineFasterDecoder::kEndBatch;
+  } else {
+    state_ = OnlineFasterDecoder::kEndFeats;
+  }
+  if (state_ != OnlineFasterDecoder::kEndBatch)
+    decoder_.FinalizeDecoding();
+  return state_;
+}
+
+
+bool OnlineLatticeDecoder::GetLattice(CompactLattice *clat) {
+  KALDI_ASSERT(state_ != OnlineFasterDecoder::kEndBatch);
+  clat->DeleteStates();
+  num_raw_arcs_ = 0;
+  if (decoder_.NumFramesDecoded() <= 0)
+    return false;
+  decoder_.GetRawLattice(&raw_lat_, true);
+  if (raw_lat_.NumStates() == 0) {
+    KALDI_WARN << "Empty lattice for the utterance ending at frame " << frame_;
+    return false;
+  }
+  for (LatticeArc::StateId s = 0; s < raw_lat_.NumStates(); s++)
+    num_raw_arcs_ += raw_lat_.NumArcs(s);
+  const LatticeFasterDecoderConfig &config = opts_.decoder_opts;
+  if (!DeterminizeLatticePhonePrunedWrapper(trans_model_, &raw_lat_,
+                                            config.lattice_beam, clat,
+                                            config.det_opts))
+    KALDI_WARN << "Determinization finished earlier than the beam for the "
+               << "utterance ending at frame " << frame_;
+  return clat->NumStates() != 0;
+}
+
+
+bool OnlineLatticeDecoder::GetBestPath(std::vector<int32> *word_ids,
+                                       std::vector<int32> *alignment) {
+  word_ids->clear();
+  alignment->clear();
+  if (decoder_.NumFramesDecoded() <= 0)
+    return false;
+  // Once the utterance is finalized, only the final-probs version is allowed.
+  Lattice best_path;
+  decoder_.GetBestPath(&best_path,
+                       state_ != OnlineFasterDecoder::kEndBatch);
+  return fst::GetLinearSymbolSequence(best_path, alignment, word_ids,
+                                      static_cast<LatticeArc::Weight*>(0));
+}
+
+} // namespace kaldi
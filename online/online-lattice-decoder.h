@@ -0,0 +1,140 @@
+// online/online-lattice-decoder.h
+
+// See ../../COPYING for clarification regarding multiple authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//  http://www.apache.org/licenses/LICENSE-2.0
+//
+// THIS CODE IS PROVIDED *AS IS* BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, EITHER EXPRESS OR IMPLIED, INCLUDING WITHOUT LIMITATION ANY IMPLIED
+// WARRANTIES OR CONDITIONS OF TITLE, FITNESS FOR A PARTICULAR PURPOSE,
+// MERCHANTABLITY OR NON-INFRINGEMENT.
+// See the Apache 2 License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef KALDI_ONLINE_ONLINE_LATTICE_DECODER_H_
+#define KALDI_ONLINE_ONLINE_LATTICE_DECODER_H_
+
+#include <vector>
+
+#include "decoder/lattice-faster-online-decoder.h"
+#include "lat/kaldi-lattice.h"
+#include "online/online-faster-decoder.h"
+
+namespace kaldi {
+
+struct OnlineLatticeDecoderOpts {
+  LatticeFasterDecoderConfig decoder_opts;
+  int32 batch_size; // number of features decoded in one go
+  int32 inter_utt_sil; // minimum silence (#frames) to trigger end of utterance
+  int32 max_utt_len_; // if utt. is longer, we accept shorter silence as utt. separators
+  int32 force_utt_len; // if > 0, utterances longer than this (#frames) are cut
+
+  OnlineLatticeDecoderOpts(): batch_size(27), inter_utt_sil(50),
+                              max_utt_len_(1500), force_utt_len(0) { }
+
+  void Register(OptionsItf *opts) {
+    decoder_opts.Register(opts);
+    opts->Register("inter-utt-sil", &inter_utt_sil,
+                   "Maximum # of silence frames to trigger new utterance");
+    opts->Register("max-utt-length", &max_utt_len_,
+                   "If the utterance becomes longer than this number of frames, "
+                   "shorter silence is acceptable as an utterance separator");
+    opts->Register("force-utt-length", &force_utt_len,
+                   "If > 0, the utterance is ended after this many frames, "
+                   "even if no silence was detected");
+  }
+};
+
+// The lattice-generating counterpart of OnlineFasterDecoder, with the same
+// Decode() contract: the input is decoded in batches, and an utterance is
+// ended whenever the best path ends with long enough silence.  Instead of a
+// linear 1-best FST, a pruned and determinized lattice is produced for every
+// utterance, so confidences can be computed or the utterance rescored without
+// a second pass.  The search itself is done by LatticeFasterOnlineDecoder,
+// which keeps per-frame token lists with forward links and prunes them every
+// "prune-interval" frames; the memory used for the determinization is bounded
+// by the "determinize-max-mem" option.
+class OnlineLatticeDecoder {
+ public:
+  typedef OnlineFasterDecoder::DecodeState DecodeState;
+
+  OnlineLatticeDecoder(const fst::Fst<fst::StdArc> &fst,
+                       const OnlineLatticeDecoderOpts &opts,
+                       const std::vector<int32> &sil_phones,
+                       const TransitionModel &trans_model);
+
+  DecodeState Decode(DecodableInterface *decodable);
+
+  // Outputs the determinized lattice of the utterance that has just ended,
+  // i.e. may only be called after Decode() returned kEndUtt or kEndFeats.
+  // The times in the lattice are relative to UtteranceStartFrame().  Returns
+  // false if the utterance is empty, or the determinization failed.
+  bool GetLattice(CompactLattice *clat);
+
+  // The number of arcs in the lattice before determinization, as of the last
+  // GetLattice() call.  These are the forward links that survived the pruning,
+  // so this is a measure of the memory the search needed for the utterance.
+  int64 NumRawLatticeArcs() const { return num_raw_arcs_; }
+
+  // Outputs the word ids and the transition ids on the best path of the
+  // current utterance, so far.  Returns false if nothing was decoded.
+  bool GetBestPath(std::vector<int32> *word_ids,
+                   std::vector<int32> *alignment);
+
+  // The first frame of the current utterance.
+  int32 UtteranceStartFrame() const { return utt_start_frame_; }
+
+  int32 frame() const { return frame_; }
+
+ private:
+  // Presents the frames of the current utterance to
+  // LatticeFasterOnlineDecoder, which counts frames from zero and needs to
+  // know how many frames are ready; the online decodables only tell whether a
+  // frame is the last one.
+  class UtteranceDecodable : public DecodableInterface {
+   public:
+    UtteranceDecodable(): decodable_(NULL), offset_(0), num_frames_ready_(0) { }
+    void Init(DecodableInterface *decodable, int32 offset,
+              int32 num_frames_ready) {
+      decodable_ = decodable;
+      offset_ = offset;
+      num_frames_ready_ = num_frames_ready;
+    }
+    virtual BaseFloat LogLikelihood(int32 frame, int32 index) {
+      return decodable_->LogLikelihood(frame + offset_, index);
+    }
+    virtual bool IsLastFrame(int32 frame) const {
+      return frame == num_frames_ready_ - 1;
+    }
+    virtual int32 NumFramesReady() const { return num_frames_ready_; }
+    virtual int32 NumIndices() const { return decodable_->NumIndices(); }
+   private:
+    DecodableInterface *decodable_;
+    int32 offset_;
+    int32 num_frames_ready_;
+  };
+
+  // Returns "true" if the current utterance should be ended here.
+  bool EndOfUtterance();
+
+  const OnlineLatticeDecoderOpts opts_;
+  const TransitionModel &trans_model_;
+  std::vector<bool> silence_tids_; // indexed by transition-id
+  LatticeFasterOnlineDecoder decoder_;
+  UtteranceDecodable utt_decodable_;
+  DecodeState state_;
+  int32 frame_; // the next frame to be processed
+  int32 utt_start_frame_; // the first frame of the current utterance
+  Lattice raw_lat_; // scratch space for the lattice before determinization
+  int64 num_raw_arcs_;
+
+  KALDI_DISALLOW_COPY_AND_ASSIGN(OnlineLatticeDecoder);
+};
+
+} // namespace kaldi
+
+#endif // KALDI_ONLINE_ONLINE_LATTICE_DECODER_H_
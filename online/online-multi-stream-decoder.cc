@@ -0,0 +1,170 @@
+// online/online-multi-stream-decoder.cc
+
+// See ../../COPYING for clarification regarding multiple authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//  http://www.apache.org/licenses/LICENSE-2.0
+//
+// THIS CODE IS PROVIDED *AS IS* BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, EITHER EXPRESS OR IMPLIED, INCLUDING WITHOUT LIMITATION ANY IMPLIED
+// WARRANTIES OR CONDITIONS OF TITLE, FITNESS FOR A PARTICULAR PURPOSE,
+// MERCHANTABLITY OR NON-INFRINGEMENT.
+// See the Apache 2 License for the specific language governing permissions and
+// limitations under the License.
+
+#include <algorithm>
+
+#include "base/timer.h"
+#include "online/online-multi-stream-decoder.h"
+
+namespace kaldi {
+
+OnlineMultiStreamDecoder::OnlineMultiStreamDecoder(
+    const fst::Fst<fst::StdArc> &fst,
+    const OnlineFasterDecoderOpts &decoder_opts,
+    const std::vector<int32> &sil_phones,
+    const TransitionModel &trans_model,
+    const OnlineMultiStreamDecoderOpts &opts,
+    const OnlineStackedGmm *stacked_gmm)
+    : fst_(fst), decoder_opts_(decoder_opts), sil_phones_(sil_phones),
+      trans_model_(trans_model), opts_(opts), stacked_gmm_(stacked_gmm),
+      num_streams_(0), num_rounds_(0), total_frames_(0), total_time_(0.0) {
+  KALDI_ASSERT(opts.max_streams > 0);
+  if (stacked_gmm_ != NULL)
+    pdf_column_.resize(stacked_gmm_->NumPdfs(), -1);
+}
+
+OnlineMultiStreamDecoder::~OnlineMultiStreamDecoder() {
+  for (size_t i = 0; i < streams_.size(); i++)
+    delete streams_[i].decoder;
+}
+
+int32 OnlineMultiStreamDecoder::AddStream(DecodableInterface *decodable) {
+  KALDI_ASSERT(decodable != NULL);
+  if (num_streams_ >= opts_.max_streams) {
+    KALDI_WARN << "Can not decode more than " << opts_.max_streams
+               << " streams at a time.";
+    return -1;
+  }
+  size_t id = 0;
+  while (id < streams_.size() && streams_[id].decoder != NULL)
+    id++;
+  if (id == streams_.size())
+    streams_.resize(id + 1);
+  Stream &stream = streams_[id];
+  stream.decoder = new OnlineFasterDecoder(fst_, decoder_opts_, sil_phones_,
+                                           trans_model_);
+  stream.decoder->InitDecoding();
+  stream.decodable = decodable;
+  stream.finished = false;
+  num_streams_++;
+  return static_cast<int32>(id);
+}
+
+int32 OnlineMultiStreamDecoder::AddStream(
+    OnlineDecodableDiagGmmScaled *decodable) {
+  int32 id = AddStream(static_cast<DecodableInterface*>(decodable));
+  if (id >= 0 && stacked_gmm_ != NULL &&
+      decodable->BatchStackedGmm() == stacked_gmm_)
+    streams_[id].gmm_decodable = decodable;
+  return id;
+}
+
+void OnlineMultiStreamDecoder::RemoveStream(int32 stream_id) {
+  KALDI_ASSERT(stream_id >= 0 && stream_id < streams_.size() &&
+               streams_[stream_id].decoder != NULL);
+  Stream &stream = streams_[stream_id];
+  delete stream.decoder;
+  stream = Stream();
+  num_streams_--;
+}
+
+OnlineFasterDecoder *OnlineMultiStreamDecoder::Decoder(int32 stream_id) {
+  KALDI_ASSERT(stream_id >= 0 && stream_id < streams_.size() &&
+               streams_[stream_id].decoder != NULL);
+  return streams_[stream_id].decoder;
+}
+
+int32 OnlineMultiStreamDecoder::DecodeRound(
+    std::vector<std::pair<int32, DecodeState> > *events) {
+  Timer timer;
+  ScoreStreams();
+  int32 num_frames = 0;
+  for (size_t i = 0; i < streams_.size(); i++) {
+    Stream &stream = streams_[i];
+    if (stream.decoder == NULL || stream.finished)
+      continue;
+    int32 start_frame = stream.decoder->frame();
+    DecodeState state = stream.decoder->Decode(stream.decodable, 1);
+    // A full reset, which sets frame() back to zero, only happens at the
+    // start of Decode(), so the difference is what we decoded in this round.
+    num_frames += stream.decoder->frame() - start_frame;
+    if (state == OnlineFasterDecoder::kEndStep)
+      continue;
+    if (state == OnlineFasterDecoder::kEndFeats)
+      stream.finished = true;
+    events->push_back(std::make_pair(static_cast<int32>(i), state));
+  }
+  total_time_ += timer.Elapsed();
+  total_frames_ += num_frames;
+  num_rounds_++;
+  if (opts_.stats_interval > 0 && num_rounds_ % opts_.stats_interval == 0)
+    KALDI_LOG << "Decoding " << num_streams_ << " streams at "
+              << FramesPerSecond() << " frames/sec";
+  return num_frames;
+}
+
+void OnlineMultiStreamDecoder::ScoreStreams() {
+  if (stacked_gmm_ == NULL)
+    return;
+  if (data_.NumRows() < static_cast<int32>(streams_.size()))
+    data_.Resize(streams_.size(), 2 * stacked_gmm_->Dim(), kUndefined);
+  int32 num_rows = 0;
+  pdfs_.clear();
+  for (size_t i = 0; i < streams_.size(); i++) {
+    Stream &stream = streams_[i];
+    stream.row = -1;
+    if (stream.gmm_decodable == NULL || stream.finished)
+      continue;
+    // The frame the decoder will decode next, if there is one.
+    int32 frame = stream.decoder->frame();
+    if (stream.gmm_decodable->IsLastFrame(frame - 1))
+      continue;
+    SubVector<BaseFloat> data(data_, num_rows);
+    const std::vector<int32> &pdfs =
+        stream.gmm_decodable->PrepareFrame(frame, &data);
+    for (size_t j = 0; j < pdfs.size(); j++) {
+      if (pdf_column_[pdfs[j]] < 0) {
+        pdf_column_[pdfs[j]] = pdfs_.size();
+        pdfs_.push_back(pdfs[j]);
+      }
+    }
+    stream.row = num_rows++;
+  }
+  for (size_t j = 0; j < pdfs_.size(); j++)
+    pdf_column_[pdfs_[j]] = -1;
+  if (pdfs_.empty())
+    return;
+
+  int32 num_pdfs = pdfs_.size();
+  if (loglikes_.NumRows() < num_rows || loglikes_.NumCols() < num_pdfs)
+    loglikes_.Resize(std::max(num_rows, loglikes_.NumRows()),
+                     std::max(num_pdfs, loglikes_.NumCols()), kUndefined);
+  SubMatrix<BaseFloat> loglikes(loglikes_, 0, num_rows, 0, num_pdfs);
+  stacked_gmm_->LogLikelihoods(data_.RowRange(0, num_rows), pdfs_,
+                               &gauss_loglikes_, &loglikes);
+  for (size_t i = 0; i < streams_.size(); i++) {
+    if (streams_[i].row >= 0)
+      streams_[i].gmm_decodable->CacheLogLikelihoods(
+          pdfs_, loglikes.Row(streams_[i].row));
+  }
+}
+
+double OnlineMultiStreamDecoder::FramesPerSecond() const {
+  return (total_time_ > 0.0 ? total_frames_ / total_time_ : 0.0);
+}
+
+} // namespace kaldi
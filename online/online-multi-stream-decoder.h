@@ -0,0 +1,146 @@
+// online/online-multi-stream-decoder.h
+
+// See ../../COPYING for clarification regarding multiple authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//  http://www.apache.org/licenses/LICENSE-2.0
+//
+// THIS CODE IS PROVIDED *AS IS* BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, EITHER EXPRESS OR IMPLIED, INCLUDING WITHOUT LIMITATION ANY IMPLIED
+// WARRANTIES OR CONDITIONS OF TITLE, FITNESS FOR A PARTICULAR PURPOSE,
+// MERCHANTABLITY OR NON-INFRINGEMENT.
+// See the Apache 2 License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef KALDI_ONLINE_ONLINE_MULTI_STREAM_DECODER_H_
+#define KALDI_ONLINE_ONLINE_MULTI_STREAM_DECODER_H_
+
+#include <utility>
+#include <vector>
+
+#include "online/online-decodable.h"
+#include "online/online-faster-decoder.h"
+#include "online/online-stacked-gmm.h"
+
+namespace kaldi {
+
+struct OnlineMultiStreamDecoderOpts {
+  int32 max_streams; // maximum number of concurrently decoded streams
+  int32 stats_interval; // throughput report period, in decoding rounds
+
+  OnlineMultiStreamDecoderOpts(): max_streams(100), stats_interval(1000) { }
+
+  void Register(OptionsItf *opts) {
+    opts->Register("max-streams", &max_streams,
+                   "Maximum number of streams decoded concurrently");
+    opts->Register("stats-interval", &stats_interval,
+                   "Report the decoding throughput every this many rounds, "
+                   "i.e. frames (0 disables the report)");
+  }
+};
+
+// Serves many concurrent utterances from a single thread.  Every stream has
+// its own OnlineFasterDecoder, i.e. its own token set, while the decoding
+// graph and the transition model are shared read-only by all of them.  The
+// streams advance together, one frame each per round, so that no stream can
+// starve the others.  The decoders still work in batches of "batch-size"
+// frames, and look for the end of the utterance at the same places as when
+// decoding a stream alone.
+// If the stacked Gaussians of the model are given, the streams added as
+// OnlineDecodableDiagGmmScaled objects that use them with --batch-pdfs are
+// scored together: on each round, the pdfs any of them requested on its
+// previous frame are scored for all of them, with one matrix-matrix product
+// per pdf.  The time this takes is not seen by the beam controllers of the
+// decoders.  The memory used by a stream is bounded by the "max-active"
+// option of the decoder.
+class OnlineMultiStreamDecoder {
+ public:
+  typedef OnlineFasterDecoder::DecodeState DecodeState;
+
+  OnlineMultiStreamDecoder(const fst::Fst<fst::StdArc> &fst,
+                           const OnlineFasterDecoderOpts &decoder_opts,
+                           const std::vector<int32> &sil_phones,
+                           const TransitionModel &trans_model,
+                           const OnlineMultiStreamDecoderOpts &opts,
+                           const OnlineStackedGmm *stacked_gmm = NULL);
+
+  ~OnlineMultiStreamDecoder();
+
+  // Starts decoding a new stream, taking scores from "decodable" (not owned,
+  // it has to outlive the stream).  Returns the id of the stream, or -1 if
+  // "max_streams" streams are already being decoded.
+  int32 AddStream(DecodableInterface *decodable);
+
+  // The same, but the pdfs of the stream are scored together with those of
+  // the other streams, if "decodable" uses the stacked Gaussians given to
+  // the constructor (see OnlineDecodableDiagGmmScaled::BatchStackedGmm()).
+  int32 AddStream(OnlineDecodableDiagGmmScaled *decodable);
+
+  // Stops decoding the stream; its id may be reused by AddStream().
+  void RemoveStream(int32 stream_id);
+
+  // Decodes one frame of every stream.  For each stream whose decoder
+  // reached an utterance or stream boundary, or the end of a batch, the pair
+  // (stream-id, state) is appended to "events", in the order of the stream
+  // ids.  Streams that reached kEndFeats are not decoded again until they are
+  // removed.  Returns the number of frames decoded.
+  int32 DecodeRound(std::vector<std::pair<int32, DecodeState> > *events);
+
+  // Gives access to the decoder of the stream, e.g. to get the tracebacks
+  // after DecodeRound() reported an event for it.
+  OnlineFasterDecoder *Decoder(int32 stream_id);
+
+  int32 NumStreams() const { return num_streams_; }
+
+  // Decoding throughput since the object was created, in frames per second of
+  // wall-clock time spent inside DecodeRound().
+  double FramesPerSecond() const;
+
+ private:
+  struct Stream {
+    OnlineFasterDecoder *decoder;
+    DecodableInterface *decodable;
+    // The same object, if it is scored together with the other streams.
+    OnlineDecodableDiagGmmScaled *gmm_decodable;
+    bool finished;
+    int32 row; // its row in "data_" on this round, or -1
+    Stream(): decoder(NULL), decodable(NULL), gmm_decodable(NULL),
+              finished(false), row(-1) { }
+  };
+
+  // Scores the pdfs of the streams that have a "gmm_decodable", for the
+  // frame they are about to decode, and caches them in the decodables.
+  void ScoreStreams();
+
+  const fst::Fst<fst::StdArc> &fst_;
+  OnlineFasterDecoderOpts decoder_opts_;
+  const std::vector<int32> sil_phones_;
+  const TransitionModel &trans_model_;
+  const OnlineMultiStreamDecoderOpts opts_;
+  const OnlineStackedGmm *stacked_gmm_;
+
+  std::vector<Stream> streams_; // indexed by stream id; unused slots have
+                                // decoder == NULL
+  int32 num_streams_;
+  int64 num_rounds_;
+  int64 total_frames_;
+  double total_time_; // seconds spent in DecodeRound()
+
+  // Used in ScoreStreams(): the data of the frames to score, one row per
+  // stream; the union of the pdfs to score; the column of each pdf in it,
+  // or -1, indexed by pdf; and scratch space for the likelihoods.
+  Matrix<BaseFloat> data_;
+  std::vector<int32> pdfs_;
+  std::vector<int32> pdf_column_;
+  Matrix<BaseFloat> loglikes_;
+  Matrix<BaseFloat> gauss_loglikes_;
+
+  KALDI_DISALLOW_COPY_AND_ASSIGN(OnlineMultiStreamDecoder);
+};
+
+} // namespace kaldi
+
+#endif // KALDI_ONLINE_ONLINE_MULTI_STREAM_DECODER_H_
@@ -0,0 +1,138 @@
+// online/online-stacked-gmm.cc
+
+// See ../../COPYING for clarification regarding multiple authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//  http://www.apache.org/licenses/LICENSE-2.0
+//
+// THIS CODE IS PROVIDED *AS IS* BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, EITHER EXPRESS OR IMPLIED, INCLUDING WITHOUT LIMITATION ANY IMPLIED
+// WARRANTIES OR CONDITIONS OF TITLE, FITNESS FOR A PARTICULAR PURPOSE,
+// MERCHANTABLITY OR NON-INFRINGEMENT.
+// See the Apache 2 License for the specific language governing permissions and
+// limitations under the License.
+
+
+#include <algorithm>
+
+#include "online/online-stacked-gmm.h"
+
+namespace kaldi {
+
+OnlineStackedGmm::OnlineStackedGmm(const AmDiagGmm &am_gmm,
+                                   int32 block_size) {
+  KALDI_ASSERT(block_size > 0);
+  int32 num_pdfs = am_gmm.NumPdfs(), dim = am_gmm.Dim(), num_gauss = 0;
+  pdf_offsets_.resize(num_pdfs + 1);
+  for (int32 pdf_id = 0; pdf_id < num_pdfs; pdf_id++) {
+    pdf_offsets_[pdf_id] = num_gauss;
+    num_gauss += am_gmm.GetPdf(pdf_id).NumGauss();
+  }
+  pdf_offsets_[num_pdfs] = num_gauss;
+
+  params_.Resize(num_gauss, 2 * dim, kUndefined);
+  gconsts_.Resize(num_gauss, kUndefined);
+  for (int32 pdf_id = 0; pdf_id < num_pdfs; pdf_id++) {
+    const DiagGmm &gmm = am_gmm.GetPdf(pdf_id);
+    int32 offset = pdf_offsets_[pdf_id], n = gmm.NumGauss();
+    params_.Range(offset, n, 0, dim).CopyFromMat(gmm.means_invvars());
+    SubMatrix<BaseFloat> inv_vars(params_, offset, n, dim, dim);
+    inv_vars.CopyFromMat(gmm.inv_vars());
+    inv_vars.Scale(-0.5);
+    gconsts_.Range(offset, n).CopyFromVec(gmm.gconsts());
+  }
+
+  for (int32 pdf_id = 0; pdf_id < num_pdfs; pdf_id++) {
+    if (block_starts_.empty() ||
+        pdf_offsets_[pdf_id + 1] - pdf_offsets_[block_starts_.back()] >
+        block_size)
+      block_starts_.push_back(pdf_id);
+  }
+  block_starts_.push_back(num_pdfs);
+}
+
+void OnlineStackedGmm::ComputeData(const VectorBase<BaseFloat> &feats,
+                                   VectorBase<BaseFloat> *data) const {
+  int32 dim = Dim();
+  KALDI_ASSERT(feats.Dim() == dim && data->Dim() == 2 * dim);
+  data->Range(0, dim).CopyFromVec(feats);
+  data->Range(dim, dim).CopyFromVec(feats);
+  data->Range(dim, dim).ApplyPow(2.0);
+}
+
+BaseFloat OnlineStackedGmm::LogLikelihood(
+    const VectorBase<BaseFloat> &data, int32 pdf_id,
+    Vector<BaseFloat> *gauss_loglikes) const {
+  int32 offset = pdf_offsets_[pdf_id], n = PdfNumGauss(pdf_id);
+  if (gauss_loglikes->Dim() < n)
+    gauss_loglikes->Resize(n, kUndefined);
+  SubVector<BaseFloat> loglikes(*gauss_loglikes, 0, n);
+  loglikes.CopyFromVec(gconsts_.Range(offset, n));
+  loglikes.AddMatVec(1.0, params_.RowRange(offset, n), kNoTrans, data, 1.0);
+  return loglikes.LogSumExp();
+}
+
+void OnlineStackedGmm::LogLikelihoods(
+    const MatrixBase<BaseFloat> &data, const std::vector<int32> &pdfs,
+    Matrix<BaseFloat> *gauss_loglikes, MatrixBase<BaseFloat> *loglikes) const {
+  int32 num_frames = data.NumRows();
+  KALDI_ASSERT(loglikes->NumRows() == num_frames &&
+               loglikes->NumCols() == static_cast<int32>(pdfs.size()));
+  for (size_t i = 0; i < pdfs.size(); i++) {
+    int32 offset = pdf_offsets_[pdfs[i]], n = PdfNumGauss(pdfs[i]);
+    if (gauss_loglikes->NumRows() < num_frames ||
+        gauss_loglikes->NumCols() < n)
+      gauss_loglikes->Resize(std::max(num_frames, gauss_loglikes->NumRows()),
+                             std::max(n, gauss_loglikes->NumCols()),
+                             kUndefined);
+    SubMatrix<BaseFloat> pdf_loglikes(*gauss_loglikes, 0, num_frames, 0, n);
+    pdf_loglikes.CopyRowsFromVec(gconsts_.Range(offset, n));
+    pdf_loglikes.AddMatMat(1.0, data, kNoTrans, params_.RowRange(offset, n),
+                           kTrans, 1.0);
+    for (int32 t = 0; t < num_frames; t++)
+      (*loglikes)(t, i) = pdf_loglikes.Row(t).LogSumExp();
+  }
+}
+
+void OnlineStackedGmm::LogLikelihoods(
+    const MatrixBase<BaseFloat> &data, Matrix<BaseFloat> *gauss_loglikes,
+    MatrixBase<BaseFloat> *loglikes) const {
+  int32 num_frames = data.NumRows();
+  KALDI_ASSERT(loglikes->NumRows() == num_frames &&
+               loglikes->NumCols() == NumPdfs());
+  for (size_t b = 0; b + 1 < block_starts_.size(); b++) {
+    int32 begin = block_starts_[b], end = block_starts_[b + 1],
+        block_offset = pdf_offsets_[begin],
+        n = pdf_offsets_[end] - block_offset;
+    if (gauss_loglikes->NumRows() < num_frames ||
+        gauss_loglikes->NumCols() < n)
+      gauss_loglikes->Resize(std::max(num_frames, gauss_loglikes->NumRows()),
+                             std::max(n, gauss_loglikes->NumCols()),
+                             kUndefined);
+    SubMatrix<BaseFloat> block_loglikes(*gauss_loglikes, 0, num_frames, 0, n);
+    block_loglikes.CopyRowsFromVec(gconsts_.Range(block_offset, n));
+    block_loglikes.AddMatMat(1.0, data, kNoTrans,
+                             params_.RowRange(block_offset, n), kTrans, 1.0);
+    for (int32 pdf_id = begin; pdf_id < end; pdf_id++) {
+      int32 offset = pdf_offsets_[pdf_id] - block_offset,
+          num_gauss = PdfNumGauss(pdf_id);
+      for (int32 t = 0; t < num_frames; t++)
+        (*loglikes)(t, pdf_id) =
+            block_loglikes.Row(t).Range(offset, num_gauss).LogSumExp();
+    }
+  }
+}
+
+bool OnlineStackedGmm::IsCompatible(const AmDiagGmm &am_gmm) const {
+  if (am_gmm.NumPdfs() != NumPdfs() || am_gmm.Dim() != Dim())
+    return false;
+  for (int32 pdf_id = 0; pdf_id < NumPdfs(); pdf_id++)
+    if (am_gmm.GetPdf(pdf_id).NumGauss() != PdfNumGauss(pdf_id))
+      return false;
+  return true;
+}
+
+} // namespace kaldi
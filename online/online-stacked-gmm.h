@@ -0,0 +1,99 @@
+// online/online-stacked-gmm.h
+
+// See ../../COPYING for clarification regarding multiple authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//  http://www.apache.org/licenses/LICENSE-2.0
+//
+// THIS CODE IS PROVIDED *AS IS* BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, EITHER EXPRESS OR IMPLIED, INCLUDING WITHOUT LIMITATION ANY IMPLIED
+// WARRANTIES OR CONDITIONS OF TITLE, FITNESS FOR A PARTICULAR PURPOSE,
+// MERCHANTABLITY OR NON-INFRINGEMENT.
+// See the Apache 2 License for the specific language governing permissions and
+// limitations under the License.
+
+
+#ifndef KALDI_ONLINE_ONLINE_STACKED_GMM_H_
+#define KALDI_ONLINE_ONLINE_STACKED_GMM_H_
+
+#include <vector>
+
+#include "base/kaldi-common.h"
+#include "gmm/am-diag-gmm.h"
+#include "matrix/kaldi-matrix.h"
+
+namespace kaldi {
+
+// The Gaussians of all the pdfs of an acoustic model, stacked so that many of
+// them can be evaluated with one matrix product.  For Gaussian i, with mean m
+// and inverse variance v, row i of Params() is [ m.*v, -0.5 v ]; multiplied
+// with the "data" [ x, x.^2 ] of a frame x, and added to Gconsts()(i), this
+// gives the log-likelihood of x.  The Gaussians of pdf p are the rows
+// [PdfOffset(p), PdfOffset(p) + PdfNumGauss(p)), i.e. they are numbered like
+// in OnlineGselectIndex.  The object is only read once it is built, so a
+// single one serves the decodables of all the streams decoded with the
+// model, from any number of threads.
+class OnlineStackedGmm {
+ public:
+  // "block_size" is the number of Gaussians scored together when all the
+  // pdfs are (see LogLikelihoods()); it bounds the size of the scratch space.
+  explicit OnlineStackedGmm(const AmDiagGmm &am_gmm, int32 block_size = 4096);
+
+  int32 NumPdfs() const { return pdf_offsets_.size() - 1; }
+  int32 NumGauss() const { return gconsts_.Dim(); }
+  int32 Dim() const { return params_.NumCols() / 2; }
+
+  int32 PdfOffset(int32 pdf_id) const { return pdf_offsets_[pdf_id]; }
+  int32 PdfNumGauss(int32 pdf_id) const {
+    return pdf_offsets_[pdf_id + 1] - pdf_offsets_[pdf_id];
+  }
+
+  const Matrix<BaseFloat> &Params() const { return params_; }
+  const Vector<BaseFloat> &Gconsts() const { return gconsts_; }
+
+  // Sets "data" to [ x, x.^2 ] for the features "feats".
+  void ComputeData(const VectorBase<BaseFloat> &feats,
+                   VectorBase<BaseFloat> *data) const;
+
+  // Outputs the log-likelihood of "pdf_id" for the frame whose data is
+  // "data".  "gauss_loglikes" is scratch space, resized as needed.
+  BaseFloat LogLikelihood(const VectorBase<BaseFloat> &data, int32 pdf_id,
+                          Vector<BaseFloat> *gauss_loglikes) const;
+
+  // Outputs in "loglikes", which has a row per row of "data" and a column
+  // per element of "pdfs", the log-likelihoods of the pdfs "pdfs" for the
+  // frames whose data are the rows of "data".  Each pdf costs one
+  // matrix-matrix product.  "gauss_loglikes" is scratch space, resized as
+  // needed.
+  void LogLikelihoods(const MatrixBase<BaseFloat> &data,
+                      const std::vector<int32> &pdfs,
+                      Matrix<BaseFloat> *gauss_loglikes,
+                      MatrixBase<BaseFloat> *loglikes) const;
+
+  // The same for all the pdfs: "loglikes" has a column per pdf.  The
+  // Gaussians are scored in blocks of whole pdfs, of about "block_size"
+  // Gaussians each, with one matrix-matrix product per block.
+  void LogLikelihoods(const MatrixBase<BaseFloat> &data,
+                      Matrix<BaseFloat> *gauss_loglikes,
+                      MatrixBase<BaseFloat> *loglikes) const;
+
+  // Checks that the Gaussians were stacked from a model with the same
+  // layout.
+  bool IsCompatible(const AmDiagGmm &am_gmm) const;
+
+ private:
+  Matrix<BaseFloat> params_;
+  Vector<BaseFloat> gconsts_;
+  std::vector<int32> pdf_offsets_; // NumPdfs() + 1 elements
+  std::vector<int32> block_starts_; // the first pdf of each block, and then
+                                    // NumPdfs()
+
+  KALDI_DISALLOW_COPY_AND_ASSIGN(OnlineStackedGmm);
+};
+
+} // namespace kaldi
+
+#endif // KALDI_ONLINE_ONLINE_STACKED_GMM_H_
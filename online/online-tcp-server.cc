@@ -0,0 +1,487 @@
+// online/online-tcp-server.cc
+
+// See ../../COPYING for clarification regarding multiple authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//  http://www.apache.org/licenses/LICENSE-2.0
+//
+// THIS CODE IS PROVIDED *AS IS* BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, EITHER EXPRESS OR IMPLIED, INCLUDING WITHOUT LIMITATION ANY IMPLIED
+// WARRANTIES OR CONDITIONS OF TITLE, FITNESS FOR A PARTICULAR PURPOSE,
+// MERCHANTABLITY OR NON-INFRINGEMENT.
+// See the Apache 2 License for the specific language governing permissions and
+// limitations under the License.
+
+#if !defined(_MSC_VER)
+
+#include <arpa/inet.h>
+#include <fcntl.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/uio.h>
+#include <unistd.h>
+#if defined(__linux__)
+#include <sys/epoll.h>
+#endif
+
+#include <algorithm>
+#include <cerrno>
+#include <climits>
+#include <cstring>
+
+#include "base/timer.h"
+#include "online/online-tcp-server.h"
+
+namespace kaldi {
+
+// Waits for any of a set of descriptors to become readable, and tells which
+// ones did by the pointers they were added with.
+class OnlineTcpServer::Poller {
+ public:
+  Poller();
+  ~Poller();
+  void Add(int32 desc, void *ptr);
+  void Remove(int32 desc);
+  // Waits for at most "timeout_ms" milliseconds.
+  void Wait(int32 timeout_ms, std::vector<void*> *ready);
+
+ private:
+#if defined(__linux__)
+  int32 epoll_desc_;
+  std::vector<struct epoll_event> events_;
+#else
+  std::vector<struct pollfd> fds_;
+  std::vector<void*> ptrs_;
+#endif
+};
+
+#if defined(__linux__)
+
+OnlineTcpServer::Poller::Poller(): events_(256) {
+  epoll_desc_ = epoll_create(256);
+  if (epoll_desc_ == -1)
+    KALDI_ERR << "epoll_create() failed: " << strerror(errno);
+}
+
+OnlineTcpServer::Poller::~Poller() { close(epoll_desc_); }
+
+void OnlineTcpServer::Poller::Add(int32 desc, void *ptr) {
+  struct epoll_event event;
+  memset(&event, 0, sizeof(event));
+  event.events = EPOLLIN;
+  event.data.ptr = ptr;
+  if (epoll_ctl(epoll_desc_, EPOLL_CTL_ADD, desc, &event) == -1)
+    KALDI_ERR << "epoll_ctl() failed: " << strerror(errno);
+}
+
+void OnlineTcpServer::Poller::Remove(int32 desc) {
+  struct epoll_event event; // ignored, but must not be NULL on old kernels
+  epoll_ctl(epoll_desc_, EPOLL_CTL_DEL, desc, &event);
+}
+
+void OnlineTcpServer::Poller::Wait(int32 timeout_ms,
+                                   std::vector<void*> *ready) {
+  ready->clear();
+  int ret = epoll_wait(epoll_desc_, &(events_[0]), events_.size(),
+                       timeout_ms);
+  for (int i = 0; i < ret; i++)
+    ready->push_back(events_[i].data.ptr);
+}
+
+#else
+
+OnlineTcpServer::Poller::Poller() { }
+
+OnlineTcpServer::Poller::~Poller() { }
+
+void OnlineTcpServer::Poller::Add(int32 desc, void *ptr) {
+  struct pollfd fd;
+  fd.fd = desc;
+  fd.events = POLLIN;
+  fd.revents = 0;
+  fds_.push_back(fd);
+  ptrs_.push_back(ptr);
+}
+
+void OnlineTcpServer::Poller::Remove(int32 desc) {
+  for (size_t i = 0; i < fds_.size(); i++) {
+    if (fds_[i].fd == desc) {
+      fds_[i] = fds_.back();
+      fds_.pop_back();
+      ptrs_[i] = ptrs_.back();
+      ptrs_.pop_back();
+      return;
+    }
+  }
+}
+
+void OnlineTcpServer::Poller::Wait(int32 timeout_ms,
+                                   std::vector<void*> *ready) {
+  ready->clear();
+  if (poll(&(fds_[0]), fds_.size(), timeout_ms) <= 0)
+    return;
+  for (size_t i = 0; i < fds_.size(); i++)
+    if (fds_[i].revents != 0)
+      ready->push_back(ptrs_[i]);
+}
+
+#endif
+
+static bool SetNonBlocking(int32 desc) {
+  int flags = fcntl(desc, F_GETFL, 0);
+  return flags != -1 && fcntl(desc, F_SETFL, flags | O_NONBLOCK) != -1;
+}
+
+OnlineTcpServer::OnlineTcpServer(const OnlineTcpServerOptions &opts,
+                                 BaseFloat samp_freq,
+                                 OnlineTcpSessionFactoryItf *factory):
+    opts_(opts), samp_freq_(samp_freq), factory_(factory), server_desc_(-1),
+    poller_(new Poller()), num_accepted_(0), stopping_(false),
+    max_queue_size_(0), busy_time_(0.0), samples_decoded_(0),
+    bytes_received_(0), decode_time_(0.0) {
+  KALDI_ASSERT(opts.num_workers > 0 && opts.max_connections > 0);
+  if (pipe(wake_pipe_) == -1 || !SetNonBlocking(wake_pipe_[0]) ||
+      !SetNonBlocking(wake_pipe_[1]))
+    KALDI_ERR << "Cannot create the wake-up pipe: " << strerror(errno);
+  poller_->Add(wake_pipe_[0], wake_pipe_);
+  for (int32 i = 0; i < opts.num_workers; i++)
+    workers_.push_back(std::thread(&OnlineTcpServer::WorkerLoop, this));
+}
+
+OnlineTcpServer::~OnlineTcpServer() {
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    stopping_ = true;
+  }
+  work_cond_.notify_all();
+  for (size_t i = 0; i < workers_.size(); i++)
+    workers_[i].join();
+  for (std::set<Connection*>::iterator it = connections_.begin();
+       it != connections_.end(); ++it) {
+    close((*it)->socket);
+    delete (*it)->session;
+    delete *it;
+  }
+  delete poller_;
+  close(wake_pipe_[0]);
+  close(wake_pipe_[1]);
+  if (server_desc_ != -1)
+    close(server_desc_);
+}
+
+bool OnlineTcpServer::Listen(int32 port) {
+  struct sockaddr_in h_addr;
+  memset(&h_addr, 0, sizeof(h_addr));
+  h_addr.sin_addr.s_addr = INADDR_ANY;
+  h_addr.sin_port = htons(port);
+  h_addr.sin_family = AF_INET;
+
+  server_desc_ = socket(AF_INET, SOCK_STREAM, 0);
+  if (server_desc_ == -1) {
+    KALDI_WARN << "Cannot create TCP socket!";
+    return false;
+  }
+  int32 flag = 1;
+  if (setsockopt(server_desc_, SOL_SOCKET, SO_REUSEADDR, &flag,
+                 sizeof(flag)) == -1) {
+    KALDI_WARN << "Cannot set socket options!";
+    return false;
+  }
+  if (bind(server_desc_, (struct sockaddr*) &h_addr, sizeof(h_addr)) == -1) {
+    KALDI_WARN << "Cannot bind to port: " << port << " (is it taken?)";
+    return false;
+  }
+  // Many clients may connect at once, so the backlog has to be long.
+  if (listen(server_desc_, SOMAXCONN) == -1 || !SetNonBlocking(server_desc_)) {
+    KALDI_WARN << "Cannot listen on port!";
+    return false;
+  }
+  poller_->Add(server_desc_, this);
+  KALDI_LOG << "TcpServer: Listening on port: " << port << " with "
+            << opts_.num_workers << " workers";
+  return true;
+}
+
+void OnlineTcpServer::Run() {
+  KALDI_ASSERT(server_desc_ != -1 && "Call Listen() first");
+  Timer timer;
+  double last_report = 0.0;
+  std::vector<void*> ready;
+  while (true) {
+    poller_->Wait(1000, &ready);
+    for (size_t i = 0; i < ready.size(); i++) {
+      if (ready[i] == this) {
+        AcceptConnections();
+      } else if (ready[i] == wake_pipe_) {
+        char buf[256];
+        while (read(wake_pipe_[0], buf, sizeof(buf)) > 0) { }
+      } else {
+        Connection *conn = static_cast<Connection*>(ready[i]);
+        bool full;
+        if (!conn->source.Receive(&full)) {
+          // The session will see the connection closed when it has done
+          // with the audio received so far.
+          poller_->Remove(conn->socket);
+          conn->receiving = false;
+        } else if (full) {
+          poller_->Remove(conn->socket);
+          conn->receiving = false;
+          std::lock_guard<std::mutex> lock(mutex_);
+          conn->paused = true;
+        }
+        Schedule(conn);
+      }
+    }
+    // Only done here, as "ready" may still point to the connections.
+    UpdateConnections();
+    double now = timer.Elapsed();
+    if (opts_.stats_interval > 0 && now - last_report >= opts_.stats_interval) {
+      ReportStats(now - last_report);
+      last_report = now;
+    }
+  }
+}
+
+void OnlineTcpServer::AcceptConnections() {
+  while (true) {
+    struct sockaddr_in addr;
+    socklen_t len = sizeof(addr);
+    int32 client_desc = accept(server_desc_, (struct sockaddr*) &addr, &len);
+    if (client_desc == -1) {
+      if (errno != EAGAIN && errno != EWOULDBLOCK && errno != EINTR &&
+          errno != ECONNABORTED)
+        KALDI_ERR << "accept() failed: " << strerror(errno);
+      return;
+    }
+    char ipstr[INET_ADDRSTRLEN];
+    inet_ntop(AF_INET, &addr.sin_addr, ipstr, sizeof(ipstr));
+    if (static_cast<int32>(connections_.size()) >= opts_.max_connections) {
+      KALDI_WARN << "TcpServer: Refused connection from " << ipstr << ": "
+                 << "already serving " << connections_.size();
+      close(client_desc);
+      continue;
+    }
+    int32 flag = 1; // the results are small, and should not wait
+    setsockopt(client_desc, IPPROTO_TCP, TCP_NODELAY, &flag, sizeof(flag));
+    if (!SetNonBlocking(client_desc)) {
+      KALDI_WARN << "TcpServer: Cannot set up connection from " << ipstr;
+      close(client_desc);
+      continue;
+    }
+    Connection *conn = new Connection(client_desc);
+    conn->session = factory_->NewSession(client_desc, &(conn->source));
+    connections_.insert(conn);
+    poller_->Add(client_desc, conn);
+    num_accepted_++;
+    KALDI_VLOG(1) << "TcpServer: Accepted connection from: " << ipstr;
+  }
+}
+
+void OnlineTcpServer::Schedule(Connection *conn) {
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (conn->state == Connection::kRunning) {
+      conn->again = true;
+      return;
+    }
+    if (conn->state != Connection::kIdle)
+      return;
+    conn->state = Connection::kQueued;
+    queue_.push_back(conn);
+    max_queue_size_ = std::max(max_queue_size_, queue_.size());
+  }
+  work_cond_.notify_one();
+}
+
+void OnlineTcpServer::UpdateConnections() {
+  // Both lists are taken at once: a connection may be resumed and then
+  // finish before we get here, but not the other way round.
+  std::vector<Connection*> resumed, finished;
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    resumed.swap(resumed_);
+    finished.swap(finished_);
+  }
+  for (size_t i = 0; i < resumed.size(); i++) {
+    poller_->Add(resumed[i]->socket, resumed[i]);
+    resumed[i]->receiving = true;
+  }
+  for (size_t i = 0; i < finished.size(); i++)
+    CloseConnection(finished[i]);
+}
+
+void OnlineTcpServer::CloseConnection(Connection *conn) {
+  if (conn->receiving)
+    poller_->Remove(conn->socket);
+  close(conn->socket);
+  delete conn->session;
+  connections_.erase(conn);
+  delete conn;
+  KALDI_VLOG(1) << "TcpServer: Client disconnected!";
+}
+
+void OnlineTcpServer::WorkerLoop() {
+  while (true) {
+    Connection *conn;
+    {
+      std::unique_lock<std::mutex> lock(mutex_);
+      while (!stopping_ && queue_.empty())
+        work_cond_.wait(lock);
+      if (stopping_)
+        return;
+      conn = queue_.front();
+      queue_.pop_front();
+      conn->state = Connection::kRunning;
+      conn->again = false;
+    }
+    Timer timer;
+    int64 samples_before = conn->source.TotalSamplesRead(),
+        bytes_before = conn->source.TotalBytesRead();
+    double decode_time_before = conn->source.DecodeTime();
+    bool more;
+    try {
+      more = conn->session->Process();
+    } catch(const std::exception &e) {
+      KALDI_WARN << "Closing connection after error: " << e.what();
+      more = false;
+    }
+    double elapsed = timer.Elapsed();
+    int64 num_samples = conn->source.TotalSamplesRead() - samples_before,
+        num_bytes = conn->source.TotalBytesRead() - bytes_before;
+    double decode_time = conn->source.DecodeTime() - decode_time_before;
+    bool wake = false;
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      busy_time_ += elapsed;
+      samples_decoded_ += num_samples;
+      bytes_received_ += num_bytes;
+      decode_time_ += decode_time;
+      if (!more) {
+        conn->state = Connection::kFinished;
+        finished_.push_back(conn);
+        wake = true;
+      } else {
+        if (conn->paused) { // the session has read the audio
+          conn->paused = false;
+          resumed_.push_back(conn);
+          wake = true;
+        }
+        if (conn->again) {
+          conn->state = Connection::kQueued;
+          queue_.push_back(conn);
+        } else {
+          conn->state = Connection::kIdle;
+        }
+      }
+    }
+    if (wake) {
+      char c = 0;
+      if (write(wake_pipe_[1], &c, 1) < 0) { } // full: Run() is waking anyway
+    }
+  }
+}
+
+void OnlineTcpServer::ReportStats(double elapsed) {
+  size_t queue_size, max_queue_size;
+  double busy_time;
+  int64 samples_decoded, bytes_received;
+  double decode_time;
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    queue_size = queue_.size();
+    max_queue_size = max_queue_size_;
+    busy_time = busy_time_;
+    samples_decoded = samples_decoded_;
+    bytes_received = bytes_received_;
+    decode_time = decode_time_;
+    max_queue_size_ = queue_size;
+    busy_time_ = 0.0;
+    samples_decoded_ = 0;
+    bytes_received_ = 0;
+    decode_time_ = 0.0;
+  }
+  double audio_time = samples_decoded / samp_freq_;
+  KALDI_LOG << "TcpServer: " << connections_.size() << " connections ("
+            << num_accepted_ << " accepted so far), work queue "
+            << queue_size << " (max " << max_queue_size << "), workers busy "
+            << (100.0 * busy_time / (elapsed * opts_.num_workers)) << "%, "
+            << audio_time << "s of audio decoded at RTF "
+            << (audio_time > 0.0 ? busy_time / audio_time : 0.0)
+            << "; received " << (bytes_received / elapsed / 1000.0)
+            << " kB/s, " << (audio_time > 0.0 ?
+                             bytes_received / audio_time / 1000.0 : 0.0)
+            << " kB per second of audio; decompressing it took "
+            << (busy_time > 0.0 ? 100.0 * decode_time / busy_time : 0.0)
+            << "% of the busy time";
+}
+
+// Writes all the data of "iov", whose pieces must not be empty, and which
+// it modifies; see WriteToSocket().
+static bool WriteAll(int32 socket, std::vector<struct iovec> *iov) {
+  // How long a client may keep its receive buffer full.
+  const int kWriteTimeoutMs = 10000;
+  size_t first = 0; // the first piece not fully written
+  while (first < iov->size()) {
+    int count = std::min<size_t>(iov->size() - first, IOV_MAX);
+    ssize_t ret = writev(socket, &((*iov)[first]), count);
+    if (ret > 0) {
+      // Skips what was written, which may end in the middle of a piece.
+      size_t num_written = ret;
+      while (num_written > 0 && num_written >= (*iov)[first].iov_len) {
+        num_written -= (*iov)[first].iov_len;
+        first++;
+      }
+      if (num_written > 0) {
+        (*iov)[first].iov_base =
+            static_cast<char*>((*iov)[first].iov_base) + num_written;
+        (*iov)[first].iov_len -= num_written;
+      }
+    } else if (ret < 0 && errno == EINTR) {
+      continue;
+    } else if (ret < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) {
+      struct pollfd fd;
+      fd.fd = socket;
+      fd.events = POLLOUT;
+      fd.revents = 0;
+      if (poll(&fd, 1, kWriteTimeoutMs) <= 0)
+        return false;
+    } else {
+      return false;
+    }
+  }
+  return true;
+}
+
+bool OnlineTcpServer::WriteToSocket(int32 socket, const char *data,
+                                    size_t num_bytes) {
+  std::vector<struct iovec> iov(num_bytes > 0 ? 1 : 0);
+  if (num_bytes > 0) {
+    iov[0].iov_base = const_cast<char*>(data);
+    iov[0].iov_len = num_bytes;
+  }
+  return WriteAll(socket, &iov);
+}
+
+bool OnlineTcpServer::WriteToSocket(int32 socket,
+                                    const std::vector<std::string> &pieces) {
+  std::vector<struct iovec> iov;
+  iov.reserve(pieces.size());
+  for (size_t i = 0; i < pieces.size(); i++) {
+    if (pieces[i].empty())
+      continue;
+    struct iovec piece;
+    piece.iov_base = const_cast<char*>(pieces[i].data());
+    piece.iov_len = pieces[i].size();
+    iov.push_back(piece);
+  }
+  return WriteAll(socket, &iov);
+}
+
+}  // namespace kaldi
+
+#endif // !defined(_MSC_VER)
@@ -0,0 +1,177 @@
+// online/online-tcp-server.h
+
+// See ../../COPYING for clarification regarding multiple authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//  http://www.apache.org/licenses/LICENSE-2.0
+//
+// THIS CODE IS PROVIDED *AS IS* BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, EITHER EXPRESS OR IMPLIED, INCLUDING WITHOUT LIMITATION ANY IMPLIED
+// WARRANTIES OR CONDITIONS OF TITLE, FITNESS FOR A PARTICULAR PURPOSE,
+// MERCHANTABLITY OR NON-INFRINGEMENT.
+// See the Apache 2 License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef KALDI_ONLINE_ONLINE_TCP_SERVER_H_
+#define KALDI_ONLINE_ONLINE_TCP_SERVER_H_
+
+#if !defined(_MSC_VER)
+
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <set>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "base/kaldi-common.h"
+#include "itf/options-itf.h"
+#include "online/online-tcp-source.h"
+
+namespace kaldi {
+
+struct OnlineTcpServerOptions {
+  int32 num_workers; // threads doing the decoding
+  int32 max_connections; // more are refused
+  BaseFloat stats_interval; // seconds between two reports; 0 for none
+
+  OnlineTcpServerOptions(): num_workers(4), max_connections(256),
+                            stats_interval(10.0) { }
+  void Register(OptionsItf *opts) {
+    opts->Register("num-workers", &num_workers,
+                   "Number of threads decoding the connections");
+    opts->Register("max-connections", &max_connections,
+                   "Maximum number of connections served at once");
+    opts->Register("server-stats-interval", &stats_interval,
+                   "Report the connections, the real-time factor and the "
+                   "work queue every this many seconds (0 disables it)");
+  }
+};
+
+// What the server does with one connection, e.g. decoding its audio.
+class OnlineTcpSessionItf {
+ public:
+  // Called on one of the worker threads whenever audio arrives on the
+  // connection, or the client closes it, but never while another call for
+  // the same session is running.  Does all the work the audio received so
+  // far allows, without waiting for more, and returns false once the session
+  // is over; the connection is then closed.
+  virtual bool Process() = 0;
+
+  virtual ~OnlineTcpSessionItf() { }
+};
+
+class OnlineTcpSessionFactoryItf {
+ public:
+  // Creates the session of a new connection.  Its audio is read from
+  // "source", and the results are written to "socket" with
+  // WriteToSocket(); neither is owned.
+  virtual OnlineTcpSessionItf *NewSession(int32 socket,
+                                          OnlineTcpVectorSource *source) = 0;
+
+  virtual ~OnlineTcpSessionFactoryItf() { }
+};
+
+// A TCP server that serves many connections at once.  One thread, the one
+// calling Run(), accepts the connections and receives their audio, waiting
+// for all the sockets at once (with epoll on Linux, poll() elsewhere).  The
+// sessions are run by a fixed pool of worker threads: a connection on which
+// audio arrived is put on a queue, and the first free worker calls its
+// session's Process().  A connection whose audio buffer is full is not
+// read from until its session has made room, so TCP slows the client down to
+// the speed of the decoding.  So, provided the sessions share what they only
+// read (models, decoding graph), the number of connections is bounded by
+// memory and the decoding speed, not by the number of threads.
+class OnlineTcpServer {
+ public:
+  // "samp_freq" is only used to work out the real-time factor.
+  OnlineTcpServer(const OnlineTcpServerOptions &opts, BaseFloat samp_freq,
+                  OnlineTcpSessionFactoryItf *factory);
+
+  // Stops the workers, once they are done with the sessions they are in,
+  // and closes all the connections.
+  ~OnlineTcpServer();
+
+  // Returns false, with a warning, if it cannot listen on "port".
+  bool Listen(int32 port);
+
+  // Serves the connections, for ever; an error of the listening socket is
+  // raised with KALDI_ERR.
+  void Run();
+
+  // Writes all of "data" to "socket", waiting for room if the socket is in
+  // non-blocking mode and its buffer is full.  Returns false if the
+  // connection is closed, or the client has not taken any of the data for
+  // too long.  May be called from any thread.
+  static bool WriteToSocket(int32 socket, const char *data, size_t num_bytes);
+
+  // The same, for several pieces of data written one after the other, with
+  // as few system calls as possible (writev()), so that a batch of results
+  // goes out at once, in as few TCP segments as possible.
+  static bool WriteToSocket(int32 socket,
+                            const std::vector<std::string> &pieces);
+
+ private:
+  class Poller;
+
+  struct Connection {
+    enum State { kIdle, kQueued, kRunning, kFinished };
+    int32 socket;
+    OnlineTcpVectorSource source;
+    OnlineTcpSessionItf *session;
+    State state; // protected by mutex_
+    bool again; // audio arrived while kRunning; protected by mutex_
+    bool paused; // not read from until the session makes room; ditto
+    bool receiving; // the socket is being polled; only used by Run()
+    explicit Connection(int32 sock): socket(sock), source(sock),
+                                     session(NULL), state(kIdle),
+                                     again(false), paused(false),
+                                     receiving(true) { }
+  };
+
+  void AcceptConnections();
+  // Puts "conn" on the work queue, unless it is already there or running.
+  void Schedule(Connection *conn);
+  // Polls again the connections whose sessions made room for more audio,
+  // and closes those whose sessions are over.
+  void UpdateConnections();
+  void CloseConnection(Connection *conn);
+  void WorkerLoop(); // the body of the worker threads
+  void ReportStats(double elapsed);
+
+  const OnlineTcpServerOptions opts_;
+  const BaseFloat samp_freq_;
+  OnlineTcpSessionFactoryItf *factory_;
+  int32 server_desc_;
+  int32 wake_pipe_[2]; // the workers wake Run() with it
+  Poller *poller_;
+  std::set<Connection*> connections_; // only used by Run()
+  int64 num_accepted_;
+
+  std::mutex mutex_; // protects what follows
+  std::condition_variable work_cond_;
+  std::deque<Connection*> queue_;
+  std::vector<Connection*> resumed_;
+  std::vector<Connection*> finished_;
+  bool stopping_;
+  // For the statistics, since the last report:
+  size_t max_queue_size_;
+  double busy_time_; // seconds spent by the workers in the sessions
+  int64 samples_decoded_;
+  int64 bytes_received_;
+  double decode_time_; // seconds spent decompressing the audio
+
+  std::vector<std::thread> workers_; // the last member, started last
+
+  KALDI_DISALLOW_COPY_AND_ASSIGN(OnlineTcpServer);
+};
+
+}  // namespace kaldi
+
+#endif // !defined(_MSC_VER)
+
+#endif // KALDI_ONLINE_ONLINE_TCP_SERVER_H_
@@ -1,157 +1,330 @@
-// online/online-tcp-source.cc
-
-// Copyright 2013 Polish-Japanese Institute of Information Technology (author: Danijel Korzinek)
-
-// See ../../COPYING for clarification regarding multiple authors
-//
-// Licensed under the Apache License, Version 2.0 (the "License");
-// you may not use this file except in compliance with the License.
-// You may obtain a copy of the License at
-//
-//  http://www.apache.org/licenses/LICENSE-2.0
-//
-// THIS CODE IS PROVIDED *AS IS* BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
-// KIND, EITHER EXPRESS OR IMPLIED, INCLUDING WITHOUT LIMITATION ANY IMPLIED
-// WARRANTIES OR CONDITIONS OF TITLE, FITNESS FOR A PARTICULAR PURPOSE,
-// MERCHANTABLITY OR NON-INFRINGEMENT.
-// See the Apache 2 License for the specific language governing permissions and
-// limitations under the License.
-
-#if !defined(_MSC_VER)
-
-#include "online-tcp-source.h"
-#include <unistd.h>
-
-namespace kaldi {
-
-typedef kaldi::int32 int32;
-
-OnlineTcpVectorSource::OnlineTcpVectorSource(int32 socket)
-    : socket_desc(socket),
-      connected(true),
-      pack_size(512),
-      frame_size(512),
-      last_pack_size(0),
-      last_pack_rem(0),
-      samples_processed(0) {
-  pack = new char[pack_size];
-  frame = new char[frame_size];
-}
-
-OnlineTcpVectorSource::~OnlineTcpVectorSource() {
-  delete[] pack;
-  delete[] frame;
-}
-
-size_t OnlineTcpVectorSource::SamplesProcessed() {
-  return samples_processed;
-}
-void OnlineTcpVectorSource::ResetSamples() {
-  samples_processed = 0;
-}
-
-bool OnlineTcpVectorSource::ReadFull(char* buf, int32 len) {
-  int32 to_read = len;
-  int32 has_read = 0;
-  int32 ret;
-
-  while (to_read > 0) {
-    ret = read(socket_desc, buf + has_read, to_read);
-    if (ret <= 0) {
-      connected = false;
-      return false;
-    }
-    to_read -= ret;
-    has_read += ret;
-  }
-
-  return true;
-}
-
-int OnlineTcpVectorSource::GetNextPack() {
-  int32 size = 0;
-  if (!ReadFull((char*) &size, 4))
-    return 0;
-
-  if (size % 2 != 0) {
-    KALDI_ERR << "TCPVectorSource: Pack size must be even!";
-    return 0;
-  }
-
-  if (pack_size < size) {
-    pack_size = size;
-    delete[] pack;
-    pack = new char[pack_size];
-  }
-
-  if (!ReadFull(pack, size))
-    return 0;
-
-  return size;
-}
-
-int OnlineTcpVectorSource::FillFrame(int32 get_size) {
-  int32 frame_offset = 0;
-  if (last_pack_rem > 0) {
-    int pack_offset = last_pack_size - last_pack_rem;
-    int size = last_pack_rem < get_size ? last_pack_rem : get_size;
-
-    memcpy(frame, pack + pack_offset, size);
-
-    last_pack_rem -= size;
-    get_size -= size;
-    frame_offset += size;
-  }
-
-  while (get_size > 0) {
-    int32 ret = GetNextPack();
-
-    if (ret == 0)
-      return frame_offset;
-
-    int32 size = ret < get_size ? ret : get_size;
-
-    memcpy(frame + frame_offset, pack, size);
-
-    last_pack_size = ret;
-    last_pack_rem = last_pack_size - size;
-    get_size -= size;
-    frame_offset += size;
-  }
-
-  return frame_offset;
-}
-
-bool OnlineTcpVectorSource::Read(Vector<BaseFloat> *data) {
-  if (!connected)
-    return false;
-
-  int32 n_elem = static_cast<uint32>(data->Dim());
-
-  int32 n_bytes = n_elem * 2;
-
-  if (frame_size < n_bytes) {
-    frame_size = n_bytes;
-    delete[] frame;
-    frame = new char[frame_size];
-  }
-
-  int32 b_read = FillFrame(n_bytes);
-  int32 n_read = b_read / 2;
-
-  short* s_frame = (short*) frame;
-  for (int32 i = 0; i < n_read; i++)
-    (*data)(i) = s_frame[i];
-
-  samples_processed += n_read;
-
-  return (n_read == n_elem);
-}
-
-bool OnlineTcpVectorSource::IsConnected() {
-  return connected;
-}
-
-}  // namespace kaldi
-
-#endif // !defined(_MSC_VER)
+// online/online-tcp-source.cc
+
+// Copyright 2013 Polish-Japanese Institute of Information Technology (author: Danijel Korzinek)
+
+// See ../../COPYING for clarification regarding multiple authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//  http://www.apache.org/licenses/LICENSE-2.0
+//
+// THIS CODE IS PROVIDED *AS IS* BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, EITHER EXPRESS OR IMPLIED, INCLUDING WITHOUT LIMITATION ANY IMPLIED
+// WARRANTIES OR CONDITIONS OF TITLE, FITNESS FOR A PARTICULAR PURPOSE,
+// MERCHANTABLITY OR NON-INFRINGEMENT.
+// See the Apache 2 License for the specific language governing permissions and
+// limitations under the License.
+
+#if !defined(_MSC_VER)
+
+#include "online-tcp-source.h"
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <string>
+#include <fcntl.h>
+#include <sys/uio.h>
+#include <unistd.h>
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+#include "base/timer.h"
+
+namespace kaldi {
+
+typedef kaldi::int32 int32;
+
+// Packets larger than this are taken as garbage, not audio.
+static const int32 kMaxPacketSize = 1 << 24;
+// The size a client asks for a codec with.
+static const int32 kCodecRequest = -1;
+
+const char *OnlineTcpCodecName(int32 codec) {
+  switch (codec) {
+    case kTcpCodecPcm: return "PCM";
+    case kTcpCodecSpeex: return "SPEEX";
+    default: return "UNKNOWN";
+  }
+}
+
+OnlineTcpVectorSource::OnlineTcpVectorSource(int32 socket, int32 buffer_size)
+    : socket_desc(socket),
+      ring_(RoundUpToNearestPowerOfTwo(std::max(buffer_size, 1024))),
+      ring_mask_(ring_.size() - 1),
+      bytes_written_(0),
+      bytes_read_(0),
+      connected(true),
+      samples_processed(0),
+      total_samples_(0),
+      packet_left_(0),
+      stream_ended_(false),
+      decoder_(NULL),
+      compressed_(false),
+      decoded_offset_(0),
+      decode_time_(0.0) {
+  int flags = fcntl(socket, F_GETFL, 0);
+  blocking_ = (flags == -1 || (flags & O_NONBLOCK) == 0);
+}
+
+size_t OnlineTcpVectorSource::SamplesProcessed() {
+  return samples_processed;
+}
+void OnlineTcpVectorSource::ResetSamples() {
+  samples_processed = 0;
+}
+
+int64 OnlineTcpVectorSource::TotalSamplesRead() {
+  return total_samples_;
+}
+
+int64 OnlineTcpVectorSource::TotalBytesRead() {
+  return bytes_read_;
+}
+
+double OnlineTcpVectorSource::DecodeTime() {
+  return decode_time_;
+}
+
+void OnlineTcpVectorSource::SetDecoder(OnlineTcpAudioDecoderItf *decoder) {
+  decoder_ = decoder;
+}
+
+int32 OnlineTcpVectorSource::Fill() {
+  int64 written = bytes_written_, size = ring_.size(),
+      room = size - (written - bytes_read_);
+  if (room == 0)
+    return 0;
+  // The free part of the ring may wrap around its end; one readv() fills
+  // both pieces.
+  int64 start = written & ring_mask_,
+      first = std::min(room, size - start);
+  struct iovec iov[2];
+  iov[0].iov_base = &(ring_[start]);
+  iov[0].iov_len = first;
+  iov[1].iov_base = &(ring_[0]);
+  iov[1].iov_len = room - first;
+  while (true) {
+    ssize_t ret = readv(socket_desc, iov, (room > first ? 2 : 1));
+    if (ret > 0) {
+      bytes_written_ = written + ret;
+      return ret;
+    }
+    if (ret < 0 && errno == EINTR)
+      continue;
+    if (ret == 0 || (errno != EAGAIN && errno != EWOULDBLOCK))
+      connected = false;
+    return -1;
+  }
+}
+
+bool OnlineTcpVectorSource::Receive(bool *full) {
+  KALDI_ASSERT(!blocking_ && "Receive() is for sockets in non-blocking mode");
+  *full = false;
+  while (true) {
+    int32 ret = Fill();
+    if (ret == 0) {
+      *full = true;
+      return true;
+    }
+    if (ret < 0)
+      return connected;
+  }
+}
+
+void OnlineTcpVectorSource::CopyOut(int64 pos, int32 num_bytes,
+                                    char *dest) const {
+  int64 start = pos & ring_mask_,
+      first = std::min<int64>(num_bytes, ring_.size() - start);
+  memcpy(dest, &(ring_[start]), first);
+  memcpy(dest + first, &(ring_[0]), num_bytes - first);
+}
+
+// Converts 16-bit samples; eight at a time with SSE2, for single precision.
+static void ConvertSamples(const int16 *src, int32 num_samples, float *dest) {
+  int32 i = 0;
+#if defined(__SSE2__)
+  for (; i + 8 <= num_samples; i += 8) {
+    __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + i));
+    // Each sample goes to the top half of a 32-bit lane, and the arithmetic
+    // shift brings it down with its sign.
+    __m128i lo = _mm_srai_epi32(_mm_unpacklo_epi16(v, v), 16),
+        hi = _mm_srai_epi32(_mm_unpackhi_epi16(v, v), 16);
+    _mm_storeu_ps(dest + i, _mm_cvtepi32_ps(lo));
+    _mm_storeu_ps(dest + i + 4, _mm_cvtepi32_ps(hi));
+  }
+#endif
+  for (; i < num_samples; i++)
+    dest[i] = src[i];
+}
+
+static void ConvertSamples(const int16 *src, int32 num_samples,
+                           double *dest) {
+  for (int32 i = 0; i < num_samples; i++)
+    dest[i] = src[i];
+}
+
+void OnlineTcpVectorSource::SelectCodec(int32 codec) {
+  compressed_ = (codec != kTcpCodecPcm && decoder_ != NULL &&
+                 decoder_->Codec() == codec);
+  int32 selected = (compressed_ ? codec : kTcpCodecPcm);
+  KALDI_VLOG(1) << "The client asked for codec " << OnlineTcpCodecName(codec)
+                << ", using " << OnlineTcpCodecName(selected);
+  // The first thing written to the connection, so the socket has room for
+  // it even in non-blocking mode.
+  std::string reply = std::string("CODEC:") + OnlineTcpCodecName(selected)
+      + "\n";
+  size_t written = 0;
+  while (written < reply.size()) {
+    ssize_t ret = write(socket_desc, reply.data() + written,
+                        reply.size() - written);
+    if (ret > 0)
+      written += ret;
+    else if (ret < 0 && errno == EINTR)
+      continue;
+    else
+      KALDI_ERR << "TCPVectorSource: could not answer the codec request";
+  }
+}
+
+bool OnlineTcpVectorSource::Read(Vector<BaseFloat> *data) {
+  int32 num_read;
+  bool ans = ReadInto(data, &num_read);
+  if (num_read < data->Dim())
+    data->Resize(num_read, kCopyData);
+  return ans;
+}
+
+bool OnlineTcpVectorSource::ReadInto(VectorBase<BaseFloat> *data,
+                                     int32 *num_read) {
+  int32 n_elem = data->Dim(), n_read = 0;
+  BaseFloat *out = data->Data();
+  int64 read = bytes_read_;
+  bool closed_at_end = false;
+  while (n_read < n_elem && !stream_ended_) {
+    // The samples decoded from compressed packets come first.
+    if (decoded_offset_ < decoded_.Dim()) {
+      int32 n = std::min(n_elem - n_read, decoded_.Dim() - decoded_offset_);
+      memcpy(out + n_read, decoded_.Data() + decoded_offset_,
+             n * sizeof(BaseFloat));
+      n_read += n;
+      decoded_offset_ += n;
+      continue;
+    }
+    // "connected" is looked at before the count of bytes written, which is
+    // final once the connection is closed.
+    bool closed = !connected;
+    int64 available = bytes_written_ - read;
+    if (packet_left_ == 0 && available >= 4) {
+      int32 size;
+      CopyOut(read, 4, reinterpret_cast<char*>(&size));
+      if (size != kCodecRequest) {
+        read += 4;
+        if (size < 0 || size > kMaxPacketSize ||
+            (!compressed_ && size % 2 != 0)) {
+          bytes_read_ = read;
+          KALDI_ERR << "TCPVectorSource: Invalid pack size " << size
+                    << (compressed_ ? "" : " (it must be even)");
+        }
+        if (size == 0) {
+          stream_ended_ = true;
+          if (compressed_)
+            decoder_->Reset();
+        }
+        packet_left_ = size;
+        continue;
+      }
+      if (read != 0) {
+        bytes_read_ = read;
+        KALDI_ERR << "TCPVectorSource: the codec can only be chosen before "
+                  << "the first packet";
+      }
+      if (available >= 8) {
+        int32 codec;
+        CopyOut(read + 4, 4, reinterpret_cast<char*>(&codec));
+        read += 8;
+        bytes_read_ = read;
+        SelectCodec(codec);
+        continue;
+      }
+    }
+    if (compressed_ && packet_left_ > 0 && available > 0) {
+      // Whatever has arrived of the packet is decoded, so that the samples
+      // are ready as soon as possible.
+      int32 num_bytes = std::min<int64>(packet_left_, available);
+      packet_data_.resize(num_bytes);
+      CopyOut(read, num_bytes, &(packet_data_[0]));
+      packet_left_ -= num_bytes;
+      read += num_bytes;
+      bytes_read_ = read;
+      Timer timer;
+      decoder_->Decode(&(packet_data_[0]), num_bytes, &decoded_);
+      decode_time_ += timer.Elapsed();
+      decoded_offset_ = 0;
+      continue;
+    }
+    // The packets hold whole samples, so a sample never straddles the end
+    // of the ring, whose size is even.
+    int32 num_bytes = std::min<int64>(std::min<int64>(packet_left_, available),
+                                      2 * (n_elem - n_read)) & ~1;
+    if (!compressed_ && num_bytes > 0) {
+      int64 start = read & ring_mask_,
+          first = std::min<int64>(num_bytes, ring_.size() - start);
+      ConvertSamples(reinterpret_cast<const int16*>(&(ring_[start])),
+                     first / 2, out + n_read);
+      ConvertSamples(reinterpret_cast<const int16*>(&(ring_[0])),
+                     (num_bytes - first) / 2, out + n_read + first / 2);
+      n_read += num_bytes / 2;
+      packet_left_ -= num_bytes;
+      read += num_bytes;
+      bytes_read_ = read; // gives the room back to the writer
+      continue;
+    }
+    // Nothing more can be read from what has been received.
+    if (closed) {
+      closed_at_end = true;
+      break;
+    }
+    if (!blocking_)
+      break;
+    bytes_read_ = read;
+    if (Fill() == 0)
+      break;
+    // If the connection was just closed, the next round finds out.
+  }
+  bytes_read_ = read;
+
+  samples_processed += n_read;
+  total_samples_ += n_read;
+  *num_read = n_read;
+  // A closed connection ends the stream once all it sent has been read.
+  return !(stream_ended_ || closed_at_end);
+}
+
+bool OnlineTcpVectorSource::HasInput() {
+  if (stream_ended_ || decoded_offset_ < decoded_.Dim())
+    return true;
+  // A partial header or sample is not enough to go on with.
+  int64 read = bytes_read_, available = bytes_written_ - read;
+  if (packet_left_ > 0)
+    return available >= (compressed_ ? 1 : 2);
+  if (available < 4)
+    return false;
+  int32 size;
+  CopyOut(read, 4, reinterpret_cast<char*>(&size));
+  return size != kCodecRequest || available >= 8;
+}
+
+void OnlineTcpVectorSource::NextStream() {
+  stream_ended_ = false;
+}
+
+bool OnlineTcpVectorSource::IsConnected() {
+  return connected;
+}
+
+}  // namespace kaldi
+
+#endif // !defined(_MSC_VER)
@@ -1,76 +1,179 @@
-// online/online-tcp-source.h
-
-// Copyright 2013 Polish-Japanese Institute of Information Technology (author: Danijel Korzinek)
-
-// See ../../COPYING for clarification regarding multiple authors
-//
-// Licensed under the Apache License, Version 2.0 (the "License");
-// you may not use this file except in compliance with the License.
-// You may obtain a copy of the License at
-//
-//  http://www.apache.org/licenses/LICENSE-2.0
-//
-// THIS CODE IS PROVIDED *AS IS* BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
-// KIND, EITHER EXPRESS OR IMPLIED, INCLUDING WITHOUT LIMITATION ANY IMPLIED
-// WARRANTIES OR CONDITIONS OF TITLE, FITNESS FOR A PARTICULAR PURPOSE,
-// MERCHANTABLITY OR NON-INFRINGEMENT.
-// See the Apache 2 License for the specific language governing permissions and
-// limitations under the License.
-
-#ifndef KALDI_ONLINE_ONLINE_TCP_SOURCE_H_
-#define KALDI_ONLINE_ONLINE_TCP_SOURCE_H_
-
-#if !defined(_MSC_VER)
-
-#include "online-audio-source.h"
-#include "matrix/kaldi-vector.h"
-
-namespace kaldi {
-/*
- * This class implements a VectorSource that reads audio data in a special format from a socket descriptor.
- *
- * The documentation and "interface" for this class is given in online-audio-source.h
- */
-class OnlineTcpVectorSource : public OnlineAudioSourceItf {
- public:
-  OnlineTcpVectorSource(int32 socket);
-  ~OnlineTcpVectorSource();
-
-  // Implementation of the OnlineAudioSourceItf
-  bool Read(Vector<BaseFloat> *data);
-
-  //returns if the socket is still connected
-  bool IsConnected();
-
-  //returns the number of samples read since the last reset
-  size_t SamplesProcessed();
-  //resets the number of samples
-  void ResetSamples();
-
- private:
-  int32 socket_desc;
-  bool connected;
-  char* pack;
-  int32 pack_size;
-  char* frame;
-  int32 frame_size;
-
-  int32 last_pack_size, last_pack_rem;
-
-  size_t samples_processed;
-
-  //runs the built-in "read" method as many times as needed to fill "buf" with "len" bytes
-  bool ReadFull(char* buf, int32 len);
-  //gets the next packet of bytes and returns its size
-  int32 GetNextPack();
-  //runs "getNextPack" enough times to fill the frame with "size" bytes
-  int32 FillFrame(int32 size);
-
-  KALDI_DISALLOW_COPY_AND_ASSIGN(OnlineTcpVectorSource);
-};
-
-}  // namespace kaldi
-
-#endif // !defined(_MSC_VER)
-
-#endif // KALDI_ONLINE_ONLINE_TCP_SOURCE_H_
+// online/online-tcp-source.h
+
+// Copyright 2013 Polish-Japanese Institute of Information Technology (author: Danijel Korzinek)
+
+// See ../../COPYING for clarification regarding multiple authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//  http://www.apache.org/licenses/LICENSE-2.0
+//
+// THIS CODE IS PROVIDED *AS IS* BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, EITHER EXPRESS OR IMPLIED, INCLUDING WITHOUT LIMITATION ANY IMPLIED
+// WARRANTIES OR CONDITIONS OF TITLE, FITNESS FOR A PARTICULAR PURPOSE,
+// MERCHANTABLITY OR NON-INFRINGEMENT.
+// See the Apache 2 License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef KALDI_ONLINE_ONLINE_TCP_SOURCE_H_
+#define KALDI_ONLINE_ONLINE_TCP_SOURCE_H_
+
+#if !defined(_MSC_VER)
+
+#include <atomic>
+#include <vector>
+
+#include "online-audio-source.h"
+#include "matrix/kaldi-vector.h"
+
+namespace kaldi {
+
+// The codecs the audio may be sent with (see below).
+enum OnlineTcpCodec {
+  kTcpCodecPcm = 0, // 16-bit samples, the default
+  kTcpCodecSpeex = 1 // Speex frames, see online2/online-speex-wrapper.h
+};
+
+// Decodes the audio of a connection that sends it compressed.
+class OnlineTcpAudioDecoderItf {
+ public:
+  // The codec it decodes, one of OnlineTcpCodec.
+  virtual int32 Codec() const = 0;
+
+  // Decodes the next "num_bytes" bytes of the stream into "samples", scaled
+  // like 16-bit ones.  The bytes need not hold whole codec frames: what is
+  // left of a frame is kept for the next call.
+  virtual void Decode(const char *data, int32 num_bytes,
+                      Vector<BaseFloat> *samples) = 0;
+
+  // Called at the end of each stream, to start the next one afresh.
+  virtual void Reset() = 0;
+
+  virtual ~OnlineTcpAudioDecoderItf() { }
+};
+
+// The name of "codec" in the answer to a codec request, e.g. "SPEEX".
+const char *OnlineTcpCodecName(int32 codec);
+
+/*
+ * This class implements a VectorSource that reads audio data in a special format from a socket descriptor.
+ *
+ * The format is a sequence of packets, each a 4-byte size followed by that
+ * many bytes of 16-bit samples; an empty packet ends a stream (the client
+ * sends one after every file), and other streams may follow on the same
+ * connection.
+ *
+ * The client may instead ask for the audio to be sent compressed, before the
+ * first packet of the connection: it sends a 4-byte -1 followed by the
+ * 4-byte code of the codec (OnlineTcpCodec), and waits for the line
+ * "CODEC:<name>" written back, with the name of the codec the packets are to
+ * be in from then on ("PCM" if the one asked for is not available).  The
+ * packets are then of any size, and an empty one still ends a stream.
+ *
+ * The bytes are received into a ring buffer, as many as it has room for with
+ * each read(), and the samples are converted from there straight into the
+ * vector passed to Read(), whatever the sizes of the packets.  If the socket
+ * is in blocking mode, Read() reads from it until it has all the samples it
+ * was asked for, or the stream ends.  If it is in non-blocking mode, e.g.
+ * served by an event loop (see OnlineTcpServer), the event loop calls
+ * Receive() when the socket is readable, and Read() returns the samples
+ * received so far instead of waiting for more.  Receive() and Read() may then
+ * be called from different threads: the ring buffer has one writer and one
+ * reader, which share nothing but the counts of bytes written and read.
+ *
+ * The documentation and "interface" for this class is given in online-audio-source.h
+ */
+class OnlineTcpVectorSource : public OnlineAudioSourceItf {
+ public:
+  // "buffer_size" is the size of the ring buffer in bytes, rounded up to a
+  // power of two; in non-blocking mode it bounds how much audio is kept for
+  // a connection whose decoding lags behind.
+  explicit OnlineTcpVectorSource(int32 socket, int32 buffer_size = 1 << 20);
+
+  // Implementation of the OnlineAudioSourceItf; "data" is resized to the
+  // number of samples read.
+  bool Read(Vector<BaseFloat> *data);
+  bool ReadInto(VectorBase<BaseFloat> *data, int32 *num_read);
+
+  // Non-blocking mode only: takes what has arrived on the socket, as far as
+  // the ring buffer has room, and sets "full" if it stopped for lack of room
+  // (then it should be called again once Read() has made some).  Returns
+  // false once the connection is closed, after which it must not be called
+  // again.
+  bool Receive(bool *full);
+
+  // Returns true if Read() has samples, or the end of a stream, to return
+  // right away.  Like Read(), called by the thread reading the audio only.
+  bool HasInput();
+
+  // Makes the codec of "decoder" (not owned) available to the client;
+  // without one, only 16-bit PCM is accepted.
+  void SetDecoder(OnlineTcpAudioDecoderItf *decoder);
+
+  // Starts on the next stream, once Read() has returned false at the end of
+  // one; until then Read() keeps returning false.
+  void NextStream();
+
+  //returns if the socket is still connected
+  bool IsConnected();
+
+  //returns the number of samples read since the last reset
+  size_t SamplesProcessed();
+  //resets the number of samples
+  void ResetSamples();
+
+  // The number of samples read since the start, for statistics.
+  int64 TotalSamplesRead();
+  // The number of bytes read, and the time spent decoding them if they are
+  // compressed, since the start; also for statistics.
+  int64 TotalBytesRead();
+  double DecodeTime();
+
+ private:
+  // Reads what it can from the socket into the free part of the ring
+  // buffer, with one call.  Returns the number of bytes read, 0 if the ring
+  // buffer is full, or -1 if there was nothing to read (in non-blocking
+  // mode) or the connection is closed.
+  int32 Fill();
+  // Copies "num_bytes" bytes from position "pos" of the stream, which must
+  // have been received, out of the ring buffer.
+  void CopyOut(int64 pos, int32 num_bytes, char *dest) const;
+  // Answers the client's request for "codec".
+  void SelectCodec(int32 codec);
+
+  int32 socket_desc;
+  bool blocking_;
+  std::vector<char> ring_;
+  const int64 ring_mask_; // ring_.size() - 1
+  // Counts of bytes since the start of the connection.  The writer
+  // (Receive() or, in blocking mode, Read()) only moves bytes_written_, the
+  // reader only bytes_read_.
+  std::atomic<int64> bytes_written_;
+  std::atomic<int64> bytes_read_;
+  // These may be looked at by another thread than the one reading, e.g.
+  // when the features are computed by an OnlineThreadedInput, or by the
+  // statistics of OnlineTcpServer.
+  std::atomic<bool> connected;
+  std::atomic<size_t> samples_processed;
+  std::atomic<int64> total_samples_;
+
+  // The state of the reader.
+  int32 packet_left_; // bytes of the current packet not read yet
+  bool stream_ended_; // Read() has seen the empty packet ending the stream
+  OnlineTcpAudioDecoderItf *decoder_; // NULL if PCM only
+  bool compressed_; // the client sends the codec of decoder_
+  std::vector<char> packet_data_; // compressed bytes on their way to decoder_
+  Vector<BaseFloat> decoded_; // samples decoded and not read yet...
+  int32 decoded_offset_; // ... from this one on
+  double decode_time_;
+
+  KALDI_DISALLOW_COPY_AND_ASSIGN(OnlineTcpVectorSource);
+};
+
+}  // namespace kaldi
+
+#endif // !defined(_MSC_VER)
+
+#endif // KALDI_ONLINE_ONLINE_TCP_SOURCE_H_
@@ -0,0 +1,86 @@
+// online/online-token-pool-test.cc
+
+// See ../../COPYING for clarification regarding multiple authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//  http://www.apache.org/licenses/LICENSE-2.0
+//
+// THIS CODE IS PROVIDED *AS IS* BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, EITHER EXPRESS OR IMPLIED, INCLUDING WITHOUT LIMITATION ANY IMPLIED
+// WARRANTIES OR CONDITIONS OF TITLE, FITNESS FOR A PARTICULAR PURPOSE,
+// MERCHANTABLITY OR NON-INFRINGEMENT.
+// See the Apache 2 License for the specific language governing permissions and
+// limitations under the License.
+
+#include <set>
+
+#include "online/online-token-pool.h"
+
+namespace kaldi {
+
+struct TestToken {
+  double cost;
+  TestToken *prev;
+  int32 id;
+};
+
+void TestTokenPoolFreeList() {
+  int32 slab_size = 1 + Rand() % 20;
+  OnlineTokenPool<TestToken> pool(slab_size);
+  std::vector<TestToken*> toks;
+  std::set<TestToken*> live;
+  int32 max_live = 0;
+  for (int32 i = 0; i < 1000; i++) {
+    if (toks.empty() || Rand() % 3 != 0) {
+      TestToken *tok = new (pool.Allocate()) TestToken();
+      tok->id = i;
+      KALDI_ASSERT(live.count(tok) == 0);
+      live.insert(tok);
+      toks.push_back(tok);
+    } else {
+      size_t j = Rand() % toks.size();
+      live.erase(toks[j]);
+      pool.Free(toks[j]);
+      toks[j] = toks.back();
+      toks.pop_back();
+    }
+    KALDI_ASSERT(pool.NumUsed() == static_cast<int64>(toks.size()));
+    max_live = std::max(max_live, static_cast<int32>(toks.size()));
+  }
+  // The freed memory was reused: we never needed more slabs than the
+  // maximum number of live tokens requires.
+  KALDI_ASSERT(pool.NumSlabs() == (max_live + slab_size - 1) / slab_size);
+}
+
+void TestTokenPoolReset() {
+  int32 slab_size = 1 + Rand() % 20, num_toks = 1 + Rand() % 100;
+  OnlineTokenPool<TestToken> pool(slab_size);
+  for (int32 utt = 0; utt < 10; utt++) {
+    std::set<TestToken*> live;
+    for (int32 i = 0; i < num_toks; i++) {
+      TestToken *tok = new (pool.Allocate()) TestToken();
+      tok->id = i;
+      KALDI_ASSERT(live.count(tok) == 0);
+      live.insert(tok);
+    }
+    pool.Reset();
+    KALDI_ASSERT(pool.NumUsed() == 0);
+  }
+  // After the first utterance, no more memory was needed.
+  KALDI_ASSERT(pool.NumSlabs() == (num_toks + slab_size - 1) / slab_size);
+  KALDI_ASSERT(pool.NumAllocs() == 10 * num_toks);
+}
+
+}  // end namespace kaldi
+
+int main() {
+  using namespace kaldi;
+  for (int i = 0; i < 20; i++) {
+    TestTokenPoolFreeList();
+    TestTokenPoolReset();
+  }
+  std::cout << "Test OK.\n";
+}
@@ -0,0 +1,110 @@
+// online/online-token-pool.h
+
+// See ../../COPYING for clarification regarding multiple authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//  http://www.apache.org/licenses/LICENSE-2.0
+//
+// THIS CODE IS PROVIDED *AS IS* BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, EITHER EXPRESS OR IMPLIED, INCLUDING WITHOUT LIMITATION ANY IMPLIED
+// WARRANTIES OR CONDITIONS OF TITLE, FITNESS FOR A PARTICULAR PURPOSE,
+// MERCHANTABLITY OR NON-INFRINGEMENT.
+// See the Apache 2 License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef KALDI_ONLINE_ONLINE_TOKEN_POOL_H_
+#define KALDI_ONLINE_ONLINE_TOKEN_POOL_H_
+
+#include <type_traits>
+#include <vector>
+
+#include "base/kaldi-common.h"
+
+namespace kaldi {
+
+// Memory for objects of type T, allocated in slabs of "slab_size" objects.
+// Freed objects are kept on an intrusive free list and handed out again
+// before the current slab is used further.  Reset() makes all the memory
+// available again in constant time, without giving it back to the system, so
+// after the first few utterances a decoder does not call malloc() any more.
+// The pool only deals with memory: the objects are constructed with placement
+// new, and must be destroyed by the user before Free(), or, if they are
+// trivially destructible, before Reset().
+template<class T>
+class OnlineTokenPool {
+ public:
+  explicit OnlineTokenPool(int32 slab_size = 1024):
+      slab_size_(slab_size), cur_slab_(0), next_in_slab_(0), free_list_(NULL),
+      num_used_(0), num_allocs_(0) { KALDI_ASSERT(slab_size > 0); }
+
+  ~OnlineTokenPool() {
+    for (size_t i = 0; i < slabs_.size(); i++)
+      delete [] slabs_[i];
+  }
+
+  // Returns uninitialized memory for one object.
+  inline void *Allocate() {
+    num_allocs_++;
+    num_used_++;
+    if (free_list_ != NULL) {
+      Block *block = free_list_;
+      free_list_ = block->next;
+      return &(block->storage);
+    }
+    if (next_in_slab_ == slab_size_) {
+      cur_slab_++;
+      next_in_slab_ = 0;
+    }
+    if (cur_slab_ == slabs_.size())
+      slabs_.push_back(new Block[slab_size_]);
+    return &(slabs_[cur_slab_][next_in_slab_++].storage);
+  }
+
+  // Gives back memory obtained from Allocate().
+  inline void Free(void *ptr) {
+    Block *block = reinterpret_cast<Block*>(ptr);
+    block->next = free_list_;
+    free_list_ = block;
+    num_used_--;
+  }
+
+  // Frees all the objects at once.
+  void Reset() {
+    cur_slab_ = 0;
+    next_in_slab_ = 0;
+    free_list_ = NULL;
+    num_used_ = 0;
+  }
+
+  // The number of objects currently allocated.
+  int64 NumUsed() const { return num_used_; }
+
+  // The number of calls to Allocate() so far.
+  int64 NumAllocs() const { return num_allocs_; }
+
+  // The number of slabs allocated from the system so far.
+  int32 NumSlabs() const { return slabs_.size(); }
+
+ private:
+  union Block {
+    Block *next; // when on the free list
+    typename std::aligned_storage<sizeof(T), alignof(T)>::type storage;
+  };
+
+  const int32 slab_size_;
+  std::vector<Block*> slabs_;
+  size_t cur_slab_; // the slab we are currently allocating from...
+  int32 next_in_slab_; // ... and the first never used block in it
+  Block *free_list_;
+  int64 num_used_;
+  int64 num_allocs_;
+
+  KALDI_DISALLOW_COPY_AND_ASSIGN(OnlineTokenPool);
+};
+
+} // namespace kaldi
+
+#endif // KALDI_ONLINE_ONLINE_TOKEN_POOL_H_
@@ -0,0 +1,188 @@
+// online/online-word-timer-test.cc
+
+// See ../../COPYING for clarification regarding multiple authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//  http://www.apache.org/licenses/LICENSE-2.0
+//
+// THIS CODE IS PROVIDED *AS IS* BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, EITHER EXPRESS OR IMPLIED, INCLUDING WITHOUT LIMITATION ANY IMPLIED
+// WARRANTIES OR CONDITIONS OF TITLE, FITNESS FOR A PARTICULAR PURPOSE,
+// MERCHANTABLITY OR NON-INFRINGEMENT.
+// See the Apache 2 License for the specific language governing permissions and
+// limitations under the License.
+
+#include <map>
+#include <sstream>
+
+#include "hmm/hmm-test-utils.h"
+#include "online/online-word-timer.h"
+
+namespace kaldi {
+
+typedef std::vector<std::pair<int32, int32> > LabelPath;
+
+// Makes random paths through the HMMs of a random transition model.
+class PathMaker {
+ public:
+  PathMaker(const TransitionModel &trans_model, bool reorder):
+      trans_model_(trans_model), reorder_(reorder) {
+    for (int32 tid = 1; tid <= trans_model.NumTransitionIds(); tid++) {
+      Key key(trans_model.TransitionIdToPhone(tid),
+              std::make_pair(trans_model.TransitionIdToHmmState(tid),
+                             trans_model.TransitionIdToTransitionIndex(tid)));
+      if (tids_.count(key) == 0)
+        tids_[key] = tid;
+    }
+  }
+
+  // Appends the arcs of one instance of "phone" to "path"; returns the
+  // number of frames.
+  int32 AddPhone(int32 phone, LabelPath *path) const {
+    const HmmTopology::TopologyEntry &entry =
+        trans_model_.GetTopo().TopologyForPhone(phone);
+    int32 final_state = static_cast<int32>(entry.size()) - 1, num_frames = 0;
+    for (int32 state = 0; state != final_state; ) {
+      const HmmTopology::HmmState &hmm_state = entry[state];
+      int32 self_loop = -1;
+      std::vector<int32> forward;
+      for (size_t i = 0; i < hmm_state.transitions.size(); i++) {
+        if (hmm_state.transitions[i].first == state)
+          self_loop = i;
+        else
+          forward.push_back(i);
+      }
+      KALDI_ASSERT(!forward.empty());
+      int32 next = forward[Rand() % forward.size()],
+          num_loops = (self_loop >= 0 ? Rand() % 3 : 0);
+      // With reordered self-loops, those of a state come after the
+      // transition out of it.
+      if (reorder_)
+        path->push_back(std::make_pair(Tid(phone, state, next), 0));
+      for (int32 i = 0; i < num_loops; i++)
+        path->push_back(std::make_pair(Tid(phone, state, self_loop), 0));
+      if (!reorder_)
+        path->push_back(std::make_pair(Tid(phone, state, next), 0));
+      num_frames += num_loops + 1;
+      state = hmm_state.transitions[next].first;
+    }
+    return num_frames;
+  }
+
+ private:
+  typedef std::pair<int32, std::pair<int32, int32> > Key;
+  int32 Tid(int32 phone, int32 state, int32 trans_index) const {
+    std::map<Key, int32>::const_iterator iter =
+        tids_.find(Key(phone, std::make_pair(state, trans_index)));
+    KALDI_ASSERT(iter != tids_.end());
+    return iter->second;
+  }
+
+  const TransitionModel &trans_model_;
+  bool reorder_;
+  std::map<Key, int32> tids_;
+};
+
+// Makes a random utterance of words and silences, some of the words on a
+// nonword phone, with the word labels placed anywhere from the previous label
+// (or nonword phone) to the start of the word, and checks that the words are timed right, however the path is cut up, and
+// whether or not the end of it is timed on a copy.
+void TestWordTimer() {
+  ContextDependency *ctx_dep = NULL;
+  TransitionModel *trans_model = GenRandTransitionModel(&ctx_dep);
+  delete ctx_dep;
+  const std::vector<int32> &phones = trans_model->GetPhones();
+  bool reorder = (Rand() % 2 == 0);
+
+  // One phone of each type at least, if there are enough of them.
+  const char *types[] = { "singleton", "nonword", "begin", "end",
+                          "internal" };
+  std::map<std::string, std::vector<int32> > phones_of_type;
+  std::ostringstream boundary_file;
+  for (size_t i = 0; i < phones.size(); i++) {
+    std::string type = types[i < 5 ? i : Rand() % 5];
+    phones_of_type[type].push_back(phones[i]);
+    boundary_file << phones[i] << " " << type << "\n";
+  }
+  WordBoundaryInfoNewOpts opts;
+  opts.reorder = reorder;
+  WordBoundaryInfo info(opts);
+  std::istringstream is(boundary_file.str());
+  info.Init(is);
+
+  PathMaker maker(*trans_model, reorder);
+  LabelPath path;
+  std::vector<OnlineTimedWord> ref_words;
+  int32 start_frame = Rand() % 100, frame = start_frame;
+  size_t label_pos = 0; // the earliest place for the next label
+  int32 num_words = Rand() % 10;
+  for (int32 w = 0; w < num_words; w++) {
+    if (!phones_of_type["nonword"].empty() && Rand() % 2 == 0) {
+      const std::vector<int32> &sil = phones_of_type["nonword"];
+      frame += maker.AddPhone(sil[Rand() % sil.size()], &path);
+      label_pos = path.size();
+    }
+    OnlineTimedWord word;
+    word.word_id = 1 + Rand() % 100;
+    word.start_frame = frame;
+    size_t pos = label_pos + Rand() % (path.size() - label_pos + 1);
+    path.insert(path.begin() + pos, std::make_pair(0, word.word_id));
+    label_pos = pos + 1;
+    const std::vector<int32> &begin = phones_of_type["begin"],
+        &end = phones_of_type["end"], &internal = phones_of_type["internal"];
+    const std::vector<int32> &nonword = phones_of_type["nonword"];
+    if (!nonword.empty() && Rand() % 4 == 0) {
+      // E.g. <UNK> on a spoken-noise phone.
+      frame += maker.AddPhone(nonword[Rand() % nonword.size()], &path);
+      label_pos = path.size();
+    } else if (begin.empty() || end.empty() || Rand() % 3 == 0) {
+      const std::vector<int32> &single = phones_of_type["singleton"];
+      frame += maker.AddPhone(single[Rand() % single.size()], &path);
+    } else {
+      frame += maker.AddPhone(begin[Rand() % begin.size()], &path);
+      for (int32 i = Rand() % 3; i > 0 && !internal.empty(); i--)
+        frame += maker.AddPhone(internal[Rand() % internal.size()], &path);
+      frame += maker.AddPhone(end[Rand() % end.size()], &path);
+    }
+    word.end_frame = frame;
+    ref_words.push_back(word);
+  }
+  if (!phones_of_type["nonword"].empty() && Rand() % 2 == 0)
+    frame += maker.AddPhone(phones_of_type["nonword"][0], &path);
+
+  OnlineWordTimer timer(*trans_model, info);
+  timer.Reset(start_frame);
+  std::vector<OnlineTimedWord> words;
+  for (size_t pos = 0; pos <= path.size(); ) {
+    // Times the rest of the path on a copy.
+    OnlineWordTimer copy(timer);
+    std::vector<OnlineTimedWord> all_words(words);
+    copy.Advance(LabelPath(path.begin() + pos, path.end()), &all_words);
+    copy.Finish(&all_words);
+    KALDI_ASSERT(all_words.size() == ref_words.size());
+    for (size_t i = 0; i < ref_words.size(); i++)
+      KALDI_ASSERT(all_words[i].word_id == ref_words[i].word_id &&
+                   all_words[i].start_frame == ref_words[i].start_frame &&
+                   all_words[i].end_frame == ref_words[i].end_frame);
+    if (pos == path.size())
+      break;
+    size_t num_arcs = 1 + Rand() % (path.size() - pos);
+    timer.Advance(LabelPath(path.begin() + pos, path.begin() + pos + num_arcs),
+                  &words);
+    pos += num_arcs;
+  }
+  KALDI_ASSERT(timer.Frame() == frame);
+  delete trans_model;
+}
+
+}  // end namespace kaldi
+
+int main() {
+  using namespace kaldi;
+  for (int i = 0; i < 100; i++)
+    TestWordTimer();
+  std::cout << "Test OK.\n";
+}
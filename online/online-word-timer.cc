@@ -0,0 +1,129 @@
+// online/online-word-timer.cc
+
+// See ../../COPYING for clarification regarding multiple authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//  http://www.apache.org/licenses/LICENSE-2.0
+//
+// THIS CODE IS PROVIDED *AS IS* BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, EITHER EXPRESS OR IMPLIED, INCLUDING WITHOUT LIMITATION ANY IMPLIED
+// WARRANTIES OR CONDITIONS OF TITLE, FITNESS FOR A PARTICULAR PURPOSE,
+// MERCHANTABLITY OR NON-INFRINGEMENT.
+// See the Apache 2 License for the specific language governing permissions and
+// limitations under the License.
+
+#include "online/online-word-timer.h"
+
+namespace kaldi {
+
+OnlineWordTimer::OnlineWordTimer(const TransitionModel &trans_model,
+                                 const WordBoundaryInfo &info):
+    trans_model_(trans_model), info_(info) {
+  Reset(0);
+}
+
+void OnlineWordTimer::Reset(int32 frame) {
+  frame_ = frame;
+  phone_ = 0;
+  phone_start_ = frame;
+  phone_exited_ = false;
+  phone_is_word_ = false;
+  word_start_ = -1;
+  labels_.clear();
+  spans_.clear();
+}
+
+void OnlineWordTimer::Advance(
+    const std::vector<std::pair<int32, int32> > &labels,
+    std::vector<OnlineTimedWord> *words) {
+  for (size_t i = 0; i < labels.size(); i++) {
+    int32 tid = labels[i].first, word_id = labels[i].second;
+    if (word_id != 0)
+      labels_.push_back(word_id);
+    if (tid == 0)
+      continue;
+    int32 phone = trans_model_.TransitionIdToPhone(tid);
+    // With reordered self-loops, those of the last state come after the
+    // transition out of it.
+    bool new_phone = (phone_ == 0 || phone != phone_ ||
+                      (phone_exited_ &&
+                       !(info_.reorder && trans_model_.IsSelfLoop(tid))));
+    if (new_phone) {
+      if (phone_ != 0)
+        EndPhone(frame_);
+      phone_ = phone;
+      phone_start_ = frame_;
+      phone_exited_ = false;
+      phone_is_word_ = false;
+      WordBoundaryInfo::PhoneType type = info_.TypeOfPhone(phone);
+      if (type == WordBoundaryInfo::kWordBeginPhone ||
+          type == WordBoundaryInfo::kWordBeginAndEndPhone ||
+          (word_start_ < 0 && (type == WordBoundaryInfo::kWordInternalPhone ||
+                               type == WordBoundaryInfo::kWordEndPhone)))
+        word_start_ = frame_; // the latter if the beginning was cut off
+    }
+    if (trans_model_.IsFinal(tid)) {
+      phone_exited_ = true;
+      // A label that comes later is that of a word after the phone.
+      phone_is_word_ =
+          (info_.TypeOfPhone(phone_) == WordBoundaryInfo::kNonWordPhone &&
+           word_start_ < 0 && labels_.size() > spans_.size());
+    }
+    frame_++;
+  }
+  Match(words);
+}
+
+void OnlineWordTimer::EndPhone(int32 frame) {
+  WordBoundaryInfo::PhoneType type = info_.TypeOfPhone(phone_);
+  if ((type == WordBoundaryInfo::kWordEndPhone ||
+       type == WordBoundaryInfo::kWordBeginAndEndPhone) && word_start_ >= 0) {
+    spans_.push_back(std::make_pair(word_start_, frame));
+    word_start_ = -1;
+  } else if (type == WordBoundaryInfo::kNonWordPhone && phone_is_word_) {
+    spans_.push_back(std::make_pair(phone_start_, frame));
+  }
+}
+
+void OnlineWordTimer::Match(std::vector<OnlineTimedWord> *words) {
+  while (!labels_.empty() && !spans_.empty()) {
+    OnlineTimedWord word;
+    word.word_id = labels_.front();
+    word.start_frame = spans_.front().first;
+    word.end_frame = spans_.front().second;
+    words->push_back(word);
+    labels_.pop_front();
+    spans_.pop_front();
+  }
+}
+
+void OnlineWordTimer::Finish(std::vector<OnlineTimedWord> *words) const {
+  // Match() left either no labels or no spans.  The current phone ends here,
+  // so it is the span of the next label if it is that of a word, or a nonword
+  // phone with a label (which, if it has not exited yet, it would get).
+  int32 last_start = word_start_;
+  if (last_start < 0 && phone_ != 0 &&
+      info_.TypeOfPhone(phone_) == WordBoundaryInfo::kNonWordPhone &&
+      (phone_is_word_ || !phone_exited_))
+    last_start = phone_start_;
+  size_t num_spans = spans_.size() + (last_start >= 0 ? 1 : 0);
+  for (size_t i = 0; i < labels_.size(); i++) {
+    OnlineTimedWord word;
+    word.word_id = labels_[i];
+    if (i < spans_.size()) {
+      word.start_frame = spans_[i].first;
+      word.end_frame = spans_[i].second;
+    } else if (i < num_spans) {
+      word.start_frame = last_start;
+      word.end_frame = frame_;
+    } else {
+      word.start_frame = word.end_frame = frame_;
+    }
+    words->push_back(word);
+  }
+}
+
+} // namespace kaldi
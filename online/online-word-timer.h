@@ -0,0 +1,97 @@
+// online/online-word-timer.h
+
+// See ../../COPYING for clarification regarding multiple authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//  http://www.apache.org/licenses/LICENSE-2.0
+//
+// THIS CODE IS PROVIDED *AS IS* BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, EITHER EXPRESS OR IMPLIED, INCLUDING WITHOUT LIMITATION ANY IMPLIED
+// WARRANTIES OR CONDITIONS OF TITLE, FITNESS FOR A PARTICULAR PURPOSE,
+// MERCHANTABLITY OR NON-INFRINGEMENT.
+// See the Apache 2 License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef KALDI_ONLINE_ONLINE_WORD_TIMER_H_
+#define KALDI_ONLINE_ONLINE_WORD_TIMER_H_
+
+#include <deque>
+#include <utility>
+#include <vector>
+
+#include "base/kaldi-common.h"
+#include "hmm/transition-model.h"
+#include "lat/word-align-lattice.h"
+
+namespace kaldi {
+
+struct OnlineTimedWord {
+  int32 word_id;
+  int32 start_frame;
+  int32 end_frame; // one past the last frame
+};
+
+// Works out the start and end times of the words on a decoding path as the
+// path grows, from the word-position types of its phones, like
+// WordAlignLattice() but without building a lattice: each arc is only looked
+// at once, whatever the length of the utterance.  A new phone starts after
+// the transition out of the last HMM state of the previous one (and, if the
+// graph has its self-loops reordered, the self-loops that follow it), or
+// when the phone changes; a word spans from a word-begin (or singleton)
+// phone to the next word-end (or singleton) one.  The word labels of the
+// graph need not be on the words' own arcs, so the n-th word label is given
+// to the n-th word span.  A nonword phone is a word of its own if a word
+// label is waiting for a span by the transition out of its last state (e.g.
+// <UNK> on a spoken-noise phone, or a silence word), as with
+// WordAlignLattice(); so the label of a word must not come before a nonword
+// phone that is ahead of the word, which holds for a graph, as what follows
+// an optional silence is not known before it.  Any other mismatch between the labels and the phones only leaves the
+// words unmatched, or wrongly timed, until Reset().
+class OnlineWordTimer {
+ public:
+  OnlineWordTimer(const TransitionModel &trans_model,
+                  const WordBoundaryInfo &info);
+
+  // Starts an utterance, whose first frame is "frame".
+  void Reset(int32 frame);
+
+  // Follows the (transition-id, word id) labels of the next arcs of the path,
+  // as output by OnlineFasterDecoder::PartialTraceback(), appending the words
+  // whose labels and ends were both reached to "words".
+  void Advance(const std::vector<std::pair<int32, int32> > &labels,
+               std::vector<OnlineTimedWord> *words);
+
+  // Appends the words not complete yet, as if the path ended here: the word
+  // being spoken ends with the current frame, and the labels of the words
+  // not reached yet span no frames.  Does not change the state, so a path
+  // that is not fixed yet can be timed on a copy of the object, and dropped.
+  void Finish(std::vector<OnlineTimedWord> *words) const;
+
+  // The frame the next emitting arc will be on.
+  int32 Frame() const { return frame_; }
+
+ private:
+  // The current phone ended before frame "frame".
+  void EndPhone(int32 frame);
+  // Gives the oldest word label to the oldest word span, while there are
+  // both.
+  void Match(std::vector<OnlineTimedWord> *words);
+
+  const TransitionModel &trans_model_;
+  const WordBoundaryInfo &info_;
+  int32 frame_;
+  int32 phone_; // the current phone, 0 if none yet
+  int32 phone_start_; // its first frame
+  bool phone_exited_; // the transition out of its last state was seen
+  bool phone_is_word_; // if a nonword phone, whether it has a word label
+  int32 word_start_; // the first frame of the current word, -1 if none
+  std::deque<int32> labels_; // word labels with no span yet
+  std::deque<std::pair<int32, int32> > spans_; // word spans with no label yet
+};
+
+} // namespace kaldi
+
+#endif // KALDI_ONLINE_ONLINE_WORD_TIMER_H_
@@ -1,81 +1,116 @@
-// online/onlinebin-util.cc
-
-// Copyright 2012 Cisco Systems (author: Matthias Paulik)
-
-//   Modifications to the original contribution by Cisco Systems made by:
-//   Vassil Panayotov
-
-// See ../../COPYING for clarification regarding multiple authors
-//
-// Licensed under the Apache License, Version 2.0 (the "License");
-// you may not use this file except in compliance with the License.
-// You may obtain a copy of the License at
-//
-//  http://www.apache.org/licenses/LICENSE-2.0
-//
-// THIS CODE IS PROVIDED *AS IS* BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
-// KIND, EITHER EXPRESS OR IMPLIED, INCLUDING WITHOUT LIMITATION ANY IMPLIED
-// WARRANTIES OR CONDITIONS OF TITLE, FITNESS FOR A PARTICULAR PURPOSE,
-// MERCHANTABLITY OR NON-INFRINGEMENT.
-// See the Apache 2 License for the specific language governing permissions and
-// limitations under the License.
-
-#include "onlinebin-util.h"
-
-namespace kaldi {
-
-//读取解码图函数 很重要
-fst::Fst<fst::StdArc> *ReadDecodeGraph(std::string filename) {
-  // 读取解码网络fst
-  Input ki(filename); // use ki.Stream() instead of is.
-  if (!ki.Stream().good()) KALDI_ERR << "Could not open decoding-graph FST "
-                                      << filename;
-
-  //在openfst中找到FstHeader类
-  fst::FstHeader hdr;
-  //读取的是标准输入流 返回的是bool值
-  if (!hdr.Read(ki.Stream(), "<unknown>")) {
-    KALDI_ERR << "Reading FST: error reading FST header.";
-  }
-  //StdArc是一个结构体
-  //判断fst的弧类型是否支持
-  if (hdr.ArcType() != fst::StdArc::Type()) {
-    KALDI_ERR << "FST with arc type " << hdr.ArcType() << " not supported.";
-  }
-  fst::FstReadOptions ropts("<unspecified>", &hdr);
-
-  fst::Fst<fst::StdArc> *decode_fst = NULL;
-  //如果类型为向量或者为常量
-  if (hdr.FstType() == "vector") {
-    decode_fst = fst::VectorFst<fst::StdArc>::Read(ki.Stream(), ropts);
-  } else if (hdr.FstType() == "const") {
-    decode_fst = fst::ConstFst<fst::StdArc>::Read(ki.Stream(), ropts);
-  } else {
-    KALDI_ERR << "Reading FST: unsupported FST type: " << hdr.FstType();
-  }
-  if (decode_fst == NULL) { // fst code will warn.
-    KALDI_ERR << "Error reading FST (after reading header).";
-    return NULL;
-  } else {
-    return decode_fst;
-  }
-}
-
-
-void PrintPartialResult(const std::vector<int32>& words,
-                        const fst::SymbolTable *word_syms,
-                        bool line_break) {
-  KALDI_ASSERT(word_syms != NULL);
-  for (size_t i = 0; i < words.size(); i++) {
-    std::string word = word_syms->Find(words[i]);
-    if (word == "")
-      KALDI_ERR << "Word-id " << words[i] <<" not in symbol table.";
-    std::cout << word << ' ';
-  }
-  if (line_break)
-    std::cout << "\n\n";
-  else
-    std::cout.flush();
-}
-
-} // namespace kaldi
+// online/onlinebin-util.cc
+
+// Copyright 2012 Cisco Systems (author: Matthias Paulik)
+
+//   Modifications to the original contribution by Cisco Systems made by:
+//   Vassil Panayotov
+
+// See ../../COPYING for clarification regarding multiple authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//  http://www.apache.org/licenses/LICENSE-2.0
+//
+// THIS CODE IS PROVIDED *AS IS* BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, EITHER EXPRESS OR IMPLIED, INCLUDING WITHOUT LIMITATION ANY IMPLIED
+// WARRANTIES OR CONDITIONS OF TITLE, FITNESS FOR A PARTICULAR PURPOSE,
+// MERCHANTABLITY OR NON-INFRINGEMENT.
+// See the Apache 2 License for the specific language governing permissions and
+// limitations under the License.
+
+#include "onlinebin-util.h"
+#include "online/online-feat-input.h"
+#include "online/online-decodable.h"
+#include "online/online-gselect.h"
+#include "online/online-stacked-gmm.h"
+#include "util/kaldi-io.h"
+
+namespace kaldi {
+
+//读取解码图函数 很重要
+fst::Fst<fst::StdArc> *ReadDecodeGraph(std::string filename) {
+  // 读取解码网络fst
+  Input ki(filename); // use ki.Stream() instead of is.
+  if (!ki.Stream().good()) KALDI_ERR << "Could not open decoding-graph FST "
+                                      << filename;
+
+  //在openfst中找到FstHeader类
+  fst::FstHeader hdr;
+  //读取的是标准输入流 返回的是bool值
+  if (!hdr.Read(ki.Stream(), "<unknown>")) {
+    KALDI_ERR << "Reading FST: error reading FST header.";
+  }
+  //StdArc是一个结构体
+  //判断fst的弧类型是否支持
+  if (hdr.ArcType() != fst::StdArc::Type()) {
+    KALDI_ERR << "FST with arc type " << hdr.ArcType() << " not supported.";
+  }
+  fst::FstReadOptions ropts("<unspecified>", &hdr);
+
+  fst::Fst<fst::StdArc> *decode_fst = NULL;
+  //如果类型为向量或者为常量
+  if (hdr.FstType() == "vector") {
+    decode_fst = fst::VectorFst<fst::StdArc>::Read(ki.Stream(), ropts);
+  } else if (hdr.FstType() == "const") {
+    decode_fst = fst::ConstFst<fst::StdArc>::Read(ki.Stream(), ropts);
+  } else {
+    KALDI_ERR << "Reading FST: unsupported FST type: " << hdr.FstType();
+  }
+  if (decode_fst == NULL) { // fst code will warn.
+    KALDI_ERR << "Error reading FST (after reading header).";
+    return NULL;
+  } else {
+    return decode_fst;
+  }
+}
+
+
+void PrintPartialResult(const std::vector<int32>& words,
+                        const fst::SymbolTable *word_syms,
+                        bool line_break) {
+  KALDI_ASSERT(word_syms != NULL);
+  for (size_t i = 0; i < words.size(); i++) {
+    std::string word = word_syms->Find(words[i]);
+    if (word == "")
+      KALDI_ERR << "Word-id " << words[i] <<" not in symbol table.";
+    std::cout << word << ' ';
+  }
+  if (line_break)
+    std::cout << "\n\n";
+  else
+    std::cout.flush();
+}
+
+
+OnlineGselectIndex *ReadGselectIndex(const std::string &rxfilename) {
+  if (rxfilename.empty())
+    return NULL;
+  OnlineGselectIndex *gselect = new OnlineGselectIndex();
+  ReadKaldiObject(rxfilename, gselect);
+  return gselect;
+}
+
+
+OnlineStackedGmm *NewStackedGmm(const AmDiagGmm &am_gmm,
+                                const OnlineDecodableOptions &opts) {
+  if (!opts.batch_pdfs && opts.gselect_rxfilename.empty())
+    return NULL;
+  return new OnlineStackedGmm(am_gmm);
+}
+
+
+bool ReadCmnPrior(const OnlineCmnOptions &opts, Matrix<double> *prior) {
+  if (opts.prior_rxfilename.empty())
+    return false;
+  ReadKaldiObject(opts.prior_rxfilename, prior);
+  if (prior->NumRows() != 2 || prior->NumCols() < 2)
+    KALDI_ERR << "Expected CMVN stats in " << opts.prior_rxfilename;
+  double count = (*prior)(0, prior->NumCols() - 1);
+  if (count > opts.prior_frames)
+    prior->Scale(opts.prior_frames / count);
+  return true;
+}
+
+} // namespace kaldi
@@ -1,421 +1,1134 @@
-// onlinebin/online-audio-client.cc
-
-// Copyright 2012 Cisco Systems (author: Matthias Paulik)
-// Copyright 2013 Polish-Japanese Institute of Information Technology (author: Danijel Korzinek)
-
-//   Modifications to the original contribution by Cisco Systems made by:
-//   Vassil Panayotov
-
-// See ../../COPYING for clarification regarding multiple authors
-//
-// Licensed under the Apache License, Version 2.0 (the "License");
-// you may not use this file except in compliance with the License.
-// You may obtain a copy of the License at
-//
-//  http://www.apache.org/licenses/LICENSE-2.0
-//
-// THIS CODE IS PROVIDED *AS IS* BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
-// KIND, EITHER EXPRESS OR IMPLIED, INCLUDING WITHOUT LIMITATION ANY IMPLIED
-// WARRANTIES OR CONDITIONS OF TITLE, FITNESS FOR A PARTICULAR PURPOSE,
-// MERCHANTABLITY OR NON-INFRINGEMENT.
-// See the Apache 2 License for the specific language governing permissions and
-// limitations under the License.
-
-#include <iostream>
-#if !defined(_MSC_VER)
-#include <sys/types.h>
-#include <sys/socket.h>
-#include <netinet/in.h>
-#include <arpa/inet.h>
-#include <netdb.h>
-#include <unistd.h>
-#endif
-
-#include "util/parse-options.h"
-#include "util/kaldi-table.h"
-#include "feat/wave-reader.h"
-#include "online/online-audio-source.h"
-
-namespace kaldi {
-
-bool WriteFull(int32 desc, char* data, int32 size);
-bool ReadLine(int32 desc, std::string* str);
-std::string TimeToTimecode(float time);
-
-struct RecognizedWord {
-  std::string word;
-  float start, end;
-};
-
-}  //namespace kaldi
-
-int main(int argc, char** argv) {
-  using namespace kaldi;
-  typedef kaldi::int32 int32;
-  #if !defined(_MSC_VER)
-  try {
-    //发送一个音频文件给kaldi音频服务器(onlinebin/online-audio-server-decode-faster)
-    //并且可选地打印其存储到HTK标签的文件或者webvtt文件
-    const char *usage =
-        "Sends an audio file to the KALDI audio server (onlinebin/online-audio-server-decode-faster)\n"
-            "and prints the result optionally saving it to an HTK label file or WebVTT subtitles file\n\n"
-            "e.g.: ./online-audio-client 192.168.50.12 9012 'scp:wav_files.scp'\n\n";
-    ParseOptions po(usage);
-
-    bool htk = false, vtt = false;
-    int32 channel = -1;
-    int32 packet_size = 1024;
-
-    po.Register("htk", &htk, "Save the result to an HTK label file");
-    po.Register("vtt", &vtt, "Save the result to a WebVTT subtitle file");
-    po.Register(
-        "channel", &channel,
-        "Channel to extract (-1 -> expect mono, 0 -> left, 1 -> right)");
-    po.Register("packet-size", &packet_size, "Send this many bytes per packet");
-
-    po.Read(argc, argv);
-    if (po.NumArgs() != 3) {
-      po.PrintUsage();
-      return 1;
-    }
-
-    std::string server_addr_str = po.GetArg(1);
-    std::string server_port_str = po.GetArg(2);
-    int32 server_port = strtol(server_port_str.c_str(), 0, 10);
-    std::string wav_rspecifier = po.GetArg(3);
-
-    int32 client_desc = socket(AF_INET, SOCK_STREAM, 0);
-    if (client_desc == -1) {
-      std::cerr << "ERROR: couldn't create socket!" << std::endl;
-      return -1;
-    }
-
-    struct hostent* hp;
-    unsigned long addr;
-
-    addr = inet_addr(server_addr_str.c_str());
-    if (addr == INADDR_NONE) {
-      hp = gethostbyname(server_addr_str.c_str());
-      if (hp == NULL) {
-        std::cerr << "ERROR: couldn't resolve host string: " << server_addr_str
-                  << std::endl;
-        close(client_desc);
-        return -1;
-      }
-
-      addr = *((unsigned long*) hp->h_addr);
-    }
-
-    sockaddr_in server;
-    server.sin_addr.s_addr = addr;
-    server.sin_family = AF_INET;
-    server.sin_port = htons(server_port);
-    if (::connect(client_desc, (struct sockaddr*) &server, sizeof(server))) {
-      std::cerr << "ERROR: couldn't connect to server!" << std::endl;
-      close(client_desc);
-      return -1;
-    }
-
-    KALDI_VLOG(2) << "Connected to KALDI server at host " << server_addr_str
-        << " port " << server_port << std::endl;
-
-    char* pack_buffer = new char[packet_size];
-
-    SequentialTableReader < WaveHolder > reader(wav_rspecifier);
-    for (; !reader.Done(); reader.Next()) {
-      std::string wav_key = reader.Key();
-
-      KALDI_VLOG(2) << "File: " << wav_key << std::endl;
-
-      const WaveData &wav_data = reader.Value();
-       //需要采样频率为16khz
-      if (wav_data.SampFreq() != 16000)
-        KALDI_ERR << "Sampling rates other than 16kHz are not supported!";
-
-      int32 num_chan = wav_data.Data().NumRows(), this_chan = channel;
-      {   // This block works out the channel (0=left, 1=right...)
-        KALDI_ASSERT(num_chan > 0);  // should have been caught in
-        // reading code if no channels.
-        if (channel == -1) {
-          this_chan = 0;
-          if (num_chan != 1)
-            KALDI_WARN << "Channel not specified but you have data with "
-                << num_chan << " channels; defaulting to zero";
-        } else {
-          if (this_chan >= num_chan) {
-            KALDI_WARN << "File with id " << wav_key << " has " << num_chan
-                << " channels but you specified channel " << channel
-                << ", producing no output.";
-            continue;
-          }
-        }
-      }
-
-      OnlineVectorSource au_src(wav_data.Data().Row(this_chan));
-      Vector < BaseFloat > data(packet_size / 2);
-      while (au_src.Read(&data)) {
-        for (int32 i = 0; i < data.Dim(); i++) {
-          short sample = (short) data(i);
-          memcpy(&pack_buffer[i * 2], (char*) &sample, 2);
-        }
-
-        int32 size = data.Dim() * 2;
-        WriteFull(client_desc, (char*) &size, 4);
-
-        WriteFull(client_desc, pack_buffer, size);
-      }
-
-      //send last packet
-      int32 size = 0;
-      WriteFull(client_desc, (char*) &size, 4);
-
-      std::string reco_output;
-      std::vector<RecognizedWord> results;
-      float total_input_dur = 0.0f, total_reco_dur = 0.0f;
-
-      while (true) {
-        std::string line;
-        if (!ReadLine(client_desc, &line))
-          KALDI_ERR << "Server disconnected!";
-
-        if (line.substr(0, 7) != "RESULT:") {
-          if (line.substr(0, 8) == "PARTIAL:") {
-            std::cout << line.substr(8) << " " << std::flush;
-            continue;
-          }
-          KALDI_ERR << "Header parse error: " << line;
-        }
-
-        std::cout << std::endl;
-
-        if (line == "RESULT:DONE")
-          break;
-
-        int32 res_num = 0;
-        float input_dur = 0;
-        float reco_dur = 0;
-
-        std::string tok, key, val;
-        size_t beg = 7, end, eq;
-
-        do {
-          end = line.find_first_of(',', beg);
-          tok = line.substr(beg, end - beg);
-          beg = end + 1;
-          eq = tok.find_first_of('=');
-          if (eq == std::string::npos || eq >= tok.size() - 1) {
-            KALDI_WARN << "Error parsing header token " << tok;
-            continue;
-          }
-
-          key = tok.substr(0, eq);
-          val = tok.substr(eq + 1);
-
-          if (key == "NUM") {
-            res_num = strtol(val.c_str(), 0, 10);
-          } else if (key == "FORMAT") {
-            if (val != "WSE") {
-              KALDI_ERR << "Only WSE format supported by this program!";
-            }
-          } else if (key == "RECO-DUR") {
-            reco_dur = strtof(val.c_str(), 0);
-          } else if (key == "INPUT-DUR") {
-            input_dur = strtof(val.c_str(), 0);
-          } else {
-            KALDI_WARN << "Unknown header key: " << key;
-          }
-        } while (end != std::string::npos);
-
-        total_input_dur += input_dur;
-        total_reco_dur += reco_dur;
-
-        for (int32 i = 0; i < res_num; i++) {
-          std::string line;
-          if (!ReadLine(client_desc, &line))
-            KALDI_ERR << "Server disconnected!";
-
-          std::string word_str, start_str, end_str;
-
-          end = line.find_first_of(',');
-          word_str = line.substr(0, end);
-          beg = end + 1;
-          end = line.find_first_of(',', beg);
-          start_str = line.substr(beg, end - beg);
-          beg = end + 1;
-          end = line.find_first_of(',', beg);
-          end_str = line.substr(beg, end - beg);
-
-          RecognizedWord word;
-          word.word = word_str;
-          word.start = strtof(start_str.c_str(), 0);
-          word.end = strtof(end_str.c_str(), 0);
-
-          results.push_back(word);
-
-          reco_output += word_str + " ";
-        }
-      }
-
-      {
-        float speed = total_input_dur / total_reco_dur;
-        KALDI_VLOG(2) << "Recognized (" << speed << "xRT): " << reco_output
-            << std::endl;
-      }
-
-      if (htk) {
-        std::string name = wav_key + ".lab";
-        std::ofstream htk_file(name.c_str());
-        for (size_t i = 0; i < results.size(); i++)
-          htk_file << (int) (results[i].start * 10000000) << " "
-              << (int) (results[i].end * 10000000) << " " << results[i].word << std::endl;
-        htk_file.close();
-      }
-
-      if (vtt && !results.empty()) {
-        std::vector<RecognizedWord> subtitles;
-        RecognizedWord subtitle_cue;
-
-        subtitle_cue.start = -1;
-        subtitle_cue.end = -1;
-        subtitle_cue.word = "";
-
-        for (size_t i = 0; i < results.size(); i++) {
-          if (subtitle_cue.end >= 0) {
-            if (results[i].start - subtitle_cue.end > 3.0f
-                || results[i].word.size() + subtitle_cue.word.size() > 64) {
-
-              if (results[i].start - subtitle_cue.end < 0.1f)
-                subtitle_cue.end = results[i].start - 0.1f;
-
-              subtitles.push_back(subtitle_cue);
-              subtitle_cue.start = -1;
-              subtitle_cue.end = -1;
-              subtitle_cue.word = "";
-
-            }
-          }
-
-          if (subtitle_cue.start < 0)
-            subtitle_cue.start = results[i].start;
-          else
-            subtitle_cue.word += " ";
-
-          subtitle_cue.end = results[i].end + 1.0f;
-
-          subtitle_cue.word += results[i].word;
-        }
-
-        subtitles.push_back(subtitle_cue);
-
-        std::string name = wav_key + ".vtt";
-        std::ofstream vtt_file(name.c_str());
-
-        vtt_file << "WEBVTT FILE" << std::endl << std::endl;
-
-        for (size_t i = 0; i < subtitles.size(); i++)
-          vtt_file << (i + 1) << std::endl << TimeToTimecode(subtitles[i].start)
-              << " --> " << TimeToTimecode(subtitles[i].end) << std::endl
-              << subtitles[i].word << std::endl << std::endl;
-
-        vtt_file.close();
-      }
-    }
-
-    close(client_desc);
-    delete[] pack_buffer;
-  }
-
-  catch (const std::exception& e) {
-    std::cerr << e.what();
-    return -1;
-  }
-
-#endif
-  return 0;
-}
-
-
-namespace kaldi {
-
-bool WriteFull(int32 desc, char* data, int32 size) {
-  int32 to_write = size;
-  int32 wrote = 0;
-  while (to_write > 0) {
-    int32 ret = write(desc, data + wrote, to_write);
-    if (ret <= 0)
-      return false;
-
-    to_write -= ret;
-    wrote += ret;
-  }
-
-  return true;
-}
-
-int32 buffer_offset = 0;
-int32 buffer_fill = 0;
-char read_buffer[1025];
-
-bool ReadLine(int32 desc, std::string* str) {
-  *str = "";
-
-  while (true) {
-    if (buffer_offset >= buffer_fill) {
-      buffer_fill = read(desc, read_buffer, 1024);
-
-      if (buffer_fill <= 0)
-        break;
-
-      buffer_offset = 0;
-    }
-
-    for (int32 i = buffer_offset; i < buffer_fill; i++) {
-      if (read_buffer[i] == '\r' || read_buffer[i] == '\n') {
-        read_buffer[i] = 0;
-        *str += (read_buffer + buffer_offset);
-
-        buffer_offset = i + 1;
-
-        if (i < buffer_fill) {
-          if (read_buffer[i] == '\n' && read_buffer[i + 1] == '\r') {
-            read_buffer[i + 1] = 0;
-            buffer_offset = i + 2;
-          }
-          if (read_buffer[i] == '\r' && read_buffer[i + 1] == '\n') {
-            read_buffer[i + 1] = 0;
-            buffer_offset = i + 2;
-          }
-        }
-
-        return true;
-      }
-    }
-
-    read_buffer[buffer_fill] = 0;
-    *str += (read_buffer + buffer_offset);
-    buffer_offset = buffer_fill;
-  }
-
-  return false;
-}
-
-std::string TimeToTimecode(float time) {
-
-  char buf[64];
-
-  int32 h, m, s, ms;
-  s = (int32) time;
-  ms = (int32)((time - (float) s) * 1000.0f);
-  m = s / 60;
-  s %= 60;
-  h = m / 60;
-  m %= 60;
-
-#if !defined(_MSC_VER)
-  snprintf(buf, 64, "%02d:%02d:%02d.%03d", h, m, s, ms);
-#endif
-
-  return buf;
-}
-
-}  //namespace kaldi
+// onlinebin/online-audio-client.cc
+
+// Copyright 2012 Cisco Systems (author: Matthias Paulik)
+// Copyright 2013 Polish-Japanese Institute of Information Technology (author: Danijel Korzinek)
+
+//   Modifications to the original contribution by Cisco Systems made by:
+//   Vassil Panayotov
+
+// See ../../COPYING for clarification regarding multiple authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//  http://www.apache.org/licenses/LICENSE-2.0
+//
+// THIS CODE IS PROVIDED *AS IS* BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, EITHER EXPRESS OR IMPLIED, INCLUDING WITHOUT LIMITATION ANY IMPLIED
+// WARRANTIES OR CONDITIONS OF TITLE, FITNESS FOR A PARTICULAR PURPOSE,
+// MERCHANTABLITY OR NON-INFRINGEMENT.
+// See the Apache 2 License for the specific language governing permissions and
+// limitations under the License.
+
+#include <algorithm>
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <iomanip>
+#include <iostream>
+#include <mutex>
+#include <sstream>
+#include <thread>
+#if !defined(_MSC_VER)
+#include <sys/types.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+#include <netdb.h>
+#include <signal.h>
+#include <unistd.h>
+#endif
+
+#include "util/parse-options.h"
+#include "util/kaldi-table.h"
+#include "feat/wave-reader.h"
+#include "online/online-audio-source.h"
+#include "online/online-tcp-source.h"
+#include "online2/online-speex-wrapper.h"
+
+namespace kaldi {
+
+// What has been read from a socket but not used yet.
+struct ReadBuffer {
+  ReadBuffer(): offset(0), fill(0) { }
+  int32 offset;
+  int32 fill;
+  char data[1025];
+};
+
+bool WriteFull(int32 desc, char* data, int32 size);
+bool ReadLine(int32 desc, ReadBuffer *buffer, std::string* str);
+bool ReadMessage(int32 desc, ReadBuffer *buffer, std::string* msg);
+std::string TimeToTimecode(float time);
+
+struct RecognizedWord {
+  std::string word;
+  float start, end;
+};
+
+std::string JsonString(const std::string &json, const std::string &key);
+float JsonNumber(const std::string &json, const std::string &key);
+void JsonWords(const std::string &json, const std::string &key,
+               std::vector<RecognizedWord> *words);
+
+// A result sent by the server, in either format.
+struct ClientResult {
+  enum Type { kPartial, kFinal, kDone };
+  Type type;
+  // For partial results, the words that are fixed, then those that may
+  // still change (only given in the JSON format); for final ones, all the
+  // words of the utterance.
+  std::vector<RecognizedWord> words;
+  std::vector<RecognizedWord> unstable_words;
+  // For final results only; "utt_end" is where the utterance ends, in
+  // seconds from the start of the file (only given in the JSON format, -1
+  // otherwise).
+  float input_dur, reco_dur, utt_end;
+};
+
+// Read the next result; return false if the server disconnected.
+bool ReadTextResult(int32 desc, ReadBuffer *buffer, ClientResult *result);
+bool ReadJsonResult(int32 desc, ReadBuffer *buffer, ClientResult *result);
+
+void WriteHtkLabels(const std::string &wav_key,
+                    const std::vector<RecognizedWord> &results);
+void WriteVttSubtitles(const std::string &wav_key,
+                       const std::vector<RecognizedWord> &results);
+
+// Seconds since some fixed point in time, from a clock that only goes
+// forward.
+static double Now() {
+  return std::chrono::duration<double>(
+      std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+// Counts latencies in bins of 10 ms, up to 10 s, and the longer ones in a
+// last bin, so that the percentiles come out to within 10 ms.
+class LatencyHistogram {
+ public:
+  LatencyHistogram(): counts_(kNumBins + 1, 0), count_(0), total_(0.0),
+                      max_(0.0) { }
+
+  void Add(double latency);
+  void Add(const LatencyHistogram &other);
+  int64 Count() const { return count_; }
+  // The latency that fraction "q" of them do not exceed, rounded up to the
+  // end of its bin.
+  double Percentile(double q) const;
+  // The count, mean, median, 90th and 99th percentiles and maximum.
+  std::string Summary() const;
+  // One line for each of the bins that are not empty.
+  std::string Bins() const;
+
+ private:
+  static const int32 kNumBins = 1000;
+  static const int32 kBinsPerSecond = 100;
+  std::vector<int64> counts_;
+  int64 count_;
+  double total_, max_;
+};
+
+struct ClientSetup {
+  sockaddr_in server;
+  bool htk, vtt;
+  int32 packet_size;
+  bool speex; // asks the server for Speex
+  SpeexOptions speex_opts;
+  bool json_results;
+  BaseFloat realtime_factor; // 0: as fast as the connection goes
+  bool print_results; // prints the words as they come, to the standard output
+};
+
+// Hands out the files to the streams, one at a time, in the order they are
+// read.
+class WaveQueue {
+ public:
+  WaveQueue(const std::string &wav_rspecifier, int32 channel):
+      reader_(wav_rspecifier), channel_(channel) { }
+
+  // Outputs the samples of the next file (of the channel asked for); returns
+  // false if there are no more.
+  bool Next(std::string *key, Vector<BaseFloat> *samples);
+
+ private:
+  std::mutex mutex_;
+  SequentialTableReader<WaveHolder> reader_;
+  int32 channel_;
+};
+
+// A connection to the server, which sends the files it gets from the queue
+// one after the other, each of them paced to "realtime_factor" times real
+// time if it is set, while another thread receives the results, so that the
+// latency of each result can be measured as the server sees it.
+class ClientStream {
+ public:
+  ClientStream(int32 id, const ClientSetup &setup, WaveQueue *queue):
+      id_(id), setup_(setup), queue_(queue), desc_(-1), use_speex_(false),
+      sending_done_(false), failed_(false), num_files_(0), audio_sent_(0.0),
+      reco_time_(0.0) { }
+  ~ClientStream() {
+    if (desc_ != -1)
+      close(desc_);
+  }
+
+  // Connects to the server and starts sending and receiving; returns false
+  // if it could not connect.
+  bool Start();
+  // Waits until all the results are in.
+  void Join();
+
+  // Whether the connection ended before all the results were in.
+  bool Failed() const { return failed_; }
+  int32 NumFiles() const { return num_files_; }
+  // Seconds of audio.
+  double AudioSent() const { return audio_sent_; }
+  double RecoTime() const { return reco_time_; }
+
+  // From the start of a file to the first partial result with words in it.
+  const LatencyHistogram &FirstPartialLatency() const {
+    return first_partial_;
+  }
+  // From sending the end of an utterance to receiving its final result.
+  const LatencyHistogram &FinalLatency() const { return final_; }
+  // From sending the end of a file to receiving all its results.
+  const LatencyHistogram &EndOfAudioLatency() const { return end_of_audio_; }
+
+ private:
+  // A file that is being sent, or whose results are not all in yet.
+  struct SentFile {
+    SentFile(const std::string &key, double start_time):
+        key(key), start_time(start_time), end_time(-1.0) { }
+    std::string key;
+    double start_time; // when sending it began, which the pacing is from
+    double end_time; // when the end of its audio was sent; -1 until then
+    // The number of samples sent up to each packet, and when it went.
+    std::vector<std::pair<int64, double> > packets;
+  };
+
+  void Send();
+  void SendFile(const std::string &key, const Vector<BaseFloat> &samples);
+  void Receive();
+  void ReceiveFile();
+  // When the packet with the sample at "audio_time" seconds into the file
+  // was sent.  Needs the lock.
+  double SentTime(const SentFile &file, double audio_time) const;
+  // Ends the connection, so that the other thread stops too.
+  void Fail(const std::exception &e);
+
+  int32 id_;
+  const ClientSetup &setup_;
+  WaveQueue *queue_;
+  int32 desc_;
+  bool use_speex_;
+  ReadBuffer read_buffer_;
+  std::thread sender_, receiver_;
+
+  // Guards what the sender and the receiver share, below.
+  std::mutex mutex_;
+  std::condition_variable files_cond_;
+  std::deque<SentFile> files_;
+  bool sending_done_;
+  bool failed_;
+
+  // Only written by the receiver.
+  int32 num_files_;
+  double audio_sent_, reco_time_;
+  LatencyHistogram first_partial_, final_, end_of_audio_;
+};
+
+}  //namespace kaldi
+
+int main(int argc, char** argv) {
+  using namespace kaldi;
+  typedef kaldi::int32 int32;
+  #if !defined(_MSC_VER)
+  try {
+    //发送一个音频文件给kaldi音频服务器(onlinebin/online-audio-server-decode-faster)
+    //并且可选地打印其存储到HTK标签的文件或者webvtt文件
+    const char *usage =
+        "Sends an audio file to the KALDI audio server (onlinebin/online-audio-server-decode-faster)\n"
+            "and prints the result optionally saving it to an HTK label file or WebVTT subtitles file\n"
+            "With --num-streams > 1, sends the files over that many connections at once, and\n"
+            "with --realtime-factor, at the pace of real time (or faster), to measure how\n"
+            "the server keeps up: the latencies of the results are printed at the end.\n\n"
+            "e.g.: ./online-audio-client 192.168.50.12 9012 'scp:wav_files.scp'\n"
+            "      ./online-audio-client --num-streams=32 --realtime-factor=1 192.168.50.12 9012 'scp:wav_files.scp'\n\n";
+    ParseOptions po(usage);
+
+    bool htk = false, vtt = false;
+    int32 channel = -1;
+    int32 packet_size = 1024;
+    std::string codec = "pcm";
+    std::string result_format = "text";
+    int32 num_streams = 1;
+    BaseFloat realtime_factor = 0.0;
+    BaseFloat ramp_up_time = 0.0;
+    SpeexOptions speex_opts;
+
+    po.Register("htk", &htk, "Save the result to an HTK label file");
+    po.Register("vtt", &vtt, "Save the result to a WebVTT subtitle file");
+    po.Register(
+        "channel", &channel,
+        "Channel to extract (-1 -> expect mono, 0 -> left, 1 -> right)");
+    po.Register("packet-size", &packet_size,
+                "Send this many bytes per packet (of samples, before any "
+                "compression)");
+    po.Register("codec", &codec, "Send the audio as \"pcm\" (16-bit samples) "
+                "or \"speex\", compressed, if the server accepts it (see "
+                "its option --speex); the --speex-* options must match the "
+                "server's");
+    po.Register("result-format", &result_format, "Expect the results as "
+                "\"text\" or \"json\" messages; must match the server's "
+                "--result-format");
+    po.Register("num-streams", &num_streams, "Send the files over this many "
+                "connections at once, each one taking the next file when it "
+                "is done with one (the results are only printed if 1)");
+    po.Register("realtime-factor", &realtime_factor, "Send the audio this "
+                "many times faster than real time, a packet being sent once "
+                "all its audio would have been recorded (0: as fast as the "
+                "server takes it)");
+    po.Register("ramp-up-time", &ramp_up_time, "Start the streams evenly "
+                "spread over this many seconds, instead of all at once");
+    speex_opts.Register(&po);
+
+    po.Read(argc, argv);
+    if (po.NumArgs() != 3) {
+      po.PrintUsage();
+      return 1;
+    }
+    if (result_format != "text" && result_format != "json")
+      KALDI_ERR << "Invalid --result-format " << result_format;
+    if (codec != "pcm" && codec != "speex")
+      KALDI_ERR << "Unknown codec " << codec;
+    if (num_streams < 1 || packet_size < 2 || realtime_factor < 0.0 ||
+        ramp_up_time < 0.0)
+      KALDI_ERR << "Invalid options";
+
+    std::string server_addr_str = po.GetArg(1);
+    std::string server_port_str = po.GetArg(2);
+    int32 server_port = strtol(server_port_str.c_str(), 0, 10);
+    std::string wav_rspecifier = po.GetArg(3);
+
+    struct hostent* hp;
+    unsigned long addr;
+
+    addr = inet_addr(server_addr_str.c_str());
+    if (addr == INADDR_NONE) {
+      hp = gethostbyname(server_addr_str.c_str());
+      if (hp == NULL) {
+        std::cerr << "ERROR: couldn't resolve host string: " << server_addr_str
+                  << std::endl;
+        return -1;
+      }
+
+      addr = *((unsigned long*) hp->h_addr);
+    }
+
+    ClientSetup setup;
+    memset(&setup.server, 0, sizeof(setup.server));
+    setup.server.sin_addr.s_addr = addr;
+    setup.server.sin_family = AF_INET;
+    setup.server.sin_port = htons(server_port);
+    setup.htk = htk;
+    setup.vtt = vtt;
+    setup.packet_size = packet_size;
+    setup.speex = (codec == "speex");
+    setup.speex_opts = speex_opts;
+    setup.json_results = (result_format == "json");
+    setup.realtime_factor = realtime_factor;
+    setup.print_results = (num_streams == 1);
+
+    // A connection that fails must not kill the process.
+    signal(SIGPIPE, SIG_IGN);
+
+    WaveQueue queue(wav_rspecifier, channel);
+    std::vector<ClientStream*> streams;
+    double start_time = Now();
+    int32 num_failed = 0;
+    for (int32 i = 0; i < num_streams; i++) {
+      double delay = start_time + ramp_up_time * i / num_streams - Now();
+      if (delay > 0.0)
+        std::this_thread::sleep_for(std::chrono::duration<double>(delay));
+      ClientStream *stream = new ClientStream(i, setup, &queue);
+      if (stream->Start()) {
+        streams.push_back(stream);
+      } else {
+        delete stream;
+        num_failed++;
+      }
+    }
+    if (!streams.empty()) {
+      KALDI_VLOG(2) << "Connected to KALDI server at host " << server_addr_str
+                    << " port " << server_port << std::endl;
+    }
+
+    LatencyHistogram first_partial_latency, final_latency, end_of_audio_latency;
+    int32 num_files = 0;
+    double audio_sent = 0.0, reco_time = 0.0;
+    for (size_t i = 0; i < streams.size(); i++) {
+      ClientStream &stream = *streams[i];
+      stream.Join();
+      if (stream.Failed())
+        num_failed++;
+      num_files += stream.NumFiles();
+      audio_sent += stream.AudioSent();
+      reco_time += stream.RecoTime();
+      first_partial_latency.Add(stream.FirstPartialLatency());
+      final_latency.Add(stream.FinalLatency());
+      end_of_audio_latency.Add(stream.EndOfAudioLatency());
+      if (num_streams > 1)
+        KALDI_LOG << "Stream " << i << ": " << stream.NumFiles()
+                  << " files, " << stream.AudioSent() << "s of audio; "
+                  << "latency of the first partial result: "
+                  << stream.FirstPartialLatency().Summary()
+                  << "; of the final results: "
+                  << stream.FinalLatency().Summary()
+                  << "; from the end of the audio to the last result: "
+                  << stream.EndOfAudioLatency().Summary();
+      delete streams[i];
+    }
+    double elapsed = Now() - start_time;
+
+    if (num_streams > 1 || realtime_factor > 0.0) {
+      KALDI_LOG << "Sent " << num_files << " files, " << audio_sent
+                << "s of audio, over " << streams.size() << " connections in "
+                << elapsed << "s (" << (audio_sent / elapsed)
+                << " times real time); the server took " << reco_time
+                << "s to decode them (RTF "
+                << (audio_sent > 0.0 ? reco_time / audio_sent : 0.0) << ")";
+      KALDI_LOG << "Latency of the first partial result: "
+                << first_partial_latency.Summary();
+      KALDI_LOG << "Latency of the final results: " << final_latency.Summary();
+      KALDI_LOG << "Latency from the end of the audio to the last result: "
+                << end_of_audio_latency.Summary();
+      KALDI_VLOG(1) << "Histogram of the latency of the first partial "
+                    << "result:\n" << first_partial_latency.Bins();
+      KALDI_VLOG(1) << "Histogram of the latency of the final results:\n"
+                    << final_latency.Bins();
+      KALDI_VLOG(1) << "Histogram of the latency from the end of the audio "
+                    << "to the last result:\n" << end_of_audio_latency.Bins();
+    }
+    if (num_failed > 0) {
+      KALDI_WARN << num_failed << " of the " << num_streams
+                 << " connections failed";
+      return -1;
+    }
+  }
+
+  catch (const std::exception& e) {
+    std::cerr << e.what();
+    return -1;
+  }
+
+#endif
+  return 0;
+}
+
+
+namespace kaldi {
+
+bool WaveQueue::Next(std::string *key, Vector<BaseFloat> *samples) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  for (; !reader_.Done(); reader_.Next()) {
+    std::string wav_key = reader_.Key();
+
+    KALDI_VLOG(2) << "File: " << wav_key << std::endl;
+
+    const WaveData &wav_data = reader_.Value();
+     //需要采样频率为16khz
+    if (wav_data.SampFreq() != 16000)
+      KALDI_ERR << "Sampling rates other than 16kHz are not supported!";
+
+    int32 num_chan = wav_data.Data().NumRows(), this_chan = channel_;
+    {   // This block works out the channel (0=left, 1=right...)
+      KALDI_ASSERT(num_chan > 0);  // should have been caught in
+      // reading code if no channels.
+      if (channel_ == -1) {
+        this_chan = 0;
+        if (num_chan != 1)
+          KALDI_WARN << "Channel not specified but you have data with "
+              << num_chan << " channels; defaulting to zero";
+      } else {
+        if (this_chan >= num_chan) {
+          KALDI_WARN << "File with id " << wav_key << " has " << num_chan
+              << " channels but you specified channel " << channel_
+              << ", producing no output.";
+          continue;
+        }
+      }
+    }
+
+    *key = wav_key;
+    *samples = wav_data.Data().Row(this_chan);
+    reader_.Next();
+    return true;
+  }
+  return false;
+}
+
+bool ClientStream::Start() {
+  desc_ = socket(AF_INET, SOCK_STREAM, 0);
+  if (desc_ == -1) {
+    KALDI_WARN << "Couldn't create socket!";
+    return false;
+  }
+  if (::connect(desc_, (const struct sockaddr*) &setup_.server,
+                sizeof(setup_.server))) {
+    KALDI_WARN << "Couldn't connect to server!";
+    return false;
+  }
+
+  if (setup_.speex) {
+    // Asks for the codec, and waits for the server to say whether it will
+    // take it.
+    int32 request[2] = { -1, kTcpCodecSpeex };
+    std::string line;
+    if (!WriteFull(desc_, (char*) request, sizeof(request)) ||
+        !ReadLine(desc_, &read_buffer_, &line)) {
+      KALDI_WARN << "Server disconnected!";
+      return false;
+    }
+    if (line == std::string("CODEC:") + OnlineTcpCodecName(kTcpCodecSpeex)) {
+      use_speex_ = true;
+    } else if (line == std::string("CODEC:") +
+               OnlineTcpCodecName(kTcpCodecPcm)) {
+      KALDI_WARN << "The server does not accept Speex; sending PCM instead";
+    } else {
+      KALDI_WARN << "Header parse error: " << line;
+      return false;
+    }
+  }
+
+  sender_ = std::thread(&ClientStream::Send, this);
+  receiver_ = std::thread(&ClientStream::Receive, this);
+  return true;
+}
+
+void ClientStream::Join() {
+  sender_.join();
+  receiver_.join();
+  close(desc_);
+  desc_ = -1;
+}
+
+void ClientStream::Fail(const std::exception &e) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  if (!failed_)
+    KALDI_WARN << "Stream " << id_ << " failed: " << e.what();
+  failed_ = true;
+  shutdown(desc_, SHUT_RDWR);
+}
+
+void ClientStream::Send() {
+  try {
+    std::string key;
+    Vector<BaseFloat> samples;
+    while (queue_->Next(&key, &samples)) {
+      SendFile(key, samples);
+      std::lock_guard<std::mutex> lock(mutex_);
+      if (failed_)
+        break;
+    }
+  } catch (const std::exception &e) {
+    Fail(e);
+  }
+  std::lock_guard<std::mutex> lock(mutex_);
+  sending_done_ = true;
+  files_cond_.notify_all();
+}
+
+void ClientStream::SendFile(const std::string &key,
+                            const Vector<BaseFloat> &samples) {
+  double start_time = Now();
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    files_.push_back(SentFile(key, start_time));
+    files_cond_.notify_all();
+  }
+
+  OnlineVectorSource au_src(samples);
+  OnlineSpeexEncoder speex_encoder(setup_.speex_opts);
+  std::vector<char> speex_bits;
+  // The size of the packet, then its data, sent with one system call.
+  std::vector<char> pack_buffer(4 + setup_.packet_size);
+  Vector < BaseFloat > data(setup_.packet_size / 2);
+  int64 samples_sent = 0, bytes_sent = 0;
+  bool more = true;
+  while (more) {
+    int32 num_read;
+    more = au_src.ReadInto(&data, &num_read);
+    SubVector<BaseFloat> packet_samples(data, 0, num_read);
+    int32 size;
+    if (use_speex_) {
+      // Only whole Speex frames come out, so a packet may be empty
+      // until the last one.
+      if (num_read > 0)
+        speex_encoder.AcceptWaveform(16000, packet_samples);
+      if (!more)
+        speex_encoder.InputFinished();
+      speex_encoder.GetSpeexBits(&speex_bits);
+      size = speex_bits.size();
+      pack_buffer.resize(4 + size);
+      if (size > 0)
+        memcpy(&pack_buffer[4], &speex_bits[0], size);
+    } else {
+      for (int32 i = 0; i < num_read; i++) {
+        short sample = (short) packet_samples(i);
+        memcpy(&pack_buffer[4 + i * 2], (char*) &sample, 2);
+      }
+      size = num_read * 2;
+    }
+    samples_sent += num_read;
+    if (size == 0)
+      continue;  // an empty packet would end the stream
+
+    if (setup_.realtime_factor > 0.0) {
+      // The packet goes once the last of its audio would have been
+      // recorded.
+      double delay = start_time + samples_sent /
+          (16000.0 * setup_.realtime_factor) - Now();
+      if (delay > 0.0)
+        std::this_thread::sleep_for(std::chrono::duration<double>(delay));
+    }
+    memcpy(&pack_buffer[0], (char*) &size, 4);
+    if (!WriteFull(desc_, &pack_buffer[0], 4 + size))
+      KALDI_ERR << "Server disconnected!";
+    bytes_sent += 4 + size;
+
+    std::lock_guard<std::mutex> lock(mutex_);
+    files_.back().packets.push_back(std::make_pair(samples_sent, Now()));
+  }
+  double duration = samples.Dim() / 16000.0;
+  KALDI_VLOG(2) << "Sent " << bytes_sent << " bytes, for "
+                << duration << "s of audio ("
+                << (bytes_sent / duration / 1000.0)
+                << " kB/s)" << std::endl;
+
+  //send last packet
+  int32 size = 0;
+  if (!WriteFull(desc_, (char*) &size, 4))
+    KALDI_ERR << "Server disconnected!";
+
+  std::lock_guard<std::mutex> lock(mutex_);
+  files_.back().end_time = Now();
+}
+
+double ClientStream::SentTime(const SentFile &file, double audio_time) const {
+  int64 sample = static_cast<int64>(audio_time * 16000.0 + 0.5);
+  std::vector<std::pair<int64, double> >::const_iterator iter =
+      std::lower_bound(file.packets.begin(), file.packets.end(),
+                       std::make_pair(sample, -1.0));
+  if (iter != file.packets.end())
+    return iter->second;
+  // The server may count some samples more than were sent, as its durations
+  // are rounded.
+  if (file.end_time >= 0.0)
+    return file.end_time;
+  return (file.packets.empty() ? file.start_time : file.packets.back().second);
+}
+
+void ClientStream::Receive() {
+  try {
+    while (true) {
+      {
+        std::unique_lock<std::mutex> lock(mutex_);
+        while (files_.empty() && !sending_done_)
+          files_cond_.wait(lock);
+        if (files_.empty())
+          break;
+      }
+      ReceiveFile();
+      std::lock_guard<std::mutex> lock(mutex_);
+      files_.pop_front();
+    }
+  } catch (const std::exception &e) {
+    Fail(e);
+  }
+}
+
+void ClientStream::ReceiveFile() {
+  std::string reco_output;
+  std::vector<RecognizedWord> results;
+  float total_input_dur = 0.0f, total_reco_dur = 0.0f;
+  bool got_partial = false;
+  std::string wav_key;
+
+  ClientResult result;
+  while (true) {
+    bool ok = (setup_.json_results ?
+               ReadJsonResult(desc_, &read_buffer_, &result) :
+               ReadTextResult(desc_, &read_buffer_, &result));
+    if (!ok)
+      KALDI_ERR << "Server disconnected!";
+    double now = Now();
+
+    if (result.type == ClientResult::kPartial) {
+      if (!got_partial &&
+          !(result.words.empty() && result.unstable_words.empty())) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        first_partial_.Add(now - files_.front().start_time);
+        got_partial = true;
+      }
+      if (setup_.print_results) {
+        for (size_t i = 0; i < result.words.size(); i++)
+          std::cout << result.words[i].word << " ";
+        std::cout << std::flush;
+      }
+    } else if (result.type == ClientResult::kFinal) {
+      total_input_dur += result.input_dur;
+      total_reco_dur += result.reco_dur;
+      {
+        std::lock_guard<std::mutex> lock(mutex_);
+        // Without the utterance end, the audio decoded so far is the best
+        // guess.
+        float utt_end = (result.utt_end >= 0.0f ? result.utt_end :
+                         total_input_dur);
+        final_.Add(now - SentTime(files_.front(), utt_end));
+      }
+      if (setup_.print_results)
+        std::cout << std::endl;
+      for (size_t i = 0; i < result.words.size(); i++) {
+        results.push_back(result.words[i]);
+        reco_output += result.words[i].word + " ";
+      }
+    } else {
+      if (setup_.print_results)
+        std::cout << std::endl;
+      std::lock_guard<std::mutex> lock(mutex_);
+      end_of_audio_.Add(now - files_.front().end_time);
+      audio_sent_ += files_.front().packets.empty() ? 0.0 :
+          files_.front().packets.back().first / 16000.0;
+      wav_key = files_.front().key;
+      break;
+    }
+  }
+  num_files_++;
+  reco_time_ += total_reco_dur;
+
+  {
+    float speed = total_input_dur / total_reco_dur;
+    KALDI_VLOG(2) << "Recognized (" << speed << "xRT): " << reco_output
+        << std::endl;
+  }
+
+  if (setup_.htk)
+    WriteHtkLabels(wav_key, results);
+  if (setup_.vtt && !results.empty())
+    WriteVttSubtitles(wav_key, results);
+}
+
+void LatencyHistogram::Add(double latency) {
+  latency = std::max(latency, 0.0);
+  int32 bin = std::min(static_cast<int32>(latency * kBinsPerSecond),
+                       static_cast<int32>(kNumBins));
+  counts_[bin]++;
+  count_++;
+  total_ += latency;
+  max_ = std::max(max_, latency);
+}
+
+void LatencyHistogram::Add(const LatencyHistogram &other) {
+  for (size_t i = 0; i < counts_.size(); i++)
+    counts_[i] += other.counts_[i];
+  count_ += other.count_;
+  total_ += other.total_;
+  max_ = std::max(max_, other.max_);
+}
+
+double LatencyHistogram::Percentile(double q) const {
+  int64 needed = std::max(static_cast<int64>(q * count_ + 0.999999),
+                          static_cast<int64>(1)), sum = 0;
+  for (int32 bin = 0; bin < kNumBins; bin++) {
+    sum += counts_[bin];
+    if (sum >= needed)
+      return std::min((bin + 1.0) / kBinsPerSecond, max_);
+  }
+  return max_;
+}
+
+std::string LatencyHistogram::Summary() const {
+  if (count_ == 0)
+    return "none";
+  std::ostringstream os;
+  os << std::fixed << std::setprecision(3) << "count " << count_ << ", mean "
+     << (total_ / count_) << "s, median " << Percentile(0.5) << "s, 90% "
+     << Percentile(0.9) << "s, 99% " << Percentile(0.99) << "s, max "
+     << max_ << "s";
+  return os.str();
+}
+
+std::string LatencyHistogram::Bins() const {
+  std::ostringstream os;
+  os << std::fixed << std::setprecision(2);
+  for (int32 bin = 0; bin <= kNumBins; bin++) {
+    if (counts_[bin] == 0)
+      continue;
+    os << static_cast<double>(bin) / kBinsPerSecond << "s";
+    if (bin < kNumBins)
+      os << " to " << (bin + 1.0) / kBinsPerSecond << "s";
+    else
+      os << " or more";
+    os << ": " << counts_[bin] << "\n";
+  }
+  return os.str();
+}
+
+bool ReadTextResult(int32 desc, ReadBuffer *buffer, ClientResult *result) {
+  std::string line;
+  if (!ReadLine(desc, buffer, &line))
+    return false;
+  result->words.clear();
+  result->unstable_words.clear();
+  result->input_dur = result->reco_dur = 0.0f;
+  result->utt_end = -1.0f;
+
+  if (line.substr(0, 7) != "RESULT:") {
+    if (line.substr(0, 8) == "PARTIAL:") {
+      RecognizedWord word;
+      word.word = line.substr(8);
+      word.start = word.end = 0.0f; // not given
+      result->type = ClientResult::kPartial;
+      result->words.push_back(word);
+      return true;
+    }
+    KALDI_ERR << "Header parse error: " << line;
+  }
+
+  if (line == "RESULT:DONE") {
+    result->type = ClientResult::kDone;
+    return true;
+  }
+  result->type = ClientResult::kFinal;
+
+  int32 res_num = 0;
+
+  std::string tok, key, val;
+  size_t beg = 7, end, eq;
+
+  do {
+    end = line.find_first_of(',', beg);
+    tok = line.substr(beg, end - beg);
+    beg = end + 1;
+    eq = tok.find_first_of('=');
+    if (eq == std::string::npos || eq >= tok.size() - 1) {
+      KALDI_WARN << "Error parsing header token " << tok;
+      continue;
+    }
+
+    key = tok.substr(0, eq);
+    val = tok.substr(eq + 1);
+
+    if (key == "NUM") {
+      res_num = strtol(val.c_str(), 0, 10);
+    } else if (key == "FORMAT") {
+      if (val != "WSE") {
+        KALDI_ERR << "Only WSE format supported by this program!";
+      }
+    } else if (key == "RECO-DUR") {
+      result->reco_dur = strtof(val.c_str(), 0);
+    } else if (key == "INPUT-DUR") {
+      result->input_dur = strtof(val.c_str(), 0);
+    } else {
+      KALDI_WARN << "Unknown header key: " << key;
+    }
+  } while (end != std::string::npos);
+
+  for (int32 i = 0; i < res_num; i++) {
+    std::string line;
+    if (!ReadLine(desc, buffer, &line))
+      return false;
+
+    std::string word_str, start_str, end_str;
+
+    end = line.find_first_of(',');
+    word_str = line.substr(0, end);
+    beg = end + 1;
+    end = line.find_first_of(',', beg);
+    start_str = line.substr(beg, end - beg);
+    beg = end + 1;
+    end = line.find_first_of(',', beg);
+    end_str = line.substr(beg, end - beg);
+
+    RecognizedWord word;
+    word.word = word_str;
+    word.start = strtof(start_str.c_str(), 0);
+    word.end = strtof(end_str.c_str(), 0);
+
+    result->words.push_back(word);
+  }
+  return true;
+}
+
+bool ReadJsonResult(int32 desc, ReadBuffer *buffer, ClientResult *result) {
+  std::string msg;
+  if (!ReadMessage(desc, buffer, &msg))
+    return false;
+  result->words.clear();
+  result->unstable_words.clear();
+  result->input_dur = result->reco_dur = 0.0f;
+  result->utt_end = -1.0f;
+
+  std::string type = JsonString(msg, "type");
+  if (type == "partial") {
+    result->type = ClientResult::kPartial;
+    JsonWords(msg, "stable", &result->words);
+    JsonWords(msg, "unstable", &result->unstable_words);
+  } else if (type == "final") {
+    result->type = ClientResult::kFinal;
+    JsonWords(msg, "words", &result->words);
+    result->input_dur = JsonNumber(msg, "input_dur");
+    result->reco_dur = JsonNumber(msg, "reco_dur");
+    result->utt_end = JsonNumber(msg, "utterance_end");
+  } else if (type == "done") {
+    result->type = ClientResult::kDone;
+  } else {
+    KALDI_ERR << "Message parse error: " << msg;
+  }
+  return true;
+}
+
+void WriteHtkLabels(const std::string &wav_key,
+                    const std::vector<RecognizedWord> &results) {
+  std::string name = wav_key + ".lab";
+  std::ofstream htk_file(name.c_str());
+  for (size_t i = 0; i < results.size(); i++)
+    htk_file << (int) (results[i].start * 10000000) << " "
+        << (int) (results[i].end * 10000000) << " " << results[i].word << std::endl;
+  htk_file.close();
+}
+
+void WriteVttSubtitles(const std::string &wav_key,
+                       const std::vector<RecognizedWord> &results) {
+  std::vector<RecognizedWord> subtitles;
+  RecognizedWord subtitle_cue;
+
+  subtitle_cue.start = -1;
+  subtitle_cue.end = -1;
+  subtitle_cue.word = "";
+
+  for (size_t i = 0; i < results.size(); i++) {
+    if (subtitle_cue.end >= 0) {
+      if (results[i].start - subtitle_cue.end > 3.0f
+          || results[i].word.size() + subtitle_cue.word.size() > 64) {
+
+        if (results[i].start - subtitle_cue.end < 0.1f)
+          subtitle_cue.end = results[i].start - 0.1f;
+
+        subtitles.push_back(subtitle_cue);
+        subtitle_cue.start = -1;
+        subtitle_cue.end = -1;
+        subtitle_cue.word = "";
+
+      }
+    }
+
+    if (subtitle_cue.start < 0)
+      subtitle_cue.start = results[i].start;
+    else
+      subtitle_cue.word += " ";
+
+    subtitle_cue.end = results[i].end + 1.0f;
+
+    subtitle_cue.word += results[i].word;
+  }
+
+  subtitles.push_back(subtitle_cue);
+
+  std::string name = wav_key + ".vtt";
+  std::ofstream vtt_file(name.c_str());
+
+  vtt_file << "WEBVTT FILE" << std::endl << std::endl;
+
+  for (size_t i = 0; i < subtitles.size(); i++)
+    vtt_file << (i + 1) << std::endl << TimeToTimecode(subtitles[i].start)
+        << " --> " << TimeToTimecode(subtitles[i].end) << std::endl
+        << subtitles[i].word << std::endl << std::endl;
+
+  vtt_file.close();
+}
+
+bool WriteFull(int32 desc, char* data, int32 size) {
+  int32 to_write = size;
+  int32 wrote = 0;
+  while (to_write > 0) {
+    int32 ret = write(desc, data + wrote, to_write);
+    if (ret <= 0)
+      return false;
+
+    to_write -= ret;
+    wrote += ret;
+  }
+
+  return true;
+}
+
+bool ReadLine(int32 desc, ReadBuffer *buffer, std::string* str) {
+  int32 &buffer_offset = buffer->offset, &buffer_fill = buffer->fill;
+  char *read_buffer = buffer->data;
+  *str = "";
+
+  while (true) {
+    if (buffer_offset >= buffer_fill) {
+      buffer_fill = read(desc, read_buffer, 1024);
+
+      if (buffer_fill <= 0)
+        break;
+
+      buffer_offset = 0;
+    }
+
+    for (int32 i = buffer_offset; i < buffer_fill; i++) {
+      if (read_buffer[i] == '\r' || read_buffer[i] == '\n') {
+        read_buffer[i] = 0;
+        *str += (read_buffer + buffer_offset);
+
+        buffer_offset = i + 1;
+
+        if (i < buffer_fill) {
+          if (read_buffer[i] == '\n' && read_buffer[i + 1] == '\r') {
+            read_buffer[i + 1] = 0;
+            buffer_offset = i + 2;
+          }
+          if (read_buffer[i] == '\r' && read_buffer[i + 1] == '\n') {
+            read_buffer[i + 1] = 0;
+            buffer_offset = i + 2;
+          }
+        }
+
+        return true;
+      }
+    }
+
+    read_buffer[buffer_fill] = 0;
+    *str += (read_buffer + buffer_offset);
+    buffer_offset = buffer_fill;
+  }
+
+  return false;
+}
+
+bool ReadMessage(int32 desc, ReadBuffer *buffer, std::string* msg) {
+  int32 &buffer_offset = buffer->offset, &buffer_fill = buffer->fill;
+  char *read_buffer = buffer->data;
+  char size_buf[4];
+  int32 size = -1, got = 0;
+  while (size < 0 || got < size) {
+    if (buffer_offset >= buffer_fill) {
+      buffer_fill = read(desc, read_buffer, 1024);
+
+      if (buffer_fill <= 0)
+        return false;
+
+      buffer_offset = 0;
+    }
+    if (size < 0) {
+      size_buf[got++] = read_buffer[buffer_offset++];
+      if (got == 4) {
+        memcpy(&size, size_buf, 4);
+        if (size < 0)
+          return false;
+        msg->resize(size);
+        got = 0;
+      }
+    } else {
+      int32 n = std::min(buffer_fill - buffer_offset, size - got);
+      msg->replace(got, n, read_buffer + buffer_offset, n);
+      buffer_offset += n;
+      got += n;
+    }
+  }
+  return true;
+}
+
+// The server's JSON messages are flat, apart from the arrays of words, so
+// the fields are simply looked up by their names.
+
+// Returns the position after the value of "key", or npos.
+static size_t JsonFind(const std::string &json, const std::string &key,
+                       size_t pos) {
+  pos = json.find("\"" + key + "\":", pos);
+  return (pos == std::string::npos ? pos : pos + key.size() + 3);
+}
+
+// Reads the string starting at "pos"; returns the position after it.
+static size_t JsonReadString(const std::string &json, size_t pos,
+                             std::string *str) {
+  *str = "";
+  if (pos >= json.size() || json[pos] != '"')
+    return std::string::npos;
+  for (pos++; pos < json.size() && json[pos] != '"'; pos++) {
+    char c = json[pos];
+    if (c == '\\' && pos + 1 < json.size()) {
+      c = json[++pos];
+      if (c == 'n') {
+        c = '\n';
+      } else if (c == 't') {
+        c = '\t';
+      } else if (c == 'u' && pos + 4 < json.size()) {
+        // The server only escapes control characters this way.
+        c = static_cast<char>(strtol(json.substr(pos + 1, 4).c_str(), 0, 16));
+        pos += 4;
+      }
+    }
+    *str += c;
+  }
+  return (pos < json.size() ? pos + 1 : std::string::npos);
+}
+
+std::string JsonString(const std::string &json, const std::string &key) {
+  std::string ans;
+  JsonReadString(json, JsonFind(json, key, 0), &ans);
+  return ans;
+}
+
+float JsonNumber(const std::string &json, const std::string &key) {
+  size_t pos = JsonFind(json, key, 0);
+  return (pos == std::string::npos ? 0.0f :
+          strtof(json.c_str() + pos, 0));
+}
+
+void JsonWords(const std::string &json, const std::string &key,
+               std::vector<RecognizedWord> *words) {
+  size_t pos = JsonFind(json, key, 0);
+  if (pos == std::string::npos || json.compare(pos, 1, "[") != 0)
+    return;
+  for (pos++; pos < json.size() && json[pos] != ']'; ) {
+    if (json[pos] == ',')
+      pos++;
+    RecognizedWord word;
+    pos = JsonReadString(json, JsonFind(json, "word", pos), &word.word);
+    if (pos == std::string::npos)
+      break;
+    size_t start_pos = JsonFind(json, "start", pos),
+        end_pos = JsonFind(json, "end", pos);
+    pos = json.find('}', pos);
+    if (pos == std::string::npos || start_pos > pos || end_pos > pos)
+      break;
+    word.start = strtof(json.c_str() + start_pos, 0);
+    word.end = strtof(json.c_str() + end_pos, 0);
+    words->push_back(word);
+    pos++;
+  }
+}
+
+std::string TimeToTimecode(float time) {
+
+  char buf[64];
+
+  int32 h, m, s, ms;
+  s = (int32) time;
+  ms = (int32)((time - (float) s) * 1000.0f);
+  m = s / 60;
+  s %= 60;
+  h = m / 60;
+  m %= 60;
+
+#if !defined(_MSC_VER)
+  snprintf(buf, 64, "%02d:%02d:%02d.%03d", h, m, s, ms);
+#endif
+
+  return buf;
+}
+
+}  //namespace kaldi
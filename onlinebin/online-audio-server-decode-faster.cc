@@ -1,424 +1,701 @@
-// onlinebin/online-audio-server-decode-faster.cc
-
-// Copyright 2012 Cisco Systems (author: Matthias Paulik)
-// Copyright 2013 Polish-Japanese Institute of Information Technology (author: Danijel Korzinek)
-
-//   Modifications to the original contribution by Cisco Systems made by:
-//   Vassil Panayotov
-
-// See ../../COPYING for clarification regarding multiple authors
-//
-// Licensed under the Apache License, Version 2.0 (the "License");
-// you may not use this file except in compliance with the License.
-// You may obtain a copy of the License at
-//
-//  http://www.apache.org/licenses/LICENSE-2.0
-//
-// THIS CODE IS PROVIDED *AS IS* BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
-// KIND, EITHER EXPRESS OR IMPLIED, INCLUDING WITHOUT LIMITATION ANY IMPLIED
-// WARRANTIES OR CONDITIONS OF TITLE, FITNESS FOR A PARTICULAR PURPOSE,
-// MERCHANTABLITY OR NON-INFRINGEMENT.
-// See the Apache 2 License for the specific language governing permissions and
-// limitations under the License.
-
-#include "feat/feature-mfcc.h"
-#include "feat/wave-reader.h"
-#include "online/online-tcp-source.h"
-#include "online/online-feat-input.h"
-#include "online/online-decodable.h"
-#include "online/online-faster-decoder.h"
-#include "online/onlinebin-util.h"
-#include "matrix/kaldi-vector.h"
-#include "lat/word-align-lattice.h"
-#include "lat/lattice-functions.h"
-#include "lat/sausages.h"
-#include "lat/determinize-lattice-pruned.h"
-
-#include <sys/socket.h>
-#include <sys/types.h>
-#include <unistd.h>
-#include <ctime>
-#include <signal.h>
-
-namespace kaldi {
-/*
- * This class is for a very simple TCP server implementation
- * in UNIX sockets.
- */
-  //tcp服务器类
-class TcpServer {
- public:
-  TcpServer();
-  ~TcpServer();
-
-  bool Listen(int32 port);  //开始在给定端口上聆听
-  int32 Accept();  //accept a client and return its descriptor 接收一个客户并且返回其描述符
-
- private:
-  struct sockaddr_in h_addr_;
-  int32 server_desc_;
-};
-
-//write a line of text to socket
-bool WriteLine(int32 socket, std::string line);
-
-//constant allowing to convert frame count to time
-const float kFramesPerSecond = 100.0f;
-}  // namespace kaldi
-
-int32 main(int argc, char *argv[]) {
-  using namespace kaldi;
-  using namespace fst;
-
-  try {
-    typedef kaldi::int32 int32;
-    typedef OnlineFeInput<Mfcc> FeInput;
-    TcpServer tcp_server;
-    signal(SIGPIPE, SIG_IGN);
-
-    // up to delta-delta derivative features are calculated (unless LDA is used)
-    const int32 kDeltaOrder = 2;
-
-    const char *usage =
-        "Starts a TCP server that receives RAW audio and outputs aligned words.\n"
-            "A sample client can be found in: onlinebin/online-audio-client\n\n"
-            "Usage: online-audio-server-decode-faster [options] model-in "
-            "fst-in word-symbol-table silence-phones word_boundary_file tcp-port [lda-matrix-in]\n\n"
-            "example: online-audio-server-decode-faster --verbose=1 --rt-min=0.5 --rt-max=3.0 --max-active=6000\n"
-            "--beam=72.0 --acoustic-scale=0.0769 final.mdl graph/HCLG.fst graph/words.txt '1:2:3:4:5'\n"
-            "graph/word_boundary.int 5000 final.mat\n\n";
-
-    ParseOptions po(usage);
-    BaseFloat acoustic_scale = 0.1;
-    int32 cmn_window = 600, min_cmn_window = 100;  // adds 1 second latency, only at utterance start.
-    int32 right_context = 4, left_context = 4;
-    BaseFloat frame_shift = 0.01;
-
-    OnlineFasterDecoderOpts decoder_opts;
-    decoder_opts.Register(&po, true);
-    OnlineFeatureMatrixOptions feature_reading_opts;
-    feature_reading_opts.Register(&po);
-
-    po.Register("left-context", &left_context,
-                "Number of frames of left context");
-    po.Register("right-context", &right_context,
-                "Number of frames of right context");
-    po.Register("acoustic-scale", &acoustic_scale,
-                "Scaling factor for acoustic likelihoods");
-    po.Register(
-        "cmn-window", &cmn_window,
-        "Number of feat. vectors used in the running average CMN calculation");
-    po.Register("min-cmn-window", &min_cmn_window,
-                "Minumum CMN window used at start of decoding (adds "
-                "latency only at start)");
-    po.Register("frame-shift", &frame_shift,
-                "Time in seconds between frames.\n");
-
-    WordBoundaryInfoNewOpts opts;
-    opts.Register(&po);
-
-    po.Read(argc, argv);
-    if (po.NumArgs() < 6 || po.NumArgs() > 7) {
-      po.PrintUsage();
-      return 1;
-    }
-
-    std::string model_rspecifier = po.GetArg(1), fst_rspecifier = po.GetArg(2),
-        word_syms_filename = po.GetArg(3), silence_phones_str = po.GetArg(4),
-        word_boundary_file = po.GetArg(5), lda_mat_rspecifier = "";
-
-    if (po.NumArgs() == 7)
-      lda_mat_rspecifier = po.GetOptArg(7);
-
-    int32 port = strtol(po.GetArg(6).c_str(), 0, 10);
-
-    std::vector<int32> silence_phones;
-    if (!SplitStringToIntegers(silence_phones_str, ":", false, &silence_phones))
-      KALDI_ERR << "Invalid silence-phones string " << silence_phones_str;
-    if (silence_phones.empty())
-      KALDI_ERR << "No silence phones given!";
-
-    if (!tcp_server.Listen(port))
-      return 0;
-
-    std::cout << "Reading LDA matrix: " << lda_mat_rspecifier << "..."
-        << std::endl;
-    Matrix < BaseFloat > lda_transform;
-    if (lda_mat_rspecifier != "") {
-      bool binary_in;
-      Input ki(lda_mat_rspecifier, &binary_in);
-      lda_transform.Read(ki.Stream(), binary_in);
-    }
-
-    std::cout << "Reading acoustic model: " << model_rspecifier << "..."
-        << std::endl;
-    TransitionModel trans_model;
-    AmDiagGmm am_gmm;
-    {
-      bool binary;
-      Input ki(model_rspecifier, &binary);
-      trans_model.Read(ki.Stream(), binary);
-      am_gmm.Read(ki.Stream(), binary);
-    }
-
-    std::cout << "Reading word list: " << word_syms_filename << "..."
-        << std::endl;
-    fst::SymbolTable *word_syms = NULL;
-    if (!(word_syms = fst::SymbolTable::ReadText(word_syms_filename)))
-      KALDI_ERR << "Could not read symbol table from file "
-          << word_syms_filename;
-
-    std::cout << "Reading word boundary file: " << word_boundary_file << "..."
-        << std::endl;
-    WordBoundaryInfo info(opts, word_boundary_file);
-
-    std::cout << "Reading FST: " << fst_rspecifier << "..." << std::endl;
-    fst::Fst < fst::StdArc > *decode_fst = ReadDecodeGraph(fst_rspecifier);
-
-    // We are not properly registering/exposing MFCC and frame extraction options,
-    // because there are parts of the online decoding code, where some of these
-    // options are hardwired(ToDo: we should fix this at some point)
-    MfccOptions mfcc_opts;
-    mfcc_opts.use_energy = false;
-    int32 frame_length = mfcc_opts.frame_opts.frame_length_ms = 25;
-    int32 mfcc_frame_shift = mfcc_opts.frame_opts.frame_shift_ms = 10;
-
-    int32 window_size = right_context + left_context + 1;
-    decoder_opts.batch_size = std::max(decoder_opts.batch_size, window_size);
-
-    DeterminizeLatticePrunedOptions det_opts;
-    det_opts.max_mem = 50000000;
-    det_opts.max_loop = 0;
-
-    VectorFst < LatticeArc > out_fst;
-    Lattice out_lat;
-    CompactLattice det_lat, aligned_lat;
-    OnlineTcpVectorSource* au_src = NULL;
-    int32 client_socket = -1;
-
-    while (true) {
-      if (au_src == NULL || !au_src->IsConnected()) {
-        if (au_src) {
-          std::cout << "Client disconnected!" << std::endl;
-          delete au_src;
-        }
-        client_socket = tcp_server.Accept();
-        au_src = new OnlineTcpVectorSource(client_socket);
-      }
-
-      //re-initalizing decoder for each utterance
-      OnlineFasterDecoder decoder(*decode_fst, decoder_opts, silence_phones,
-                                  trans_model);
-
-      Mfcc mfcc(mfcc_opts);
-      FeInput fe_input(au_src, &mfcc, frame_length * (16000 / 1000),
-                       mfcc_frame_shift * (16000 / 1000));  //we always assume 16 kHz Fs on input
-      OnlineCmnInput cmn_input(&fe_input, cmn_window, min_cmn_window);
-      OnlineFeatInputItf *feat_transform = 0;
-      if (lda_mat_rspecifier != "") {
-        feat_transform = new OnlineLdaInput(&cmn_input, lda_transform,
-                                            left_context, right_context);
-      } else {
-        DeltaFeaturesOptions opts;
-        opts.order = kDeltaOrder;
-        feat_transform = new OnlineDeltaInput(opts, &cmn_input);
-      }
-
-      // feature_reading_opts contains number of retries, batch size.
-      OnlineFeatureMatrix feature_matrix(feature_reading_opts, feat_transform);
-
-      OnlineDecodableDiagGmmScaled decodable(am_gmm, trans_model,
-                                             acoustic_scale, &feature_matrix);
-
-      clock_t start = clock();
-      int32 decoder_offset = 0;
-
-      while (1) {
-        if (!au_src->IsConnected())
-          break;
-
-        OnlineFasterDecoder::DecodeState dstate = decoder.Decode(&decodable);
-
-        if (!au_src->IsConnected()) {
-          break;
-        }
-
-        if (dstate & (decoder.kEndFeats | decoder.kEndUtt)) {
-          std::vector<int32> word_ids, times, lengths;
-
-          decoder.FinishTraceBack(&out_fst);
-          decoder.GetBestPath(&out_fst);
-
-          ConvertLattice(out_fst, &out_lat);
-
-          Invert(&out_lat);
-          //TopSort(&out_lat);
-          //ArcSort(&out_lat, ILabelCompare<LatticeArc>());
-
-          DeterminizeLatticePruned(out_lat, 10.0f, &det_lat, det_opts);
-
-          WordAlignLattice(det_lat, trans_model, info, 0, &aligned_lat);
-
-          CompactLatticeToWordAlignment(aligned_lat, &word_ids, &times,
-                                        &lengths);
-
-          //count number of non-sil words
-          int32 words_num = 0;
-          for (size_t i = 0; i < word_ids.size(); i++)
-            if (word_ids[i] != 0)
-              words_num++;
-
-          if (words_num > 0) {
-
-            float dur = (clock() - start) / (float) CLOCKS_PER_SEC;
-            float input_dur = au_src->SamplesProcessed() / 16000.0;
-
-            start = clock();
-            au_src->ResetSamples();
-
-            std::stringstream sstr;
-            sstr << "RESULT:NUM=" << words_num << ",FORMAT=WSE,RECO-DUR=" << dur
-                << ",INPUT-DUR=" << input_dur;
-
-            WriteLine(client_socket, sstr.str());
-
-            for (size_t i = 0; i < word_ids.size(); i++) {
-              if (word_ids[i] == 0)
-                continue;  //skip silences...
-
-              std::string word = word_syms->Find(word_ids[i]);
-              if (word.empty())
-                word = "???";
-
-              float start = (times[i] + decoder_offset) / kFramesPerSecond;
-              float len = lengths[i] / kFramesPerSecond;
-
-              std::stringstream wstr;
-              wstr << word << "," << start << "," << (start + len);
-
-              WriteLine(client_socket, wstr.str());
-            }
-          }
-
-          if (dstate == decoder.kEndFeats) {
-            WriteLine(client_socket, "RESULT:DONE");
-            break;
-          }
-
-          decoder_offset = decoder.frame();
-        } else {
-          std::vector<int32> word_ids;
-          if (decoder.PartialTraceback(&out_fst)) {
-            GetLinearSymbolSequence(out_fst, static_cast<vector<int32> *>(0),
-                                    &word_ids,
-                                    static_cast<LatticeArc::Weight*>(0));
-            for (size_t i = 0; i < word_ids.size(); i++) {
-              if (word_ids[i] != 0) {
-                WriteLine(client_socket,
-                          "PARTIAL:" + word_syms->Find(word_ids[i]));
-              }
-            }
-          }
-        }
-      }
-      delete feat_transform;
-    }
-
-    std::cout << "Deinitizalizing..." << std::endl;
-
-    delete word_syms;
-    delete decode_fst;
-    return 0;
-
-  } catch (const std::exception& e) {
-    std::cerr << e.what();
-    return -1;
-  }
-}  // main()
-
-namespace kaldi {
-// IMPLEMENTATION OF THE CLASSES/METHODS ABOVE MAIN
-TcpServer::TcpServer() {
-  server_desc_ = -1;
-}
-
-bool TcpServer::Listen(int32 port) {
-  h_addr_.sin_addr.s_addr = INADDR_ANY;
-  h_addr_.sin_port = htons(port);
-  h_addr_.sin_family = AF_INET;
-
-  server_desc_ = socket(AF_INET, SOCK_STREAM, 0);
-
-  if (server_desc_ == -1) {
-    KALDI_ERR << "Cannot create TCP socket!";
-    return false;
-  }
-
-  int32 flag = 1;
-  int32 len = sizeof(int32);
-  if( setsockopt(server_desc_, SOL_SOCKET, SO_REUSEADDR, &flag, len) == -1){
-    KALDI_ERR << "Cannot set socket options!\n";
-    return false;
-  }
-
-  if (bind(server_desc_, (struct sockaddr*) &h_addr_, sizeof(h_addr_)) == -1) {
-    KALDI_ERR << "Cannot bind to port: " << port << " (is it taken?)";
-    return false;
-  }
-
-  if (listen(server_desc_, 1) == -1) {
-    KALDI_ERR << "Cannot listen on port!";
-    return false;
-  }
-
-  std::cout << "TcpServer: Listening on port: " << port << std::endl;
-
-  return true;
-
-}
-
-TcpServer::~TcpServer() {
-  if (server_desc_ != -1)
-    close(server_desc_);
-}
-
-int32 TcpServer::Accept() {
-  std::cout << "Waiting for client..." << std::endl;
-
-  socklen_t len;
-
-  len = sizeof(struct sockaddr);
-  int32 client_desc = accept(server_desc_, (struct sockaddr*) &h_addr_, &len);
-
-  struct sockaddr_storage addr;
-  char ipstr[20];
-
-  len = sizeof addr;
-  getpeername(client_desc, (struct sockaddr*) &addr, &len);
-
-  struct sockaddr_in *s = (struct sockaddr_in *) &addr;
-  inet_ntop(AF_INET, &s->sin_addr, ipstr, sizeof ipstr);
-
-  std::cout << "TcpServer: Accepted connection from: " << ipstr << std::endl;
-
-  return client_desc;
-}
-
-bool WriteLine(int32 socket, std::string line) {
-  line = line + "\n";
-
-  const char* p = line.c_str();
-  int32 to_write = line.size();
-  int32 wrote = 0;
-  while (to_write > 0) {
-    int32 ret = write(socket, p + wrote, to_write);
-    if (ret <= 0)
-      return false;
-
-    to_write -= ret;
-    wrote += ret;
-  }
-
-  return true;
-}
-}  // namespace kaldi
+// onlinebin/online-audio-server-decode-faster.cc
+
+// Copyright 2012 Cisco Systems (author: Matthias Paulik)
+// Copyright 2013 Polish-Japanese Institute of Information Technology (author: Danijel Korzinek)
+
+//   Modifications to the original contribution by Cisco Systems made by:
+//   Vassil Panayotov
+
+// See ../../COPYING for clarification regarding multiple authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//  http://www.apache.org/licenses/LICENSE-2.0
+//
+// THIS CODE IS PROVIDED *AS IS* BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, EITHER EXPRESS OR IMPLIED, INCLUDING WITHOUT LIMITATION ANY IMPLIED
+// WARRANTIES OR CONDITIONS OF TITLE, FITNESS FOR A PARTICULAR PURPOSE,
+// MERCHANTABLITY OR NON-INFRINGEMENT.
+// See the Apache 2 License for the specific language governing permissions and
+// limitations under the License.
+
+#include "feat/feature-mfcc.h"
+#include "feat/wave-reader.h"
+#include "online/online-tcp-source.h"
+#include "online/online-tcp-server.h"
+#include "online/online-feat-input.h"
+#include "online/online-feat-pipeline.h"
+#include "online/online-decodable.h"
+#include "online/online-faster-decoder.h"
+#include "online/onlinebin-util.h"
+#include "online/online-word-timer.h"
+#include "online2/online-speex-wrapper.h"
+#include "matrix/kaldi-vector.h"
+#include "lat/word-align-lattice.h"
+#include "lat/lattice-functions.h"
+#include "lat/sausages.h"
+#include "lat/determinize-lattice-pruned.h"
+#include "base/timer.h"
+
+#include <signal.h>
+#include <cstdio>
+#include <memory>
+
+namespace kaldi {
+
+// Everything the connections share: the models and the options.  Nothing in
+// it is modified once the server runs, so the worker threads read it
+// without locking.
+struct DecodingSetup {
+  const TransitionModel *trans_model;
+  const AmDiagGmm *am_gmm;
+  const OnlineGselectIndex *gselect;
+  const OnlineStackedGmm *stacked_gmm;
+  const fst::Fst<fst::StdArc> *decode_fst;
+  const fst::SymbolTable *word_syms;
+  const WordBoundaryInfo *word_boundary_info;
+  const Matrix<BaseFloat> *lda_transform; // NULL: deltas are used instead
+  const Matrix<double> *cmn_prior; // NULL if none
+  std::vector<int32> silence_phones;
+  OnlineFasterDecoderOpts decoder_opts;
+  bool pi_beam_controller;
+  OnlinePiBeamControllerOpts beam_controller_opts;
+  OnlineFeatureMatrixOptions feature_reading_opts;
+  OnlineDecodableOptions decodable_opts;
+  MfccOptions mfcc_opts;
+  BaseFloat acoustic_scale;
+  int32 cmn_window, min_cmn_window;
+  BaseFloat cmn_decay;
+  int32 left_context, right_context;
+  int32 frame_length, frame_shift; // in milliseconds
+  fst::DeterminizeLatticePrunedOptions det_opts;
+  bool accept_speex;
+  SpeexOptions speex_opts;
+  bool json_results; // framed JSON messages instead of lines of text
+  int32 partial_interval; // frames between two partial JSON results
+};
+
+// Decodes the audio of the clients that send it compressed with Speex.
+class SpeexTcpDecoder : public OnlineTcpAudioDecoderItf {
+ public:
+  explicit SpeexTcpDecoder(const SpeexOptions &opts):
+      opts_(opts), decoder_(new OnlineSpeexDecoder(opts)) { }
+  ~SpeexTcpDecoder() { delete decoder_; }
+
+  virtual int32 Codec() const { return kTcpCodecSpeex; }
+  virtual void Decode(const char *data, int32 num_bytes,
+                      Vector<BaseFloat> *samples) {
+    bits_.assign(data, data + num_bytes);
+    decoder_->AcceptSpeexBits(bits_);
+    decoder_->GetWaveform(samples);
+  }
+  virtual void Reset() {
+    delete decoder_;
+    decoder_ = new OnlineSpeexDecoder(opts_);
+  }
+
+ private:
+  const SpeexOptions &opts_;
+  OnlineSpeexDecoder *decoder_;
+  std::vector<char> bits_;
+};
+
+// The feature pipeline and the decoder for one stream (i.e. one file sent
+// by the client) of a connection.
+struct DecodingStream {
+  DecodingStream(const DecodingSetup &setup, OnlineTcpVectorSource *au_src,
+                 const Matrix<double> &speaker_stats);
+  ~DecodingStream();
+
+  Mfcc mfcc;
+  OnlineFeInput<Mfcc> fe_input;
+  OnlineCmnInput cmn_input;
+  OnlineFeatInputItf *feat_transform;
+  OnlinePrefetchInput prefetch;
+  OnlineFeatureMatrix feature_matrix;
+  // Created once there is a frame, as its constructor wants one.
+  OnlineDecodableDiagGmmScaled *decodable;
+  OnlinePiBeamController beam_controller;
+  OnlineFasterDecoder decoder;
+  int32 decoder_offset;
+  double reco_time; // spent on this stream since the last result
+  // For the JSON results only:
+  OnlineWordTimer word_timer; // times the fixed part of the best path
+  std::vector<OnlineTimedWord> utt_words; // the fixed words of the utterance
+  size_t num_words_sent; // how many of them were sent as stable
+  int32 partial_frame; // the frame of the last partial result
+  int32 utterance; // the number of utterances ended before this one
+};
+
+// Decodes the streams of a connection one after the other, as their audio
+// comes in.  The frames are computed ahead of the decoder as far as the
+// audio allows, and the decoder is only run on a batch when all of its
+// frames are there, so that it never waits.
+class DecodingSession : public OnlineTcpSessionItf {
+ public:
+  DecodingSession(const DecodingSetup &setup, int32 socket,
+                  OnlineTcpVectorSource *au_src):
+      setup_(setup), client_socket_(socket), au_src_(au_src), stream_(NULL),
+      speex_decoder_(NULL) {
+    if (setup.accept_speex) {
+      speex_decoder_ = new SpeexTcpDecoder(setup.speex_opts);
+      au_src->SetDecoder(speex_decoder_);
+    }
+  }
+  ~DecodingSession() {
+    delete stream_;
+    delete speex_decoder_;
+  }
+
+  virtual bool Process();
+
+ private:
+  // Decodes the batches whose frames are all there, and sends their
+  // results.  Sets "*done" once the stream is over.  Returns false if the
+  // client cannot be written to.
+  bool Decode(bool *done);
+  // Queues the words of the utterance that ended, and the end of the stream
+  // if it did; or the partial results in the middle of an utterance.
+  void QueueTextResults(OnlineFasterDecoder::DecodeState dstate);
+  void QueueJsonResults(OnlineFasterDecoder::DecodeState dstate);
+  void QueueEndOfStream();
+  // Queues a line of the text protocol, or a message of the JSON one.
+  void QueueLine(const std::string &line);
+  void QueueMessage(const std::string &json);
+  // Writes what was queued, with a single system call if it can.  Returns
+  // false if the client cannot be written to.
+  bool Flush();
+
+  const DecodingSetup &setup_;
+  int32 client_socket_;
+  OnlineTcpVectorSource *au_src_;
+  DecodingStream *stream_;
+  Matrix<double> speaker_stats_; // CMN stats of the earlier streams
+  SpeexTcpDecoder *speex_decoder_; // NULL unless --speex
+
+  std::vector<std::string> output_; // queued, not written yet
+
+  // Kept to avoid reallocating them.
+  fst::VectorFst<LatticeArc> out_fst_;
+  Lattice out_lat_;
+  CompactLattice det_lat_, aligned_lat_;
+  std::vector<std::pair<int32, int32> > labels_;
+  std::vector<OnlineTimedWord> unstable_words_;
+  std::vector<OnlineDecodeBatchStats> batch_stats_;
+};
+
+class DecodingSessionFactory : public OnlineTcpSessionFactoryItf {
+ public:
+  explicit DecodingSessionFactory(const DecodingSetup &setup): setup_(setup) { }
+  virtual OnlineTcpSessionItf *NewSession(int32 socket,
+                                          OnlineTcpVectorSource *source) {
+    return new DecodingSession(setup_, socket, source);
+  }
+ private:
+  const DecodingSetup &setup_;
+};
+
+//constant allowing to convert frame count to time
+const float kFramesPerSecond = 100.0f;
+}  // namespace kaldi
+
+int32 main(int argc, char *argv[]) {
+  using namespace kaldi;
+  using namespace fst;
+
+  try {
+    typedef kaldi::int32 int32;
+    signal(SIGPIPE, SIG_IGN);
+
+    const char *usage =
+        "Starts a TCP server that receives RAW audio and outputs aligned words.\n"
+            "With --speex, the clients may send the audio compressed instead.\n"
+            "Many clients are served at once, by a pool of decoding threads.\n"
+            "A sample client can be found in: onlinebin/online-audio-client\n\n"
+            "Usage: online-audio-server-decode-faster [options] model-in "
+            "fst-in word-symbol-table silence-phones word_boundary_file tcp-port [lda-matrix-in]\n\n"
+            "example: online-audio-server-decode-faster --verbose=1 --rt-min=0.5 --rt-max=3.0 --max-active=6000\n"
+            "--beam=72.0 --acoustic-scale=0.0769 --num-workers=8 final.mdl graph/HCLG.fst graph/words.txt '1:2:3:4:5'\n"
+            "graph/word_boundary.int 5000 final.mat\n\n";
+
+    ParseOptions po(usage);
+    DecodingSetup setup;
+    setup.acoustic_scale = 0.1;
+    setup.cmn_window = 600;
+    setup.min_cmn_window = 100;  // adds 1 second latency, only at utterance start.
+    setup.right_context = 4;
+    setup.left_context = 4;
+    setup.pi_beam_controller = false;
+    setup.accept_speex = false;
+    std::string result_format = "text";
+    BaseFloat partial_interval = 0.0;
+    BaseFloat frame_shift = 0.01;
+
+    setup.decoder_opts.Register(&po, true);
+    setup.beam_controller_opts.Register(&po);
+    setup.feature_reading_opts.Register(&po);
+    setup.decodable_opts.Register(&po);
+    OnlineCmnOptions cmn_opts;
+    cmn_opts.Register(&po);
+    OnlineTcpServerOptions server_opts;
+    server_opts.Register(&po);
+    setup.speex_opts.Register(&po);
+
+    po.Register("left-context", &setup.left_context,
+                "Number of frames of left context");
+    po.Register("right-context", &setup.right_context,
+                "Number of frames of right context");
+    po.Register("acoustic-scale", &setup.acoustic_scale,
+                "Scaling factor for acoustic likelihoods");
+    po.Register(
+        "cmn-window", &setup.cmn_window,
+        "Number of feat. vectors used in the running average CMN calculation");
+    po.Register("min-cmn-window", &setup.min_cmn_window,
+                "Minumum CMN window used at start of decoding (adds "
+                "latency only at start)");
+    po.Register("frame-shift", &frame_shift,
+                "Time in seconds between frames.\n");
+    po.Register("pi-beam-controller", &setup.pi_beam_controller,
+                "Adapt the beam with a PI controller following --target-rtf "
+                "and --max-tokens, instead of keeping the real-time factor "
+                "within [--rt-min, --rt-max]");
+    po.Register("speex", &setup.accept_speex,
+                "Accept audio compressed with Speex from the clients that ask "
+                "for it (see online-audio-client --codec); the --speex-* "
+                "options must match the client's");
+    po.Register("result-format", &result_format,
+                "How the results are sent: \"text\", as lines of text, or "
+                "\"json\", as JSON messages, each preceded by its 4-byte "
+                "size, which also give the partial results with word times, "
+                "telling which words are fixed (\"stable\") and which may "
+                "still change (\"unstable\"), and with the final results "
+                "where the utterance ends in the audio (\"utterance_end\")");
+    po.Register("partial-interval", &partial_interval,
+                "With --result-format=json, the minimum time in seconds of "
+                "audio between two partial results (0: after every batch "
+                "decoded)");
+
+    WordBoundaryInfoNewOpts opts;
+    opts.Register(&po);
+
+    po.Read(argc, argv);
+    if (po.NumArgs() < 6 || po.NumArgs() > 7) {
+      po.PrintUsage();
+      return 1;
+    }
+
+    std::string model_rspecifier = po.GetArg(1), fst_rspecifier = po.GetArg(2),
+        word_syms_filename = po.GetArg(3), silence_phones_str = po.GetArg(4),
+        word_boundary_file = po.GetArg(5), lda_mat_rspecifier = "";
+
+    if (po.NumArgs() == 7)
+      lda_mat_rspecifier = po.GetOptArg(7);
+
+    int32 port = strtol(po.GetArg(6).c_str(), 0, 10);
+
+    if (result_format != "text" && result_format != "json")
+      KALDI_ERR << "Invalid --result-format " << result_format;
+    setup.json_results = (result_format == "json");
+    setup.partial_interval = static_cast<int32>(
+        partial_interval * kFramesPerSecond + 0.5);
+
+    if (!SplitStringToIntegers(silence_phones_str, ":", false,
+                               &setup.silence_phones))
+      KALDI_ERR << "Invalid silence-phones string " << silence_phones_str;
+    if (setup.silence_phones.empty())
+      KALDI_ERR << "No silence phones given!";
+
+    std::cout << "Reading LDA matrix: " << lda_mat_rspecifier << "..."
+        << std::endl;
+    Matrix < BaseFloat > lda_transform;
+    if (lda_mat_rspecifier != "") {
+      bool binary_in;
+      Input ki(lda_mat_rspecifier, &binary_in);
+      lda_transform.Read(ki.Stream(), binary_in);
+    }
+
+    std::cout << "Reading acoustic model: " << model_rspecifier << "..."
+        << std::endl;
+    TransitionModel trans_model;
+    AmDiagGmm am_gmm;
+    {
+      bool binary;
+      Input ki(model_rspecifier, &binary);
+      trans_model.Read(ki.Stream(), binary);
+      am_gmm.Read(ki.Stream(), binary);
+    }
+    std::unique_ptr<OnlineGselectIndex> gselect(
+        ReadGselectIndex(setup.decodable_opts.gselect_rxfilename));
+    std::unique_ptr<OnlineStackedGmm> stacked_gmm(
+        NewStackedGmm(am_gmm, setup.decodable_opts));
+    Matrix<double> cmn_prior;
+    bool have_cmn_prior = ReadCmnPrior(cmn_opts, &cmn_prior);
+
+    std::cout << "Reading word list: " << word_syms_filename << "..."
+        << std::endl;
+    std::unique_ptr<fst::SymbolTable> word_syms(
+        fst::SymbolTable::ReadText(word_syms_filename));
+    if (!word_syms)
+      KALDI_ERR << "Could not read symbol table from file "
+          << word_syms_filename;
+
+    std::cout << "Reading word boundary file: " << word_boundary_file << "..."
+        << std::endl;
+    WordBoundaryInfo info(opts, word_boundary_file);
+
+    std::cout << "Reading FST: " << fst_rspecifier << "..." << std::endl;
+    std::unique_ptr<fst::Fst<fst::StdArc> > decode_fst(
+        ReadDecodeGraph(fst_rspecifier));
+
+    // We are not properly registering/exposing MFCC and frame extraction options,
+    // because there are parts of the online decoding code, where some of these
+    // options are hardwired(ToDo: we should fix this at some point)
+    setup.mfcc_opts.use_energy = false;
+    setup.frame_length = setup.mfcc_opts.frame_opts.frame_length_ms = 25;
+    setup.frame_shift = setup.mfcc_opts.frame_opts.frame_shift_ms = 10;
+
+    int32 window_size = setup.right_context + setup.left_context + 1;
+    setup.decoder_opts.batch_size = std::max(setup.decoder_opts.batch_size,
+                                             window_size);
+
+    setup.det_opts.max_mem = 50000000;
+    setup.det_opts.max_loop = 0;
+
+    setup.trans_model = &trans_model;
+    setup.am_gmm = &am_gmm;
+    setup.gselect = gselect.get();
+    setup.stacked_gmm = stacked_gmm.get();
+    setup.decode_fst = decode_fst.get();
+    setup.word_syms = word_syms.get();
+    setup.word_boundary_info = &info;
+    setup.lda_transform = (lda_mat_rspecifier != "" ? &lda_transform : NULL);
+    setup.cmn_prior = (have_cmn_prior ? &cmn_prior : NULL);
+    setup.cmn_decay = cmn_opts.decay;
+
+    // The server is only built once everything the sessions use is there,
+    // as its worker threads start right away; it is destroyed, and they are
+    // joined, before any of it, also when an exception is thrown.
+    DecodingSessionFactory factory(setup);
+    OnlineTcpServer tcp_server(server_opts, 16000, &factory);
+    if (!tcp_server.Listen(port))
+      return 1;
+    tcp_server.Run();
+
+    std::cout << "Deinitizalizing..." << std::endl;
+    return 0;
+
+  } catch (const std::exception& e) {
+    std::cerr << e.what();
+    return -1;
+  }
+}  // main()
+
+namespace kaldi {
+// IMPLEMENTATION OF THE CLASSES/METHODS ABOVE MAIN
+
+// up to delta-delta derivative features are calculated (unless LDA is used)
+static const int32 kDeltaOrder = 2;
+
+static OnlineFeatInputItf *NewFeatTransform(const DecodingSetup &setup,
+                                            OnlineFeatInputItf *cmn_input) {
+  if (setup.lda_transform != NULL)
+    return new OnlineLdaInput(cmn_input, *setup.lda_transform,
+                              setup.left_context, setup.right_context);
+  DeltaFeaturesOptions opts;
+  opts.order = kDeltaOrder;
+  return new OnlineDeltaInput(opts, cmn_input);
+}
+
+DecodingStream::DecodingStream(const DecodingSetup &setup,
+                               OnlineTcpVectorSource *au_src,
+                               const Matrix<double> &speaker_stats):
+    mfcc(setup.mfcc_opts),
+    //we always assume 16 kHz Fs on input
+    fe_input(au_src, &mfcc, setup.frame_length * (16000 / 1000),
+             setup.frame_shift * (16000 / 1000)),
+    cmn_input(&fe_input, setup.cmn_window, setup.min_cmn_window,
+              setup.cmn_decay),
+    feat_transform(NewFeatTransform(setup, &cmn_input)),
+    prefetch(feat_transform),
+    feature_matrix(setup.feature_reading_opts, &prefetch),
+    decodable(NULL),
+    beam_controller(setup.beam_controller_opts, setup.decoder_opts.beam,
+                    setup.frame_shift / 1000.0),
+    decoder(*setup.decode_fst, setup.decoder_opts, setup.silence_phones,
+            *setup.trans_model),
+    decoder_offset(0), reco_time(0.0),
+    word_timer(*setup.trans_model, *setup.word_boundary_info),
+    num_words_sent(0), partial_frame(0), utterance(0) {
+  if (setup.pi_beam_controller)
+    decoder.SetBeamController(&beam_controller);
+  decoder.SetFrameShift(setup.frame_shift / 1000.0);
+  decoder.KeepBatchStats(GetVerboseLevel() >= 2);
+  // Later streams of a connection start from the stats of the earlier ones.
+  if (speaker_stats.NumRows() != 0)
+    cmn_input.SetPrior(speaker_stats);
+  else if (setup.cmn_prior != NULL)
+    cmn_input.SetPrior(*setup.cmn_prior);
+}
+
+DecodingStream::~DecodingStream() {
+  delete decodable;
+  delete feat_transform;
+}
+
+bool DecodingSession::Process() {
+  while (true) {
+    if (stream_ == NULL) {
+      if (!au_src_->HasInput())
+        return au_src_->IsConnected(); // wait for audio, or we are done
+      stream_ = new DecodingStream(setup_, au_src_, speaker_stats_);
+    }
+    bool done;
+    if (!Decode(&done))
+      return false;
+    if (!done)
+      return true;
+    stream_->cmn_input.GetStats(&speaker_stats_);
+    delete stream_;
+    stream_ = NULL;
+    au_src_->NextStream();
+  }
+}
+
+bool DecodingSession::Decode(bool *done) {
+  Timer timer;
+  OnlinePrefetchInput &prefetch = stream_->prefetch;
+  prefetch.Prefetch();
+  *done = false;
+  if (stream_->decodable == NULL) {
+    if (prefetch.NumFramesReady() == 0) {
+      // Nothing to decode, e.g. the client sent an empty file.
+      *done = prefetch.Ended();
+      if (*done)
+        QueueEndOfStream();
+      return Flush();
+    }
+    stream_->decodable = new OnlineDecodableDiagGmmScaled(
+        *setup_.am_gmm, *setup_.trans_model, setup_.acoustic_scale,
+        &stream_->feature_matrix, setup_.decodable_opts, setup_.gselect,
+        setup_.stacked_gmm);
+  }
+  OnlineFasterDecoder &decoder = stream_->decoder;
+  // Decode() looks at the frame after the batch, to tell if it is the last.
+  while (prefetch.Ended() || prefetch.NumFramesReady() >
+         decoder.frame() + setup_.decoder_opts.batch_size) {
+    OnlineFasterDecoder::DecodeState dstate =
+        decoder.Decode(stream_->decodable);
+
+    // Only kept at verbose level 2 and up, but drained after every batch.
+    batch_stats_.clear();
+    decoder.GetBatchStats(&batch_stats_);
+    for (size_t i = 0; i < batch_stats_.size(); i++)
+      KALDI_VLOG(2) << "BATCH-STATS: frame=" << batch_stats_[i].frame
+                    << " beam=" << batch_stats_[i].beam
+                    << " rtf=" << batch_stats_[i].rtf
+                    << " tokens=" << batch_stats_[i].num_tokens;
+
+    stream_->reco_time += timer.Elapsed();
+    timer.Reset();
+    if (setup_.json_results)
+      QueueJsonResults(dstate);
+    else
+      QueueTextResults(dstate);
+    if (dstate == decoder.kEndFeats) {
+      *done = true;
+      break;
+    }
+  }
+  stream_->reco_time += timer.Elapsed();
+  // The results of all the batches decoded go out at once.
+  return Flush();
+}
+
+void DecodingSession::QueueTextResults(
+    OnlineFasterDecoder::DecodeState dstate) {
+  OnlineFasterDecoder &decoder = stream_->decoder;
+  if (dstate & (decoder.kEndFeats | decoder.kEndUtt)) {
+    std::vector<int32> word_ids, times, lengths;
+
+    decoder.FinishTraceBack(&out_fst_);
+    decoder.GetBestPath(&out_fst_);
+
+    ConvertLattice(out_fst_, &out_lat_);
+
+    fst::Invert(&out_lat_);
+    //TopSort(&out_lat);
+    //ArcSort(&out_lat, ILabelCompare<LatticeArc>());
+
+    fst::DeterminizeLatticePruned(out_lat_, 10.0f, &det_lat_, setup_.det_opts);
+
+    WordAlignLattice(det_lat_, *setup_.trans_model,
+                     *setup_.word_boundary_info, 0, &aligned_lat_);
+
+    CompactLatticeToWordAlignment(aligned_lat_, &word_ids, &times, &lengths);
+
+    //count number of non-sil words
+    int32 words_num = 0;
+    for (size_t i = 0; i < word_ids.size(); i++)
+      if (word_ids[i] != 0)
+        words_num++;
+
+    if (words_num > 0) {
+      float dur = stream_->reco_time;
+      float input_dur = au_src_->SamplesProcessed() / 16000.0;
+
+      stream_->reco_time = 0.0;
+      au_src_->ResetSamples();
+
+      std::stringstream sstr;
+      sstr << "RESULT:NUM=" << words_num << ",FORMAT=WSE,RECO-DUR=" << dur
+          << ",INPUT-DUR=" << input_dur;
+
+      QueueLine(sstr.str());
+
+      for (size_t i = 0; i < word_ids.size(); i++) {
+        if (word_ids[i] == 0)
+          continue;  //skip silences...
+
+        std::string word = setup_.word_syms->Find(word_ids[i]);
+        if (word.empty())
+          word = "???";
+
+        float start = (times[i] + stream_->decoder_offset) / kFramesPerSecond;
+        float len = lengths[i] / kFramesPerSecond;
+
+        std::stringstream wstr;
+        wstr << word << "," << start << "," << (start + len);
+
+        QueueLine(wstr.str());
+      }
+    }
+
+    if (dstate == decoder.kEndFeats)
+      QueueEndOfStream();
+    else
+      stream_->decoder_offset = decoder.frame();
+  } else {
+    std::vector<int32> word_ids;
+    if (decoder.PartialTraceback(&word_ids)) {
+      for (size_t i = 0; i < word_ids.size(); i++) {
+        if (word_ids[i] != 0)
+          QueueLine("PARTIAL:" + setup_.word_syms->Find(word_ids[i]));
+      }
+    }
+  }
+}
+
+// Escapes what has to be in a JSON string.
+static std::string JsonEscape(const std::string &str) {
+  std::string ans;
+  for (size_t i = 0; i < str.size(); i++) {
+    unsigned char c = str[i];
+    if (c == '"' || c == '\\') {
+      ans += '\\';
+      ans += c;
+    } else if (c < 0x20) {
+      char buf[8];
+      snprintf(buf, sizeof(buf), "\\u%04x", c);
+      ans += buf;
+    } else {
+      ans += c;
+    }
+  }
+  return ans;
+}
+
+// Writes "words", from the "begin"-th on, as a JSON array.
+static void WordsToJson(const fst::SymbolTable &word_syms,
+                        const std::vector<OnlineTimedWord> &words,
+                        size_t begin, std::ostream &os) {
+  os << "[";
+  for (size_t i = begin; i < words.size(); i++) {
+    std::string word = word_syms.Find(words[i].word_id);
+    if (word.empty())
+      word = "???";
+    os << (i > begin ? "," : "") << "{\"word\":\"" << JsonEscape(word)
+       << "\",\"start\":" << words[i].start_frame / kFramesPerSecond
+       << ",\"end\":" << words[i].end_frame / kFramesPerSecond << "}";
+  }
+  os << "]";
+}
+
+void DecodingSession::QueueJsonResults(
+    OnlineFasterDecoder::DecodeState dstate) {
+  DecodingStream &stream = *stream_;
+  OnlineFasterDecoder &decoder = stream.decoder;
+  std::ostringstream msg;
+  if (dstate & (decoder.kEndFeats | decoder.kEndUtt)) {
+    // The words are timed as the path grows, so the end of the utterance
+    // only has the part after the last partial traceback to look at.
+    decoder.FinishTraceBack(&labels_);
+    stream.word_timer.Advance(labels_, &stream.utt_words);
+    stream.word_timer.Finish(&stream.utt_words);
+    msg << "{\"type\":\"final\",\"utterance\":" << stream.utterance
+        << ",\"words\":";
+    WordsToJson(*setup_.word_syms, stream.utt_words, 0, msg);
+    msg << ",\"reco_dur\":" << stream.reco_time << ",\"input_dur\":"
+        << au_src_->SamplesProcessed() / 16000.0 << ",\"utterance_end\":"
+        << decoder.frame() / kFramesPerSecond << "}";
+    QueueMessage(msg.str());
+    stream.reco_time = 0.0;
+    au_src_->ResetSamples();
+    stream.utt_words.clear();
+    stream.num_words_sent = 0;
+    stream.utterance++;
+    stream.word_timer.Reset(decoder.frame());
+    stream.partial_frame = decoder.frame();
+    if (dstate == decoder.kEndFeats)
+      QueueEndOfStream();
+    return;
+  }
+  // The words up to the immortal token are fixed: they are on the path to
+  // any of the active tokens.
+  if (decoder.PartialTraceback(&labels_))
+    stream.word_timer.Advance(labels_, &stream.utt_words);
+  if (decoder.frame() - stream.partial_frame < setup_.partial_interval)
+    return;
+  // The rest of the best path may still change, so it is timed on a copy.
+  decoder.FinishTraceBack(&labels_);
+  OnlineWordTimer tail_timer(stream.word_timer);
+  unstable_words_.clear();
+  tail_timer.Advance(labels_, &unstable_words_);
+  tail_timer.Finish(&unstable_words_);
+  msg << "{\"type\":\"partial\",\"utterance\":" << stream.utterance
+      << ",\"stable\":";
+  WordsToJson(*setup_.word_syms, stream.utt_words, stream.num_words_sent,
+              msg);
+  msg << ",\"unstable\":";
+  WordsToJson(*setup_.word_syms, unstable_words_, 0, msg);
+  msg << "}";
+  QueueMessage(msg.str());
+  stream.num_words_sent = stream.utt_words.size();
+  stream.partial_frame = decoder.frame();
+}
+
+void DecodingSession::QueueEndOfStream() {
+  if (setup_.json_results)
+    QueueMessage("{\"type\":\"done\"}");
+  else
+    QueueLine("RESULT:DONE");
+}
+
+void DecodingSession::QueueLine(const std::string &line) {
+  output_.push_back(line + "\n");
+}
+
+void DecodingSession::QueueMessage(const std::string &json) {
+  int32 size = json.size();
+  output_.push_back(std::string(reinterpret_cast<const char*>(&size),
+                                sizeof(size)));
+  output_.push_back(json);
+}
+
+bool DecodingSession::Flush() {
+  bool ans = OnlineTcpServer::WriteToSocket(client_socket_, output_);
+  output_.clear();
+  return ans;
+}
+}  // namespace kaldi
@@ -0,0 +1,81 @@
+// onlinebin/online-gmm-build-gselect.cc
+
+// See ../../COPYING for clarification regarding multiple authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//  http://www.apache.org/licenses/LICENSE-2.0
+//
+// THIS CODE IS PROVIDED *AS IS* BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, EITHER EXPRESS OR IMPLIED, INCLUDING WITHOUT LIMITATION ANY IMPLIED
+// WARRANTIES OR CONDITIONS OF TITLE, FITNESS FOR A PARTICULAR PURPOSE,
+// MERCHANTABLITY OR NON-INFRINGEMENT.
+// See the Apache 2 License for the specific language governing permissions and
+// limitations under the License.
+
+#include "base/kaldi-common.h"
+#include "util/common-utils.h"
+#include "gmm/am-diag-gmm.h"
+#include "hmm/transition-model.h"
+#include "online/online-gselect.h"
+
+int main(int argc, char *argv[]) {
+  try {
+    using namespace kaldi;
+    typedef kaldi::int32 int32;
+
+    const char *usage =
+        "Builds the Gaussian selection index used by the online GMM decoders\n"
+        "(option --gselect), from the acoustic model and a small diagonal UBM\n"
+        "with the same feature dimension, e.g. one trained with\n"
+        "gmm-global-init-from-feats on the decoding features.\n"
+        "Each Gaussian of the model is attached to the --num-ubm-per-gauss\n"
+        "UBM components closest to it; at decoding time the model Gaussians\n"
+        "attached to the --gselect-num best UBM components are evaluated.\n\n"
+        "Usage: online-gmm-build-gselect [options] model-in ubm-in gselect-out\n\n"
+        "Example: online-gmm-build-gselect --num-ubm-per-gauss=3 final.mdl "
+        "final.ubm gselect.idx";
+    ParseOptions po(usage);
+    bool binary = true;
+    int32 num_ubm_per_gauss = 3;
+    po.Register("binary", &binary, "Write output in binary mode");
+    po.Register("num-ubm-per-gauss", &num_ubm_per_gauss,
+                "Number of UBM components each Gaussian of the model is "
+                "attached to");
+    po.Read(argc, argv);
+    if (po.NumArgs() != 3) {
+      po.PrintUsage();
+      return 1;
+    }
+
+    std::string model_rxfilename = po.GetArg(1),
+        ubm_rxfilename = po.GetArg(2),
+        gselect_wxfilename = po.GetArg(3);
+
+    TransitionModel trans_model;
+    AmDiagGmm am_gmm;
+    {
+      bool binary_in;
+      Input ki(model_rxfilename, &binary_in);
+      trans_model.Read(ki.Stream(), binary_in);
+      am_gmm.Read(ki.Stream(), binary_in);
+    }
+    DiagGmm ubm;
+    ReadKaldiObject(ubm_rxfilename, &ubm);
+
+    OnlineGselectIndex gselect;
+    gselect.Build(ubm, am_gmm, num_ubm_per_gauss);
+    WriteKaldiObject(gselect, gselect_wxfilename, binary);
+
+    KALDI_LOG << "Attached the " << am_gmm.NumGauss() << " Gaussians of the "
+              << "model to " << gselect.NumUbmPerGauss() << " of the "
+              << ubm.NumGauss() << " UBM components each; wrote the index to "
+              << gselect_wxfilename;
+    return 0;
+  } catch(const std::exception& e) {
+    std::cerr << e.what();
+    return -1;
+  }
+}
@@ -0,0 +1,297 @@
+// onlinebin/online-wav-gmm-latgen-faster.cc
+
+// See ../../COPYING for clarification regarding multiple authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//  http://www.apache.org/licenses/LICENSE-2.0
+//
+// THIS CODE IS PROVIDED *AS IS* BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, EITHER EXPRESS OR IMPLIED, INCLUDING WITHOUT LIMITATION ANY IMPLIED
+// WARRANTIES OR CONDITIONS OF TITLE, FITNESS FOR A PARTICULAR PURPOSE,
+// MERCHANTABLITY OR NON-INFRINGEMENT.
+// See the Apache 2 License for the specific language governing permissions and
+// limitations under the License.
+
+#include "base/timer.h"
+#include "feat/feature-mfcc.h"
+#include "feat/wave-reader.h"
+#include "lat/kaldi-lattice.h"
+#include "online/online-audio-source.h"
+#include "online/online-feat-input.h"
+#include "online/online-decodable.h"
+#include "online/online-faster-decoder.h"
+#include "online/online-lattice-decoder.h"
+#include "online/onlinebin-util.h"
+
+namespace kaldi {
+
+// The feature pipeline and the decodable for one wav file.
+struct DecodingPipeline {
+  typedef OnlineFeInput<Mfcc> FeInput;
+
+  DecodingPipeline(const VectorBase<BaseFloat> &wave,
+                   const MfccOptions &mfcc_opts, int32 cmn_window,
+                   int32 min_cmn_window, const Matrix<BaseFloat> &lda_transform,
+                   int32 left_context, int32 right_context,
+                   const OnlineFeatureMatrixOptions &feature_reading_opts,
+                   const AmDiagGmm &am_gmm, const TransitionModel &trans_model,
+                   BaseFloat acoustic_scale,
+                   const OnlineDecodableOptions &decodable_opts,
+                   const OnlineGselectIndex *gselect,
+                   const OnlineStackedGmm *stacked_gmm):
+      au_src(wave), mfcc(mfcc_opts),
+      fe_input(&au_src, &mfcc,
+               mfcc_opts.frame_opts.frame_length_ms * 16,
+               mfcc_opts.frame_opts.frame_shift_ms * 16),
+      cmn_input(&fe_input, cmn_window, min_cmn_window),
+      feat_transform(NULL), feature_matrix(NULL), decodable(NULL) {
+    if (lda_transform.NumRows() != 0) {
+      feat_transform = new OnlineLdaInput(&cmn_input, lda_transform,
+                                          left_context, right_context);
+    } else {
+      DeltaFeaturesOptions opts;
+      opts.order = 2;
+      feat_transform = new OnlineDeltaInput(opts, &cmn_input);
+    }
+    feature_matrix = new OnlineFeatureMatrix(feature_reading_opts,
+                                             feat_transform);
+    // The decodable can't be initialized with empty input; "decodable"
+    // stays NULL in that case.
+    if (feature_matrix->IsValidFrame(0))
+      decodable = new OnlineDecodableDiagGmmScaled(am_gmm, trans_model,
+                                                   acoustic_scale,
+                                                   feature_matrix,
+                                                   decodable_opts, gselect,
+                                                   stacked_gmm);
+  }
+
+  ~DecodingPipeline() {
+    delete decodable;
+    delete feature_matrix;
+    delete feat_transform;
+  }
+
+  OnlineVectorSource au_src;
+  Mfcc mfcc;
+  FeInput fe_input;
+  OnlineCmnInput cmn_input;
+  OnlineFeatInputItf *feat_transform;
+  OnlineFeatureMatrix *feature_matrix;
+  OnlineDecodableDiagGmmScaled *decodable;
+};
+
+}  // namespace kaldi
+
+int main(int argc, char *argv[]) {
+  try {
+    using namespace kaldi;
+    using namespace fst;
+
+    typedef kaldi::int32 int32;
+    typedef kaldi::int64 int64;
+
+    const char *usage =
+        "Reads in wav file(s), simulates online decoding and writes a\n"
+        "determinized lattice for every utterance found by the on-the-fly\n"
+        "segmentation.  The lattices are keyed <wav-key>_<start>-<end>, with\n"
+        "times relative to the start frame.\n"
+        "Feature splicing/LDA transform is used, if the optional(last) argument "
+        "is given.\n"
+        "Otherwise delta/delta-delta(i.e. 2-nd order) features are produced.\n"
+        "With --compare-one-best, every file is decoded by OnlineFasterDecoder\n"
+        "as well, and the speed of the two decoders is reported.\n\n"
+        "Usage: online-wav-gmm-latgen-faster [options] wav-rspecifier model-in "
+        "fst-in silence-phones lattice-wspecifier [lda-matrix-in]\n\n"
+        "Example: online-wav-gmm-latgen-faster --max-active=4000 --beam=12.0 "
+        "--lattice-beam=6.0 --acoustic-scale=0.0769 scp:wav.scp model HCLG.fst "
+        "'1:2:3:4:5' ark:lat.ark";
+    ParseOptions po(usage);
+    BaseFloat acoustic_scale = 0.1;
+    int32 cmn_window = 600, min_cmn_window = 100;
+    int32 right_context = 4, left_context = 4;
+    bool compare_one_best = false;
+
+    OnlineLatticeDecoderOpts decoder_opts;
+    decoder_opts.Register(&po);
+    OnlineFeatureMatrixOptions feature_reading_opts;
+    feature_reading_opts.Register(&po);
+    OnlineDecodableOptions decodable_opts;
+    decodable_opts.Register(&po);
+
+    po.Register("left-context", &left_context, "Number of frames of left context");
+    po.Register("right-context", &right_context, "Number of frames of right context");
+    po.Register("acoustic-scale", &acoustic_scale,
+                "Scaling factor for acoustic likelihoods");
+    po.Register("cmn-window", &cmn_window,
+        "Number of feat. vectors used in the running average CMN calculation");
+    po.Register("min-cmn-window", &min_cmn_window,
+                "Minumum CMN window used at start of decoding (adds "
+                "latency only at start)");
+    po.Register("compare-one-best", &compare_one_best,
+                "Also decode with the 1-best OnlineFasterDecoder, using the "
+                "same beam, and compare the speed");
+    po.Read(argc, argv);
+    if (po.NumArgs() != 5 && po.NumArgs() != 6) {
+      po.PrintUsage();
+      return 1;
+    }
+
+    std::string wav_rspecifier = po.GetArg(1),
+        model_rspecifier = po.GetArg(2),
+        fst_rspecifier = po.GetArg(3),
+        silence_phones_str = po.GetArg(4),
+        lattice_wspecifier = po.GetArg(5),
+        lda_mat_rspecifier = po.GetOptArg(6);
+
+    std::vector<int32> silence_phones;
+    if (!SplitStringToIntegers(silence_phones_str, ":", false, &silence_phones))
+        KALDI_ERR << "Invalid silence-phones string " << silence_phones_str;
+    if (silence_phones.empty())
+        KALDI_ERR << "No silence phones given!";
+
+    CompactLatticeWriter lattice_writer(lattice_wspecifier);
+
+    Matrix<BaseFloat> lda_transform;
+    if (lda_mat_rspecifier != "") {
+      bool binary_in;
+      Input ki(lda_mat_rspecifier, &binary_in);
+      lda_transform.Read(ki.Stream(), binary_in);
+    }
+
+    TransitionModel trans_model;
+    AmDiagGmm am_gmm;
+    {
+        bool binary;
+        Input ki(model_rspecifier, &binary);
+        trans_model.Read(ki.Stream(), binary);
+        am_gmm.Read(ki.Stream(), binary);
+    }
+    OnlineGselectIndex *gselect =
+        ReadGselectIndex(decodable_opts.gselect_rxfilename);
+    OnlineStackedGmm *stacked_gmm = NewStackedGmm(am_gmm, decodable_opts);
+
+    fst::Fst<fst::StdArc> *decode_fst = ReadDecodeGraph(fst_rspecifier);
+
+    MfccOptions mfcc_opts;
+    mfcc_opts.use_energy = false;
+    mfcc_opts.frame_opts.frame_length_ms = 25;
+    int32 frame_shift = mfcc_opts.frame_opts.frame_shift_ms = 10;
+
+    int32 window_size = right_context + left_context + 1;
+    decoder_opts.batch_size = std::max(decoder_opts.batch_size, window_size);
+
+    // The 1-best decoder is configured to search the same way, with a fixed
+    // beam.
+    OnlineFasterDecoderOpts one_best_opts;
+    one_best_opts.beam = decoder_opts.decoder_opts.beam;
+    one_best_opts.max_active = decoder_opts.decoder_opts.max_active;
+    one_best_opts.min_active = decoder_opts.decoder_opts.min_active;
+    one_best_opts.beam_delta = decoder_opts.decoder_opts.beam_delta;
+    one_best_opts.hash_ratio = decoder_opts.decoder_opts.hash_ratio;
+    one_best_opts.batch_size = decoder_opts.batch_size;
+    one_best_opts.inter_utt_sil = decoder_opts.inter_utt_sil;
+    one_best_opts.max_utt_len_ = decoder_opts.max_utt_len_;
+    one_best_opts.force_utt_len = decoder_opts.force_utt_len;
+    one_best_opts.beam_update = 0.0;
+
+    OnlineLatticeDecoder decoder(*decode_fst, decoder_opts,
+                                 silence_phones, trans_model);
+    OnlineFasterDecoder one_best_decoder(*decode_fst, one_best_opts,
+                                         silence_phones, trans_model);
+    one_best_decoder.SetFrameShift(frame_shift / 1000.0);
+
+    SequentialTableReader<WaveHolder> reader(wav_rspecifier);
+    CompactLattice clat;
+    double total_audio = 0.0, lattice_time = 0.0, one_best_time = 0.0;
+    int64 num_raw_arcs = 0, num_lattice_arcs = 0;
+    int32 num_utts = 0, num_failed = 0;
+    for (; !reader.Done(); reader.Next()) {
+      std::string wav_key = reader.Key();
+      const WaveData &wav_data = reader.Value();
+      if (wav_data.SampFreq() != 16000)
+        KALDI_ERR << "Sampling rates other than 16kHz are not supported!";
+      DecodingPipeline pipeline(wav_data.Data().Row(0), mfcc_opts, cmn_window,
+                                min_cmn_window, lda_transform, left_context,
+                                right_context, feature_reading_opts, am_gmm,
+                                trans_model, acoustic_scale, decodable_opts,
+                                gselect, stacked_gmm);
+      if (pipeline.decodable == NULL) {
+        KALDI_WARN << "No features for " << wav_key;
+        continue;
+      }
+      total_audio += wav_data.Duration();
+
+      Timer timer;
+      while (1) {
+        OnlineFasterDecoder::DecodeState dstate =
+            decoder.Decode(pipeline.decodable);
+        if (dstate & (OnlineFasterDecoder::kEndFeats |
+                      OnlineFasterDecoder::kEndUtt)) {
+          std::stringstream utt_key;
+          utt_key << wav_key << '_' << decoder.UtteranceStartFrame() << '-'
+                  << decoder.frame();
+          if (decoder.GetLattice(&clat)) {
+            lattice_writer.Write(utt_key.str(), clat);
+            num_raw_arcs += decoder.NumRawLatticeArcs();
+            for (CompactLatticeArc::StateId s = 0; s < clat.NumStates(); s++)
+              num_lattice_arcs += clat.NumArcs(s);
+            num_utts++;
+          } else {
+            num_failed++;
+          }
+          if (dstate == OnlineFasterDecoder::kEndFeats)
+            break;
+        }
+      }
+      lattice_time += timer.Elapsed();
+
+      if (compare_one_best) {
+        // A fresh pipeline, as the features were consumed by the first pass.
+        DecodingPipeline one_best_pipeline(
+            wav_data.Data().Row(0), mfcc_opts, cmn_window, min_cmn_window,
+            lda_transform, left_context, right_context, feature_reading_opts,
+            am_gmm, trans_model, acoustic_scale,
+            decodable_opts, gselect, stacked_gmm);
+        std::vector<int32> word_ids;
+        Timer one_best_timer;
+        while (1) {
+          OnlineFasterDecoder::DecodeState dstate =
+              one_best_decoder.Decode(one_best_pipeline.decodable);
+          if (dstate & (OnlineFasterDecoder::kEndFeats |
+                        OnlineFasterDecoder::kEndUtt)) {
+            one_best_decoder.FinishTraceBack(&word_ids);
+            if (dstate == OnlineFasterDecoder::kEndFeats)
+              break;
+          } else {
+            one_best_decoder.PartialTraceback(&word_ids);
+          }
+        }
+        one_best_time += one_best_timer.Elapsed();
+      }
+    }
+
+    KALDI_LOG << "Wrote " << num_utts << " lattices, failed for " << num_failed;
+    if (total_audio > 0.0) {
+      KALDI_LOG << "Lattice decoder: real-time factor " << lattice_time /
+          total_audio << ", " << num_raw_arcs / total_audio
+                << " raw lattice arcs and " << num_lattice_arcs / total_audio
+                << " determinized lattice arcs per second of audio.";
+      if (compare_one_best)
+        KALDI_LOG << "1-best decoder: real-time factor " << one_best_time /
+            total_audio << "; the lattice generation costs "
+                  << (one_best_time > 0.0 ?
+                      100.0 * (lattice_time / one_best_time - 1.0) : 0.0)
+                  << "% extra time.";
+    }
+    delete gselect;
+    delete stacked_gmm;
+    delete decode_fst;
+    return (num_utts != 0 ? 0 : 1);
+  } catch(const std::exception& e) {
+    std::cerr << e.what();
+    return -1;
+  }
+} // main()
@@ -0,0 +1,277 @@
+// onlinebin/online-wav-gmm-multi-decode-faster.cc
+
+// See ../../COPYING for clarification regarding multiple authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//  http://www.apache.org/licenses/LICENSE-2.0
+//
+// THIS CODE IS PROVIDED *AS IS* BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, EITHER EXPRESS OR IMPLIED, INCLUDING WITHOUT LIMITATION ANY IMPLIED
+// WARRANTIES OR CONDITIONS OF TITLE, FITNESS FOR A PARTICULAR PURPOSE,
+// MERCHANTABLITY OR NON-INFRINGEMENT.
+// See the Apache 2 License for the specific language governing permissions and
+// limitations under the License.
+
+#include "base/timer.h"
+#include "feat/feature-mfcc.h"
+#include "feat/wave-reader.h"
+#include "online/online-audio-source.h"
+#include "online/online-feat-input.h"
+#include "online/online-decodable.h"
+#include "online/online-multi-stream-decoder.h"
+#include "online/onlinebin-util.h"
+
+namespace kaldi {
+
+// Everything that is specific to one stream: the feature pipeline and the
+// decodable reading from it.
+struct DecodingStream {
+  typedef OnlineFeInput<Mfcc> FeInput;
+
+  DecodingStream(const std::string &key, const VectorBase<BaseFloat> &wave,
+                 const MfccOptions &mfcc_opts, int32 cmn_window,
+                 int32 min_cmn_window, const Matrix<BaseFloat> &lda_transform,
+                 int32 left_context, int32 right_context,
+                 const OnlineFeatureMatrixOptions &feature_reading_opts,
+                 const AmDiagGmm &am_gmm, const TransitionModel &trans_model,
+                 BaseFloat acoustic_scale,
+                 const OnlineDecodableOptions &decodable_opts,
+                 const OnlineGselectIndex *gselect,
+                 const OnlineStackedGmm *stacked_gmm):
+      key(key), au_src(wave), mfcc(mfcc_opts),
+      fe_input(&au_src, &mfcc,
+               mfcc_opts.frame_opts.frame_length_ms * 16,
+               mfcc_opts.frame_opts.frame_shift_ms * 16),
+      cmn_input(&fe_input, cmn_window, min_cmn_window),
+      feat_transform(NULL), feature_matrix(NULL), decodable(NULL),
+      start_frame(0), num_samples(wave.Dim()) {
+    if (lda_transform.NumRows() != 0) {
+      feat_transform = new OnlineLdaInput(&cmn_input, lda_transform,
+                                          left_context, right_context);
+    } else {
+      DeltaFeaturesOptions opts;
+      opts.order = 2;
+      feat_transform = new OnlineDeltaInput(opts, &cmn_input);
+    }
+    feature_matrix = new OnlineFeatureMatrix(feature_reading_opts,
+                                             feat_transform);
+    // The decodable can't be initialized with empty input; "decodable"
+    // stays NULL in that case.
+    if (feature_matrix->IsValidFrame(0))
+      decodable = new OnlineDecodableDiagGmmScaled(am_gmm, trans_model,
+                                                   acoustic_scale,
+                                                   feature_matrix,
+                                                   decodable_opts, gselect,
+                                                   stacked_gmm);
+  }
+
+  ~DecodingStream() {
+    delete decodable;
+    delete feature_matrix;
+    delete feat_transform;
+  }
+
+  std::string key;
+  OnlineVectorSource au_src;
+  Mfcc mfcc;
+  FeInput fe_input;
+  OnlineCmnInput cmn_input;
+  OnlineFeatInputItf *feat_transform;
+  OnlineFeatureMatrix *feature_matrix;
+  OnlineDecodableDiagGmmScaled *decodable;
+  int32 start_frame;
+  int32 num_samples;
+};
+
+}  // namespace kaldi
+
+int main(int argc, char *argv[]) {
+  try {
+    using namespace kaldi;
+    using namespace fst;
+
+    typedef kaldi::int32 int32;
+    typedef kaldi::int64 int64;
+
+    const char *usage =
+        "Decodes several wav files concurrently from a single thread, using\n"
+        "one OnlineFasterDecoder per stream over a shared decoding graph, and\n"
+        "reports the decoding throughput.  Useful for finding out how many\n"
+        "live streams one core can serve.  The streams advance together, one\n"
+        "frame at a time; with --batch-pdfs, their pdfs are scored together.\n"
+        "Feature splicing/LDA transform is used, if the optional(last) argument "
+        "is given.\n"
+        "Otherwise delta/delta-delta(i.e. 2-nd order) features are produced.\n\n"
+        "Usage: online-wav-gmm-multi-decode-faster [options] wav-rspecifier "
+        "model-in fst-in silence-phones transcript-wspecifier [lda-matrix-in]\n\n"
+        "Example: online-wav-gmm-multi-decode-faster --max-streams=200 "
+        "--max-active=2000 --beam=12.0 --acoustic-scale=0.0769 "
+        "scp:wav.scp model HCLG.fst '1:2:3:4:5' ark,t:trans.txt";
+    ParseOptions po(usage);
+    BaseFloat acoustic_scale = 0.1;
+    int32 cmn_window = 600, min_cmn_window = 100;
+    int32 right_context = 4, left_context = 4;
+
+    OnlineFasterDecoderOpts decoder_opts;
+    decoder_opts.Register(&po, true);
+    OnlineFeatureMatrixOptions feature_reading_opts;
+    feature_reading_opts.Register(&po);
+    OnlineDecodableOptions decodable_opts;
+    decodable_opts.Register(&po);
+    OnlineMultiStreamDecoderOpts multi_opts;
+    multi_opts.Register(&po);
+
+    po.Register("left-context", &left_context, "Number of frames of left context");
+    po.Register("right-context", &right_context, "Number of frames of right context");
+    po.Register("acoustic-scale", &acoustic_scale,
+                "Scaling factor for acoustic likelihoods");
+    po.Register("cmn-window", &cmn_window,
+        "Number of feat. vectors used in the running average CMN calculation");
+    po.Register("min-cmn-window", &min_cmn_window,
+                "Minumum CMN window used at start of decoding (adds "
+                "latency only at start)");
+    po.Read(argc, argv);
+    if (po.NumArgs() != 5 && po.NumArgs() != 6) {
+      po.PrintUsage();
+      return 1;
+    }
+
+    std::string wav_rspecifier = po.GetArg(1),
+        model_rspecifier = po.GetArg(2),
+        fst_rspecifier = po.GetArg(3),
+        silence_phones_str = po.GetArg(4),
+        words_wspecifier = po.GetArg(5),
+        lda_mat_rspecifier = po.GetOptArg(6);
+
+    std::vector<int32> silence_phones;
+    if (!SplitStringToIntegers(silence_phones_str, ":", false, &silence_phones))
+        KALDI_ERR << "Invalid silence-phones string " << silence_phones_str;
+    if (silence_phones.empty())
+        KALDI_ERR << "No silence phones given!";
+
+    Int32VectorWriter words_writer(words_wspecifier);
+
+    Matrix<BaseFloat> lda_transform;
+    if (lda_mat_rspecifier != "") {
+      bool binary_in;
+      Input ki(lda_mat_rspecifier, &binary_in);
+      lda_transform.Read(ki.Stream(), binary_in);
+    }
+
+    TransitionModel trans_model;
+    AmDiagGmm am_gmm;
+    {
+        bool binary;
+        Input ki(model_rspecifier, &binary);
+        trans_model.Read(ki.Stream(), binary);
+        am_gmm.Read(ki.Stream(), binary);
+    }
+    OnlineGselectIndex *gselect =
+        ReadGselectIndex(decodable_opts.gselect_rxfilename);
+    OnlineStackedGmm *stacked_gmm = NewStackedGmm(am_gmm, decodable_opts);
+
+    fst::Fst<fst::StdArc> *decode_fst = ReadDecodeGraph(fst_rspecifier);
+
+    MfccOptions mfcc_opts;
+    mfcc_opts.use_energy = false;
+    mfcc_opts.frame_opts.frame_length_ms = 25;
+    mfcc_opts.frame_opts.frame_shift_ms = 10;
+
+    int32 window_size = right_context + left_context + 1;
+    decoder_opts.batch_size = std::max(decoder_opts.batch_size, window_size);
+
+    OnlineMultiStreamDecoder decoder(*decode_fst, decoder_opts,
+                                     silence_phones, trans_model, multi_opts,
+                                     stacked_gmm);
+    SequentialTableReader<WaveHolder> reader(wav_rspecifier);
+    // Indexed by stream id.
+    std::vector<DecodingStream*> streams;
+    VectorFst<LatticeArc> out_fst;
+    std::vector<std::pair<int32, OnlineFasterDecoder::DecodeState> > events;
+    double total_audio = 0.0;
+    int32 max_concurrent = 0;
+    // The tokens the decoders created, and the allocations from the system
+    // this took.
+    int64 num_tokens = 0, num_token_slabs = 0;
+    Timer timer;
+    while (true) {
+      // Keep as many streams as we are allowed to open.
+      while (!reader.Done() && decoder.NumStreams() < multi_opts.max_streams) {
+        const WaveData &wav_data = reader.Value();
+        if (wav_data.SampFreq() != 16000)
+          KALDI_ERR << "Sampling rates other than 16kHz are not supported!";
+        DecodingStream *stream = new DecodingStream(
+            reader.Key(), wav_data.Data().Row(0), mfcc_opts, cmn_window,
+            min_cmn_window, lda_transform, left_context, right_context,
+            feature_reading_opts, am_gmm, trans_model, acoustic_scale,
+            decodable_opts, gselect, stacked_gmm);
+        total_audio += wav_data.Duration();
+        if (stream->decodable == NULL) {
+          KALDI_WARN << "No features for " << reader.Key();
+          delete stream;
+        } else {
+          int32 id = decoder.AddStream(stream->decodable);
+          if (id >= streams.size())
+            streams.resize(id + 1, NULL);
+          streams[id] = stream;
+        }
+        reader.Next();
+      }
+      max_concurrent = std::max(max_concurrent, decoder.NumStreams());
+      if (decoder.NumStreams() == 0)
+        break;
+
+      events.clear();
+      decoder.DecodeRound(&events);
+      for (size_t i = 0; i < events.size(); i++) {
+        int32 id = events[i].first;
+        OnlineFasterDecoder::DecodeState dstate = events[i].second;
+        if (!(dstate & (OnlineFasterDecoder::kEndFeats |
+                        OnlineFasterDecoder::kEndUtt)))
+          continue;
+        OnlineFasterDecoder *stream_decoder = decoder.Decoder(id);
+        DecodingStream *stream = streams[id];
+        std::vector<int32> word_ids;
+        stream_decoder->GetBestPath(&out_fst);
+        fst::GetLinearSymbolSequence(out_fst,
+                                     static_cast<vector<int32> *>(0),
+                                     &word_ids,
+                                     static_cast<LatticeArc::Weight*>(0));
+        std::stringstream res_key;
+        res_key << stream->key << '_' << stream->start_frame << '-'
+                << stream_decoder->frame();
+        if (!word_ids.empty())
+          words_writer.Write(res_key.str(), word_ids);
+        stream->start_frame = stream_decoder->frame();
+        if (dstate == OnlineFasterDecoder::kEndFeats) {
+          num_tokens += stream_decoder->NumTokensAllocated();
+          num_token_slabs += stream_decoder->NumTokenSlabs();
+          decoder.RemoveStream(id);
+          delete stream;
+          streams[id] = NULL;
+        }
+      }
+    }
+    double elapsed = timer.Elapsed();
+    KALDI_LOG << "Decoded " << total_audio << " seconds of audio in "
+              << elapsed << " seconds, using up to " << max_concurrent
+              << " concurrent streams; real-time factor is "
+              << (total_audio > 0.0 ? elapsed / total_audio : 0.0)
+              << ", decoder throughput " << decoder.FramesPerSecond()
+              << " frames/sec.";
+    KALDI_LOG << num_tokens << " tokens were created using "
+              << num_token_slabs << " memory allocations ("
+              << (num_token_slabs > 0 ? num_tokens / num_token_slabs : 0)
+              << " tokens per allocation).";
+    delete gselect;
+    delete stacked_gmm;
+    delete decode_fst;
+    return 0;
+  } catch(const std::exception& e) {
+    std::cerr << e.what();
+    return -1;
+  }
+} // main()